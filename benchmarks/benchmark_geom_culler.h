@@ -0,0 +1,80 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+#include "simulant/nodes/geoms/octree_culler.h"
+
+namespace {
+
+using namespace smlt;
+
+class GeomCullerBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    /* A level made of BOXES * BOXES small boxes, alternating between two materials */
+    const static uint32_t BOXES = 16;
+
+    void set_up() {
+        SimulantBenchmarkCase::set_up();
+
+        stage_ = window->new_stage();
+        camera_ = stage_->new_camera();
+        camera_->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+
+        auto mat1 = stage_->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+        auto mat2 = stage_->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+
+        mesh_ = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        for(uint32_t z = 0; z < BOXES; ++z) {
+            for(uint32_t x = 0; x < BOXES; ++x) {
+                mesh_->new_submesh_as_box(
+                    _F("box_{0}_{1}").format(x, z),
+                    ((x + z) % 2) ? mat1 : mat2,
+                    1.0, 1.0, 1.0,
+                    Vec3((float(x) - 8.0f) * 3.0f, 0, -10.0f - (float(z) * 3.0f))
+                );
+            }
+        }
+    }
+
+    void tear_down() {
+        window->destroy_stage(stage_->id());
+        SimulantBenchmarkCase::tear_down();
+    }
+
+    void bench_compile() {
+        for(auto merge: {false, true}) {
+            measure((merge) ? "merged" : "plain", [&]() {
+                OctreeCuller culler(nullptr, mesh_, 5, merge);
+                culler.compile(Vec3(), Quaternion());
+            }, BOXES * BOXES, "boxes");
+        }
+    }
+
+    void bench_gather() {
+        for(auto merge: {false, true}) {
+            GeomCullerOptions options;
+            options.merge_by_material = merge;
+            auto geom = stage_->new_geom_with_mesh(mesh_->id(), options);
+
+            batcher::RenderQueue queue;
+            queue.reset(stage_, window->renderer.get(), camera_);
+
+            measure((merge) ? "merged" : "plain", [&]() {
+                queue.clear();
+                geom->culler->renderables_visible(camera_->frustum(), &queue);
+            }, BOXES * BOXES, "boxes");
+
+            auto& stats = geom->culler->last_gather_stats();
+            std::cout << _F("    cells visited: {0}, renderables: {1}").format(
+                stats.cells_visited, stats.renderables_emitted
+            ) << std::endl;
+        }
+    }
+
+private:
+    StagePtr stage_;
+    CameraPtr camera_;
+    MeshPtr mesh_;
+};
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+#include "simulant/renderers/batching/light_grid.h"
+
+namespace {
+
+using namespace smlt;
+
+class LightAssignmentBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    const static uint32_t LIGHT_COUNT = 200;
+    const static uint32_t ACTOR_COUNT = 5000;
+
+    void set_up() {
+        SimulantBenchmarkCase::set_up();
+
+        stage_ = window->new_stage();
+        camera_ = stage_->new_camera();
+        camera_->set_perspective_projection(Degrees(45.0), 4.0 / 3.0, 0.1, 500.0);
+
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_box("box", stage_->assets->new_material(), 1.0f, 1.0f, 1.0f);
+
+        for(uint32_t i = 0; i < LIGHT_COUNT; ++i) {
+            auto light = stage_->new_light_as_point(random_position(), Colour::WHITE);
+            light->set_attenuation_from_range(random().float_in_range(5.0f, 20.0f));
+            lights_.push_back(light);
+        }
+
+        for(uint32_t i = 0; i < ACTOR_COUNT; ++i) {
+            auto actor = stage_->new_actor_with_mesh(mesh->id());
+            actor->move_to(random_position());
+            actors_.push_back(actor);
+        }
+
+        stage_->partitioner->_apply_writes();
+    }
+
+    void tear_down() {
+        lights_.clear();
+        actors_.clear();
+        window->destroy_stage(stage_->id());
+    }
+
+    Vec3 random_position() {
+        auto z = random().float_in_range(-400.0f, -1.0f);
+        return Vec3(
+            random().float_in_range(z * 0.4f, -z * 0.4f),
+            random().float_in_range(z * 0.3f, -z * 0.3f),
+            z
+        );
+    }
+
+    void bench_every_light() {
+        uint64_t affected = 0;
+
+        measure("", [&]() {
+            for(auto actor: actors_) {
+                auto aabb = actor->transformed_aabb();
+                for(auto& light: lights_) {
+                    if(aabb.intersects_sphere(light->absolute_position(), light->range() * 2)) {
+                        ++affected;
+                    }
+                }
+            }
+        }, ACTOR_COUNT, "actors");
+
+        assert_true(affected > 0u);
+    }
+
+    void bench_light_grid() {
+        batcher::LightGrid grid;
+        std::vector<uint32_t> candidates;
+        uint64_t affected = 0;
+
+        measure("", [&]() {
+            grid.build(camera_->view_matrix(), camera_->projection_matrix(), &lights_[0], lights_.size());
+
+            for(auto actor: actors_) {
+                auto aabb = actor->transformed_aabb();
+
+                candidates.resize(0);
+                grid.lights_for(aabb, candidates);
+
+                for(auto i: candidates) {
+                    auto& light = lights_[i];
+                    if(aabb.intersects_sphere(light->absolute_position(), light->range() * 2)) {
+                        ++affected;
+                    }
+                }
+            }
+        }, ACTOR_COUNT, "actors");
+
+        assert_true(affected > 0u);
+    }
+
+    void bench_prepare() {
+        PipelineID pipeline = window->render(stage_, camera_);
+        auto sequence = window->render_sequence();
+
+        measure("", [&]() {
+            sequence->prepare();
+            sequence->finish();
+            window->frame_arena->reset();
+        }, ACTOR_COUNT, "actors");
+
+        window->destroy_pipeline(pipeline);
+    }
+
+private:
+    StagePtr stage_;
+    CameraPtr camera_;
+
+    std::vector<LightPtr> lights_;
+    std::vector<ActorPtr> actors_;
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+
+namespace {
+
+using namespace smlt;
+
+class LoaderBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    /* Size of the file on disk, so the rate comes out in bytes/s */
+    double file_size(const std::string& filename) {
+        auto stream = window->vfs->open_file(filename);
+        stream->seekg(0, std::ios::end);
+        return (double) stream->tellg();
+    }
+
+    /* Assets are destroyed and collected straight away so memory stays flat
+     * however many iterations are run */
+    void bench_obj_mesh() {
+        const std::string filename = "cube.obj";
+
+        measure(filename, [&]() {
+            auto id = window->shared_assets->new_mesh_from_file(filename)->id();
+            window->shared_assets->destroy_mesh(id);
+            window->shared_assets->run_garbage_collection();
+        }, file_size(filename), "bytes");
+    }
+
+    void bench_png_texture() {
+        const std::string filename = "crate.png";
+
+        measure(filename, [&]() {
+            auto id = window->shared_assets->new_texture_from_file(filename)->id();
+            window->shared_assets->destroy_texture(id);
+            window->shared_assets->run_garbage_collection();
+        }, file_size(filename), "bytes");
+    }
+
+    void bench_particle_script() {
+        const std::string filename = ParticleScript::BuiltIns::FIRE;
+
+        measure("fire", [&]() {
+            auto id = window->shared_assets->new_particle_script_from_file(filename)->id();
+            window->shared_assets->destroy_particle_script(id);
+            window->shared_assets->run_garbage_collection();
+        }, file_size(filename), "bytes");
+    }
+};
+
+}
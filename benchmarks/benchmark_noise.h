@@ -0,0 +1,89 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+#include "simulant/utils/noise.h"
+#include "simulant/utils/simplex.h"
+#include "simulant/threads/thread_pool.h"
+
+namespace {
+
+using namespace smlt;
+
+class NoiseBenchmarks : public smlt::test::BenchmarkCase {
+public:
+    /* A 256x256 patch of terrain, sampled 64 times per unit like the terrain sample */
+    const static uint32_t SIZE = 256;
+
+    void set_up() {
+        BenchmarkCase::set_up();
+
+        grid_ = noise::Grid(Vec3(), Vec3(1.0f / 64.0f, 1.0f / 64.0f, 0.0f), SIZE, SIZE);
+        out_.resize(grid_.size());
+    }
+
+    void bench_perlin() {
+        noise::Perlin perlin(seed());
+
+        measure("scalar", [&]() {
+            for(uint32_t z = 0; z < SIZE; ++z) {
+                for(uint32_t x = 0; x < SIZE; ++x) {
+                    out_[(z * SIZE) + x] = perlin.noise(x / 64.0, z / 64.0);
+                }
+            }
+        }, grid_.size(), "samples");
+
+        measure("batch", [&]() {
+            perlin.fill(grid_, &out_[0]);
+        }, grid_.size(), "samples");
+    }
+
+    void bench_perlin_octave() {
+        noise::PerlinOctave perlin(4, seed());
+
+        measure("scalar", [&]() {
+            for(uint32_t z = 0; z < SIZE; ++z) {
+                for(uint32_t x = 0; x < SIZE; ++x) {
+                    out_[(z * SIZE) + x] = perlin.noise(x / 64.0, z / 64.0);
+                }
+            }
+        }, grid_.size(), "samples");
+
+        measure("batch", [&]() {
+            perlin.fill(grid_, &out_[0]);
+        }, grid_.size(), "samples");
+    }
+
+    void bench_simplex() {
+        Simplex simplex(seed());
+
+        measure("scalar", [&]() {
+            for(uint32_t z = 0; z < SIZE; ++z) {
+                for(uint32_t x = 0; x < SIZE; ++x) {
+                    out_[(z * SIZE) + x] = simplex.noise(x / 64.0, z / 64.0);
+                }
+            }
+        }, grid_.size(), "samples");
+
+        measure("batch", [&]() {
+            simplex.fill(grid_, &out_[0]);
+        }, grid_.size(), "samples");
+    }
+
+    void bench_perlin_octave_threaded() {
+        thread::ThreadPool pool(thread::ThreadPool::hardware_concurrency() - 1);
+        skip_if(!pool.worker_count(), "Needs more than one core");
+
+        noise::PerlinOctave perlin(4, seed());
+
+        measure("", [&]() {
+            perlin.fill(grid_, &out_[0], &pool);
+        }, grid_.size(), "samples");
+    }
+
+private:
+    noise::Grid grid_;
+    std::vector<float> out_;
+};
+
+}
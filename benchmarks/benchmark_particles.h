@@ -0,0 +1,53 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+
+namespace {
+
+using namespace smlt;
+
+class ParticleBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    void set_up() {
+        SimulantBenchmarkCase::set_up();
+        stage_ = window->new_stage();
+    }
+
+    void tear_down() {
+        window->destroy_stage(stage_->id());
+    }
+
+    void bench_fire_update() {
+        const uint32_t SYSTEM_COUNT = 10;
+
+        auto script = stage_->assets->new_particle_script_from_file(ParticleScript::BuiltIns::FIRE);
+
+        std::vector<ParticleSystemPtr> systems;
+        for(uint32_t i = 0; i < SYSTEM_COUNT; ++i) {
+            auto ps = stage_->new_particle_system(script);
+            ps->move_to(random().point_in_sphere(50.0f));
+            systems.push_back(ps);
+        }
+
+        const float step = 1.0f / 60.0f;
+
+        // Let the emitters reach a steady state before timing
+        for(uint32_t i = 0; i < 120; ++i) {
+            for(auto ps: systems) {
+                ps->update(step);
+            }
+        }
+
+        measure("", [&]() {
+            for(auto ps: systems) {
+                ps->update(step);
+            }
+        }, SYSTEM_COUNT, "systems");
+    }
+
+private:
+    StagePtr stage_;
+};
+
+}
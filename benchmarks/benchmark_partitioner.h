@@ -0,0 +1,79 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+
+namespace {
+
+using namespace smlt;
+
+class PartitionerBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    const static uint32_t ACTOR_COUNT = 2000;
+
+    StagePtr populate(AvailablePartitioner partitioner, std::vector<ActorPtr>* actors=nullptr) {
+        auto stage = window->new_stage(partitioner);
+
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_box("box", stage->assets->new_material(), 1.0f, 1.0f, 1.0f);
+
+        for(uint32_t i = 0; i < ACTOR_COUNT; ++i) {
+            auto actor = stage->new_actor_with_mesh(mesh->id());
+            actor->move_to(
+                random().float_in_range(-250.0f, 250.0f),
+                random().float_in_range(-50.0f, 50.0f),
+                random().float_in_range(-250.0f, 250.0f)
+            );
+
+            if(actors) {
+                actors->push_back(actor);
+            }
+        }
+
+        stage->partitioner->_apply_writes();
+        return stage;
+    }
+
+    void query(const std::string& label, AvailablePartitioner partitioner) {
+        auto stage = populate(partitioner);
+
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(45.0), 4.0 / 3.0, 0.1, 500.0);
+        stage->partitioner->_apply_writes();
+
+        std::vector<LightID> lights;
+        std::vector<StageNode*> nodes;
+
+        measure(label, [&]() {
+            lights.clear();
+            nodes.clear();
+            stage->partitioner->lights_and_geometry_visible_from(camera->id(), lights, nodes);
+        }, ACTOR_COUNT, "actors");
+
+        window->destroy_stage(stage->id());
+    }
+
+    void bench_frustum_query() {
+        query("frustum", PARTITIONER_FRUSTUM);
+    }
+
+    void bench_spatial_hash_query() {
+        query("hash", PARTITIONER_HASH);
+    }
+
+    void bench_moving_actors() {
+        std::vector<ActorPtr> actors;
+        auto stage = populate(PARTITIONER_HASH, &actors);
+
+        measure("", [&]() {
+            for(auto actor: actors) {
+                actor->move_by(0.1f, 0.0f, 0.0f);
+            }
+            stage->partitioner->_apply_writes();
+        }, actors.size(), "actors");
+
+        window->destroy_stage(stage->id());
+    }
+};
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+
+namespace {
+
+using namespace smlt;
+
+class PhysicsBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    static const uint32_t BODY_COUNT = 2000;
+
+    void set_up() {
+        SimulantBenchmarkCase::set_up();
+        stage_ = window->new_stage();
+
+        physics_ = behaviours::RigidBodySimulation::create(window->time_keeper);
+
+        auto ground = stage_->new_actor();
+        auto floor = ground->new_behaviour<behaviours::StaticBody>(physics_.get());
+        floor->add_box_collider(Vec3(200, 1, 200), behaviours::PhysicsMaterial::STONE);
+
+        /* Columns of boxes dropped onto the floor, so that there are plenty
+         * of contacts once they land */
+        for(uint32_t i = 0; i < BODY_COUNT; ++i) {
+            auto actor = stage_->new_actor();
+            actor->move_to(
+                random().float_in_range(-50.0f, 50.0f),
+                2.0f + (i % 20) * 1.5f,
+                random().float_in_range(-50.0f, 50.0f)
+            );
+
+            auto body = actor->new_behaviour<behaviours::RigidBody>(physics_.get());
+            body->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+            bodies_.push_back(body);
+        }
+
+        // Let the boxes land, it's the piles we want to measure
+        for(uint32_t i = 0; i < 120; ++i) {
+            physics_->fixed_update(STEP);
+        }
+    }
+
+    void tear_down() {
+        physics_->set_threaded_stepping(false);
+        window->destroy_stage(stage_->id());
+        bodies_.clear();
+        physics_.reset();
+        SimulantBenchmarkCase::tear_down();
+    }
+
+    /* Stepping, then moving every stage node to its body */
+    void frame() {
+        physics_->fixed_update(STEP);
+
+        for(auto body: bodies_) {
+            body->update(STEP);
+        }
+
+        physics_->wait();
+    }
+
+    void bench_step_2000_bodies() {
+        measure("inline", [&]() {
+            frame();
+        }, BODY_COUNT, "bodies");
+    }
+
+    /* The step runs while the nodes are moved to the last results */
+    void bench_step_2000_bodies_threaded() {
+        physics_->set_threaded_stepping(true);
+        skip_if(!physics_->is_threaded_stepping(), "Needs more than one core");
+
+        measure("threaded", [&]() {
+            frame();
+        }, BODY_COUNT, "bodies");
+    }
+
+    void bench_raycasts() {
+        const uint32_t RAY_COUNT = 1000;
+
+        std::vector<Ray> rays;
+        for(uint32_t i = 0; i < RAY_COUNT; ++i) {
+            auto start = Vec3(random().float_in_range(-50.0f, 50.0f), 40.0f, random().float_in_range(-50.0f, 50.0f));
+            rays.push_back(Ray(start, Vec3(0, -50.0f, 0)));
+        }
+
+        measure("single", [&]() {
+            for(auto& ray: rays) {
+                physics_->intersect_ray(ray.start, ray.dir);
+            }
+        }, RAY_COUNT, "rays");
+
+        std::vector<behaviours::RayHit> hits(RAY_COUNT);
+        measure("batched", [&]() {
+            physics_->intersect_rays(&rays[0], rays.size(), &hits[0]);
+        }, RAY_COUNT, "rays");
+    }
+
+private:
+    const float STEP = 1.0f / 60.0f;
+
+    StagePtr stage_;
+    behaviours::PhysicsSimulationPtr physics_;
+    std::vector<behaviours::RigidBody*> bodies_;
+};
+
+}
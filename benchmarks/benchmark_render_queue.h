@@ -0,0 +1,132 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+
+namespace {
+
+using namespace smlt;
+
+class BenchmarkRenderGroupFactory : public batcher::RenderGroupFactory {
+public:
+    batcher::RenderGroupKey prepare_render_group(
+        batcher::RenderGroup*,
+        const Renderable*,
+        const MaterialPass*,
+        const uint8_t pass_number,
+        const bool is_blended,
+        const float distance_to_camera) override {
+
+        return batcher::generate_render_group_key(pass_number, is_blended, distance_to_camera);
+    }
+};
+
+class CountingVisitor : public batcher::RenderQueueVisitor {
+public:
+    void start_traversal(const batcher::RenderQueue&, uint64_t, Stage*) override {}
+    void change_render_group(const batcher::RenderGroup*, const batcher::RenderGroup*) override { ++group_changes; }
+    void change_material_pass(const MaterialPass*, const MaterialPass*) override { ++pass_changes; }
+    void apply_lights(const LightState* const*, const uint8_t) override {}
+    void end_traversal(const batcher::RenderQueue&, Stage*) override {}
+
+    void visit(const Renderable*, const MaterialPass*, batcher::Iteration) override {
+        ++visits;
+    }
+
+    void visit_instanced(const Renderable* const*, std::size_t count, const MaterialPass*, batcher::Iteration) override {
+        visits += count;
+    }
+
+    uint64_t visits = 0;
+    uint64_t group_changes = 0;
+    uint64_t pass_changes = 0;
+};
+
+class RenderQueueBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    const static uint32_t RENDERABLE_COUNT = 5000;
+    const static uint32_t MESH_COUNT = 8;
+
+    void set_up() {
+        SimulantBenchmarkCase::set_up();
+        stage_ = window->new_stage();
+        camera_ = stage_->new_camera();
+
+        for(uint32_t i = 0; i < MESH_COUNT; ++i) {
+            auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+            mesh->new_submesh_as_rectangle("rect", stage_->assets->new_material(), 1.0f, 1.0f);
+            meshes_.push_back(mesh);
+        }
+
+        for(uint32_t i = 0; i < RENDERABLE_COUNT; ++i) {
+            auto mesh = meshes_[random().int_in_range(0, MESH_COUNT - 1)];
+            auto submesh = mesh->first_submesh();
+
+            Vec3 position(
+                random().float_in_range(-100.0f, 100.0f),
+                random().float_in_range(-100.0f, 100.0f),
+                random().float_in_range(-200.0f, -1.0f)
+            );
+
+            Renderable r;
+            r.vertex_data = mesh->vertex_data.get();
+            r.index_data = submesh->index_data.get();
+            r.index_element_count = submesh->index_data->count();
+            r.material = submesh->material().get();
+            r.final_transformation = Mat4::as_translation(position);
+            r.centre = position;
+            renderables_.push_back(r);
+        }
+    }
+
+    void tear_down() {
+        renderables_.clear();
+        meshes_.clear();
+        window->destroy_stage(stage_->id());
+    }
+
+    void fill(batcher::RenderQueue& queue) {
+        queue.reset(stage_, &factory_, camera_);
+        for(auto& r: renderables_) {
+            queue.insert_renderable(Renderable(r));
+        }
+    }
+
+    void bench_insertion() {
+        batcher::RenderQueue queue;
+
+        measure("", [&]() {
+            fill(queue);
+        }, RENDERABLE_COUNT, "renderables");
+    }
+
+    void bench_traversal() {
+        batcher::RenderQueue queue;
+        fill(queue);
+
+        CountingVisitor visitor;
+        uint64_t frame = 0;
+
+        measure("instanced", [&]() {
+            queue.traverse(&visitor, frame++);
+        }, RENDERABLE_COUNT, "renderables");
+
+        queue.set_instancing_enabled(false);
+
+        measure("individual", [&]() {
+            queue.traverse(&visitor, frame++);
+        }, RENDERABLE_COUNT, "renderables");
+
+        assert_true(visitor.visits > 0u);
+    }
+
+private:
+    StagePtr stage_;
+    CameraPtr camera_;
+    BenchmarkRenderGroupFactory factory_;
+
+    std::vector<MeshPtr> meshes_;
+    std::vector<Renderable> renderables_;
+};
+
+}
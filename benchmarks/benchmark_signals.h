@@ -0,0 +1,195 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+#include "simulant/threads/atomic.h"
+#include "simulant/signals/ring_buffer.h"
+
+namespace {
+
+using namespace smlt;
+
+/*
+ * The signal as it was before slots were stored inline: a std::function and
+ * a shared connection record per slot, kept in a lock-free list. Only what's
+ * needed to connect, emit and disconnect is kept, so the two can be compared.
+ */
+namespace legacy {
+
+class LegacySignalBase;
+
+struct ConnectionImpl {
+    ConnectionImpl(LegacySignalBase* parent, size_t id):
+        id(id),
+        parent(parent) {}
+
+    size_t id;
+    LegacySignalBase* parent;
+};
+
+class LegacySignalBase {
+public:
+    virtual ~LegacySignalBase() {}
+    virtual bool disconnect(const ConnectionImpl& conn) = 0;
+};
+
+class Connection {
+public:
+    Connection(std::shared_ptr<ConnectionImpl> impl):
+        impl_(impl) {}
+
+    bool disconnect() {
+        auto p = impl_.lock();
+        return p && p->parent->disconnect(*p);
+    }
+
+private:
+    std::weak_ptr<ConnectionImpl> impl_;
+};
+
+template<typename> class Signal;
+
+template<typename R, typename... Args>
+class Signal<R (Args...)> : public LegacySignalBase {
+public:
+    typedef std::function<R (Args...)> callback;
+
+    Signal() {
+        connection_counter_ = 0;
+    }
+
+    Connection connect(const callback& func) {
+        connection_counter_++;
+        auto conn_impl = std::make_shared<ConnectionImpl>(this, connection_counter_);
+        links_.push_back({func, conn_impl});
+        return Connection(conn_impl);
+    }
+
+    void operator()(Args... args) {
+        for(auto& link: links_) {
+            link.func(args...);
+        }
+    }
+
+    bool disconnect(const ConnectionImpl& conn_impl) override {
+        auto size = links_.size();
+
+        for(auto it = links_.begin(); it != links_.end();) {
+            if((*it).conn_impl.get() == &conn_impl) {
+                it = links_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        return size != links_.size();
+    }
+
+private:
+    thread::Atomic<size_t> connection_counter_ = {0};
+
+    struct Link {
+        callback func;
+        std::shared_ptr<ConnectionImpl> conn_impl;
+    };
+
+    threadsafe::ring_buffer<Link> links_;
+};
+
+typedef Signal<void (const AABB&)> BoundsUpdatedSignal;
+
+}
+
+class SignalBenchmarks : public smlt::test::BenchmarkCase {
+public:
+    /* Roughly one signal per node in a busy stage */
+    const static uint32_t SIGNAL_COUNT = 1000;
+
+    /* Like Stage::new_actor(), which connects a lambda to each new node */
+    template<typename Signal>
+    void connect(const std::string& label) {
+        uint32_t id = 1;
+        uint32_t calls = 0;
+
+        measure(label, [&]() {
+            std::unique_ptr<Signal[]> signals(new Signal[SIGNAL_COUNT]);
+            for(uint32_t i = 0; i < SIGNAL_COUNT; ++i) {
+                signals[i].connect([&calls, id](const AABB&) {
+                    calls += id;
+                });
+            }
+        }, SIGNAL_COUNT, "connections");
+
+        _S_UNUSED(calls);
+    }
+
+    void bench_connect() {
+        /* What each signal adds to a node, and what a node weighs overall */
+        char line[256];
+        snprintf(
+            line, sizeof(line),
+            "    sizeof(BoundsUpdatedSignal) legacy %u bytes, current %u bytes, sizeof(Actor) %u bytes",
+            (uint32_t) sizeof(legacy::BoundsUpdatedSignal),
+            (uint32_t) sizeof(BoundsUpdatedSignal),
+            (uint32_t) sizeof(Actor)
+        );
+        std::cout << line << std::endl;
+
+        connect<legacy::BoundsUpdatedSignal>("legacy");
+        connect<BoundsUpdatedSignal>("current");
+    }
+
+    template<typename Signal>
+    void connect_disconnect(const std::string& label) {
+        Signal signal;
+
+        measure(label, [&]() {
+            for(uint32_t i = 0; i < SIGNAL_COUNT; ++i) {
+                auto conn = signal.connect([](const AABB&) {});
+                conn.disconnect();
+            }
+        }, SIGNAL_COUNT, "connections");
+    }
+
+    void bench_connect_disconnect() {
+        connect_disconnect<legacy::BoundsUpdatedSignal>("legacy");
+        connect_disconnect<BoundsUpdatedSignal>("current");
+    }
+
+    template<typename Signal>
+    void emit(const std::string& label, uint32_t slots) {
+        std::unique_ptr<Signal[]> signals(new Signal[SIGNAL_COUNT]);
+
+        uint32_t calls = 0;
+        for(uint32_t i = 0; i < SIGNAL_COUNT; ++i) {
+            for(uint32_t j = 0; j < slots; ++j) {
+                signals[i].connect([&calls](const AABB&) {
+                    ++calls;
+                });
+            }
+        }
+
+        AABB bounds(Vec3(-1, -1, -1), Vec3(1, 1, 1));
+
+        measure(_F("{0}_{1}_slots").format(label, slots), [&]() {
+            for(uint32_t i = 0; i < SIGNAL_COUNT; ++i) {
+                signals[i](bounds);
+            }
+        }, SIGNAL_COUNT, "emits");
+
+        _S_UNUSED(calls);
+    }
+
+    /* Two slots fit inline, more spill into the overflow storage */
+    void bench_emit() {
+        for(uint32_t slots: {1u, 2u, 4u}) {
+            emit<legacy::BoundsUpdatedSignal>("legacy", slots);
+            emit<BoundsUpdatedSignal>("current", slots);
+        }
+    }
+};
+
+}
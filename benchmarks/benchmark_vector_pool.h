@@ -0,0 +1,101 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+#include "simulant/generic/manual_manager.h"
+
+namespace {
+
+using namespace smlt;
+
+class PooledObject;
+
+typedef smlt::default_init_ptr<PooledObject> PooledObjectPtr;
+typedef smlt::UniqueID<PooledObjectPtr> PooledObjectID;
+
+class PooledObject {
+public:
+    PooledObjectID id_;
+    float data[16];
+
+    PooledObject(PooledObjectID id): id_(id) {}
+
+    bool init() { return true; }
+    void clean_up() {}
+    void _bind_id_pointer(PooledObject*) {}
+};
+
+typedef smlt::ManualManager<PooledObject, PooledObjectID> PooledObjectManager;
+
+class VectorPoolBenchmarks : public smlt::test::SimulantBenchmarkCase {
+public:
+    const uint32_t LIVE_COUNT = 20000;
+    const uint32_t CHURN_COUNT = 100;
+
+    /* Spawning and destroying a handful of objects in a pool which is
+     * already large, like bullets in a busy stage */
+    void bench_pool_churn() {
+        PooledObjectManager manager;
+
+        std::vector<PooledObjectID> ids;
+        for(uint32_t i = 0; i < LIVE_COUNT; ++i) {
+            ids.push_back(manager.make()->id_);
+        }
+
+        measure("", [&]() {
+            for(uint32_t i = 0; i < CHURN_COUNT; ++i) {
+                auto idx = random().int_in_range(0, ids.size() - 1);
+                manager.destroy(ids[idx]);
+                manager.clean_up();
+                ids[idx] = manager.make()->id_;
+            }
+        }, CHURN_COUNT, "objects");
+    }
+
+    void bench_pool_iteration() {
+        PooledObjectManager manager;
+
+        std::vector<PooledObjectID> ids;
+        for(uint32_t i = 0; i < LIVE_COUNT; ++i) {
+            ids.push_back(manager.make()->id_);
+        }
+
+        // Leave holes, iteration shouldn't have to visit them
+        for(uint32_t i = 0; i < LIVE_COUNT; i += 2) {
+            manager.destroy(ids[i]);
+        }
+        manager.clean_up();
+
+        float total = 0.0f;
+        measure("", [&]() {
+            for(auto obj: manager._each()) {
+                total += obj->data[0];
+            }
+        }, manager.size(), "objects");
+
+        _S_UNUSED(total);
+    }
+
+    void bench_actor_churn() {
+        auto stage = window->new_stage();
+
+        std::vector<ActorID> ids;
+        for(uint32_t i = 0; i < LIVE_COUNT; ++i) {
+            ids.push_back(stage->new_actor()->id());
+        }
+
+        measure("", [&]() {
+            for(uint32_t i = 0; i < CHURN_COUNT; ++i) {
+                auto idx = random().int_in_range(0, ids.size() - 1);
+                stage->destroy_actor(ids[idx]);
+                ids[idx] = stage->new_actor()->id();
+            }
+
+            stage->clean_up_dead_objects();
+        }, CHURN_COUNT, "actors");
+
+        window->destroy_stage(stage->id());
+    }
+};
+
+}
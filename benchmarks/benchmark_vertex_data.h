@@ -0,0 +1,73 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/benchmark.h"
+
+namespace {
+
+using namespace smlt;
+
+class VertexDataBenchmarks : public smlt::test::BenchmarkCase {
+public:
+    const static uint32_t VERTEX_COUNT = 10000;
+
+    void set_up() {
+        BenchmarkCase::set_up();
+
+        for(uint32_t i = 0; i < VERTEX_COUNT; ++i) {
+            positions_.push_back(random().point_in_sphere(100.0f));
+        }
+    }
+
+    void bench_position_writes() {
+        VertexData data(VertexSpecification::POSITION_ONLY);
+
+        measure("", [&]() {
+            data.clear();
+            for(auto& p: positions_) {
+                data.position(p);
+                data.move_next();
+            }
+            data.done();
+        }, VERTEX_COUNT, "vertices");
+    }
+
+    void bench_full_vertex_writes() {
+        VertexData data(VertexSpecification::DEFAULT);
+
+        measure("", [&]() {
+            data.clear();
+            for(auto& p: positions_) {
+                data.position(p);
+                data.normal(Vec3::POSITIVE_Y);
+                data.tex_coord0(p.x, p.z);
+                data.diffuse(Colour::WHITE);
+                data.move_next();
+            }
+            data.done();
+        }, VERTEX_COUNT, "vertices");
+    }
+
+    void bench_rewrite_in_place() {
+        VertexData data(VertexSpecification::DEFAULT);
+        for(auto& p: positions_) {
+            data.position(p);
+            data.move_next();
+        }
+        data.done();
+
+        measure("", [&]() {
+            data.move_to_start();
+            for(auto& p: positions_) {
+                data.position(p);
+                data.move_next();
+            }
+            data.done();
+        }, VERTEX_COUNT, "vertices");
+    }
+
+private:
+    std::vector<Vec3> positions_;
+};
+
+}
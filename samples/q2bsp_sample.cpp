@@ -4,13 +4,26 @@
 
 using namespace smlt;
 
+//Needed because the Quake 2 coord system is weird
+static Mat4 quake_to_simulant() {
+    Mat4 rotation_x = Mat4::as_rotation_x(Degrees(-90));
+    Mat4 rotation_y = Mat4::as_rotation_y(Degrees(90.0f));
+    return rotation_y * rotation_x;
+}
+
+struct VisibleCounts {
+    uint32_t renderables = 0;
+    uint32_t triangles = 0;
+    uint64_t time_us = 0;
+};
+
 class GameScene : public smlt::Scene<GameScene> {
 public:
     GameScene(smlt::Window* window):
         smlt::Scene<GameScene>(window) {}
 
     void load() {
-        stage_ = window->new_stage(smlt::PARTITIONER_FRUSTUM);
+        stage_ = window->new_stage(smlt::PARTITIONER_BSP);
         camera_ = stage_->new_camera();
         pipeline_ = window->render(stage_, camera_).as_pipeline();
 
@@ -21,7 +34,10 @@ public:
         window->vfs->add_search_path("sample_data/quake2/textures");
 
         auto mesh = stage_->assets->new_mesh_from_file("sample_data/quake2/maps/demo1.bsp");
-        stage_->new_geom_with_mesh(mesh->id());
+
+        smlt::GeomCullerOptions culler_options;
+        culler_options.type = smlt::GEOM_CULLER_TYPE_BSP;
+        stage_->new_geom_with_mesh(mesh->id(), culler_options);
 
         yield_coroutine();
 
@@ -32,18 +48,13 @@ public:
                 auto position = ent["origin"];
                 std::vector<unicode> coords = _u(position).split(" ");
 
-                //Needed because the Quake 2 coord system is weird
-                Mat4 rotation_x = Mat4::as_rotation_x(Degrees(-90));
-                Mat4 rotation_y = Mat4::as_rotation_y(Degrees(90.0f));
-                Mat4 rotation = rotation_y * rotation_x;
-
                 smlt::Vec3 pos(
                     coords[0].to_float(),
                     coords[1].to_float(),
                     coords[2].to_float()
                 );
 
-                pos = pos.rotated_by(rotation);
+                pos = pos.rotated_by(quake_to_simulant());
                 camera_->move_to_absolute(pos);
             }
 
@@ -62,19 +73,143 @@ public:
 
         stage_->new_light_as_directional();
         yield_coroutine();
+
+        if(app->args->arg_value<bool>("benchmark", false).value()) {
+            run_benchmark(mesh, entities);
+        }
     }
 
 private:
     StagePtr stage_;
     CameraPtr camera_;
     PipelinePtr pipeline_;
+
+    VisibleCounts count_visible(StagePtr stage, CameraPtr camera, uint32_t iterations) {
+        VisibleCounts counts;
+        batcher::RenderQueue queue;
+
+        auto start = TimeKeeper::now_in_us();
+
+        for(uint32_t i = 0; i < iterations; ++i) {
+            std::vector<LightID> lights;
+            std::vector<StageNode*> nodes;
+
+            stage->partitioner->_apply_writes();
+            stage->partitioner->lights_and_geometry_visible_from(camera->id(), lights, nodes);
+
+            queue.reset(stage, window->renderer.get(), camera);
+            for(auto node: nodes) {
+                node->_get_renderables(&queue, camera, DETAIL_LEVEL_NEAREST);
+            }
+        }
+
+        counts.time_us = (TimeKeeper::now_in_us() - start) / iterations;
+        counts.renderables = queue.renderable_count();
+
+        for(uint32_t i = 0; i < queue.renderable_count(); ++i) {
+            counts.triangles += queue.renderable(i)->index_element_count / 3;
+        }
+
+        return counts;
+    }
+
+    /*
+     * Compares what the BSP partitioner submits for rendering against the
+     * spatial hash partitioner (with the default octree geom culler), from
+     * every entity in the map that has an origin.
+     */
+    void run_benchmark(MeshPtr mesh, Q2EntityList& entities) {
+        const uint32_t iterations = 20;
+
+        auto hash_stage = window->new_stage(smlt::PARTITIONER_HASH);
+        auto hash_camera = hash_stage->new_camera();
+        hash_stage->new_geom_with_mesh(mesh->id());
+
+        for(auto& camera: {camera_, hash_camera}) {
+            camera->set_perspective_projection(
+                Degrees(45.0),
+                float(window->width()) / float(window->height()),
+                1.0,
+                1000.0
+            );
+        }
+
+        auto start_position = camera_->absolute_position();
+        auto start_rotation = camera_->absolute_rotation();
+
+        VisibleCounts bsp_total, hash_total;
+        uint32_t views = 0;
+
+        for(auto& ent: entities) {
+            if(!ent.count("origin")) {
+                continue;
+            }
+
+            std::vector<unicode> coords = _u(ent["origin"]).split(" ");
+            if(coords.size() != 3) {
+                continue;
+            }
+
+            smlt::Vec3 pos(coords[0].to_float(), coords[1].to_float(), coords[2].to_float());
+            pos = pos.rotated_by(quake_to_simulant());
+
+            /* Look in four directions from each point */
+            for(int angle = 0; angle < 360; angle += 90) {
+                auto rotation = Quaternion(Vec3::POSITIVE_Y, Degrees(angle));
+
+                camera_->move_to_absolute(pos);
+                camera_->rotate_to_absolute(rotation);
+                hash_camera->move_to_absolute(pos);
+                hash_camera->rotate_to_absolute(rotation);
+
+                auto bsp = count_visible(stage_, camera_, iterations);
+                auto hash = count_visible(hash_stage, hash_camera, iterations);
+
+                bsp_total.renderables += bsp.renderables;
+                bsp_total.triangles += bsp.triangles;
+                bsp_total.time_us += bsp.time_us;
+
+                hash_total.renderables += hash.renderables;
+                hash_total.triangles += hash.triangles;
+                hash_total.time_us += hash.time_us;
+
+                ++views;
+            }
+        }
+
+        window->destroy_stage(hash_stage->id());
+
+        camera_->move_to_absolute(start_position);
+        camera_->rotate_to_absolute(start_rotation);
+
+        if(!views) {
+            L_WARN("No entities with an origin to benchmark from");
+            return;
+        }
+
+        auto report = [views](const std::string& name, const VisibleCounts& total) {
+            L_INFO(_F("{0}: {1} renderables, {2} triangles, {3}us per view (average over {4} views)").format(
+                name,
+                total.renderables / views,
+                total.triangles / views,
+                total.time_us / views,
+                views
+            ));
+        };
+
+        report("BSPPartitioner", bsp_total);
+        report("SpatialHashPartitioner", hash_total);
+    }
 };
 
 
 class Q2Sample: public smlt::Application {
 public:
     Q2Sample(const smlt::AppConfig& config):
-        smlt::Application(config) {}
+        smlt::Application(config) {
+
+        args->define_arg("--benchmark", smlt::ARG_TYPE_BOOLEAN, "log what the BSP and spatial hash partitioners submit for rendering");
+    }
 
 private:
     bool init() {
@@ -1,5 +1,7 @@
 #include "simulant/simulant.h"
 #include "simulant/scenes/loading.h"
+#include "simulant/utils/noise.h"
+#include "simulant/threads/thread_pool.h"
 
 using namespace smlt;
 
@@ -8,26 +10,80 @@ inline T clamp(T x, T a = 0, T b = 1) {
     return x < a ? a : (x > b ? b : x);
 }
 
-void calculate_splat_map(int width, int length, TexturePtr texture, VertexData& vertices) {
+/* The heightmap in sample_data is only 423x378, so we stretch it over a 4k map
+ * and add some smaller hills on top */
+const uint32_t TERRAIN_SIZE = 4096;
+
+std::vector<float> generate_heights(TexturePtr heightmap) {
+    std::vector<float> heights(TERRAIN_SIZE * TERRAIN_SIZE);
+
+    auto& pixels = heightmap->data();
+    auto stride = heightmap->bytes_per_pixel();
+    int32_t width = heightmap->width();
+    int32_t height = heightmap->height();
+
+    auto pixel = [&](int32_t x, int32_t z) -> float {
+        x = clamp(x, 0, width - 1);
+        z = clamp(z, 0, height - 1);
+        return float(pixels[((z * width) + x) * stride]) / 256.0f;
+    };
+
+    noise::PerlinOctave detail(4);
+
+    thread::ThreadPool pool(thread::ThreadPool::hardware_concurrency() - 1);
+    pool.parallel_for(TERRAIN_SIZE, 16, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> row_detail(TERRAIN_SIZE);
+
+        for(auto z = begin; z < end; ++z) {
+            noise::Grid row(Vec3(0, z / 64.0f, 0), Vec3(1.0f / 64.0f, 0, 0), TERRAIN_SIZE, 1);
+            detail.fill(row, &row_detail[0]);
+
+            for(uint32_t x = 0; x < TERRAIN_SIZE; ++x) {
+                float u = (float(x) / float(TERRAIN_SIZE)) * float(width - 1);
+                float v = (float(z) / float(TERRAIN_SIZE)) * float(height - 1);
+
+                int32_t px = u, pz = v;
+                float fx = u - px, fz = v - pz;
+
+                float top = pixel(px, pz) + (pixel(px + 1, pz) - pixel(px, pz)) * fx;
+                float bottom = pixel(px, pz + 1) + (pixel(px + 1, pz + 1) - pixel(px, pz + 1)) * fx;
+                float h = top + (bottom - top) * fz;
+
+                h += 0.04f * row_detail[x];
+                heights[(z * TERRAIN_SIZE) + x] = clamp(h, 0.0f, 1.0f);
+            }
+        }
+    });
+
+    return heights;
+}
+
+void calculate_splat_map(int width, int length, TexturePtr texture, const TerrainData& terrain) {
     texture->resize(width, length);
     texture->mutate_data([&](uint8_t* data, uint16_t, uint16_t, TextureFormat) {
-        for(uint32_t i = 0; i < vertices.count(); ++i) {
-            auto n = vertices.normal_at<Vec3>(i);
+        for(int32_t j = 0; j < length; ++j) {
+            for(int32_t i = 0; i < width; ++i) {
+                int32_t x = (i * terrain.x_size) / width;
+                int32_t z = (j * terrain.z_size) / length;
+
+                auto n = terrain.normal(x, z);
 
-            Degrees steepness = Radians(acos(n->dot(Vec3(0, 1, 0))));
-            float height = (vertices.position_at<Vec3>(i)->y + 64.0f) / 128.0f;
+                Degrees steepness = Radians(acos(n.dot(Vec3(0, 1, 0))));
+                float height = (terrain.height(x, z) - terrain.min_height) / (terrain.max_height - terrain.min_height);
 
-            float rock = clamp(steepness.value / 45.0f);
-            float sand = clamp(1.0f - (height * 4.0f));
-            float grass = (sand > 0.5f) ? 0.0f : 0.5f;
-            float snow = height * clamp(n->z);
+                float rock = clamp(steepness.value / 45.0f);
+                float sand = clamp(1.0f - (height * 4.0f));
+                float grass = (sand > 0.5f) ? 0.0f : 0.5f;
+                float snow = height * clamp(n.z);
 
-            float z = rock + sand + grass + snow;
+                float total = rock + sand + grass + snow;
 
-            data[i * 4] = 255.0f * (sand / z);
-            data[(i * 4) + 1] = 255.0f * (grass / z);
-            data[(i * 4) + 2] = 255.0f * (rock / z);
-            data[(i * 4) + 3] = 255.0f * (snow / z);
+                auto pixel = data + (((j * width) + i) * 4);
+                pixel[0] = 255.0f * (sand / total);
+                pixel[1] = 255.0f * (grass / total);
+                pixel[2] = 255.0f * (rock / total);
+                pixel[3] = 255.0f * (snow / total);
+            }
         }
     });
 }
@@ -57,13 +113,13 @@ public:
         link_pipeline(pipeline_);
 
         camera_->set_perspective_projection(
-            Degrees(45.0), float(window->width()) / float(window->height()), 10.0, 10000.0
+            Degrees(45.0), float(window->width()) / float(window->height()), 1.0, 10000.0
         );
 
         pipeline_->viewport->set_colour(smlt::Colour::SKY_BLUE);
 
         auto cam = camera_;
-        cam->move_to(0, 50, 700);
+        cam->move_to(0, 400, 2200);
         cam->look_at(0, 0, 0);
 
         cam->new_behaviour<smlt::behaviours::Fly>(window);
@@ -72,19 +128,29 @@ public:
         terrain_material_id_ = terrain_material;
 
         smlt::HeightmapSpecification spec;
-        spec.smooth_iterations = 0;
+        spec.min_height = -100.0f;
+        spec.max_height = 250.0f;
+        spec.spacing = 1.0f;
+        spec.texcoord0_repeat = 256.0f;
 
-        terrain_mesh_id_ = stage_->assets->new_mesh_from_heightmap("sample_data/terrain.png", spec);
-        auto terrain_mesh = stage_->assets->mesh(terrain_mesh_id_);
+        /* Far too big for a single mesh, so only the heights are kept and the
+         * Geom builds the chunks it needs as the camera moves around */
+        spec.generate_mesh = false;
+
+        smlt::TextureFlags flags;
+        flags.auto_upload = false;
+        flags.flip_vertically = true;
+
+        auto heightmap = stage_->assets->new_texture_from_file("sample_data/terrain.png", flags);
+        auto heights = generate_heights(heightmap);
+        stage_->assets->destroy_texture(heightmap->id());
+
+        auto terrain_mesh = stage_->assets->new_mesh_from_heights(TERRAIN_SIZE, TERRAIN_SIZE, heights, spec);
+        terrain_mesh_id_ = terrain_mesh;
 
         auto terrain_data = terrain_mesh->data->get<smlt::TerrainData>("terrain_data");
-        auto terrain_splatmap = stage_->assets->new_texture(terrain_data.x_size, terrain_data.z_size);
-        calculate_splat_map(
-            terrain_data.x_size,
-            terrain_data.z_size,
-            terrain_splatmap,
-            terrain_mesh->vertex_data
-        );
+        auto terrain_splatmap = stage_->assets->new_texture(1024, 1024);
+        calculate_splat_map(1024, 1024, terrain_splatmap, terrain_data);
 
         terrain_material->pass(0)->set_property_value(
             terrain_material->find_property_id("textures[4]"),
@@ -93,22 +159,20 @@ public:
 
         terrain_mesh->set_material(terrain_material);
 
-        terrain_actor_ = stage_->new_actor_with_mesh(terrain_mesh_id_);
+        smlt::GeomCullerOptions options;
+        options.type = smlt::GEOM_CULLER_TYPE_TERRAIN;
+        terrain_geom_ = stage_->new_geom_with_mesh(terrain_mesh_id_, options);
 
         done = true;
     }
 
-    void fixed_update(float dt) override {
-        terrain_actor_->rotate_global_y_by(smlt::Degrees(dt * 5.0f));
-    }
-
 private:
     PipelinePtr pipeline_;
     StagePtr stage_;
     CameraPtr camera_;
 
     MeshID terrain_mesh_id_;
-    ActorPtr terrain_actor_;
+    GeomPtr terrain_geom_;
     MaterialID terrain_material_id_;
 
     TextureID terrain_textures_[4];
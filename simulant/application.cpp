@@ -30,12 +30,18 @@ namespace smlt { typedef SDL2Window SysWindow; }
 #endif
 
 #include "application.h"
+#include "headless_window.h"
+#include "time_keeper.h"
 #include "scenes/loading.h"
 #include "input/input_state.h"
+#include "renderers/null/null_renderer.h"
 
 #define SIMULANT_PROFILE_KEY "SIMULANT_PROFILE"
 #define SIMULANT_SHOW_CURSOR_KEY "SIMULANT_SHOW_CURSOR"
 #define SIMULANT_DEBUG_KEY "SIMULANT_DEBUG"
+#define SIMULANT_HEADLESS_KEY "SIMULANT_HEADLESS"
+#define SIMULANT_FRAME_COUNT_KEY "SIMULANT_FRAME_COUNT"
+#define SIMULANT_PIPELINED_KEY "SIMULANT_PIPELINED"
 
 namespace smlt {
 
@@ -55,8 +61,22 @@ Application::Application(const AppConfig &config):
         std::getenv(SIMULANT_PROFILE_KEY) != NULL
     );
 
-    /* Remove frame limiting in profiling mode */
-    if(PROFILING) {
+    if(std::getenv(SIMULANT_HEADLESS_KEY)) {
+        config_.development.headless = true;
+    }
+
+    if(std::getenv(SIMULANT_PIPELINED_KEY)) {
+        config_.general.pipelined_rendering = true;
+    }
+
+    const char* frame_count = std::getenv(SIMULANT_FRAME_COUNT_KEY);
+    if(frame_count) {
+        config_.development.frame_count = std::strtoul(frame_count, nullptr, 10);
+    }
+
+    /* Remove frame limiting in profiling mode, or if there's no
+     * window to show frames in */
+    if(PROFILING || config_.development.headless) {
         config_.enable_vsync = false;
         config_.target_frame_rate = 0;
     }
@@ -74,7 +94,7 @@ void Application::construct_window(const AppConfig& config) {
     AppConfig config_copy = config;
 
     /* If we're profiling, disable the frame time and vsync */
-    if(PROFILING) {
+    if(PROFILING || config_.development.headless) {
         config_copy.target_frame_rate = std::numeric_limits<uint16_t>::max();
         config_copy.enable_vsync = false;
     }
@@ -91,6 +111,7 @@ void Application::construct_window(const AppConfig& config) {
 
     smlt::get_logger("/")->add_handler(smlt::Handler::ptr(new smlt::StdIOHandler));
     smlt::get_logger("/")->set_level(config_copy.log_level);
+    smlt::get_logger("/")->set_async(config_copy.async_logging);
 
     L_DEBUG("Constructing the window");
 
@@ -103,14 +124,25 @@ void Application::construct_window(const AppConfig& config) {
         }
     }
 
-    window_ = SysWindow::create(
-        this,
-        config_copy.width,
-        config_copy.height,
-        config_copy.bpp,
-        config_copy.fullscreen,
-        config_copy.enable_vsync
-    );
+    if(config_.development.headless) {
+        window_ = HeadlessWindow::create(
+            this,
+            config_copy.width,
+            config_copy.height,
+            config_copy.bpp,
+            config_copy.fullscreen,
+            config_copy.enable_vsync
+        );
+    } else {
+        window_ = SysWindow::create(
+            this,
+            config_copy.width,
+            config_copy.height,
+            config_copy.bpp,
+            config_copy.fullscreen,
+            config_copy.enable_vsync
+        );
+    }
 
     if(!window_) {
         L_ERROR("[FATAL] There was an error creating the window");
@@ -154,6 +186,7 @@ void Application::construct_window(const AppConfig& config) {
     }
 
     window_->set_title(config.title.encode());
+    window_->set_pipelined_rendering(config_.general.pipelined_rendering);
 
     /* FIXME: This is weird, the Application owns the Window, yet we're using the Window to call up to the App?
      * Not sure how to fix this without substantial changes to the frame running code */
@@ -226,7 +259,28 @@ int32_t Application::run() {
         return 1;
     }
 
-    while(window_->run_frame()) {}
+    const uint32_t frame_count = config_.development.frame_count;
+
+    if(frame_count) {
+        std::vector<uint64_t> frame_times;
+        frame_times.reserve(frame_count);
+
+        bool running = true;
+        while(running) {
+            /* Stopping takes effect at the end of the next frame */
+            if(frame_times.size() + 1 == frame_count) {
+                window_->stop_running();
+            }
+
+            auto start = TimeKeeper::now_in_us();
+            running = window_->run_frame();
+            frame_times.push_back(TimeKeeper::now_in_us() - start);
+        }
+
+        print_frame_report(frame_times);
+    } else {
+        while(window_->run_frame()) {}
+    }
 
     /* Make sure we unload and destroy all scenes */
     scene_manager_->destroy_all();
@@ -243,6 +297,9 @@ int32_t Application::run() {
 
     window_.reset();
 
+    // Write out anything still sitting in the log buffer
+    smlt::flush_logs();
+
 #ifdef _arch_dreamcast
     if(PROFILING) {
         profiler_stop();
@@ -267,4 +324,45 @@ int32_t Application::run(int argc, char* argv[]) {
     return ret;
 }
 
+void Application::print_frame_report(const std::vector<uint64_t>& frame_times_us) {
+    if(frame_times_us.empty()) {
+        return;
+    }
+
+    /* The first frame includes a lot of one-off work so it's reported on its own */
+    std::vector<uint64_t> sorted(frame_times_us.begin() + 1, frame_times_us.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&sorted](float p) -> float {
+        std::size_t i = std::min(sorted.size() - 1, std::size_t(p * float(sorted.size())));
+        return float(sorted[i]) / 1000.0f;
+    };
+
+    std::cout << "First frame time: " << float(frame_times_us[0]) / 1000.0f << "ms" << std::endl;
+
+    if(!sorted.empty()) {
+        uint64_t total = 0;
+        for(auto t: sorted) {
+            total += t;
+        }
+
+        std::cout << "Frame time (mean): " << (float(total) / float(sorted.size())) / 1000.0f << "ms" << std::endl;
+        std::cout << "Frame time (p50): " << percentile(0.5f) << "ms" << std::endl;
+        std::cout << "Frame time (p90): " << percentile(0.9f) << "ms" << std::endl;
+        std::cout << "Frame time (p99): " << percentile(0.99f) << "ms" << std::endl;
+        std::cout << "Frame time (max): " << float(sorted.back()) / 1000.0f << "ms" << std::endl;
+    }
+
+    auto headless = dynamic_cast<HeadlessWindow*>(window_.get());
+    if(headless) {
+        auto stats = headless->null_renderer()->total_stats();
+        float frames = float(frame_times_us.size());
+
+        std::cout << "Draw calls per frame: " << float(stats.draw_calls) / frames << std::endl;
+        std::cout << "Renderables per frame: " << float(stats.renderables_drawn) / frames << std::endl;
+        std::cout << "State changes per frame: " << float(stats.render_group_changes + stats.material_pass_changes + stats.light_changes) / frames << std::endl;
+        std::cout << "Bytes uploaded: " << stats.bytes_uploaded << std::endl;
+    }
+}
+
 }
@@ -67,11 +67,18 @@ struct AppConfig {
 
     smlt::LogLevel log_level = smlt::LOG_LEVEL_WARN;
 
+    /* If true, log messages are written by a background thread rather
+     * than the thread that logged them */
+    bool async_logging = true;
+
     /* If set to true, the mouse cursor will not be hidden by default */
     bool show_cursor = false;
 
     struct General {
-
+        /* If true, each frame is drawn while the next one is updated on
+         * another thread. See Window::set_pipelined_rendering(). Can also be
+         * enabled with SIMULANT_PIPELINED=1 */
+        bool pipelined_rendering = false;
     } general;
 
     struct Desktop {
@@ -99,6 +106,16 @@ struct AppConfig {
             FIXME: Not yet working
         */
         std::string force_renderer = "";
+
+        /* If true, no window is opened and nothing is really drawn or
+         * played. Time advances one fixed step per frame and there is no
+         * frame limit. Can also be enabled with SIMULANT_HEADLESS=1 */
+        bool headless = false;
+
+        /* If non-zero the application exits after this many frames and
+         * prints a report of how long they took on the CPU. Can also be
+         * set with SIMULANT_FRAME_COUNT */
+        uint32_t frame_count = 0;
     } development;
 };
 
@@ -170,6 +187,8 @@ private:
     AppConfig config_;
     void construct_window(const AppConfig& config);
 
+    void print_frame_report(const std::vector<uint64_t>& frame_times_us);
+
     ArgParser args_;
 };
 
@@ -21,7 +21,9 @@
 #include "asset_manager.h"
 #include "loader.h"
 #include "procedural/mesh.h"
+#include "meshes/mesh_optimizer.h"
 #include "utils/gl_thread_check.h"
+#include "renderers/renderer.h"
 
 /** FIXME
  *
@@ -212,6 +214,41 @@ MeshPtr AssetManager::new_mesh_from_submesh(SubMesh* submesh, GarbageCollectMeth
     return result;
 }
 
+/* The nearest attribute to attr that the renderer can draw */
+static VertexAttribute drawable_attribute(const Renderer* renderer, VertexAttribute attr) {
+    if(!renderer || renderer->supports_vertex_attribute(attr)) {
+        return attr;
+    }
+
+    switch(attr) {
+        case VERTEX_ATTRIBUTE_2H:
+        case VERTEX_ATTRIBUTE_2US:
+            return VERTEX_ATTRIBUTE_2F;
+        case VERTEX_ATTRIBUTE_4H:
+            return VERTEX_ATTRIBUTE_4F;
+        case VERTEX_ATTRIBUTE_4B:
+            return VERTEX_ATTRIBUTE_3F;
+        default:
+            return attr;
+    }
+}
+
+static VertexSpecification drawable_specification(const Renderer* renderer, VertexSpecification spec) {
+    spec.position_attribute = drawable_attribute(renderer, spec.position_attribute);
+    spec.normal_attribute = drawable_attribute(renderer, spec.normal_attribute);
+    spec.texcoord0_attribute = drawable_attribute(renderer, spec.texcoord0_attribute);
+    spec.texcoord1_attribute = drawable_attribute(renderer, spec.texcoord1_attribute);
+    spec.texcoord2_attribute = drawable_attribute(renderer, spec.texcoord2_attribute);
+    spec.texcoord3_attribute = drawable_attribute(renderer, spec.texcoord3_attribute);
+    spec.texcoord4_attribute = drawable_attribute(renderer, spec.texcoord4_attribute);
+    spec.texcoord5_attribute = drawable_attribute(renderer, spec.texcoord5_attribute);
+    spec.texcoord6_attribute = drawable_attribute(renderer, spec.texcoord6_attribute);
+    spec.texcoord7_attribute = drawable_attribute(renderer, spec.texcoord7_attribute);
+    spec.diffuse_attribute = drawable_attribute(renderer, spec.diffuse_attribute);
+    spec.specular_attribute = drawable_attribute(renderer, spec.specular_attribute);
+    return spec;
+}
+
 MeshPtr AssetManager::new_mesh_from_file(
     const unicode& path,
     const VertexSpecification& desired_specification,
@@ -228,6 +265,36 @@ MeshPtr AssetManager::new_mesh_from_file(
 
     loader->into(mesh, loader_options);
 
+    if(options.optimize) {
+        auto stats = MeshOptimizer().optimize(mesh);
+        L_DEBUG(_F("Optimized {0}: {1} -> {2} vertices, ACMR {3} -> {4}, {5} bytes saved").format(
+            path, stats.vertices_before, stats.vertices_after,
+            stats.acmr_before, stats.acmr_after, stats.bytes_saved()
+        ));
+    }
+
+    if(options.repack_specification.has_positions()) {
+        if(mesh->is_animated()) {
+            L_WARN(_F("Not repacking {0} as it's animated").format(path));
+        } else {
+            auto before = mesh->vertex_data->data_size();
+            auto stride = mesh->vertex_data->stride();
+
+            /* Fall back to floats for anything the renderer can't draw */
+            auto spec = drawable_specification(window->renderer.get(), options.repack_specification);
+            if(spec != options.repack_specification) {
+                L_WARN(_F("Repacking {0} with float attributes in place of unsupported ones").format(path));
+            }
+
+            mesh->vertex_data->repack(spec);
+            mesh->vertex_data->done();
+
+            L_DEBUG(_F("Repacked {0}: {1} -> {2} bytes per vertex, {3} -> {4} bytes").format(
+                path, stride, mesh->vertex_data->stride(), before, mesh->vertex_data->data_size()
+            ));
+        }
+    }
+
     mesh_manager_.set_garbage_collection_method(mesh->id(), garbage_collect);
     return mesh;
 }
@@ -255,6 +322,15 @@ MeshPtr AssetManager::new_mesh_from_heightmap(const unicode& image_file, const H
     return mesh;
 }
 
+MeshPtr AssetManager::new_mesh_from_heights(uint32_t x_size, uint32_t z_size, const std::vector<float>& heights, const HeightmapSpecification& spec, GarbageCollectMethod garbage_collect) {
+    auto mesh = new_mesh(VertexSpecification::DEFAULT, GARBAGE_COLLECT_NEVER);
+
+    terrain::build_terrain(mesh.get(), x_size, z_size, heights, spec);
+    mesh_manager_.set_garbage_collection_method(mesh->id(), garbage_collect);
+
+    return mesh;
+}
+
 MeshPtr AssetManager::new_mesh_from_vertices(VertexSpecification vertex_specification, const std::string& submesh_name, const std::vector<Vec2> &vertices, MeshArrangement arrangement, GarbageCollectMethod garbage_collect) {
     auto mesh = new_mesh(vertex_specification, GARBAGE_COLLECT_NEVER);
     auto submesh = mesh->new_submesh(submesh_name, arrangement);
@@ -0,0 +1,231 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cassert>
+
+#include "audio_stream.h"
+
+namespace smlt {
+
+PCMRingBuffer::PCMRingBuffer(std::size_t chunk_count, std::size_t chunk_bytes):
+    data_(chunk_count * chunk_bytes),
+    sizes_(chunk_count, 0),
+    chunk_bytes_(chunk_bytes) {
+
+    assert(chunk_count);
+}
+
+uint8_t* PCMRingBuffer::begin_write() {
+    uint64_t slot = 0;
+
+    {
+        thread::Lock<thread::Mutex> g(lock_);
+        if(written_ - read_ == sizes_.size()) {
+            return nullptr;
+        }
+
+        slot = written_ % sizes_.size();
+    }
+
+    return &data_[slot * chunk_bytes_];
+}
+
+void PCMRingBuffer::end_write(std::size_t bytes) {
+    assert(bytes <= chunk_bytes_);
+
+    thread::Lock<thread::Mutex> g(lock_);
+    sizes_[written_ % sizes_.size()] = bytes;
+    ++written_;
+}
+
+const uint8_t* PCMRingBuffer::begin_read(std::size_t* bytes) {
+    uint64_t slot = 0;
+
+    {
+        thread::Lock<thread::Mutex> g(lock_);
+        if(written_ == read_) {
+            return nullptr;
+        }
+
+        slot = read_ % sizes_.size();
+        *bytes = sizes_[slot];
+    }
+
+    return &data_[slot * chunk_bytes_];
+}
+
+void PCMRingBuffer::end_read() {
+    thread::Lock<thread::Mutex> g(lock_);
+    assert(written_ != read_);
+    ++read_;
+}
+
+std::size_t PCMRingBuffer::ready_count() const {
+    thread::Lock<thread::Mutex> g(lock_);
+    return written_ - read_;
+}
+
+AudioStream::AudioStream(AudioDataFormat format, uint32_t sample_rate, std::size_t chunk_bytes, std::size_t chunk_count):
+    ring_(chunk_count, chunk_bytes),
+    format_(format),
+    sample_rate_(sample_rate) {
+
+}
+
+int32_t AudioStream::queue_buffer(SoundDriver* driver, AudioBufferID buffer) {
+    std::size_t bytes = 0;
+    const uint8_t* data = ring_.begin_read(&bytes);
+
+    if(!data) {
+        /* Only count the first miss, the caller will keep asking until the
+         * decoder catches up */
+        if(!starving_) {
+            starving_ = true;
+            ++underrun_count_;
+        }
+
+        return STREAM_NOT_READY;
+    }
+
+    starving_ = false;
+
+    if(!bytes) {
+        /* End of stream marker, it's left in the ring so that every subsequent
+         * call also returns 0 */
+        return 0;
+    }
+
+    driver->upload_buffer_data(buffer, format_, data, bytes, sample_rate_);
+    ring_.end_read();
+
+    if(thread_) {
+        thread_->wake();
+    }
+
+    return bytes;
+}
+
+bool AudioStream::fill() {
+    if(decoded_all_) {
+        return false;
+    }
+
+    uint8_t* out = ring_.begin_write();
+    if(!out) {
+        return false;
+    }
+
+    std::size_t bytes = decode(out, ring_.chunk_bytes());
+    decoded_all_ = (bytes == 0);
+    ring_.end_write(bytes);
+    return true;
+}
+
+void AudioStream::prime(std::size_t count) {
+    while(count--) {
+        if(!fill()) {
+            break;
+        }
+    }
+}
+
+AudioStreamThread::AudioStreamThread() {
+    thread_.reset(new thread::Thread(&AudioStreamThread::run, this));
+}
+
+AudioStreamThread::~AudioStreamThread() {
+    {
+        thread::Lock<thread::Mutex> g(wake_lock_);
+        running_ = false;
+        wake_condition_.notify_one();
+    }
+
+    thread_->join();
+}
+
+void AudioStreamThread::add(std::shared_ptr<AudioStream> stream) {
+    {
+        thread::Lock<thread::Mutex> g(streams_lock_);
+        stream->thread_ = this;
+        streams_.push_back(stream);
+    }
+
+    wake();
+}
+
+void AudioStreamThread::remove(std::shared_ptr<AudioStream> stream) {
+    /* The audio thread holds this lock while it decodes, so once we have it the
+     * stream is no longer in use and the last reference is dropped on this
+     * thread rather than that one */
+    thread::Lock<thread::Mutex> g(streams_lock_);
+    streams_.erase(std::remove(streams_.begin(), streams_.end(), stream), streams_.end());
+    stream->thread_ = nullptr;
+}
+
+void AudioStreamThread::wake() {
+    thread::Lock<thread::Mutex> g(wake_lock_);
+    wake_pending_ = true;
+    wake_condition_.notify_one();
+}
+
+std::size_t AudioStreamThread::stream_count() const {
+    thread::Lock<thread::Mutex> g(streams_lock_);
+    return streams_.size();
+}
+
+void AudioStreamThread::run() {
+    while(true) {
+        bool busy = false;
+
+        {
+            thread::Lock<thread::Mutex> g(streams_lock_);
+            for(auto& stream: streams_) {
+                busy = stream->fill() || busy;
+            }
+        }
+
+        thread::Lock<thread::Mutex> g(wake_lock_);
+
+        /* Everything is full, sleep until a chunk is consumed or a stream
+         * is added */
+        while(!busy && !wake_pending_ && running_) {
+            wake_condition_.wait(wake_lock_);
+        }
+
+        wake_pending_ = false;
+
+        if(!running_) {
+            break;
+        }
+    }
+}
+
+AudioStreamHandle::AudioStreamHandle(std::shared_ptr<AudioStreamThread> thread, std::shared_ptr<AudioStream> stream):
+    thread_(thread),
+    stream_(stream) {
+
+    thread_->add(stream_);
+}
+
+AudioStreamHandle::~AudioStreamHandle() {
+    thread_->remove(stream_);
+}
+
+}
@@ -0,0 +1,173 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "sound_driver.h"
+#include "threads/mutex.h"
+#include "threads/condition.h"
+#include "threads/thread.h"
+
+namespace smlt {
+
+/* Returned from a StreamFunc when the decoder hasn't caught up with playback
+ * yet. The buffer should be offered again on the next update */
+const int32_t STREAM_NOT_READY = -1;
+
+/*
+ * A fixed set of preallocated PCM chunks handed from a single producer (the
+ * audio thread) to a single consumer (the main thread, which uploads them to
+ * the SoundDriver). Each side only ever touches the chunk at its own counter,
+ * so the lock is only held to move a counter - never while decoding or
+ * uploading.
+ */
+class PCMRingBuffer {
+public:
+    PCMRingBuffer(std::size_t chunk_count, std::size_t chunk_bytes);
+
+    /* Producer side, returns nullptr if every chunk is still waiting to be read */
+    uint8_t* begin_write();
+    void end_write(std::size_t bytes);
+
+    /* Consumer side, returns nullptr if nothing has been decoded yet */
+    const uint8_t* begin_read(std::size_t* bytes);
+    void end_read();
+
+    std::size_t chunk_bytes() const { return chunk_bytes_; }
+    std::size_t chunk_count() const { return sizes_.size(); }
+
+    /* The number of chunks decoded but not yet read */
+    std::size_t ready_count() const;
+
+private:
+    std::vector<uint8_t> data_;
+    std::vector<std::size_t> sizes_;
+    std::size_t chunk_bytes_;
+
+    mutable thread::Mutex lock_;
+    uint64_t written_ = 0;
+    uint64_t read_ = 0;
+};
+
+class AudioStreamThread;
+
+/*
+ * A source of PCM data which is decoded ahead of playback on the audio
+ * thread. Subclasses only need to implement decode().
+ */
+class AudioStream {
+public:
+    static const std::size_t DEFAULT_CHUNK_COUNT = 4;
+
+    AudioStream(AudioDataFormat format, uint32_t sample_rate, std::size_t chunk_bytes, std::size_t chunk_count=DEFAULT_CHUNK_COUNT);
+    virtual ~AudioStream() {}
+
+    /* Called from the main thread. Uploads the next decoded chunk into buffer and
+     * returns the number of bytes uploaded, 0 if the stream has finished, or
+     * STREAM_NOT_READY if the decoder has fallen behind */
+    int32_t queue_buffer(SoundDriver* driver, AudioBufferID buffer);
+
+    /* Decodes a single chunk if there is space for one. Returns false if there
+     * was nothing to do */
+    bool fill();
+
+    /* Decodes up to count chunks immediately, so that playback can start
+     * without waiting for the audio thread */
+    void prime(std::size_t count);
+
+    /* The number of times queue_buffer() was called with nothing ready */
+    uint32_t underrun_count() const { return underrun_count_; }
+
+    const PCMRingBuffer& ring() const { return ring_; }
+
+private:
+    friend class AudioStreamThread;
+
+    /* Writes up to max_bytes of PCM data to out and returns the number of bytes
+     * written. Returning 0 ends the stream. Called from the audio thread */
+    virtual std::size_t decode(uint8_t* out, std::size_t max_bytes) = 0;
+
+    PCMRingBuffer ring_;
+    AudioDataFormat format_;
+    uint32_t sample_rate_;
+
+    AudioStreamThread* thread_ = nullptr;
+
+    /* Only touched by the producer */
+    bool decoded_all_ = false;
+
+    /* Only touched by the consumer */
+    bool starving_ = false;
+    uint32_t underrun_count_ = 0;
+};
+
+/*
+ * A single thread which keeps every registered stream's ring buffer topped up.
+ * Streams are filled a chunk at a time in turn so a long decode on one doesn't
+ * starve the others.
+ */
+class AudioStreamThread {
+public:
+    AudioStreamThread();
+    ~AudioStreamThread();
+
+    void add(std::shared_ptr<AudioStream> stream);
+
+    /* Once this returns the audio thread will not touch the stream again */
+    void remove(std::shared_ptr<AudioStream> stream);
+
+    /* Tell the thread that a chunk has been consumed */
+    void wake();
+
+    std::size_t stream_count() const;
+
+private:
+    void run();
+
+    mutable thread::Mutex streams_lock_;
+    std::vector<std::shared_ptr<AudioStream>> streams_;
+
+    thread::Mutex wake_lock_;
+    thread::Condition wake_condition_;
+    bool wake_pending_ = false;
+    bool running_ = true;
+
+    std::unique_ptr<thread::Thread> thread_;
+};
+
+/* Keeps a stream registered with the audio thread for as long as the handle
+ * is alive */
+class AudioStreamHandle {
+public:
+    AudioStreamHandle(std::shared_ptr<AudioStreamThread> thread, std::shared_ptr<AudioStream> stream);
+    ~AudioStreamHandle();
+
+    AudioStreamHandle(const AudioStreamHandle&) = delete;
+    AudioStreamHandle& operator=(const AudioStreamHandle&) = delete;
+
+    AudioStream* stream() const { return stream_.get(); }
+
+private:
+    std::shared_ptr<AudioStreamThread> thread_;
+    std::shared_ptr<AudioStream> stream_;
+};
+
+}
@@ -41,6 +41,8 @@ Organism::~Organism() {
     }
 
     behaviours_.clear();
+    serial_behaviours_.clear();
+    parallel_behaviours_.clear();
     behaviour_names_.clear();
     behaviour_types_.clear();
 }
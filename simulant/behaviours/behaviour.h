@@ -23,6 +23,7 @@
 #include <set>
 #include <memory>
 #include <type_traits>
+#include <functional>
 
 #include "../logging.h"
 
@@ -32,6 +33,7 @@
 #include "../input/input_manager.h"
 
 #include "../threads/mutex.h"
+#include "behaviour_dispatcher.h"
 
 namespace smlt {
 
@@ -42,6 +44,21 @@ class Organism;
 
 typedef std::shared_ptr<Behaviour> BehaviourPtr;
 
+/*
+ * What a behaviour touches when it updates. This decides whether it can be
+ * run on a worker thread, see BehaviourDispatcher.
+ */
+enum BehaviourDataAccess {
+    /* Anything at all. Runs on the thread running the update pass, in the
+     * order it was added */
+    BEHAVIOUR_DATA_ACCESS_ANY,
+
+    /* Only the node it's attached to (and that node's children), plus
+     * anything which doesn't change during updates such as input. Runs in
+     * parallel with other behaviours like it, after the rest have updated */
+    BEHAVIOUR_DATA_ACCESS_OWN_NODE
+};
+
 class Behaviour:
     public Updateable {
 public:
@@ -49,6 +66,11 @@ public:
 
     virtual const std::string name() const = 0;
 
+    /* Read once, when the behaviour is added to an organism */
+    virtual BehaviourDataAccess data_access() const {
+        return BEHAVIOUR_DATA_ACCESS_ANY;
+    }
+
     void enable();
     void disable();
 
@@ -59,6 +81,15 @@ public:
     Property<Behaviour, Organism> organism = {this, &Behaviour::organism_};
 
     bool attached() const { return organism_ != nullptr; }
+
+protected:
+    /* Runs func on the thread running the update pass, after it finishes.
+     * Behaviours declaring BEHAVIOUR_DATA_ACCESS_OWN_NODE must use this to
+     * create, destroy or reparent nodes */
+    void defer(const std::function<void ()>& func) {
+        BehaviourDispatcher::defer(func);
+    }
+
 private:
     friend class Organism;
 
@@ -166,10 +197,13 @@ public:
         return ret.get();
     }
 
+    /* While a BehaviourDispatcher is running a pass these skip behaviours
+     * declaring BEHAVIOUR_DATA_ACCESS_OWN_NODE, the dispatcher runs those
+     * itself with the *_parallel_behaviours functions below */
     void fixed_update_behaviours(float step) {
         thread::Lock<thread::Mutex> lock(container_lock_);
 
-        for(auto& behaviour: behaviours_) {
+        for(auto& behaviour: dispatched_behaviours()) {
             behaviour->_fixed_update_thunk(step);
         }
     }
@@ -177,22 +211,44 @@ public:
     void update_behaviours(float dt) {
         thread::Lock<thread::Mutex> lock(container_lock_);
 
-        for(auto& behaviour: behaviours_) {
+        for(auto& behaviour: dispatched_behaviours()) {
+            update_behaviour(behaviour.get(), dt);
+        }
+    }
 
-            // Call any overridden functions looking for first update
-            if(!behaviour->first_update_done_) {
-                behaviour->on_behaviour_first_update(this);
-                behaviour->first_update_done_ = true;
-            }
+    void late_update_behaviours(float dt) {
+        thread::Lock<thread::Mutex> lock(container_lock_);
 
-            behaviour->_update_thunk(dt);
+        for(auto& behaviour: dispatched_behaviours()) {
+            behaviour->_late_update_thunk(dt);
         }
     }
 
-    void late_update_behaviours(float dt) {
+    bool has_parallel_behaviours() const {
+        thread::Lock<thread::Mutex> lock(container_lock_);
+        return !parallel_behaviours_.empty();
+    }
+
+    void fixed_update_parallel_behaviours(float step) {
         thread::Lock<thread::Mutex> lock(container_lock_);
 
-        for(auto& behaviour: behaviours_) {
+        for(auto& behaviour: parallel_behaviours_) {
+            behaviour->_fixed_update_thunk(step);
+        }
+    }
+
+    void update_parallel_behaviours(float dt) {
+        thread::Lock<thread::Mutex> lock(container_lock_);
+
+        for(auto& behaviour: parallel_behaviours_) {
+            update_behaviour(behaviour.get(), dt);
+        }
+    }
+
+    void late_update_parallel_behaviours(float dt) {
+        thread::Lock<thread::Mutex> lock(container_lock_);
+
+        for(auto& behaviour: parallel_behaviours_) {
             behaviour->_late_update_thunk(dt);
         }
     }
@@ -218,6 +274,12 @@ private:
             behaviour_types_.insert(std::make_pair(typeid(T).hash_code(), behaviour));
             behaviour_names_.insert(behaviour->name());
             behaviours_.push_back(behaviour);
+
+            if(behaviour->data_access() == BEHAVIOUR_DATA_ACCESS_OWN_NODE) {
+                parallel_behaviours_.push_back(behaviour);
+            } else {
+                serial_behaviours_.push_back(behaviour);
+            }
         }
 
         // Call outside the lock to prevent deadlocking if
@@ -225,9 +287,25 @@ private:
         behaviour->set_organism(this);
     }
 
+    const std::vector<BehaviourPtr>& dispatched_behaviours() const {
+        return (BehaviourDispatcher::is_dispatching()) ? serial_behaviours_ : behaviours_;
+    }
+
+    void update_behaviour(Behaviour* behaviour, float dt) {
+        // Call any overridden functions looking for first update
+        if(!behaviour->first_update_done_) {
+            behaviour->on_behaviour_first_update(this);
+            behaviour->first_update_done_ = true;
+        }
+
+        behaviour->_update_thunk(dt);
+    }
+
     mutable thread::Mutex container_lock_;
 
     std::vector<BehaviourPtr> behaviours_;
+    std::vector<BehaviourPtr> serial_behaviours_;
+    std::vector<BehaviourPtr> parallel_behaviours_;
     std::unordered_set<std::string> behaviour_names_;
     std::unordered_map<std::size_t, BehaviourPtr> behaviour_types_;
 
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "behaviour_dispatcher.h"
+#include "../stage.h"
+#include "../nodes/stage_node.h"
+
+namespace smlt {
+
+const std::size_t BehaviourDispatcher::MIN_BATCH_SIZE;
+
+/* Passes only ever run on one thread at a time, so this doesn't need guarding */
+static bool dispatching_ = false;
+
+static thread::Mutex deferred_lock_;
+static std::vector<std::function<void ()>> deferred_;
+
+BehaviourDispatcher::BehaviourDispatcher(thread::ThreadPool* pool):
+    pool_(pool) {
+
+}
+
+bool BehaviourDispatcher::is_dispatching() {
+    return dispatching_;
+}
+
+void BehaviourDispatcher::defer(const std::function<void ()>& func) {
+    if(!dispatching_) {
+        func();
+        return;
+    }
+
+    thread::Lock<thread::Mutex> lock(deferred_lock_);
+    deferred_.push_back(func);
+}
+
+void BehaviourDispatcher::run_deferred() {
+    std::vector<std::function<void ()>> to_run;
+
+    {
+        thread::Lock<thread::Mutex> lock(deferred_lock_);
+        std::swap(to_run, deferred_);
+    }
+
+    /* Anything these defer runs immediately, we're no longer dispatching */
+    for(auto& func: to_run) {
+        func();
+    }
+}
+
+template<typename Serial, typename Parallel>
+void BehaviourDispatcher::run(Stage* stage, Serial serial, Parallel parallel) {
+    roots_.clear();
+
+    dispatching_ = true;
+
+    for(auto node: stage->each_descendent_and_self()) {
+        serial(node);
+
+        if(!node->has_parallel_behaviours()) {
+            continue;
+        }
+
+        /* Moving the stage moves everything, so its own behaviours run here
+         * with the serial ones rather than on a worker */
+        if(node == stage) {
+            parallel(node);
+            continue;
+        }
+
+        /* Moving a node moves its children, so the whole subtree goes to
+         * the same thread */
+        StageNode* root = node;
+        while(root->parent() && root->parent() != stage) {
+            root = static_cast<StageNode*>(root->parent());
+        }
+
+        roots_.push_back(root);
+    }
+
+    if(!roots_.empty()) {
+        std::sort(roots_.begin(), roots_.end());
+        roots_.erase(std::unique(roots_.begin(), roots_.end()), roots_.end());
+
+        auto& roots = roots_;
+        auto batch = [&roots, &parallel](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; ++i) {
+                for(auto node: roots[i]->each_descendent_and_self()) {
+                    parallel(node);
+                }
+            }
+        };
+
+        if(pool_) {
+            pool_->parallel_for(roots.size(), MIN_BATCH_SIZE, batch);
+        } else {
+            batch(0, roots.size());
+        }
+    }
+
+    dispatching_ = false;
+
+    run_deferred();
+}
+
+void BehaviourDispatcher::fixed_update(Stage* stage, float step) {
+    run(
+        stage,
+        [step](StageNode* node) { node->fixed_update(step); },
+        [step](StageNode* node) { node->fixed_update_parallel_behaviours(step); }
+    );
+}
+
+void BehaviourDispatcher::update(Stage* stage, float dt) {
+    run(
+        stage,
+        [dt](StageNode* node) { node->update(dt); },
+        [dt](StageNode* node) { node->update_parallel_behaviours(dt); }
+    );
+}
+
+void BehaviourDispatcher::late_update(Stage* stage, float dt) {
+    run(
+        stage,
+        [dt](StageNode* node) { node->late_update(dt); },
+        [dt](StageNode* node) { node->late_update_parallel_behaviours(dt); }
+    );
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../threads/thread_pool.h"
+
+namespace smlt {
+
+class Stage;
+class StageNode;
+
+/*
+ * Runs the update passes for a stage's nodes.
+ *
+ * Each pass first updates every node on the calling thread, in order, as it
+ * always has, except that behaviours declaring BEHAVIOUR_DATA_ACCESS_OWN_NODE
+ * are skipped. Those are then run across the worker threads, batched by the
+ * top level node they sit under so that no two threads ever touch the same
+ * subtree. Any attached to the stage itself run on the calling thread, right
+ * after the stage's serial update. Finally anything deferred with Behaviour::defer() runs, on the
+ * calling thread, and that's the point where it's safe for nodes to be
+ * created, destroyed or reparented again.
+ *
+ * The workers are the window's shared worker_pool. With no pool, or a pool
+ * with no workers (e.g. on the Dreamcast), the parallel behaviours all run on
+ * the calling thread, so behaviour is the same everywhere.
+ *
+ * Behaviours run on a worker must not throw.
+ */
+class BehaviourDispatcher {
+public:
+    /* Fewer nodes than this are never split across threads */
+    static const std::size_t MIN_BATCH_SIZE = 16;
+
+    BehaviourDispatcher(thread::ThreadPool* pool=nullptr);
+
+    BehaviourDispatcher(const BehaviourDispatcher&) = delete;
+    BehaviourDispatcher& operator=(const BehaviourDispatcher&) = delete;
+
+    void fixed_update(Stage* stage, float step);
+    void update(Stage* stage, float dt);
+    void late_update(Stage* stage, float dt);
+
+    void set_thread_pool(thread::ThreadPool* pool) { pool_ = pool; }
+
+    std::size_t worker_count() const { return (pool_) ? pool_->worker_count() : 0; }
+
+    /* The number of top level nodes handed to workers in the last pass */
+    std::size_t last_batch_size() const { return roots_.size(); }
+
+    /* True while a pass is running. Organisms use this to leave their
+     * parallel behaviours to the dispatcher */
+    static bool is_dispatching();
+
+    /* Queues func until the end of the current pass, or calls it straight
+     * away if there isn't one. Safe to call from any thread */
+    static void defer(const std::function<void ()>& func);
+
+private:
+    template<typename Serial, typename Parallel>
+    void run(Stage* stage, Serial serial, Parallel parallel);
+
+    void run_deferred();
+
+    thread::ThreadPool* pool_ = nullptr;
+
+    std::vector<StageNode*> roots_;
+};
+
+}
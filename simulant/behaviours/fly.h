@@ -41,6 +41,10 @@ public:
 
     const std::string name() const override { return "Fly by Keyboard"; }
 
+    BehaviourDataAccess data_access() const override {
+        return BEHAVIOUR_DATA_ACCESS_OWN_NODE;
+    }
+
     void set_speed(float v) { speed_ = v; }
 private:
     void on_behaviour_added(Organism* controllable) override {
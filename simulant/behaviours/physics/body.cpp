@@ -16,16 +16,10 @@ namespace impl {
 Body::Body(RigidBodySimulation* simulation):
     simulation_(simulation->shared_from_this()) {
 
-    // Keep each body's last_state in sync when the simulation is stepped
-    simulation_stepped_connection_ = simulation->signal_simulation_pre_step().connect([this]() {
-        if(auto sim = simulation_.lock()) {
-            last_state_ = sim->body_transform(this);
-        }
-    });
 }
 
 Body::~Body() {
-    simulation_stepped_connection_.disconnect();
+
 }
 
 bool Body::init() {
@@ -81,30 +75,19 @@ void Body::rotate_to(const Quaternion& rotation) {
 }
 
 void Body::update(float dt) {
-    const bool INTERPOLATION_ENABLED = true;
+    _S_UNUSED(dt);
 
     auto sim = simulation_.lock();
     if(!sim) {
         return;
     }
 
-    if(INTERPOLATION_ENABLED) {
-        auto prev_state = last_state_; // This is set by the signal connected in Body::Body()
-        auto next_state = sim->body_transform(this);
-
-        // Prevent a divide by zero.
-        float t = (dt == 0.0f) ? 0.0f : sim->time_keeper_->fixed_step_remainder() / dt;
+    /* The simulation keeps the results of the last two steps, so this
+     * never has to wait for a step that's still running */
+    auto state = sim->interpolated_transform(this);
 
-        auto new_pos = prev_state.first.lerp(next_state.first, t);
-        auto new_rot = prev_state.second.slerp(next_state.second, t);
-
-        stage_node->move_to_absolute(new_pos);
-        stage_node->rotate_to_absolute(new_rot);
-    } else {
-        auto state = sim->body_transform(this);
-        stage_node->move_to_absolute(state.first);
-        stage_node->rotate_to_absolute(state.second);
-    }
+    stage_node->move_to_absolute(state.first);
+    stage_node->rotate_to_absolute(state.second);
 }
 
 void Body::store_collider(b3Shape *shape, const PhysicsMaterial &material) {
@@ -173,7 +156,7 @@ void Body::add_box_collider(const Vec3 &size, const PhysicsMaterial &properties,
     sdef.friction = properties.friction;
     sdef.restitution = properties.bounciness;
 
-    store_collider(sim->bodies_.at(this)->CreateShape(sdef), properties);
+    store_collider(sim->world_body(this)->CreateShape(sdef), properties);
 }
 
 void Body::add_sphere_collider(const float diameter, const PhysicsMaterial& properties, const Vec3& offset) {
@@ -192,7 +175,7 @@ void Body::add_sphere_collider(const float diameter, const PhysicsMaterial& prop
     sdef.friction = properties.friction;
     sdef.restitution = properties.bounciness;
 
-    store_collider(sim->bodies_.at(this)->CreateShape(sdef), properties);
+    store_collider(sim->world_body(this)->CreateShape(sdef), properties);
 }
 
 void Body::register_collision_listener(CollisionListener *listener) {
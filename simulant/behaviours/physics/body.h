@@ -109,7 +109,8 @@ protected:
     b3Body* body_ = nullptr;
     std::weak_ptr<RigidBodySimulation> simulation_;
 
-    std::pair<Vec3, Quaternion> last_state_;
+    /* Where this body's transforms are kept in the simulation */
+    int32_t transform_slot_ = -1;
 
     void update(float dt) override;
 
@@ -125,7 +126,6 @@ protected:
 private:
     virtual bool is_dynamic() const { return true; }
 
-    sig::connection simulation_stepped_connection_;
     std::vector<std::shared_ptr<b3Hull>> hulls_;
     std::set<CollisionListener*> listeners_;
 
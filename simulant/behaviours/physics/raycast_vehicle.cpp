@@ -107,14 +107,19 @@ void RaycastVehicle::fixed_update(float dt) {
 
     std::vector<Intersection> intersections;
 
-    for(auto& ray: rays) {
-        Intersection intersection;
-        auto ret = sim->intersect_ray(ray.start, ray.dir, &intersection.dist, &intersection.normal);
+    auto hits = sim->intersect_rays(rays);
+
+    for(std::size_t i = 0; i < rays.size(); ++i) {
+        auto& ray = rays[i];
+        auto& hit = hits[i];
 
         // If we intersected
-        if(ret.second) {
+        if(hit.hit) {
             // Store the intersection information
-            intersection.point = ret.first;
+            Intersection intersection;
+            intersection.dist = hit.distance;
+            intersection.normal = hit.normal;
+            intersection.point = hit.point;
             intersection.penetration = Vec3(ray.dir).length() - intersection.dist;
             intersection.ray_dir = Vec3(ray.dir);
             intersection.ray_start = Vec3(ray.start);
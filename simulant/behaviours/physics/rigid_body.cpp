@@ -47,7 +47,7 @@ void RigidBody::set_linear_velocity(const Vec3& vel) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3Vec3 v;
     to_b3vec3(vel, v);
@@ -61,7 +61,7 @@ void RigidBody::set_linear_damping(const float d) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
     b->SetLinearDamping(d);
 }
 
@@ -71,7 +71,7 @@ void RigidBody::set_angular_damping(const float d) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
     b->SetAngularDamping(d);
 }
 
@@ -81,7 +81,7 @@ void RigidBody::add_force(const Vec3 &force) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3Vec3 v;
     to_b3vec3(force, v);
@@ -94,7 +94,7 @@ void RigidBody::add_relative_force(const Vec3 &force) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3Vec3 v;
     to_b3vec3(force, v);
@@ -109,7 +109,7 @@ void RigidBody::add_relative_torque(const Vec3 &torque) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
     b3Vec3 t;
     to_b3vec3(torque, t);
 
@@ -123,7 +123,7 @@ void RigidBody::add_impulse(const Vec3& impulse) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3Vec3 v;
     to_b3vec3(impulse, v);
@@ -136,7 +136,7 @@ void RigidBody::add_impulse_at_position(const Vec3& impulse, const Vec3& positio
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3Vec3 i, p;
     to_b3vec3(impulse, i);
@@ -150,7 +150,7 @@ float RigidBody::mass() const {
         return 0;
     }
 
-    const b3Body* b = sim->bodies_.at(this);
+    const b3Body* b = sim->world_body(this);
     return b->GetMass();
 }
 
@@ -160,7 +160,7 @@ Vec3 RigidBody::linear_velocity() const {
         return Vec3();
     }
 
-    const b3Body* b = sim->bodies_.at(this);
+    const b3Body* b = sim->world_body(this);
 
     Vec3 v;
     to_vec3(b->GetLinearVelocity(), v);
@@ -173,7 +173,7 @@ Vec3 RigidBody::angular_velocity() const {
         return Vec3();
     }
 
-    const b3Body* b = sim->bodies_.at(this);
+    const b3Body* b = sim->world_body(this);
 
     Vec3 v;
     to_vec3(b->GetAngularVelocity(), v);
@@ -186,7 +186,7 @@ Vec3 RigidBody::linear_velocity_at(const Vec3& position) const {
         return Vec3();
     }
 
-    const b3Body* b = sim->bodies_.at(this);
+    const b3Body* b = sim->world_body(this);
 
     b3Vec3 bv;
     to_b3vec3(position, bv);
@@ -213,7 +213,7 @@ void RigidBody::set_center_of_mass(const smlt::Vec3& com) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3MassData data;
     b->GetMassData(&data);
@@ -236,7 +236,7 @@ void RigidBody::add_force_at_position(const Vec3& force, const Vec3& position) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
 
     b3Vec3 f, p;
     to_b3vec3(force, f);
@@ -251,7 +251,7 @@ void RigidBody::add_torque(const Vec3& torque) {
         return;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
     b3Vec3 t;
     to_b3vec3(torque, t);
     b->ApplyTorque(t, true);
@@ -263,7 +263,7 @@ bool RigidBody::is_awake() const {
         return false;
     }
 
-    b3Body* b = sim->bodies_.at(this);
+    b3Body* b = sim->world_body(this);
     return b->IsAwake();
 }
 
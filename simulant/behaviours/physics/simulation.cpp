@@ -3,6 +3,9 @@
 #include "../../nodes/stage_node.h"
 #include "../../deps/bounce/bounce.h"
 #include "../../macros.h"
+#include "../../time_keeper.h"
+#include "../../logging.h"
+#include "../../threads/thread_pool.h"
 
 /* Need for bounce */
 void b3BeginProfileScope(const char* name) {
@@ -69,14 +72,11 @@ public:
 
         if(simulation_->body_exists(bodyA) && simulation_->body_exists(bodyB)) {
             auto coll_pair = build_collision_pair(contact);
-            auto& collA = coll_pair.first;
-            auto& collB = coll_pair.second;
-
-            bodyA->contact_started(collA);
-            bodyB->contact_started(collB);
 
             // FIXME: Populate contact points
 
+            notify(true, coll_pair);
+
             active_contacts_.insert(contact);
         }
     }
@@ -95,11 +95,7 @@ public:
 
         if(simulation_->body_exists(bodyA) && simulation_->body_exists(bodyB)) {
             auto coll_pair = build_collision_pair(contact);
-            auto& collA = coll_pair.first;
-            auto& collB = coll_pair.second;
-
-            bodyA->contact_finished(collA);
-            bodyB->contact_finished(collB);
+            notify(false, coll_pair);
 
             active_contacts_.erase(contact);
         } else {
@@ -124,7 +120,53 @@ public:
         return ret;
     }
 
+    /* While queueing, contacts are stored until dispatch() rather than
+     * reported straight away. Steps queue so that listeners are always
+     * called on the thread that called fixed_update() */
+    void set_queueing(bool value) { queueing_ = value; }
+
+    void dispatch() {
+        for(auto& event: events_) {
+            auto bodyA = event.collisions.first.this_body;
+            auto bodyB = event.collisions.second.this_body;
+
+            if(!simulation_->body_exists(bodyA) || !simulation_->body_exists(bodyB)) {
+                continue;
+            }
+
+            if(event.started) {
+                bodyA->contact_started(event.collisions.first);
+                bodyB->contact_started(event.collisions.second);
+            } else {
+                bodyA->contact_finished(event.collisions.first);
+                bodyB->contact_finished(event.collisions.second);
+            }
+        }
+
+        events_.clear();
+    }
+
 private:
+    struct ContactEvent {
+        bool started;
+        std::pair<Collision, Collision> collisions;
+    };
+
+    void notify(bool started, const std::pair<Collision, Collision>& collisions) {
+        if(queueing_) {
+            events_.push_back(ContactEvent{started, collisions});
+        } else if(started) {
+            collisions.first.this_body->contact_started(collisions.first);
+            collisions.second.this_body->contact_started(collisions.second);
+        } else {
+            collisions.first.this_body->contact_finished(collisions.first);
+            collisions.second.this_body->contact_finished(collisions.second);
+        }
+    }
+
+    bool queueing_ = false;
+    std::vector<ContactEvent> events_;
+
     std::pair<Collision, Collision> build_collision_pair(b3Contact* contact) {
         b3Shape* shapeA = contact->GetShapeA();
         b3Shape* shapeB = contact->GetShapeB();
@@ -170,7 +212,13 @@ RigidBodySimulation::RigidBodySimulation(TimeKeeper *time_keeper):
     scene_->SetContactListener(contact_listener_.get());
 }
 
+RigidBodySimulation::~RigidBodySimulation() {
+    set_threaded_stepping(false);
+}
+
 void RigidBodySimulation::set_gravity(const Vec3& gravity) {
+    wait();
+
     b3Vec3 g;
     to_b3vec3(gravity, g);
     scene_->SetGravity(g);
@@ -182,48 +230,184 @@ bool RigidBodySimulation::init() {
 }
 
 void RigidBodySimulation::clean_up() {
+    set_threaded_stepping(false);
+
     // Disconnect the contact listener
     scene_->SetContactListener(nullptr);
 }
 
+void RigidBodySimulation::set_threaded_stepping(bool value) {
+    if(value == is_threaded_stepping()) {
+        return;
+    }
+
+    if(value) {
+        if(thread::ThreadPool::hardware_concurrency() < 2) {
+            L_INFO("Only one core available, physics will step on the calling thread");
+            return;
+        }
+
+        thread_running_ = true;
+        thread_.reset(new thread::Thread(&RigidBodySimulation::run_thread, this));
+    } else {
+        wait();
+
+        {
+            thread::Lock<thread::Mutex> g(step_lock_);
+            thread_running_ = false;
+            step_condition_.notify_all();
+        }
+
+        thread_->join();
+        thread_.reset();
+    }
+}
+
+void RigidBodySimulation::run_thread() {
+    while(true) {
+        float dt = 0.0f;
+
+        {
+            thread::Lock<thread::Mutex> g(step_lock_);
+            while(!step_pending_ && thread_running_) {
+                step_condition_.wait(step_lock_);
+            }
+
+            if(!thread_running_) {
+                break;
+            }
+
+            dt = pending_step_;
+        }
+
+        step(dt);
+
+        thread::Lock<thread::Mutex> g(step_lock_);
+        step_pending_ = false;
+        step_unpublished_ = true;
+        step_condition_.notify_all();
+    }
+}
+
+void RigidBodySimulation::wait() {
+    {
+        thread::Lock<thread::Mutex> g(step_lock_);
+        while(step_pending_) {
+            step_condition_.wait(step_lock_);
+        }
+
+        if(!step_unpublished_) {
+            return;
+        }
+
+        step_unpublished_ = false;
+    }
+
+    publish();
+}
+
 void RigidBodySimulation::fixed_update(float step) {
+    if(!thread_) {
+        signal_simulation_pre_step_();
+        this->step(step);
+        publish();
+        return;
+    }
+
+    /* Pick up the step we started last time before starting the next */
+    wait();
+
+    signal_simulation_pre_step_();
+
+    thread::Lock<thread::Mutex> g(step_lock_);
+    pending_step_ = step;
+    step_pending_ = true;
+    step_condition_.notify_all();
+}
+
+void RigidBodySimulation::step(float dt) {
     uint32_t velocity_iterations = 8;
     uint32_t position_iterations = 2;
 
-    signal_simulation_pre_step_();
-    scene_->Step(step, velocity_iterations, position_iterations);
+    contact_listener_->set_queueing(true);
+    scene_->Step(dt, velocity_iterations, position_iterations);
+    contact_listener_->set_queueing(false);
+
+    for(uint32_t i = 0; i < slot_bodies_.size(); ++i) {
+        b3Body* b = slot_bodies_[i];
+        if(!b) {
+            continue;
+        }
+
+        auto& next = next_transforms_[i];
+        to_vec3(b->GetWorldCenter(), next.position);
+        to_quat(b->GetOrientation(), next.rotation);
+    }
 }
 
-std::pair<Vec3, bool> RigidBodySimulation::intersect_ray(const Vec3& start, const Vec3& direction, float* distance, Vec3* normal) {
-    b3RayCastSingleOutput result;
+void RigidBodySimulation::publish() {
+    std::swap(previous_transforms_, current_transforms_);
+    std::swap(current_transforms_, next_transforms_);
+
+    contact_listener_->dispatch();
+}
+
+void RigidBodySimulation::cast_ray(const Vec3& start, const Vec3& direction, RayHit& result) const {
+    b3RayCastSingleOutput output;
     b3Vec3 s, d;
 
     to_b3vec3(start, s);
     to_b3vec3(start + direction, d);
 
-    bool hit = scene_->RayCastSingle(&result, s, d);
+    result = RayHit();
+    result.hit = scene_->RayCastSingle(&output, s, d);
+
+    if(result.hit) {
+        to_vec3(output.point, result.point);
+        to_vec3(output.normal, result.normal);
+        result.distance = (result.point - start).length();
+    }
+}
 
-    float closest = std::numeric_limits<float>::max();
-    Vec3 impact_point, closest_normal;
+std::pair<Vec3, bool> RigidBodySimulation::intersect_ray(const Vec3& start, const Vec3& direction, float* distance, Vec3* normal) {
+    wait();
 
-    if(hit) {
-        to_vec3(result.point, impact_point);
-        closest = (impact_point - start).length();
-        to_vec3(result.normal, closest_normal);
+    RayHit result;
+    cast_ray(start, direction, result);
 
+    if(result.hit) {
         if(distance) {
-            *distance = closest;
+            *distance = result.distance;
         }
 
         if(normal) {
-            *normal = closest_normal;
+            *normal = result.normal;
         }
     }
 
-    return std::make_pair(impact_point, hit);
+    return std::make_pair(result.point, result.hit);
+}
+
+void RigidBodySimulation::intersect_rays(const Ray* rays, std::size_t count, RayHit* results) {
+    wait();
+
+    for(std::size_t i = 0; i < count; ++i) {
+        cast_ray(rays[i].start, rays[i].dir, results[i]);
+    }
+}
+
+std::vector<RayHit> RigidBodySimulation::intersect_rays(const std::vector<Ray>& rays) {
+    std::vector<RayHit> results(rays.size());
+    if(!rays.empty()) {
+        intersect_rays(&rays[0], rays.size(), &results[0]);
+    }
+
+    return results;
 }
 
 b3Body *RigidBodySimulation::acquire_body(impl::Body *body) {
+    wait();
+
     b3BodyDef def;
 
     bool is_dynamic = body->is_dynamic();
@@ -239,18 +423,66 @@ b3Body *RigidBodySimulation::acquire_body(impl::Body *body) {
         to_b3quat(body->stage_node->absolute_rotation(), def.orientation);
     }
 
-    bodies_[body] = scene_->CreateBody(def);
-    return bodies_[body];
+    b3Body* b = scene_->CreateBody(def);
+    bodies_[body] = b;
+
+    if(free_slots_.empty()) {
+        free_slots_.push_back(slot_bodies_.size());
+        slot_bodies_.push_back(nullptr);
+        previous_transforms_.push_back(Transform());
+        current_transforms_.push_back(Transform());
+        next_transforms_.push_back(Transform());
+    }
+
+    body->transform_slot_ = free_slots_.back();
+    free_slots_.pop_back();
+
+    slot_bodies_[body->transform_slot_] = b;
+
+    /* Until the first step the body is wherever it was created */
+    Transform start;
+    to_vec3(b->GetWorldCenter(), start.position);
+    to_quat(b->GetOrientation(), start.rotation);
+
+    previous_transforms_[body->transform_slot_] = start;
+    current_transforms_[body->transform_slot_] = start;
+    next_transforms_[body->transform_slot_] = start;
+
+    return b;
 }
 
 void RigidBodySimulation::release_body(impl::Body *body) {
+    wait();
+
     auto bbody = bodies_.at(body);
     scene_->DestroyBody(bbody);
     bodies_.erase(body);
+
+    slot_bodies_[body->transform_slot_] = nullptr;
+    free_slots_.push_back(body->transform_slot_);
+    body->transform_slot_ = -1;
+}
+
+b3Body* RigidBodySimulation::world_body(const impl::Body* body) {
+    wait();
+    return bodies_.at(body);
+}
+
+std::pair<Vec3, Quaternion> RigidBodySimulation::interpolated_transform(const impl::Body* body) const {
+    auto prev = previous_transforms_[body->transform_slot_];
+    auto& next = current_transforms_[body->transform_slot_];
+
+    float step = time_keeper_->fixed_step();
+    float t = (step == 0.0f) ? 1.0f : std::min(1.0f, time_keeper_->fixed_step_remainder() / step);
+
+    return std::make_pair(
+        prev.position.lerp(next.position, t),
+        prev.rotation.slerp(next.rotation, t)
+    );
 }
 
 std::pair<Vec3, Quaternion> RigidBodySimulation::body_transform(const impl::Body *body) {
-    b3Body* b = bodies_.at(body);
+    b3Body* b = world_body(body);
 
     auto position = b->GetWorldCenter();
     auto rotation = b->GetOrientation();
@@ -265,7 +497,7 @@ std::pair<Vec3, Quaternion> RigidBodySimulation::body_transform(const impl::Body
 }
 
 void RigidBodySimulation::set_body_transform(impl::Body* body, const Vec3& position, const Quaternion& rotation) {
-    b3Body* b = bodies_.at(body);
+    b3Body* b = world_body(body);
 
     auto axis_angle = rotation.to_axis_angle();
 
@@ -273,6 +505,14 @@ void RigidBodySimulation::set_body_transform(impl::Body* body, const Vec3& posit
     to_b3vec3(position, p);
     to_b3vec3(axis_angle.axis, a);
     b->SetTransform(p, a, axis_angle.angle.value);
+
+    /* Teleport rather than interpolate from wherever the body was */
+    Transform moved;
+    to_vec3(b->GetWorldCenter(), moved.position);
+    to_quat(b->GetOrientation(), moved.rotation);
+
+    previous_transforms_[body->transform_slot_] = moved;
+    current_transforms_[body->transform_slot_] = moved;
 }
 
 
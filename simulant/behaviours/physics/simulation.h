@@ -3,6 +3,9 @@
 #include "../../generic/managed.h"
 #include "../../signals/signal.h"
 #include "../../types.h"
+#include "../../threads/thread.h"
+#include "../../threads/mutex.h"
+#include "../../threads/condition.h"
 
 #include "collider.h"
 
@@ -26,6 +29,13 @@ namespace impl {
 
 typedef sig::signal<void ()> SimulationPreStepSignal;
 
+struct RayHit {
+    bool hit = false;
+    Vec3 point;
+    Vec3 normal;
+    float distance = 0.0f;
+};
+
 class RigidBodySimulation:
     public RefCounted<RigidBodySimulation> {
 
@@ -33,13 +43,48 @@ class RigidBodySimulation:
 
 public:
     RigidBodySimulation(TimeKeeper* time_keeper);
+    ~RigidBodySimulation();
+
     bool init() override;
     void clean_up() override;
 
     void fixed_update(float step);
 
+    /*
+     * When enabled, fixed_update() hands the step to a dedicated thread and
+     * returns straight away, so stepping overlaps with the rest of the frame.
+     * The results are picked up by the next call to wait(), which happens at
+     * the start of the next fixed_update() or as soon as anything reads or
+     * changes the simulation. Bodies therefore lag a step behind, and
+     * collision listeners are still called on the thread calling
+     * fixed_update().
+     *
+     * Has no effect on single core machines (e.g. the Dreamcast)
+     */
+    void set_threaded_stepping(bool value);
+    bool is_threaded_stepping() const { return bool(thread_); }
+
+    /* Blocks until the step running on the simulation thread (if any) has
+     * finished, and publishes its results */
+    void wait();
+
     std::pair<Vec3, bool> intersect_ray(const Vec3& start, const Vec3& direction, float* distance=nullptr, Vec3 *normal=nullptr);
 
+    /*
+     * Casts count rays, from ray.start to ray.start + ray.dir, writing a
+     * result for each into results. The results are exactly what
+     * intersect_ray() would give for each ray, but the simulation is only
+     * waited on once for the whole batch.
+     *
+     * The rays are cast one after another on the calling thread. bounce
+     * doesn't promise that its world can be queried from several threads
+     * at once, so they aren't spread across workers. There's no batched
+     * sphere cast or overlap query either, the world is only ever queried
+     * a ray at a time.
+     */
+    void intersect_rays(const Ray* rays, std::size_t count, RayHit* results);
+    std::vector<RayHit> intersect_rays(const std::vector<Ray>& rays);
+
     void set_gravity(const Vec3& gravity);
 
     bool body_exists(const impl::Body* body) const { return bodies_.count(body); }
@@ -60,8 +105,48 @@ private:
 
     std::unordered_map<const impl::Body*, b3Body*> bodies_;
 
+    /* Waits for any running step, use this rather than bodies_ directly */
+    b3Body* world_body(const impl::Body* body);
+
     std::pair<Vec3, Quaternion> body_transform(const impl::Body *body);
     void set_body_transform(impl::Body *body, const Vec3& position, const Quaternion& rotation);    
+
+    /* Where each body was after the last two steps, indexed by the body's
+     * transform slot. These are only swapped by publish(), so bodies can
+     * read them while a step is running */
+    struct Transform {
+        Vec3 position;
+        Quaternion rotation;
+    };
+
+    std::vector<Transform> previous_transforms_;
+    std::vector<Transform> current_transforms_;
+    std::vector<Transform> next_transforms_;
+
+    std::vector<b3Body*> slot_bodies_;
+    std::vector<uint32_t> free_slots_;
+
+    /* Blends the last two steps by how far through the next one we are */
+    std::pair<Vec3, Quaternion> interpolated_transform(const impl::Body* body) const;
+
+    /* Steps the world and records the results in next_transforms_ */
+    void step(float dt);
+
+    /* Makes the last step's results current and fires its contact events */
+    void publish();
+
+    void run_thread();
+
+    /* Casts a single ray, the caller must have waited for any running step */
+    void cast_ray(const Vec3& start, const Vec3& direction, RayHit& result) const;
+
+    std::unique_ptr<thread::Thread> thread_;
+    thread::Mutex step_lock_;
+    thread::Condition step_condition_;
+    float pending_step_ = 0.0f;
+    bool step_pending_ = false;
+    bool step_unpublished_ = false;
+    bool thread_running_ = false;
 };
 
 void to_b3vec3(const Vec3& rhs, b3Vec3& ret);
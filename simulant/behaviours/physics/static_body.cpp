@@ -79,7 +79,7 @@ void StaticBody::add_mesh_collider(const MeshID &mesh_id, const PhysicsMaterial
     sdef.friction = properties.friction;
     sdef.restitution = properties.bounciness;
 
-    store_collider(sim->bodies_.at(this)->CreateShape(sdef), properties);
+    store_collider(sim->world_body(this)->CreateShape(sdef), properties);
 }
 
 StaticBody::MeshCache& StaticBody::get_mesh_cache() {
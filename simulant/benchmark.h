@@ -0,0 +1,288 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Benchmarks are written just like tests (see test.h), but subclass
+ * BenchmarkCase or SimulantBenchmarkCase and name their methods bench_*.
+ * tools/test_generator.py --benchmarks discovers them and builds the
+ * simulant_benchmarks executable.
+ *
+ * Each bench_ method calls measure() one or more times. measure() works out
+ * how many calls of the body make a repetition long enough to time reliably,
+ * warms up, then times a number of repetitions and reports percentiles of the
+ * per-call time along with a rate.
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include "test.h"
+#include "random.h"
+#include "time_keeper.h"
+
+namespace smlt {
+namespace test {
+
+struct BenchmarkOptions {
+    uint32_t warmup_runs = 2;
+    uint32_t repetitions = 10;
+
+    /* Repetitions are made at least this long by calling the body repeatedly */
+    uint64_t min_repetition_us = 2000;
+
+    /* Every benchmark's random() is seeded with this so workloads are the
+     * same from run to run */
+    uint32_t seed = 1234;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    std::string unit;
+
+    uint32_t iterations = 0;
+    double items_per_iteration = 1.0;
+
+    /* Nanoseconds per iteration, one per repetition */
+    std::vector<double> samples;
+
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+
+    double rate = 0.0;
+
+    void calculate() {
+        if(samples.empty()) {
+            return;
+        }
+
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](double p) -> double {
+            // Nearest rank
+            std::size_t rank = (std::size_t) std::ceil(p * sorted.size());
+            return sorted[std::min(sorted.size() - 1, (rank) ? rank - 1 : 0)];
+        };
+
+        double total = 0.0;
+        for(auto s: sorted) {
+            total += s;
+        }
+
+        mean = total / sorted.size();
+        min = sorted.front();
+        max = sorted.back();
+        p50 = percentile(0.50);
+        p90 = percentile(0.90);
+        p99 = percentile(0.99);
+
+        rate = (mean > 0.0) ? (items_per_iteration * 1000000000.0) / mean : 0.0;
+    }
+};
+
+struct BenchmarkContext {
+    BenchmarkOptions options;
+    std::string current;
+    std::vector<BenchmarkResult> results;
+};
+
+template<typename Base>
+class BenchmarkCaseBase : public Base {
+public:
+    void _begin(BenchmarkContext* context, const std::string& name) {
+        context_ = context;
+        context_->current = name;
+        random_ = RandomGenerator(context_->options.seed);
+    }
+
+protected:
+    /*
+     * Times body. items_per_iteration and unit describe what one call of
+     * body processes (e.g. 1000 "renderables") and are used for the rate.
+     */
+    template<typename Func>
+    void measure(const std::string& label, Func&& body, double items_per_iteration=1.0, const std::string& unit="calls") {
+        auto& options = context_->options;
+
+        auto run = [&body](uint32_t iterations) -> uint64_t {
+            auto start = TimeKeeper::now_in_us();
+            for(uint32_t i = 0; i < iterations; ++i) {
+                body();
+            }
+            return TimeKeeper::now_in_us() - start;
+        };
+
+        /* Find an iteration count which makes the clock meaningful, this
+         * doubles as the first warm up */
+        const uint32_t max_iterations = 1 << 24;
+
+        uint32_t iterations = 1;
+        while(iterations < max_iterations && run(iterations) < options.min_repetition_us) {
+            iterations *= 2;
+        }
+
+        for(uint32_t i = 0; i < options.warmup_runs; ++i) {
+            run(iterations);
+        }
+
+        BenchmarkResult result;
+        result.name = (label.empty()) ? context_->current : context_->current + "/" + label;
+        result.unit = unit;
+        result.iterations = iterations;
+        result.items_per_iteration = items_per_iteration;
+
+        for(uint32_t i = 0; i < options.repetitions; ++i) {
+            result.samples.push_back((double(run(iterations)) * 1000.0) / double(iterations));
+        }
+
+        result.calculate();
+        context_->results.push_back(result);
+
+        char line[256];
+        snprintf(
+            line, sizeof(line), "    %-60s p50 %12.1fns  p90 %12.1fns  %14.1f %s/s",
+            result.name.c_str(), result.p50, result.p90, result.rate, unit.c_str()
+        );
+        std::cout << line << std::endl;
+    }
+
+    uint32_t seed() const { return context_->options.seed; }
+
+    /* Reseeded before every benchmark */
+    RandomGenerator& random() { return random_; }
+
+private:
+    BenchmarkContext* context_ = nullptr;
+    RandomGenerator random_;
+};
+
+class BenchmarkCase : public BenchmarkCaseBase<TestCase> {};
+class SimulantBenchmarkCase : public BenchmarkCaseBase<SimulantTestCase> {};
+
+class BenchmarkRunner {
+public:
+    template<typename T, typename U>
+    void register_case(std::vector<U> methods, std::vector<std::string> names) {
+        std::shared_ptr<T> instance = std::make_shared<T>();
+
+        instances_.push_back(instance);
+
+        for(std::size_t i = 0; i < methods.size(); ++i) {
+            std::function<void()> func = std::bind(methods[i], instance.get());
+            std::string name = names[i];
+
+            benchmarks_.push_back([=](BenchmarkContext* context) {
+                instance->_begin(context, name);
+                instance->set_up();
+                func();
+                instance->tear_down();
+            });
+
+            names_.push_back(name);
+        }
+    }
+
+    int32_t run(const std::string& filter, const BenchmarkOptions& options, const std::string& json_output="") {
+        BenchmarkContext context;
+        context.options = options;
+
+        int32_t failed = 0;
+
+        std::cout << std::endl << "Running benchmarks (seed: " << options.seed << ")" << std::endl << std::endl;
+
+        for(std::size_t i = 0; i < benchmarks_.size(); ++i) {
+            if(!filter.empty() && names_[i].find(filter) != 0) {
+                continue;
+            }
+
+            try {
+                benchmarks_[i](&context);
+            } catch(SkippedTestError& e) {
+                std::cout << "    " << names_[i] << " SKIPPED" << std::endl;
+            } catch(AssertionError& e) {
+                std::cout << "\033[33m" << "    " << names_[i] << " FAILED: " << e.what() << "\033[0m" << std::endl;
+                ++failed;
+            } catch(std::exception& e) {
+                std::cout << "\033[31m" << "    " << names_[i] << " EXCEPT: " << e.what() << "\033[0m" << std::endl;
+                ++failed;
+            }
+        }
+
+        if(!json_output.empty()) {
+            write_json(json_output, context);
+            std::cout << std::endl << "Results written to: " << json_output << std::endl;
+        }
+
+        return failed;
+    }
+
+private:
+    static std::string escape(const std::string& s) {
+        std::string ret;
+        for(auto c: s) {
+            if(c == '"' || c == '\\') {
+                ret += '\\';
+            }
+            ret += c;
+        }
+        return ret;
+    }
+
+    void write_json(const std::string& path, const BenchmarkContext& context) {
+        std::ofstream out(path.c_str());
+        out.precision(10);
+
+        out << "{\n";
+        out << "  \"seed\": " << context.options.seed << ",\n";
+        out << "  \"repetitions\": " << context.options.repetitions << ",\n";
+        out << "  \"benchmarks\": [\n";
+
+        for(std::size_t i = 0; i < context.results.size(); ++i) {
+            auto& r = context.results[i];
+
+            out << "    {";
+            out << "\"name\": \"" << escape(r.name) << "\", ";
+            out << "\"unit\": \"" << escape(r.unit) << "\", ";
+            out << "\"iterations\": " << r.iterations << ", ";
+            out << "\"mean_ns\": " << r.mean << ", ";
+            out << "\"min_ns\": " << r.min << ", ";
+            out << "\"max_ns\": " << r.max << ", ";
+            out << "\"p50_ns\": " << r.p50 << ", ";
+            out << "\"p90_ns\": " << r.p90 << ", ";
+            out << "\"p99_ns\": " << r.p99 << ", ";
+            out << "\"rate\": " << r.rate;
+            out << "}" << ((i + 1 < context.results.size()) ? "," : "") << "\n";
+        }
+
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+    std::vector<std::shared_ptr<void>> instances_;
+    std::vector<std::function<void (BenchmarkContext*)>> benchmarks_;
+    std::vector<std::string> names_;
+};
+
+}
+}
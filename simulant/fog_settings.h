@@ -25,7 +25,7 @@ public:
     float linear_end() const;
 
     void set_colour(const Colour& colour);
-    const Colour& colour() { return colour_; }
+    const Colour& colour() const { return colour_; }
 private:
     bool enabled_ = false;
     FogType type_ = FOG_TYPE_LINEAR;
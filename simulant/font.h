@@ -76,6 +76,7 @@ private:
     friend class ui::Widget;
     friend class loaders::TTFLoader;
     friend class loaders::FNTLoader;
+    friend class TextureAtlas;
 };
 
 }
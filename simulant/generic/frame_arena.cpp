@@ -0,0 +1,175 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cassert>
+#include <algorithm>
+
+#include "frame_arena.h"
+
+namespace smlt {
+
+const std::size_t FrameArena::DEFAULT_BLOCK_SIZE;
+
+FrameArena::FrameArena(std::size_t block_size):
+    block_size_(block_size),
+    owner_(thread::this_thread_id()) {
+
+}
+
+void* FrameArena::allocate(std::size_t size, std::size_t alignment) {
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+
+    if(blocks_.empty()) {
+        push_block(std::max(block_size_, size + alignment));
+    }
+
+    while(true) {
+        auto& block = blocks_[current_];
+
+        auto base = reinterpret_cast<uintptr_t>(block.data.get());
+        auto start = (base + offset_ + (alignment - 1)) & ~uintptr_t(alignment - 1);
+
+        if(start + size <= base + block.size) {
+            offset_ = (start + size) - base;
+
+            ++allocation_count_;
+            bytes_used_ += size;
+            return reinterpret_cast<void*>(start);
+        }
+
+        if(current_ + 1 == blocks_.size()) {
+            push_block(std::max(block_size_, size + alignment));
+        }
+
+        ++current_;
+        offset_ = 0;
+    }
+}
+
+void FrameArena::deallocate(void* p, std::size_t size) {
+    if(!p || blocks_.empty()) {
+        return;
+    }
+
+    auto& block = blocks_[current_];
+    auto base = reinterpret_cast<uintptr_t>(block.data.get());
+    auto addr = reinterpret_cast<uintptr_t>(p);
+
+    if(addr + size == base + offset_) {
+        offset_ = addr - base;
+    }
+}
+
+void FrameArena::reset() {
+    {
+        thread::Lock<thread::Mutex> lock(children_lock_);
+        for(auto& child: children_) {
+            child.second->reset();
+        }
+    }
+
+    if(blocks_.size() > 1) {
+        /* Whatever this frame needed, the next one probably will too */
+        std::size_t total = 0;
+        for(auto& block: blocks_) {
+            total += block.size;
+        }
+
+        blocks_.clear();
+        push_block(total);
+    }
+
+    current_ = 0;
+    offset_ = 0;
+
+    allocation_count_ = 0;
+    heap_allocation_count_ = 0;
+    bytes_used_ = 0;
+}
+
+FrameArena* FrameArena::local() {
+    auto id = thread::this_thread_id();
+    if(id == owner_) {
+        return this;
+    }
+
+    thread::Lock<thread::Mutex> lock(children_lock_);
+    for(auto& child: children_) {
+        if(child.first == id) {
+            return child.second.get();
+        }
+    }
+
+    auto arena = new FrameArena(block_size_);
+    children_.push_back(std::make_pair(id, std::unique_ptr<FrameArena>(arena)));
+    return arena;
+}
+
+uint32_t FrameArena::allocation_count() const {
+    auto ret = allocation_count_;
+
+    thread::Lock<thread::Mutex> lock(children_lock_);
+    for(auto& child: children_) {
+        ret += child.second->allocation_count();
+    }
+
+    return ret;
+}
+
+uint32_t FrameArena::heap_allocation_count() const {
+    auto ret = heap_allocation_count_;
+
+    thread::Lock<thread::Mutex> lock(children_lock_);
+    for(auto& child: children_) {
+        ret += child.second->heap_allocation_count();
+    }
+
+    return ret;
+}
+
+std::size_t FrameArena::bytes_used() const {
+    auto ret = bytes_used_;
+
+    thread::Lock<thread::Mutex> lock(children_lock_);
+    for(auto& child: children_) {
+        ret += child.second->bytes_used();
+    }
+
+    return ret;
+}
+
+std::size_t FrameArena::capacity() const {
+    std::size_t ret = 0;
+    for(auto& block: blocks_) {
+        ret += block.size;
+    }
+
+    return ret;
+}
+
+void FrameArena::push_block(std::size_t size) {
+    Block block;
+    block.data.reset(new uint8_t[size]);
+    block.size = size;
+
+    blocks_.push_back(std::move(block));
+    ++heap_allocation_count_;
+}
+
+}
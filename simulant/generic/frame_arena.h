@@ -0,0 +1,150 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "../threads/thread.h"
+#include "../threads/mutex.h"
+
+namespace smlt {
+
+/*
+ * A linear allocator for data which doesn't outlive the frame.
+ *
+ * Allocating bumps a pointer through a block of memory, and nothing is
+ * freed until reset(), which the window calls once the frame has finished.
+ * If a frame needs more than one block, reset() replaces them with a single
+ * block big enough for all of it, so after the first few frames the arena
+ * doesn't touch the heap at all.
+ *
+ * An arena must only be used from one thread. Other threads call local()
+ * to get a sub-arena of their own, these are reset along with their parent.
+ */
+class FrameArena {
+public:
+    static const std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    FrameArena(std::size_t block_size=DEFAULT_BLOCK_SIZE);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+    /* Only gives memory back if p was the most recent allocation, anything
+     * else waits for reset() */
+    void deallocate(void* p, std::size_t size);
+
+    /* Frees everything allocated by this arena and its sub-arenas. Must only
+     * be called when no other thread is using them */
+    void reset();
+
+    /* Returns this arena when called on the thread that created it,
+     * otherwise a sub-arena for the calling thread */
+    FrameArena* local();
+
+    /* Counts since the last reset(), including sub-arenas. heap_allocation_count()
+     * is the number of blocks that had to be allocated */
+    uint32_t allocation_count() const;
+    uint32_t heap_allocation_count() const;
+    std::size_t bytes_used() const;
+
+    std::size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        std::size_t size = 0;
+    };
+
+    std::size_t block_size_;
+    thread::ThreadID owner_;
+
+    std::vector<Block> blocks_;
+    std::size_t current_ = 0;
+    std::size_t offset_ = 0;
+
+    uint32_t allocation_count_ = 0;
+    uint32_t heap_allocation_count_ = 0;
+    std::size_t bytes_used_ = 0;
+
+    mutable thread::Mutex children_lock_;
+    std::vector<std::pair<thread::ThreadID, std::unique_ptr<FrameArena>>> children_;
+
+    void push_block(std::size_t size);
+};
+
+/* Lets standard containers allocate from a FrameArena. Containers using this
+ * must be gone by the time the arena is reset */
+template<typename T>
+class FrameAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind {
+        typedef FrameAllocator<U> other;
+    };
+
+    FrameAllocator(FrameArena* arena):
+        arena_(arena) {}
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other):
+        arena_(other.arena()) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        arena_->deallocate(p, n * sizeof(T));
+    }
+
+    FrameArena* arena() const { return arena_; }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>& other) const {
+        return arena_ == other.arena();
+    }
+
+    template<typename U>
+    bool operator!=(const FrameAllocator<U>& other) const {
+        return arena_ != other.arena();
+    }
+
+private:
+    FrameArena* arena_;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+}
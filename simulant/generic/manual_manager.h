@@ -67,14 +67,10 @@ public:
 
             assert(container_);
 
-            // If we've asked for the end, or the container is empty
-            // we return 1 past the final
-            if(pos == POSITION_END || !container_->_size()) {
-                current_ = container_->_capacity();
-            } else {
-                while(!container_->_contains(id_type(current_ + 1))) {
-                    current_++;
-                }
+            // If we've asked for the end we return 1 past the final
+            // live element
+            if(pos == POSITION_END) {
+                current_ = container_->_size();
             }
         }
 
@@ -82,18 +78,7 @@ public:
             /* Check the parent container didn't change */
             assert(change_counter_ == container_->change_counter_);
 
-            while(1) {
-                current_++;
-
-                if(current_ >= container_->_capacity()) {
-                    break;
-                }
-
-                if(container_->_contains(id_type(current_ + 1))) {
-                    break;
-                }
-            }
-
+            current_++;
             return *this;
         }
 
@@ -114,8 +99,7 @@ public:
         reference operator*() const {
             assert(change_counter_ == container_->change_counter_);
 
-            id_type id(current_ + 1);
-            auto ret = container_->_get(id);
+            auto ret = container_->pool_.element_at(current_);
             assert(ret);
             return ret;
         }
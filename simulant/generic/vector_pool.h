@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <cassert>
 #include <utility>
 #include <vector>
-#include <array>
+#include <memory>
+#include <algorithm>
 
 #include "../threads/thread.h"
 #include "../threads/mutex.h"
@@ -13,25 +15,52 @@ namespace smlt {
 
 typedef unsigned char byte;
 
-struct MetaBlock {
-#ifndef NDEBUG
-    // If we're debugging, we add marker bytes between each element
-    // and initalize them to 0xAB we can then assert that these
-    // haven't been overwritten to detect overflows
-    byte marker_byte;
-#endif
-    // We store the next_used item for fast iteration (e.g. skipping free blocks)
-    bool used = false;
-    byte* next_used = nullptr;
-    byte* prev_used = nullptr;
+/*
+ * IDs handed out by a VectorPool hold the slot index (plus one, so zero is
+ * never a valid ID) in the low bits and the slot's generation in the high
+ * bits. A slot's generation is bumped whenever it's released, so an ID
+ * that outlives its object never matches whatever is allocated there next.
+ *
+ * Generations wrap after GENERATION_MASK + 1 reuses of the same slot, and
+ * a pool can hold at most MAX_SLOTS objects.
+ */
+struct PoolHandle {
+    static const uint32_t INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+    static const uint32_t MAX_SLOTS = INDEX_MASK;
+
+    static uint32_t make(uint32_t slot, uint32_t generation) {
+        return ((generation & GENERATION_MASK) << INDEX_BITS) | (slot + 1);
+    }
+
+    /* Returns an out-of-range slot for the null ID */
+    static uint32_t slot(uint32_t value) {
+        return (value & INDEX_MASK) - 1;
+    }
+
+    static uint32_t generation(uint32_t value) {
+        return value >> INDEX_BITS;
+    }
 };
 
+/*
+ * Storage for objects that are created and destroyed often (actors,
+ * particle systems etc.)
+ *
+ * Objects live in fixed size chunks so their addresses never change. Free
+ * slots are kept on a stack so alloc() and release() don't depend on the
+ * size of the pool, and the most recently released (and so most likely
+ * cached) slot is the next one used. Live slots are also kept in a packed
+ * list so they can be iterated without visiting free ones, the order of that
+ * list changes as objects are released.
+ */
 template<typename T, typename IDType, int ChunkSize, typename ...Subtypes>
 class VectorPool {
 public:
     typedef T element_type;
     typedef IDType id_type;
-    typedef byte slot_id;
+    typedef uint32_t slot_id;
 
     template<typename... Others> struct MaxSize {
       static constexpr size_t value = 0;
@@ -44,13 +73,12 @@ public:
     };
 
     const static uint32_t object_size = MaxSize<T, Subtypes...>::value;
-    const static uint32_t element_size_unpadded = object_size + sizeof(MetaBlock);
-    const static uint32_t element_size = element_size_unpadded + (
-        ((element_size_unpadded % 8) != 0) ? (8 - (element_size_unpadded % 8)) : 0
+    const static uint32_t element_size = object_size + (
+        ((object_size % 8) != 0) ? (8 - (object_size % 8)) : 0
     );
     const static uint32_t array_size = element_size * ChunkSize;
 
-    static_assert(ChunkSize < std::numeric_limits<slot_id>::max(), "ChunkSize must be less than 256");
+    static_assert(ChunkSize > 0 && uint32_t(ChunkSize) <= PoolHandle::MAX_SLOTS, "ChunkSize is out of range");
 
     VectorPool() {}
 
@@ -58,108 +86,83 @@ public:
         clear();
     }
 
-    static MetaBlock* meta_block(const byte* element) {
-        if(!element) return nullptr;
-
-        return (MetaBlock*) (element + object_size);
-    }
-
     template<typename U, typename... Args>
     std::pair<id_type, T*> alloc(Args&&... args) {
-        uint32_t i = 0;
-        for(auto& chunk: chunks_) {
-            auto chunk_id = i++;
-
-            if(chunk->used_count_ == ChunkSize) {
-                continue;
-            } else {
-                // We lock the chunk whenever we update metadata
-                thread::Lock<thread::Mutex> g(chunk->lock_);
-
-                byte* new_thing = chunk->alloc_free_slot();
-                assert(new_thing);
-
-                // Hopefully this works... address of the new element, minus the start
-                // should return the number of bytes between the two.
-                slot_id slot = (new_thing - &chunk->elements_[0]) / element_size;
-                id_type id = id_for_chunk_slot(chunk_id, slot);
-
-#ifndef NDEBUG
-                MetaBlock* meta = meta_block(new_thing);
-                assert(meta->used); // Should've been allocated
-#endif
-
-                /* Construct the object, release the slot
-                 * if it throws */
-                T* ret = nullptr;
-                try {
-                    ++chunk->used_count_;
-                    ret = new (new_thing) U(id, args...);
-                    if(!ret->init()) {
-                        ret->clean_up();
-                        ret->~T(); // Call the destructor
-                        throw InstanceInitializationError(typeid(T).name());
-                    }
-                } catch(...) {
-                    chunk->release_slot(new_thing);
-                    --chunk->used_count_;
-                    throw;
-                }
-
-
-                ++size_;
-
-                return std::make_pair(
-                    id,
-                    ret
-                );
+        slot_id slot;
+        byte* addr;
+        id_type id;
+
+        {
+            thread::Lock<thread::Mutex> g(lock_);
+
+            if(free_slots_.empty()) {
+                push_chunk();
             }
+
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+
+            /* The slot counts as used while the object is constructed, as
+             * it always has */
+            link(slot);
+
+            addr = address(slot);
+            id = id_type(PoolHandle::make(slot, slots_[slot].generation));
         }
 
-        // No free chunks
-        push_chunk();
+        /* Construct the object, release the slot
+         * if it throws */
+        T* ret = nullptr;
+        try {
+            ret = new (addr) U(id, args...);
+            if(!ret->init()) {
+                ret->clean_up();
+                ret->~T(); // Call the destructor
+                throw InstanceInitializationError(typeid(T).name());
+            }
+        } catch(...) {
+            thread::Lock<thread::Mutex> g(lock_);
+            unlink(slot);
+            throw;
+        }
 
-        return alloc<U, Args...>(std::forward<Args>(args)...);
+        return std::make_pair(
+            id,
+            ret
+        );
     }
 
+    /* Only true for the current generation of a slot, so stale IDs are
+     * caught without looking at the object itself */
     bool used(id_type id) const {
-        byte* addr = find_address(id);
-        if(!addr) {
-            return false;
-        }
-
-        return meta_block(addr)->used;
+        thread::Lock<thread::Mutex> g(lock_);
+        return is_used(id);
     }
 
+    /* Takes the lock as alloc() on another thread may be adding a chunk */
     T* get(id_type id) const {
-        assert(used(id));
-#ifndef NDEBUG
-        byte* addr = find_address(id);
-        MetaBlock* meta = meta_block(addr);
-        assert(meta->marker_byte == 0xAB);
-        return reinterpret_cast<T*>(addr);
-#else
-        return reinterpret_cast<T*>(find_address(id));
-#endif
+        thread::Lock<thread::Mutex> g(lock_);
+        assert(is_used(id));
+        return reinterpret_cast<T*>(address(PoolHandle::slot(id.value())));
     }
 
     void release(id_type id) {
-        assert(used(id));
+        auto slot = PoolHandle::slot(id.value());
+        T* element = nullptr;
 
-        auto p = find_chunk_and_slot(id);
-        T* element = get(id);
+        {
+            thread::Lock<thread::Mutex> g(lock_);
+            assert(is_used(id));
+            element = reinterpret_cast<T*>(address(slot));
+        }
 
         assert(element);
         element->clean_up();
         // Call the destructor
         element->~T();
 
-        thread::Lock<thread::Mutex> g(p.first->lock_);
-        p.first->release_slot((uint8_t*) element);
-
-        // Decrement the used count on the chunk
-        p.first->used_count_--;
-        --size_;
+        thread::Lock<thread::Mutex> g(lock_);
+        unlink(slot);
     }
 
     std::size_t capacity() const {
@@ -167,36 +170,35 @@ public:
     }
 
     std::size_t size() const {
-        return size_;
+        return live_.size();
     }
 
-    void clear() {
-        /* Release all the slots, but don't delete the chunks */
-        std::size_t chunk_id = 0;
-        for(auto& chunk: chunks_) {
-            while(chunk->first_used_) {
-
-#ifndef NDEBUG
-                auto meta = meta_block(chunk->first_used_);
-                assert(meta->used);
-#endif
-
-                assert(chunk->used_count_);
-
-                slot_id slot = (chunk->first_used_ - &chunk->elements_[0]) / element_size;
-                id_type id = id_for_chunk_slot(chunk_id, slot);
-                release(id);
+    /* The live objects, in no particular order. i must be less than size()
+     * and any alloc() or release() invalidates the order */
+    T* element_at(std::size_t i) const {
+        assert(i < live_.size());
+        return reinterpret_cast<T*>(address(live_[i]));
+    }
 
-                assert(!meta->used);
-            }
+    id_type id_at(std::size_t i) const {
+        assert(i < live_.size());
+        auto slot = live_[i];
+        return id_type(PoolHandle::make(slot, slots_[slot].generation));
+    }
 
-            ++chunk_id;
+    void clear() {
+        /* Release all the slots, but don't delete the chunks. Releasing
+         * one object may release others so go from the back each time */
+        while(!live_.empty()) {
+            release(id_at(live_.size() - 1));
         }
     }
 
     void shrink_to_fit() {
+        thread::Lock<thread::Mutex> g(lock_);
+
         /* Remove empty chunks from the back */
-        while(chunks_.size() && chunks_.back()->used_count_ == 0) {
+        while(chunks_.size() && chunk_empty(chunks_.size() - 1)) {
             pop_chunk();
         }
     }
@@ -206,233 +208,107 @@ public:
     }
 
 private:
-    thread::Mutex chunk_lock_;
-
-    struct Chunk {
-        Chunk() {
-            // Make sure everything is zeroed out to start
-            std::fill(elements_, elements_ + array_size, 0);
-
-            // Get a pointer to the first meta block (which follows the object)
-            MetaBlock* meta = (MetaBlock*) &elements_[object_size];
-
-            // Initialise all the meta blocks across the whole thing
-            for(auto i = 0; i < ChunkSize; ++i) {
-#ifndef NDEBUG
-                // Set marker bytes (to detect corruption) if in debug mode
-                meta->marker_byte = 0;
-#endif
-                meta->next_used = nullptr;
-                meta->prev_used = nullptr;
-                meta->used = false;
-            }
-        }
+    const static uint32_t NOT_LIVE = ~0u;
 
-        void release_slot(byte* addr) {
-            auto meta = meta_block(addr);
+    struct Slot {
+        uint32_t generation = 0;
 
-#ifndef NDEBUG
-            assert(meta->marker_byte == 0xAB);
-            meta->marker_byte = 0;
-#endif
-
-            if(first_used_ == addr) {
-                first_used_ = meta->next_used;
+        /* Index into live_, or NOT_LIVE */
+        uint32_t live = NOT_LIVE;
+    };
 
-                // If we are wiping first used, then the size should be 1 (reducing to zero)
-                assert((first_used_) ? used_count_ > 1 : used_count_ == 1);
-            }
+    struct Chunk {
+        /* Force 8-byte alignment */
+        byte elements_[array_size] __attribute__((aligned(8)));
+    };
 
-            if(meta->prev_used) {
-                auto prev_meta = meta_block(meta->prev_used);
-                prev_meta->next_used = meta->next_used;
-            }
+    mutable thread::Mutex lock_;
 
-            if(meta->next_used) {
-                auto next_meta = meta_block(meta->next_used);
-                next_meta->prev_used = meta->prev_used;
-            }
+    std::vector<std::unique_ptr<Chunk>> chunks_;
 
-            meta->used = false;
-        }
+    /* One per slot that has ever existed. This isn't shrunk along with the
+     * chunks so generations survive shrink_to_fit() */
+    std::vector<Slot> slots_;
 
-        byte* alloc_free_slot() {
-            if(this->used_count_ == ChunkSize) {
-                return nullptr;
-            }
+    std::vector<slot_id> free_slots_;
+    std::vector<slot_id> live_;
 
-            auto insert_before = [](byte* after) -> byte* {
-                auto this_addr = after - element_size;
-                auto after_meta = meta_block(after);
-                auto this_meta = meta_block(this_addr);
-
-                assert(!this_meta->used);
-#ifndef NDEBUG
-                assert(this_meta->marker_byte == 0);
-#endif
-
-                if(after_meta->prev_used) {
-                    auto prev_meta = meta_block(after_meta->prev_used);
-                    prev_meta->next_used = this_addr;
-                }
-
-                this_meta->prev_used = after_meta->prev_used;
-                this_meta->next_used = after;
-                after_meta->prev_used = this_addr;
-
-                this_meta->used = true;
-#ifndef NDEBUG
-                this_meta->marker_byte = 0xAB;
-#endif
-                return this_addr;
-            };
-
-            auto insert_after = [](byte* before) -> byte* {
-                auto before_meta = meta_block(before);
-                auto this_addr = before + element_size;
-                auto this_meta = meta_block(this_addr);
-
-                assert(!this_meta->used);
-#ifndef NDEBUG
-                assert(this_meta->marker_byte == 0);
-#endif
-
-                if(before_meta->next_used) {
-                    auto next_meta = meta_block(before_meta->next_used);
-                    next_meta->prev_used = this_addr;
-                }
-
-                this_meta->next_used = before_meta->next_used;
-                this_meta->prev_used = before;
-                before_meta->next_used = this_addr;
-
-                this_meta->used = true;
-#ifndef NDEBUG
-                this_meta->marker_byte = 0xAB;
-#endif
-                return this_addr;
-            };
-
-            if(!first_used_) {
-                byte* it = &elements_[0];
-                auto meta = meta_block(it);
-
-                assert(!meta->used);
-#ifndef NDEBUG
-                assert(meta->marker_byte == 0);
-                meta->marker_byte = 0xAB;
-#endif
-
-                meta->used = true;
-                meta->next_used = meta->prev_used = nullptr;
-                first_used_ = it;
-                return it;
-            } else {
-                byte* it = first_used_;
-
-                while(it) {
-                    /* First we look behind this element, if that is unused
-                     * then we've jumped over a gap and we can use it */
-                    if(it != &elements_[0]) {
-                        auto to_alloc = it - element_size;
-                        auto to_alloc_meta = meta_block(to_alloc);
-
-                        if(!to_alloc_meta->used) {
-                            auto ret = insert_before(it);
-                            if(first_used_ == it) {
-                                first_used_ = ret;
-                            }
-                            return ret;
-                        }
-                    }
-
-                    auto next = meta_block(it)->next_used;
-
-                    if(!next) {
-                        /* We've reached the final used block, but, is there
-                         * space afterwards? */
-                        next = it + element_size;
-                        if(next < &elements_[array_size]) {
-                            return insert_after(it);
-                        } else {
-                            // No space left!
-                            assert(0 && "This shouldn't happen, should be caught by used_count check at the top of this function");
-                            return nullptr;
-                        }
-                    }
-
-                    it = next;
-                }
-
-                return nullptr;
-            }
+    bool is_used(id_type id) const {
+        auto slot = PoolHandle::slot(id.value());
+        if(slot >= slots_.size()) {
+            return false;
         }
 
-        /* Force 8-byte alignment */
-        byte elements_[array_size] __attribute__((aligned(8)));
+        auto& s = slots_[slot];
+        return s.live != NOT_LIVE && s.generation == PoolHandle::generation(id.value());
+    }
 
-        thread::Mutex lock_;
-        byte* first_used_ = nullptr;
-        byte used_count_ = 0;
-    };
+    byte* address(slot_id slot) const {
+        return &chunks_[slot / ChunkSize]->elements_[(slot % ChunkSize) * element_size];
+    }
 
-    std::vector<std::shared_ptr<Chunk>> chunks_;
+    void link(slot_id slot) {
+        auto& s = slots_[slot];
+        assert(s.live == NOT_LIVE);
 
-    void push_chunk() {
-        thread::Lock<thread::Mutex> g(chunk_lock_);
-        chunks_.push_back(std::make_shared<Chunk>());
+        s.live = live_.size();
+        live_.push_back(slot);
     }
 
-    void pop_chunk() {
-        auto chunk_id = chunks_.size() - 1;
-        auto chunk = chunks_.at(chunk_id);
+    void unlink(slot_id slot) {
+        auto& s = slots_[slot];
+        assert(s.live != NOT_LIVE);
 
-        auto first_used = chunk->first_used_;
-        while(first_used) {
-            auto meta = meta_block(first_used);
-            assert(meta->used);
+        /* Swap the last live slot into this one's place */
+        auto last = live_.back();
+        live_[s.live] = last;
+        slots_[last].live = s.live;
+        live_.pop_back();
 
-            slot_id slot = (first_used - &chunk->elements_[0]) / element_size;
-            id_type id = id_for_chunk_slot(chunk_id, slot);
-            release(id);
+        s.live = NOT_LIVE;
+        s.generation = (s.generation + 1) & PoolHandle::GENERATION_MASK;
 
-            assert(!meta->used);
-            first_used = meta->next_used;
+        free_slots_.push_back(slot);
+    }
+
+    bool chunk_empty(std::size_t chunk_id) const {
+        for(std::size_t i = chunk_id * ChunkSize; i < (chunk_id + 1) * ChunkSize; ++i) {
+            if(slots_[i].live != NOT_LIVE) {
+                return false;
+            }
         }
 
-        thread::Lock<thread::Mutex> g(chunk_lock_);
-        chunks_.pop_back();
+        return true;
     }
 
-    std::pair<Chunk*, slot_id> find_chunk_and_slot(id_type id) const {
-        assert(id.value() > 0);
+    void push_chunk() {
+        const slot_id first = capacity();
+        const slot_id end = first + ChunkSize;
+
+        assert(end <= PoolHandle::MAX_SLOTS);
 
-        // We must subtract one from the id value
-        auto v = id.value() - 1;
-        auto idx = v / ChunkSize;
-        slot_id slot = (v % ChunkSize);
+        chunks_.push_back(std::unique_ptr<Chunk>(new Chunk()));
 
-        if(idx >= chunks_.size() || slot >= ChunkSize) {
-            return std::make_pair(nullptr, 0);
+        if(slots_.size() < end) {
+            slots_.resize(end);
         }
 
-        return std::make_pair(chunks_[idx].get(), slot);
+        /* Pushed in reverse so that the lowest slot is used first */
+        for(slot_id i = end; i > first; --i) {
+            free_slots_.push_back(i - 1);
+        }
     }
 
-    id_type id_for_chunk_slot(uint32_t chunk_id, slot_id slot) {
-        return ((chunk_id * ChunkSize) + slot) + 1;
-    }
+    void pop_chunk() {
+        const slot_id first = capacity() - ChunkSize;
 
-    byte* find_address(id_type id) const {
-        auto chunk = find_chunk_and_slot(id);
-        if(!chunk.first) {
-            return nullptr;
-        }
+        free_slots_.erase(
+            std::remove_if(free_slots_.begin(), free_slots_.end(), [first](slot_id s) { return s >= first; }),
+            free_slots_.end()
+        );
 
-        return &chunk.first->elements_[chunk.second * element_size];
+        chunks_.pop_back();
     }
-
-    uint32_t size_ = 0;
 };
 
 
@@ -0,0 +1,88 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "headless_window.h"
+#include "input/input_state.h"
+#include "renderers/null/null_renderer.h"
+#include "sound_drivers/null_sound_driver.h"
+
+namespace smlt {
+
+HeadlessWindow::HeadlessWindow(uint32_t width, uint32_t height, uint32_t bpp, bool fullscreen, bool enable_vsync):
+    Window(width, height, bpp, fullscreen, enable_vsync) {
+
+    platform_.reset(new HeadlessPlatform);
+
+    /* Take one fixed step per frame regardless of real time */
+    time_keeper->set_forced_delta_time(time_keeper->fixed_step());
+}
+
+HeadlessWindow::~HeadlessWindow() {
+    try {
+        _clean_up();
+    } catch(...) {
+        L_ERROR("There was a problem shutting down the Window. Ignoring.");
+    }
+}
+
+void HeadlessWindow::cursor_position(int32_t& mouse_x, int32_t& mouse_y) {
+    mouse_x = mouse_y = 0;
+}
+
+NullRenderer* HeadlessWindow::null_renderer() const {
+    return static_cast<NullRenderer*>(renderer_.get());
+}
+
+bool HeadlessWindow::create_window() {
+    L_DEBUG("Creating headless window");
+
+    /* There is no real context, but there's nothing stopping us rendering */
+    set_has_context(true);
+    renderer_->init_context();
+
+    return true;
+}
+
+void HeadlessWindow::destroy_window() {
+    set_has_context(false);
+}
+
+std::shared_ptr<Renderer> HeadlessWindow::create_renderer() {
+    return std::make_shared<NullRenderer>(this);
+}
+
+std::shared_ptr<SoundDriver> HeadlessWindow::create_sound_driver() {
+    return std::make_shared<NullSoundDriver>(this);
+}
+
+void HeadlessWindow::initialize_input_controller(InputState& controller) {
+    MouseDeviceInfo mouse;
+    mouse.id = 0;
+    mouse.button_count = 3;
+    mouse.axis_count = 2;
+
+    KeyboardDeviceInfo keyboard;
+    keyboard.id = 0;
+
+    controller._update_keyboard_devices({keyboard});
+    controller._update_mouse_devices({mouse});
+    controller._update_joystick_devices({});
+}
+
+}
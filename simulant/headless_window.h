@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * A window that never opens anything. It uses the NullRenderer and the
+ * NullSoundDriver so it runs anywhere, including machines without a GPU.
+ *
+ * Every frame advances time by exactly one fixed step no matter how long
+ * it took, so the same application produces the same frames each run. This
+ * makes it useful for measuring the CPU cost of a frame.
+ */
+
+#include "window.h"
+#include "platform.h"
+
+namespace smlt {
+
+class NullRenderer;
+
+class HeadlessWindow : public Window {
+    class HeadlessPlatform : public Platform {
+    public:
+        std::string name() const override { return "headless"; }
+    };
+
+public:
+    static Window::ptr create(Application* app, int width, int height, int bpp, bool fullscreen, bool enable_vsync) {
+        return Window::create<HeadlessWindow>(app, width, height, bpp, fullscreen, enable_vsync);
+    }
+
+    HeadlessWindow(uint32_t width, uint32_t height, uint32_t bpp, bool fullscreen, bool enable_vsync);
+    virtual ~HeadlessWindow();
+
+    void set_title(const std::string&) override {} // No-op
+    void cursor_position(int32_t& mouse_x, int32_t& mouse_y) override;
+    void show_cursor(bool) override {} // No-op
+    void lock_cursor(bool) override {} // No-op
+
+    void check_events() override {} // No-op
+    void swap_buffers() override {} // No-op
+
+    /* The renderer, for reading back what would have been drawn */
+    NullRenderer* null_renderer() const;
+
+private:
+    bool create_window() override;
+    void destroy_window() override;
+
+    std::shared_ptr<Renderer> create_renderer() override;
+    std::shared_ptr<SoundDriver> create_sound_driver() override;
+
+    void initialize_input_controller(InputState& controller) override;
+};
+
+}
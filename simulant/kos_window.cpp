@@ -8,9 +8,12 @@
 
 #include "sound_drivers/openal_sound_driver.h"
 #include "sound_drivers/null_sound_driver.h"
+#include "sound_drivers/software_sound_driver.h"
+#include "sound_drivers/openal_audio_sink.h"
 
 #include "renderers/renderer_config.h"
 #include "utils/memory.h"
+#include "utils/gl_error.h"
 
 namespace smlt {
 
@@ -32,6 +35,7 @@ KOSWindow::KOSWindow(uint32_t width, uint32_t height, uint32_t bpp, bool fullscr
 
 void KOSWindow::swap_buffers() {
     glKosSwapBuffers();
+    GLChecker::end_of_frame_check();
 }
 
 bool KOSWindow::create_window() {
@@ -294,6 +298,12 @@ std::shared_ptr<SoundDriver> KOSWindow::create_sound_driver() {
     if(selected == "null") {
         L_DEBUG("Null sound driver activated");
         return std::make_shared<NullSoundDriver>(this);
+    } else if(selected == "software") {
+        L_DEBUG("Software sound driver activated");
+        return std::make_shared<SoftwareSoundDriver>(this, std::make_shared<OpenALAudioSink>());
+    } else if(selected == "wav") {
+        L_DEBUG("Software sound driver activated, writing to simulant.wav");
+        return std::make_shared<SoftwareSoundDriver>(this, std::make_shared<WAVAudioSink>("simulant.wav"));
     } else {
         if(selected != "openal") {
             L_WARN(_F("Unknown sound driver ({0}) falling back to OpenAL").format(selected));
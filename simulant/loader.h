@@ -168,6 +168,17 @@ struct MeshLoadOptions {
      * force disabled. This is useful on the Dreamcast where having blending enabled
      * is costly */
     bool blending_enabled = true;
+
+    /* If set, MeshOptimizer is run over the mesh after loading. This merges
+     * duplicate vertices and reorders the vertices and indices so the mesh
+     * renders faster, but vertex and triangle order is no longer file order */
+    bool optimize = false;
+
+    /* If this has positions, the vertex data is repacked into it after loading
+     * (and after optimizing) whatever format the loader used. Set it to
+     * VertexSpecification::COMPACT to shrink the vertices. Animated meshes
+     * are left as they are. */
+    VertexSpecification repack_specification;
 };
 
 #define MESH_LOAD_OPTIONS_KEY "mesh_options"
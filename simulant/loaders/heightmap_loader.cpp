@@ -17,13 +17,55 @@
 //     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <cmath>
+
 #include "heightmap_loader.h"
 #include "../meshes/mesh.h"
 #include "../asset_manager.h"
+#include "../window.h"
+#include "../threads/thread_pool.h"
 #include "texture_loader.h"
 
 namespace smlt {
 
+Vec3 TerrainData::position(int32_t x, int32_t z) const {
+    return Vec3(
+        (float(x) * grid_spacing) - (grid_spacing * float(x_size) * 0.5f),
+        height(x, z),
+        (float(z) * grid_spacing) - (grid_spacing * float(z_size) * 0.5f)
+    );
+}
+
+Vec3 TerrainData::normal(int32_t x, int32_t z) const {
+    /* Central differences, or one-sided ones along the edges */
+    int32_t x0 = std::max(x - 1, 0);
+    int32_t x1 = std::min(x + 1, int32_t(x_size) - 1);
+    int32_t z0 = std::max(z - 1, 0);
+    int32_t z1 = std::min(z + 1, int32_t(z_size) - 1);
+
+    float dx = (x1 > x0) ? (height(x0, z) - height(x1, z)) / (float(x1 - x0) * grid_spacing) : 0.0f;
+    float dz = (z1 > z0) ? (height(x, z0) - height(x, z1)) / (float(z1 - z0) * grid_spacing) : 0.0f;
+
+    return Vec3(dx, 1.0f, dz).normalized();
+}
+
+float TerrainData::height_at(float x, float z) const {
+    float gx = (x + (grid_spacing * float(x_size) * 0.5f)) / grid_spacing;
+    float gz = (z + (grid_spacing * float(z_size) * 0.5f)) / grid_spacing;
+
+    gx = std::min(std::max(gx, 0.0f), float(x_size - 1));
+    gz = std::min(std::max(gz, 0.0f), float(z_size - 1));
+
+    int32_t x0 = int32_t(gx);
+    int32_t z0 = int32_t(gz);
+    float fx = gx - float(x0);
+    float fz = gz - float(z0);
+
+    float top = height(x0, z0) + (height(x0 + 1, z0) - height(x0, z0)) * fx;
+    float bottom = height(x0, z0 + 1) + (height(x0 + 1, z0 + 1) - height(x0, z0 + 1)) * fx;
+    return top + (bottom - top) * fz;
+}
+
 namespace terrain {
     // Mesh helper functions specific to heightmaps
 
@@ -32,7 +74,8 @@ float get_height_at(MeshPtr terrain, float x_point, float z_point) {
      * Returns the interpolated height of the terrain at the specified location
      */
 
-    return 0.0f;
+    TerrainData data = terrain->data->get<TerrainData>("terrain_data");
+    return data.height_at(x_point, z_point);
 }
 
 Vec3 get_vertex_at(MeshPtr terrain, int x, int z) {
@@ -145,6 +188,150 @@ void smooth_terrain(MeshPtr terrain, uint32_t iterations) {
     _smooth_terrain(terrain.get(), iterations);
 }
 
+static void smooth_heights(thread::ThreadPool* pool, std::vector<float>& heights, int32_t width, int32_t height, uint32_t iterations) {
+    // http://nic-gamedev.blogspot.co.uk/2013/02/simple-terrain-smoothing.html
+
+    /* Each point becomes the average of itself and its neighbours. Every row
+     * reads from the previous iteration, so the rows can be done in parallel */
+    std::vector<float> smoothed(heights.size());
+
+    for(uint32_t i = 0; i < iterations; ++i) {
+        auto smooth_rows = [&](std::size_t begin, std::size_t end) {
+            for(int32_t z = begin; z < int32_t(end); ++z) {
+                for(int32_t x = 0; x < width; ++x) {
+                    float total = 0.0f;
+                    int32_t count = 0;
+
+                    for(int32_t nz = std::max(z - 1, 0); nz <= std::min(z + 1, height - 1); ++nz) {
+                        for(int32_t nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); ++nx) {
+                            total += heights[(nz * width) + nx];
+                            ++count;
+                        }
+                    }
+
+                    smoothed[(z * width) + x] = total / float(count);
+                }
+            }
+        };
+
+        if(pool) {
+            pool->parallel_for(height, 16, smooth_rows);
+        } else {
+            smooth_rows(0, height);
+        }
+
+        std::swap(heights, smoothed);
+    }
+}
+
+void build_terrain(Mesh* mesh, uint32_t x_size, uint32_t z_size, std::vector<float> heights, const HeightmapSpecification& spec) {
+    if(heights.size() != std::size_t(x_size) * std::size_t(z_size)) {
+        throw std::logic_error("The number of heights doesn't match the size of the terrain");
+    }
+
+    float range = spec.max_height - spec.min_height;
+    for(auto& h: heights) {
+        h = spec.min_height + (range * h);
+    }
+
+    if(spec.smooth_iterations) {
+        auto window = mesh->asset_manager().window.get();
+        auto pool = (window) ? window->worker_pool.get() : nullptr;
+        smooth_heights(pool, heights, x_size, z_size, spec.smooth_iterations);
+    }
+
+    // Add some properties for the user to access if they need to
+    TerrainData data;
+    data.x_size = x_size;
+    data.z_size = z_size;
+    data.min_height = spec.min_height;
+    data.max_height = spec.max_height;
+    data.grid_spacing = spec.spacing;
+    data.texcoord0_repeat = spec.texcoord0_repeat;
+    data.heights = std::make_shared<std::vector<float>>(std::move(heights));
+    mesh->data->stash(data, "terrain_data");
+
+    smlt::MaterialPtr mat = mesh->asset_manager().clone_default_material();
+
+    if(!spec.generate_mesh) {
+        mesh->new_submesh_with_material("terrain", mat, MESH_ARRANGEMENT_TRIANGLES, INDEX_TYPE_16_BIT);
+        return;
+    }
+
+    const int patch_size = 100;
+
+    int patches_across = std::ceil(float(x_size) / float(patch_size));
+    int patches_down = std::ceil(float(z_size) / float(patch_size));
+
+    int total_patches = patches_across * patches_down;
+
+    auto index_type = (x_size * z_size > std::numeric_limits<uint16_t>::max()) ?
+        INDEX_TYPE_32_BIT : INDEX_TYPE_16_BIT;
+
+    // We divide the heightmap into patches for more efficient rendering
+    std::vector<smlt::SubMesh*> submeshes;
+    for(int i = 0; i < total_patches; ++i) {
+        submeshes.push_back(mesh->new_submesh_with_material(
+            std::to_string(i), mat, MESH_ARRANGEMENT_TRIANGLES, index_type
+        ));
+        submeshes.back()->index_data->reserve(patch_size * patch_size);
+    }
+
+    int32_t height = (int32_t) z_size;
+    int32_t width = (int32_t) x_size;
+    int32_t largest = std::max(width, height);
+
+    mesh->vertex_data->resize(width * height);
+
+    // Generate the vertices from the heightmap
+    for(int32_t z = 0; z < height; ++z) {
+        for(int32_t x = 0; x < width; ++x) {
+            int32_t idx = (z * width) + x;
+
+            mesh->vertex_data->position(data.position(x, z));
+            mesh->vertex_data->normal(
+                (spec.calculate_normals) ? data.normal(x, z) : Vec3(0, 1, 0)
+            );
+
+            mesh->vertex_data->diffuse(smlt::Colour::WHITE);
+
+            // First texture coordinate takes into account texture_repeat setting
+            mesh->vertex_data->tex_coord0(
+                (spec.texcoord0_repeat / float(largest)) * float(x),
+                (spec.texcoord0_repeat / float(largest)) * float(z)
+            );
+
+            // Second texture coordinate makes the texture span the entire terrain
+            mesh->vertex_data->tex_coord1(
+                (1.0f / float(width)) * float(x),
+                (1.0f / float(height)) * float(z)
+            );
+
+            mesh->vertex_data->move_next();
+
+            if(z < (height - 1) && x < (width - 1)) {
+                int patch_x = (x / float(patch_size));
+                int patch_z = (z / float(patch_size));
+                int patch_idx = (patch_z * patches_across) + patch_x;
+
+                auto sm = submeshes.at(patch_idx);
+                sm->index_data->index(idx);
+                sm->index_data->index(idx + width);
+                sm->index_data->index(idx + 1);
+
+                sm->index_data->index(idx + 1);
+                sm->index_data->index(idx + width);
+                sm->index_data->index(idx + width + 1);
+            }
+        }
+    }
+
+    for(auto sm: submeshes) {
+        sm->index_data->done();
+    }
+    mesh->vertex_data->done();
+}
+
 }
 
 
@@ -251,35 +438,7 @@ void HeightmapLoader::into(Loadable &resource, const LoaderOptions &options) {
         throw std::logic_error("Creating a heightmap from a compressed texture is currently unimplemented");
     }
 
-    float range = spec.max_height - spec.min_height;
-
-    float x_offset = (spec.spacing * float(tex->width())) * 0.5f;
-    float z_offset = (spec.spacing * float(tex->height())) * 0.5f;
-
-    const int patch_size = 100;
-
-    int patches_across = std::ceil(float(tex->width()) / float(patch_size));
-    int patches_down = std::ceil(float(tex->height()) / float(patch_size));
-
-    int total_patches = patches_across * patches_down;
-
-    auto index_type = (tex->width() * tex->height() > std::numeric_limits<uint16_t>::max()) ?
-        INDEX_TYPE_32_BIT : INDEX_TYPE_16_BIT;
-
-    // We divide the heightmap into patches for more efficient rendering
-    smlt::MaterialPtr mat = mesh->asset_manager().clone_default_material();
-    std::vector<smlt::SubMesh*> submeshes;
-    for(int i = 0; i < total_patches; ++i) {
-        submeshes.push_back(mesh->new_submesh_with_material(
-            std::to_string(i), mat, MESH_ARRANGEMENT_TRIANGLES, index_type
-        ));
-        submeshes.back()->index_data->reserve(patch_size * patch_size);
-    }
-
-    int32_t height = (int32_t) tex->height();
-    int32_t width = (int32_t) tex->width();
-    int32_t largest = std::max(width, height);
-    int32_t total = width * height;
+    int32_t total = tex->width() * tex->height();
 
     std::vector<float> heights(total);
     auto& tex_data = tex->data();
@@ -288,108 +447,13 @@ void HeightmapLoader::into(Loadable &resource, const LoaderOptions &options) {
         heights[i] = float(tex_data[i * stride]) / 256.0f;
     }
 
-    // Add some properties for the user to access if they need to
-    TerrainData data;
-    data.x_size = width;
-    data.z_size = height;
-    data.min_height = spec.min_height;
-    data.max_height = spec.max_height;
-    data.grid_spacing = spec.spacing;
-    mesh->data->stash(data, "terrain_data");
-
-    // Generate the vertices from the heightmap
-    for(int32_t z = 0; z < height; ++z) {
-        for(int32_t x = 0; x < width; ++x) {
-            int32_t idx = (z * width) + x;
-
-            float normalized_height = heights[idx];
-            float depth = range * normalized_height;
-            float final_pos = spec.min_height + depth;
-
-            Vec3 pos = Vec3(
-                (float(x) * spec.spacing) - x_offset,
-                final_pos,
-                (float(z) * spec.spacing) - z_offset
-            );
-            mesh->vertex_data->position(pos);
-            mesh->vertex_data->normal(Vec3(0, 1, 0));
-
-            mesh->vertex_data->diffuse(smlt::Colour::WHITE);
-
-            // First texture coordinate takes into account texture_repeat setting
-            mesh->vertex_data->tex_coord0(
-                (spec.texcoord0_repeat / float(largest)) * float(x),
-                (spec.texcoord0_repeat / float(largest)) * float(z)
-            );
-
-            // Second texture coordinate makes the texture span the entire terrain
-            mesh->vertex_data->tex_coord1(
-                (1.0f / float(width)) * float(x),
-                (1.0f / float(height)) * float(z)
-            );
-
-            mesh->vertex_data->move_next();
-
-            if(z < (height - 1) && x < (width - 1)) {
-                int patch_x = (x / float(patch_size));
-                int patch_z = (z / float(patch_size));
-                int patch_idx = (patch_z * patches_across) + patch_x;
-
-                auto sm = submeshes.at(patch_idx);
-                sm->index_data->index(idx);
-                sm->index_data->index(idx + width);
-                sm->index_data->index(idx + 1);
-
-                sm->index_data->index(idx + 1);
-                sm->index_data->index(idx + width);
-                sm->index_data->index(idx + width + 1);
-            }
-        }
-    }
-
-    if(spec.smooth_iterations) {
-        terrain::_smooth_terrain(mesh, spec.smooth_iterations);
-    }
-
-    if(spec.calculate_normals) {
-        // The mesh don't have any normals, let's generate some!
-        std::unordered_map<int, smlt::Vec3> index_to_normal;
-
-        for(auto sm: submeshes) {
-            // Go through all the triangles, add the face normal to all the vertices
-            for(uint32_t i = 0; i < sm->index_data->count(); i+=3) {
-                Index idx1 = sm->index_data->at(i);
-                Index idx2 = sm->index_data->at(i+1);
-                Index idx3 = sm->index_data->at(i+2);
-
-                auto v1 = sm->vertex_data->position_at<Vec3>(idx1);
-                auto v2 = sm->vertex_data->position_at<Vec3>(idx2);
-                auto v3 = sm->vertex_data->position_at<Vec3>(idx3);
-
-                smlt::Vec3 normal = (*v2 - *v1).normalized().cross((*v3 - *v1).normalized()).normalized();
-
-                index_to_normal[idx1] += normal;
-                index_to_normal[idx2] += normal;
-                index_to_normal[idx3] += normal;
-            }
-        }
-
-        // Now set the normal on the vertex data
-        for(auto p: index_to_normal) {
-            mesh->vertex_data->move_to(p.first);
-            auto n = p.second.normalized();
-            mesh->vertex_data->normal(n);
-        }
-    }
-
-    for(auto sm: submeshes) {
-        sm->index_data->done();
-    }
-    mesh->vertex_data->done();
+    uint32_t width = tex->width();
+    uint32_t height = tex->height();
 
     mesh->asset_manager().destroy_texture(tex->id()); //Finally delete the texture
+
+    terrain::build_terrain(mesh, width, height, std::move(heights), spec);
 }
 
 }
 }
-
@@ -20,6 +20,8 @@
 #define HEIGHTMAP_LOADER_H
 
 #include <functional>
+#include <memory>
+#include <vector>
 #include "../loader.h"
 
 namespace smlt {
@@ -32,6 +34,28 @@ struct TerrainData {
     float max_height;
     float min_height;
     float grid_spacing;
+    float texcoord0_repeat;
+
+    /* The final height of every grid point, row by row (z * x_size + x).
+     * Copies of the TerrainData share this, as it can be very large */
+    std::shared_ptr<std::vector<float>> heights;
+
+    /* The height of a grid point, points outside the grid are clamped to the edge */
+    float height(int32_t x, int32_t z) const {
+        x = (x < 0) ? 0 : (x >= int32_t(x_size)) ? int32_t(x_size) - 1 : x;
+        z = (z < 0) ? 0 : (z >= int32_t(z_size)) ? int32_t(z_size) - 1 : z;
+        return (*heights)[(z * x_size) + x];
+    }
+
+    /* The position of a grid point in the terrain's space */
+    Vec3 position(int32_t x, int32_t z) const;
+
+    /* The surface normal at a grid point */
+    Vec3 normal(int32_t x, int32_t z) const;
+
+    /* The height of the terrain surface at a point in the terrain's space,
+     * interpolated from the four surrounding grid points */
+    float height_at(float x, float z) const;
 };
 
 
@@ -43,6 +67,9 @@ void recalculate_terrain_normals(smlt::MeshPtr terrain);
 void smooth_terrain(smlt::MeshPtr terrain, uint32_t iterations=20);
 TextureID generate_alphamap(smlt::MeshPtr terrain, AlphaMapWeightFunc func);
 
+/* Returns the interpolated height of the terrain at x, z in the mesh's space */
+float get_height_at(MeshPtr terrain, float x_point, float z_point);
+
 }
 
 struct HeightmapSpecification {
@@ -52,8 +79,27 @@ struct HeightmapSpecification {
     uint32_t smooth_iterations = 0;
     bool calculate_normals = true;
     float texcoord0_repeat = 4.0f;
+
+    /* If false, only the TerrainData is built and the mesh is left with a
+     * single empty submesh to carry the material. The mesh can then only be
+     * drawn by a Geom with GEOM_CULLER_TYPE_TERRAIN, which builds the
+     * geometry for the visible chunks as it needs it. Use this for big
+     * heightmaps, a full resolution 4096x4096 mesh needs over 500M of
+     * vertex data. */
+    bool generate_mesh = true;
 };
 
+namespace terrain {
+
+/*
+ * Builds a terrain into mesh from a grid of x_size * z_size heights in the
+ * range 0 to 1, row by row. This is what the heightmap loader does with the
+ * pixels of the image, and is useful for generated terrain.
+ */
+void build_terrain(Mesh* mesh, uint32_t x_size, uint32_t z_size, std::vector<float> heights, const HeightmapSpecification& spec);
+
+}
+
 namespace loaders {
 
 class HeightmapLoader : public Loader {
@@ -62,9 +108,6 @@ public:
         Loader(filename, data) {}
 
     void into(Loadable& resource, const LoaderOptions& options = LoaderOptions());
-
-private:
-    void smooth_terrain_iteration(Mesh *mesh, int width, int height);
 };
 
 class HeightmapLoaderType : public LoaderType {
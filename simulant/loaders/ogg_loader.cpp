@@ -22,6 +22,7 @@
 
 #include "../logging.h"
 #include "../sound.h"
+#include "../audio_stream.h"
 
 namespace smlt {
 namespace loaders {
@@ -42,58 +43,82 @@ private:
     stb_vorbis* vorbis_;
 };
 
-int32_t queue_buffer(std::weak_ptr<Sound> sound, StreamWrapper::ptr stream, AudioBufferID buffer) {
-    std::shared_ptr<Sound> self = sound.lock();
-    if(!self) {
-        // The sound was destroyed, we can't stream without a sound so just bail
-        return 0;
+/*
+ * Decodes on the audio thread. The stream keeps the sound alive, as
+ * stb_vorbis reads straight from the sound's data
+ */
+class OGGStream : public AudioStream {
+public:
+    OGGStream(std::shared_ptr<Sound> sound):
+        AudioStream(sound->format(), sound->sample_rate(), sound->buffer_size()),
+        sound_(sound),
+        channels_(sound->channels()),
+        vorbis_(stb_vorbis_open_memory(&sound->data()[0], sound->data().size(), nullptr, nullptr)) {
+
     }
 
-    std::vector<int16_t> pcm;
-    int s = self->buffer_size();
-    pcm.resize(s);
-
-    size_t size = 0;
-    int result = 0;
-
-    while(size < self->buffer_size()) {
-        // 'result' is the total number of samples per channel
-        result = stb_vorbis_get_samples_short_interleaved(
-            stream->get(),
-            self->channels(),
-            &pcm[0] + (size / 2),  // Size is in bytes, we need shorts
-            self->buffer_size() - size
-        );
-
-        if(result > 0)  {
-            // samples-per-channel * channels * size of each sample
-            // so this is the total bytes we just read
-            size += result * self->channels() * sizeof(int16_t);
-        } else {
-            break;
+    ~OGGStream() {
+        if(vorbis_) {
+            stb_vorbis_close(vorbis_);
         }
     }
 
-    if(size == 0) {
-        return 0;
+    bool is_valid() const { return vorbis_ != nullptr; }
+
+private:
+    std::size_t decode(uint8_t* out, std::size_t max_bytes) override {
+        int16_t* pcm = reinterpret_cast<int16_t*>(out);
+
+        // Keep whole frames, so a chunk never splits a sample between channels
+        std::size_t max_shorts = (max_bytes / sizeof(int16_t) / channels_) * channels_;
+        std::size_t shorts = 0;
+
+        while(shorts < max_shorts) {
+            // 'result' is the number of samples per channel
+            int result = stb_vorbis_get_samples_short_interleaved(
+                vorbis_, channels_, pcm + shorts, max_shorts - shorts
+            );
+
+            if(result <= 0) {
+                break;
+            }
+
+            shorts += result * channels_;
+        }
+
+        return shorts * sizeof(int16_t);
     }
 
-    self->_driver()->upload_buffer_data(buffer, self->format(), (uint8_t*) &pcm[0], size * sizeof(int16_t), self->sample_rate());
-    return size;
+    std::shared_ptr<Sound> sound_;
+    int channels_;
+    stb_vorbis* vorbis_;
+};
+
+static int32_t queue_buffer(std::shared_ptr<AudioStreamHandle> handle, SoundDriver* driver, AudioBufferID buffer) {
+    return handle->stream()->queue_buffer(driver, buffer);
 }
 
+/* Sources start by queuing this many buffers, so decode them up front */
+static const std::size_t PRIMED_CHUNKS = 2;
+
 static void init_source(Sound* self, SourceInstance& source) {
     /*
-     *  This is either smart or crazy and I haven't worked out which yet...
-     *
-     *  Create a new stream from the supplied sound, wrap it in a smart pointer and bind it to the Source's stream function.
-     *
-     *  This means the source knows nothing about the sound or the stream, and we don't need to store any stb_vorbis specific
-     *  data on the Source, well, not explicitly.
+     *  Each source gets its own decoder which is registered with the driver's audio
+     *  thread. The stream func holds the only handle so when the source is destroyed
+     *  (or restarted) the decoder is unregistered and freed.
      */
 
-    StreamWrapper::ptr stream(new StreamWrapper(stb_vorbis_open_memory(&self->data()[0], self->data().size(), nullptr, nullptr)));
-    source.set_stream_func(std::bind(&queue_buffer, self->shared_from_this(), stream, std::placeholders::_1));
+    auto stream = std::make_shared<OGGStream>(self->shared_from_this());
+    if(!stream->is_valid()) {
+        L_WARN("Unable to open the OGG stream");
+        return;
+    }
+
+    stream->prime(PRIMED_CHUNKS);
+
+    SoundDriver* driver = self->_driver();
+    auto handle = std::make_shared<AudioStreamHandle>(driver->stream_thread(), stream);
+    source.set_stream_func(std::bind(&queue_buffer, handle, driver, std::placeholders::_1));
 }
 
 
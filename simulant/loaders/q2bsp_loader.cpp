@@ -26,6 +26,7 @@
 #include "../vfs.h"
 #include "../stage.h"
 #include "../meshes/mesh.h"
+#include "../meshes/bsp_tree.h"
 #include "../types.h"
 #include "../nodes/light.h"
 #include "../nodes/camera.h"
@@ -336,6 +337,16 @@ void Q2BSPLoader::into(Loadable& resource, const LoaderOptions &options) {
     read_lump(file, header, Q2::LumpType::LIGHTMAPS, lightmap_data);
     read_lump(file, header, Q2::LumpType::EDGES, edges);
 
+    std::vector<Q2::Node> nodes;
+    std::vector<Q2::Leaf> leaves;
+    std::vector<uint16_t> leaf_faces;
+    std::vector<uint8_t> visibility;
+
+    read_lump(file, header, Q2::LumpType::NODES, nodes);
+    read_lump(file, header, Q2::LumpType::LEAVES, leaves);
+    read_lump(file, header, Q2::LumpType::LEAF_FACE_TABLE, leaf_faces);
+    read_lump(file, header, Q2::LumpType::VISIBILITY, visibility);
+
     std::for_each(vertices.begin(), vertices.end(), [&](Q2::Point3f& vert) {
         vert = vert.transformed_by(rotation);
     });
@@ -393,6 +404,11 @@ void Q2BSPLoader::into(Loadable& resource, const LoaderOptions &options) {
 
     std::vector<std::set<uint32_t>> face_indexes(faces.size());
 
+    /* The range of indexes each BSP face ended up as, so that the tree can
+     * refer to them. Faces with no material have no entry */
+    auto tree = std::make_shared<BSPTree>();
+    std::vector<int32_t> tree_face_for(faces.size(), -1);
+
     int32_t face_id = -1;
     for(Q2::Face& f: faces) {
         FaceUVLimits uv_limit;
@@ -423,6 +439,7 @@ void Q2BSPLoader::into(Loadable& resource, const LoaderOptions &options) {
         }
 
         SubMesh* sm = submeshes_by_material.at(material_id);
+        uint32_t first_index = sm->index_data->count();
 
         /*
          *  A unique vertex is defined by a combination of the position ID and the
@@ -501,8 +518,102 @@ void Q2BSPLoader::into(Loadable& resource, const LoaderOptions &options) {
         uv_limit.min = Vec2(min_u, min_v);
         uv_limit.max = Vec2(max_u, max_v);
         uv_limits.push_back(uv_limit);
+
+        BSPFace tree_face;
+        tree_face.submesh = sm->name();
+        tree_face.first_index = first_index;
+        tree_face.index_count = sm->index_data->count() - first_index;
+
+        tree_face_for[&f - &faces[0]] = tree->faces.size();
+        tree->faces.push_back(tree_face);
     }
 
+    /*
+     * Build the BSP tree and decompress the PVS, this is what allows the
+     * BSP culler to skip everything that can't be seen from the camera's cluster
+     */
+    for(auto& plane: planes) {
+        BSPPlane p;
+        p.normal = plane.normal.rotated_by(rotation);
+        p.distance = plane.distance; // The rotation is about the origin, so distance is unchanged
+        tree->planes.push_back(p);
+    }
+
+    /* The tree is walked with these indices as they are, so anything pointing
+     * outside the lumps means the file is broken */
+    auto valid_child = [&](int32_t child) -> bool {
+        return (child >= 0) ? uint32_t(child) < nodes.size() : uint32_t(-(child + 1)) < leaves.size();
+    };
+
+    for(auto& node: nodes) {
+        if(node.plane >= planes.size() || !valid_child(node.front_child) || !valid_child(node.back_child)) {
+            throw std::runtime_error("Not a valid Q2 map");
+        }
+
+        BSPNode n;
+        n.plane = node.plane;
+        n.children[0] = node.front_child;
+        n.children[1] = node.back_child;
+        tree->nodes.push_back(n);
+    }
+
+    for(auto& leaf: leaves) {
+        BSPLeaf l;
+        l.cluster = (leaf.cluster == 0xFFFF) ? -1 : int32_t(leaf.cluster);
+
+        Vec3 corners[] = {
+            Vec3(leaf.bbox_min.x, leaf.bbox_min.y, leaf.bbox_min.z).transformed_by(rotation),
+            Vec3(leaf.bbox_max.x, leaf.bbox_max.y, leaf.bbox_max.z).transformed_by(rotation)
+        };
+        l.bounds = AABB(corners, 2);
+
+        if(uint32_t(leaf.first_leaf_face + leaf.num_leaf_faces) > leaf_faces.size()) {
+            throw std::runtime_error("Not a valid Q2 map");
+        }
+
+        for(uint32_t i = leaf.first_leaf_face; i < uint32_t(leaf.first_leaf_face + leaf.num_leaf_faces); ++i) {
+            if(leaf_faces[i] >= faces.size()) {
+                throw std::runtime_error("Not a valid Q2 map");
+            }
+
+            auto face = tree_face_for[leaf_faces[i]];
+            if(face >= 0) {
+                l.faces.push_back(face);
+            }
+        }
+
+        tree->leaves.push_back(l);
+    }
+
+    if(visibility.size() >= sizeof(uint32_t)) {
+        uint32_t cluster_count = *reinterpret_cast<uint32_t*>(&visibility[0]);
+        auto offsets = reinterpret_cast<Q2::VisibilityOffsets*>(&visibility[sizeof(uint32_t)]);
+
+        if(sizeof(uint32_t) + uint64_t(cluster_count) * sizeof(Q2::VisibilityOffsets) <= visibility.size()) {
+            std::vector<uint8_t> rows;
+            rows.reserve(cluster_count * ((cluster_count + 7) / 8));
+
+            for(uint32_t i = 0; i < cluster_count; ++i) {
+                auto row = BSPTree::decompress_row(&visibility[0], visibility.size(), offsets[i].pvs, cluster_count);
+                rows.insert(rows.end(), row.begin(), row.end());
+            }
+
+            tree->set_visibility(cluster_count, std::move(rows));
+        } else {
+            L_WARN("Quake 2 visibility data is truncated, ignoring");
+        }
+    }
+
+    if(tree->has_visibility()) {
+        for(auto& leaf: tree->leaves) {
+            if(leaf.cluster >= int32_t(tree->cluster_count())) {
+                throw std::runtime_error("Not a valid Q2 map");
+            }
+        }
+    }
+
+    mesh->data->stash(tree, BSPTree::DATA_KEY);
+
     L_WARN("About to pack lightmaps");
 
     auto lightmaps = extract_lightmaps(lightmap_data, faces, uv_limits);
@@ -110,6 +110,35 @@ struct Face {
     uint32_t lightmap_offset;   // offset of the lightmap (in bytes) in the lightmap lump
 };
 
+struct Node {
+    uint32_t plane;
+    int32_t front_child;        // negative children are leaves: -(leaf + 1)
+    int32_t back_child;
+    Point3s bbox_min;
+    Point3s bbox_max;
+    uint16_t first_face;
+    uint16_t num_faces;
+};
+
+struct Leaf {
+    uint32_t brush_or;          // contents of the leaf
+    uint16_t cluster;           // 0xFFFF if the leaf is solid
+    uint16_t area;
+    Point3s bbox_min;
+    Point3s bbox_max;
+    uint16_t first_leaf_face;   // index into the leaf face table
+    uint16_t num_leaf_faces;
+    uint16_t first_leaf_brush;
+    uint16_t num_leaf_brushes;
+};
+
+/* The visibility lump starts with a cluster count, followed by one of these
+ * per cluster. Offsets are from the start of the lump */
+struct VisibilityOffsets {
+    uint32_t pvs;
+    uint32_t phs;
+};
+
 struct Lump {
     uint32_t offset;
     uint32_t length;
@@ -2,6 +2,7 @@
 #include <cassert>
 #include <stdexcept>
 #include "logging.h"
+#include "threads/condition.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -68,36 +69,245 @@ void StdIOHandler::do_write_message(Logger* logger,
         }
 }
 
+const char* level_name(LogLevel level) {
+    switch(level) {
+        case LOG_LEVEL_DEBUG: return "DEBUG";
+        case LOG_LEVEL_INFO: return "INFO";
+        case LOG_LEVEL_WARN: return "WARN";
+        case LOG_LEVEL_ERROR: return "ERROR";
+        default: return "NONE";
+    }
+}
+
+/*
+ * A fixed size ring of log records, shared by every async logger and drained
+ * by a single writer thread. Producers only hold the lock long enough to move
+ * a record into a slot, all of the formatting and I/O happens on the writer.
+ *
+ * We don't have <atomic> on every platform we support (see threads/atomic.h)
+ * so this is guarded by a mutex rather than being lock-free, but the critical
+ * section is tiny and never does any I/O.
+ */
+class AsyncLogWriter {
+public:
+    static const std::size_t CAPACITY = 1024;
+
+    AsyncLogWriter():
+        slots_(CAPACITY),
+        thread_(&AsyncLogWriter::run, this) {
+
+        thread_id_ = thread_.id();
+    }
+
+    void push(Logger* logger, LogRecord&& record) {
+        thread::Lock<thread::Mutex> g(lock_);
+
+        while(size_ == slots_.size()) {
+            /* Not worth stalling the caller for. Handlers logging from the
+             * writer thread can't wait for themselves to make space at all */
+            if(record.level > LOG_LEVEL_WARN || thread::this_thread_id() == thread_id_) {
+                ++dropped_;
+                return;
+            }
+
+            space_.wait(lock_);
+        }
+
+        auto& slot = slots_[(head_ + size_) % slots_.size()];
+        slot.logger = logger;
+        slot.record = std::move(record);
+
+        ++size_;
+        ++pushed_;
+
+        data_.notify_one();
+    }
+
+    void flush() {
+        /* Handlers can't wait on themselves */
+        if(thread::this_thread_id() == thread_id_) {
+            return;
+        }
+
+        thread::Lock<thread::Mutex> g(lock_);
+        auto target = pushed_;
+        while(written_ < target) {
+            flushed_.wait(lock_);
+        }
+    }
+
+private:
+    struct Slot {
+        Logger* logger = nullptr;
+        LogRecord record;
+    };
+
+    thread::Mutex lock_;
+    thread::Condition data_;
+    thread::Condition space_;
+    thread::Condition flushed_;
+
+    std::vector<Slot> slots_;
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+
+    uint64_t pushed_ = 0;
+    uint64_t written_ = 0;
+    uint32_t dropped_ = 0;
+
+    thread::Thread thread_;
+    thread::ThreadID thread_id_ = 0;
+
+    void run() {
+        std::vector<Slot> batch;
+        batch.reserve(CAPACITY);
+
+        while(true) {
+            uint32_t dropped = 0;
+
+            {
+                thread::Lock<thread::Mutex> g(lock_);
+                while(!size_) {
+                    data_.wait(lock_);
+                }
+
+                for(std::size_t i = 0; i < size_; ++i) {
+                    batch.push_back(std::move(slots_[(head_ + i) % slots_.size()]));
+                }
+
+                head_ = (head_ + size_) % slots_.size();
+                size_ = 0;
+
+                dropped = dropped_;
+                dropped_ = 0;
+
+                space_.notify_all();
+            }
+
+            if(dropped) {
+                LogRecord record;
+                record.time = std::chrono::system_clock::now();
+                record.level = LOG_LEVEL_WARN;
+                record.thread_id = thread_id_;
+                record.file = __FILE__;
+                record.line = __LINE__;
+
+                std::stringstream ss;
+                ss << dropped << " log messages were dropped because the log buffer was full";
+                record.text = ss.str();
+
+                root_logger()->_write_record(record);
+            }
+
+            for(auto& slot: batch) {
+                slot.logger->_write_record(slot.record);
+            }
+
+            {
+                thread::Lock<thread::Mutex> g(lock_);
+                written_ += batch.size();
+                flushed_.notify_all();
+            }
+
+            batch.clear();
+        }
+    }
+};
+
+static AsyncLogWriter* log_writer(bool create=true) {
+    /* Static deinitialization hack, like the loggers this is never destroyed */
+    static thread::Mutex lock;
+    static AsyncLogWriter* writer = nullptr;
+
+    thread::Lock<thread::Mutex> g(lock);
+    if(!writer && create) {
+        writer = new AsyncLogWriter();
+    }
+
+    return writer;
+}
+
+void Logger::write_message(LogLevel level, const std::string& text,
+                   const std::string& file, int32_t line) {
+
+    LogRecord record;
+    record.time = std::chrono::system_clock::now();
+    record.level = level;
+    record.thread_id = thread::this_thread_id();
+    record.line = line;
+    record.file = file;
+    record.text = text;
+
+    if(async_) {
+        auto writer = log_writer();
+        writer->push(this, std::move(record));
+
+        /* Make sure errors are visible before we carry on, in case the
+         * application is about to fall over */
+        if(level == LOG_LEVEL_ERROR) {
+            writer->flush();
+        }
+    } else {
+        _write_record(record);
+    }
+}
+
+void Logger::_write_record(const LogRecord& record) {
+    std::stringstream s;
+    s << record.thread_id << ": ";
+    s << record.text << " (" << record.file << ":" << record.line << ")";
+
+    thread::Lock<thread::Mutex> g(handler_lock_);
+    for(uint32_t i = 0; i < handlers_.size(); ++i) {
+        handlers_[i]->write_message(this, record.time, level_name(record.level), s.str());
+    }
+}
+
+void Logger::flush() {
+    flush_logs();
+}
+
+void flush_logs() {
+    auto writer = log_writer(false);
+    if(writer) {
+        writer->flush();
+    }
+}
+
 void debug(const std::string& text, const std::string& file, int32_t line) {
-    get_logger("/")->debug(text, file, line);
+    root_logger()->debug(text, file, line);
 }
 
 void info(const std::string& text, const std::string& file, int32_t line) {
-    get_logger("/")->info(text, file, line);
+    root_logger()->info(text, file, line);
 }
 
 void warn(const std::string& text, const std::string& file, int32_t line) {
-    get_logger("/")->warn(text, file, line);
+    root_logger()->warn(text, file, line);
 }
 
 void warn_once(const std::string& text, const std::string& file, int32_t line) {
-    get_logger("/")->warn_once(text, file, line);
+    root_logger()->warn_once(text, file, line);
 }
 
 void error(const std::string& text, const std::string& file, int32_t line) {
-    get_logger("/")->error(text, file, line);
+    root_logger()->error(text, file, line);
 }
 
+Logger* root_logger() {
+    /* Static deinitialization hack, destructors won't get called! */
+    static Logger* root = new Logger("/");
+    return root;
+}
 
 Logger* get_logger(const std::string& name) {
     typedef std::unordered_map<std::string, Logger::ptr> LoggerMap;
 
     /* Static deinitialization hack, destructors won't get called! */
-    static Logger* root = new Logger("/");
     static LoggerMap* loggers_ = new LoggerMap();
 
     if(name.empty() || name == "/") {
-        return root;
+        return root_logger();
     } else {
         if(loggers_->find(name) == loggers_->end()) {
             loggers_->insert(std::make_pair(name, std::make_shared<Logger>(name)));
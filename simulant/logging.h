@@ -133,6 +133,22 @@ private:
     std::ofstream stream_;
 };
 
+/*
+ * Everything about a log call, kept in binary form. Turning this into text
+ * (including the timestamp) happens when it's written, which for async
+ * loggers is on the log writer thread.
+ */
+struct LogRecord {
+    DateTime time;
+    LogLevel level = LOG_LEVEL_NONE;
+    thread::ThreadID thread_id = 0;
+    int32_t line = -1;
+    std::string file;
+    std::string text;
+};
+
+const char* level_name(LogLevel level);
+
 class Logger {
 public:
     typedef std::shared_ptr<Logger> ptr;
@@ -147,25 +163,26 @@ public:
 
     void add_handler(Handler::ptr handler) {
         //FIXME: check it doesn't exist already
+        thread::Lock<thread::Mutex> g(handler_lock_);
         handlers_.push_back(handler);
     }
 
     void debug(const std::string& text, const std::string& file="None", int32_t line=-1) {
         if(level_ < LOG_LEVEL_DEBUG) return;
 
-        write_message("DEBUG", text, file, line);
+        write_message(LOG_LEVEL_DEBUG, text, file, line);
     }
 
     void info(const std::string& text, const std::string& file="None", int32_t line=-1) {
         if(level_ < LOG_LEVEL_INFO) return;
 
-        write_message("INFO", text, file, line);
+        write_message(LOG_LEVEL_INFO, text, file, line);
     }
 
     void warn(const std::string& text, const std::string& file="None", int32_t line=-1) {
         if(level_ < LOG_LEVEL_WARN) return;
 
-        write_message("WARN", text, file, line);
+        write_message(LOG_LEVEL_WARN, text, file, line);
     }
 
     void warn_once(const std::string& text, const std::string& file="None", int32_t line=-1) {
@@ -193,31 +210,54 @@ public:
     void error(const std::string& text, const std::string& file="None", int32_t line=-1) {
         if(level_ < LOG_LEVEL_ERROR) return;
 
-        write_message("ERROR", text, file, line);
+        write_message(LOG_LEVEL_ERROR, text, file, line);
     }
 
     void set_level(LogLevel level) {
         level_ = level;
     }
 
-private:
-    void write_message(const std::string& level, const std::string& text,
-                       const std::string& file, int32_t line) {
-
-        std::stringstream s;
-        s << thread::this_thread_id() << ": ";
-        s << text << " (" << file << ":" << Formatter("{0}").format(line) << ")";
-        for(uint32_t i = 0; i < handlers_.size(); ++i) {
-            handlers_[i]->write_message(this, std::chrono::system_clock::now(), level, s.str());
-        }
+    /* The L_* macros check this before building the message, so nothing
+     * is formatted for levels which are filtered out */
+    bool is_enabled(LogLevel level) const {
+        return level_ >= level;
     }
 
+    /*
+     * When async, messages are queued in a ring buffer and written by a
+     * background thread, so logging only costs the caller a copy of the
+     * message. If the buffer fills up, debug and info messages are dropped
+     * (and the number dropped is logged) while warnings and errors wait
+     * for space. Errors are always flushed before error() returns.
+     */
+    void set_async(bool value) {
+        async_ = value;
+    }
+
+    bool is_async() const { return async_; }
+
+    /* Blocks until every message queued by async loggers has been written */
+    void flush();
+
+    /* Formats a record and passes it to each handler */
+    void _write_record(const LogRecord& record);
+
+private:
+    void write_message(LogLevel level, const std::string& text,
+                       const std::string& file, int32_t line);
+
     std::string name_;
+
+    thread::Mutex handler_lock_;
     std::vector<Handler::ptr> handlers_;
 
     LogLevel level_;
+    bool async_ = false;
 };
 
+/* The same as get_logger("/"), without the string comparison */
+Logger* root_logger();
+
 Logger* get_logger(const std::string& name);
 
 void debug(const std::string& text, const std::string& file="None", int32_t line=-1);
@@ -226,17 +266,24 @@ void warn(const std::string& text, const std::string& file="None", int32_t line=
 void warn_once(const std::string& text, const std::string& file="None", int32_t line=-1);
 void error(const std::string& text, const std::string& file="None", int32_t line=-1);
 
+/* Waits for any queued messages to be written out */
+void flush_logs();
+
 
 class DebugScopedLog {
 public:
     DebugScopedLog(const std::string& text, const std::string& file, uint32_t line):
         text_(text) {
 
-        debug(smlt::Formatter("Enter: {0} ({1}, {2})").format(text, file, line));
+        if(root_logger()->is_enabled(LOG_LEVEL_DEBUG)) {
+            debug(smlt::Formatter("Enter: {0} ({1}, {2})").format(text, file, line));
+        }
     }
 
     ~DebugScopedLog() {
-        debug(smlt::Formatter("Exit: {0}").format(text_));
+        if(root_logger()->is_enabled(LOG_LEVEL_DEBUG)) {
+            debug(smlt::Formatter("Exit: {0}").format(text_));
+        }
     }
 
 private:
@@ -247,30 +294,43 @@ private:
 
 typedef smlt::Formatter _F;
 
+/*
+ * The level is checked before txt is evaluated, so any _F(...).format(...)
+ * in a filtered out log call costs nothing.
+ */
+
+#define _SMLT_LOG(logger, level, method, txt) \
+    do { \
+        smlt::Logger* _smlt_logger = (logger); \
+        if(_smlt_logger->is_enabled(level)) { \
+            _smlt_logger->method((txt), __FILE__, __LINE__); \
+        } \
+    } while(0)
+
 #define L_DEBUG(txt) \
-    smlt::debug((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::root_logger(), smlt::LOG_LEVEL_DEBUG, debug, txt)
 
 #define L_INFO(txt) \
-    smlt::info((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::root_logger(), smlt::LOG_LEVEL_INFO, info, txt)
 
 #define L_WARN(txt) \
-    smlt::warn((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::root_logger(), smlt::LOG_LEVEL_WARN, warn, txt)
 
 #define L_WARN_ONCE(txt) \
-    smlt::warn_once((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::root_logger(), smlt::LOG_LEVEL_WARN, warn_once, txt)
 
 #define L_ERROR(txt) \
-    smlt::error((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::root_logger(), smlt::LOG_LEVEL_ERROR, error, txt)
 
 #define L_DEBUG_N(name, txt) \
-    smlt::get_logger((name))->debug((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::get_logger((name)), smlt::LOG_LEVEL_DEBUG, debug, txt)
 
 #define L_INFO_N(name, txt) \
-    smlt::get_logger((name))->info((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::get_logger((name)), smlt::LOG_LEVEL_INFO, info, txt)
 
 #define L_WARN_N(name, txt) \
-    smlt::get_logger((name))->warn((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::get_logger((name)), smlt::LOG_LEVEL_WARN, warn, txt)
 
 #define L_ERROR_N(name, txt) \
-    smlt::get_logger((name))->error((txt), __FILE__, __LINE__)
+    _SMLT_LOG(smlt::get_logger((name)), smlt::LOG_LEVEL_ERROR, error, txt)
 
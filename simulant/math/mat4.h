@@ -66,6 +66,14 @@ public:
 
     Vec4 operator*(const Vec4& rhs) const;
 
+    bool operator==(const Mat4& rhs) const {
+        return memcmp(m, rhs.m, sizeof(float) * 16) == 0;
+    }
+
+    bool operator!=(const Mat4& rhs) const {
+        return !(*this == rhs);
+    }
+
     void extract_rotation_and_translation(Quaternion& rotation, Vec3& translation) const;
 
     static Mat4 as_rotation_x(const Degrees& angle);
@@ -24,11 +24,13 @@ void AdjacencyInfo::rebuild() {
     }
 
     edges_.clear();
+    faces_ = AdjacencyFaces();
+    edge_arrays_ = AdjacencyEdges();
 
     typedef std::tuple<uint32_t, uint32_t> edge_pair;
     typedef std::tuple<float, float, float> vec_tuple;
     std::unordered_map<vec_tuple, uint32_t> position_map;
-    std::unordered_map<edge_pair, uint32_t> edge_triangles;
+    std::unordered_map<edge_pair, uint32_t> edge_faces;
 
     // FIXME: handle other types
     if(mesh_->vertex_data->vertex_specification().position_attribute != VERTEX_ATTRIBUTE_3F) {
@@ -37,21 +39,13 @@ void AdjacencyInfo::rebuild() {
     }
 
     auto vertices = mesh_->vertex_data.get();
-    auto calculate_normal = [&vertices](uint32_t a, uint32_t b, uint32_t c) -> smlt::Vec3 {
-        auto va = vertices->position_at<smlt::Vec3>(a);
-        auto vb = vertices->position_at<smlt::Vec3>(b);
-        auto vc = vertices->position_at<smlt::Vec3>(c);
-        auto v1 = *vb - *va;
-        auto v2 = *vc - *va;
-        return v1.cross(v2).normalized();
-    };
 
     auto size = mesh_->vertex_data->count();
 
     for(auto submesh: mesh_->each_submesh()) {
         if(!submesh->contributes_to_edge_list()) {
             // Ignore submeshes which don't contribute to the edge list
-            return;
+            continue;
         }
 
         submesh->each_triangle([&](uint32_t a, uint32_t b, uint32_t c) {
@@ -60,21 +54,52 @@ void AdjacencyInfo::rebuild() {
             assert(b < size);
             assert(c < size);
 
-            auto v1 = to_tuple(*vertices->position_at<smlt::Vec3>(a));
-            auto v2 = to_tuple(*vertices->position_at<smlt::Vec3>(b));
-            auto v3 = to_tuple(*vertices->position_at<smlt::Vec3>(c));
+            auto& va = *vertices->position_at<smlt::Vec3>(a);
+            auto& vb = *vertices->position_at<smlt::Vec3>(b);
+            auto& vc = *vertices->position_at<smlt::Vec3>(c);
+
+            auto v1 = to_tuple(va);
+            auto v2 = to_tuple(vb);
+            auto v3 = to_tuple(vc);
 
             // If this vertex already exist, use the first known index (or insert this as the first known index)
             a = (position_map.count(v1)) ? position_map[v1] : position_map.insert(std::make_pair(v1, a)).first->second;
             b = (position_map.count(v2)) ? position_map[v2] : position_map.insert(std::make_pair(v2, b)).first->second;
             c = (position_map.count(v3)) ? position_map[v3] : position_map.insert(std::make_pair(v3, c)).first->second;
 
-            edge_triangles.insert(std::make_pair(std::make_pair(a, b), c));
-            edge_triangles.insert(std::make_pair(std::make_pair(b, c), a));
-            edge_triangles.insert(std::make_pair(std::make_pair(c, a), b));
+            uint32_t face = faces_.size();
+            auto n = (vb - va).cross(vc - va).normalized();
+
+            faces_.nx.push_back(n.x);
+            faces_.ny.push_back(n.y);
+            faces_.nz.push_back(n.z);
+            faces_.d.push_back(-n.dot(va));
+            faces_.indexes[0].push_back(a);
+            faces_.indexes[1].push_back(b);
+            faces_.indexes[2].push_back(c);
+
+            edge_faces.insert(std::make_pair(std::make_pair(a, b), face));
+            edge_faces.insert(std::make_pair(std::make_pair(b, c), face));
+            edge_faces.insert(std::make_pair(std::make_pair(c, a), face));
         });
     }
 
+    /* Returns the vertex of the face which isn't on the edge */
+    auto opposite = [this](uint32_t face, uint32_t i0, uint32_t i1) -> uint32_t {
+        for(auto& idx: faces_.indexes) {
+            auto v = idx[face];
+            if(v != i0 && v != i1) {
+                return v;
+            }
+        }
+
+        return faces_.indexes[0][face];
+    };
+
+    auto normal = [this](uint32_t face) -> Vec3 {
+        return Vec3(faces_.nx[face], faces_.ny[face], faces_.nz[face]);
+    };
+
     /*
        (0, 1) -> 2
        (1, 2) -> 3,
@@ -82,11 +107,11 @@ void AdjacencyInfo::rebuild() {
     */
 
     // For performance
-    edges_.reserve(edge_triangles.size());
+    edges_.reserve(edge_faces.size());
 
     std::unordered_map<std::tuple<uint32_t, uint32_t>, std::size_t> edge_lookup;
 
-    for(auto& p: edge_triangles) {
+    for(auto& p: edge_faces) {
         /* Checking only for reversed is intentional because of polygon winding
          * an edge can only be shared if it's in the opposite direction */
         auto i0 = std::get<0>(p.first);
@@ -99,35 +124,31 @@ void AdjacencyInfo::rebuild() {
 
         if(existing != edge_lookup.end()) {
             auto& existing_edge = edges_[existing->second];
-            existing_edge.triangle_indexes[1] = p.second;
+            existing_edge.triangle_indexes[1] = opposite(p.second, i0, i1);
             existing_edge.triangle_count = 2;
-            existing_edge.normals[1] = calculate_normal(
-                existing_edge.indexes[1],
-                existing_edge.indexes[0],
-                existing_edge.triangle_indexes[1]
-            );
+            existing_edge.normals[1] = normal(p.second);
+
+            edge_arrays_.face1[existing->second] = p.second;
         } else {
             // Add the new edge
             EdgeInfo new_info;
             new_info.indexes[0] = i0;
             new_info.indexes[1] = i1;
-            new_info.triangle_indexes[0] = p.second;
+            new_info.triangle_indexes[0] = opposite(p.second, i0, i1);
             new_info.triangle_count = 1;
-            new_info.normals[0] = calculate_normal(new_info.indexes[0], new_info.indexes[1], new_info.triangle_indexes[0]);
+            new_info.normals[0] = normal(p.second);
 
             edges_.push_back(new_info);
 
+            edge_arrays_.v0.push_back(i0);
+            edge_arrays_.v1.push_back(i1);
+            edge_arrays_.face0.push_back(p.second);
+            edge_arrays_.face1.push_back(-1);
+
             auto t = std::make_tuple(new_info.indexes[0], new_info.indexes[1]);
             edge_lookup.insert(std::make_pair(t, edges_.size() - 1));
         }
     }
 }
 
-void AdjacencyInfo::each_edge(const std::function<void (std::size_t, const EdgeInfo& edge)>& cb) {
-    std::size_t i = 0;
-    for(auto& edge: edges_) {
-        cb(i++, edge);
-    }
-}
-
 }
@@ -22,17 +22,60 @@ struct EdgeInfo {
     smlt::Vec3 normals[2]; // Triangle normals
 };
 
+/*
+ * Structure-of-arrays copies of the adjacency data. These are what the silhouette
+ * code works on, as classifying every face against a light is then a straight
+ * run over contiguous floats which the compiler can vectorize.
+ */
+struct AdjacencyFaces {
+    /* Face planes: dot(n, p) + d == 0 */
+    std::vector<float> nx;
+    std::vector<float> ny;
+    std::vector<float> nz;
+    std::vector<float> d;
+
+    /* The (position-welded) vertex indexes of each face */
+    std::vector<uint32_t> indexes[3];
+
+    std::size_t size() const { return nx.size(); }
+};
+
+struct AdjacencyEdges {
+    std::vector<uint32_t> v0;
+    std::vector<uint32_t> v1;
+
+    /* Faces either side of the edge, face1 is -1 if the edge is open */
+    std::vector<int32_t> face0;
+    std::vector<int32_t> face1;
+
+    std::size_t size() const { return v0.size(); }
+};
+
 class AdjacencyInfo {
 public:
     AdjacencyInfo(Mesh* mesh);
     void rebuild();
 
     uint32_t edge_count() const { return edges_.size(); }
-    void each_edge(const std::function<void (std::size_t, const EdgeInfo &)> &cb);
+    uint32_t face_count() const { return faces_.size(); }
+
+    template<typename Func>
+    void each_edge(Func&& cb) const {
+        std::size_t i = 0;
+        for(auto& edge: edges_) {
+            cb(i++, edge);
+        }
+    }
+
+    const AdjacencyFaces& faces() const { return faces_; }
+    const AdjacencyEdges& edges() const { return edge_arrays_; }
+
 private:
     Mesh* mesh_ = nullptr;
     std::vector<EdgeInfo> edges_;
 
+    AdjacencyFaces faces_;
+    AdjacencyEdges edge_arrays_;
 };
 
 }
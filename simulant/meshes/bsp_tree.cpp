@@ -0,0 +1,153 @@
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "bsp_tree.h"
+
+namespace smlt {
+
+const char* BSPTree::DATA_KEY = "bsp_tree";
+
+int32_t BSPTree::find_leaf(const Vec3& point) const {
+    if(nodes.empty()) {
+        return (leaves.empty()) ? -1 : 0;
+    }
+
+    /* A tree never visits a node twice on the way down, so taking more steps
+     * than there are nodes means the children form a loop */
+    int32_t idx = 0;
+    for(std::size_t steps = 0; idx >= 0; ++steps) {
+        if(steps == nodes.size()) {
+            return -1;
+        }
+
+        auto& node = nodes[idx];
+        auto& plane = planes[node.plane];
+
+        float d = plane.normal.dot(point) - plane.distance;
+        idx = node.children[(d >= 0.0f) ? 0 : 1];
+    }
+
+    return -(idx + 1);
+}
+
+int32_t BSPTree::find_cluster(const Vec3& point) const {
+    auto leaf = find_leaf(point);
+    return (leaf < 0) ? -1 : leaves[leaf].cluster;
+}
+
+void BSPTree::set_visibility(uint32_t cluster_count, std::vector<uint8_t> rows) {
+    cluster_count_ = cluster_count;
+    visibility_ = std::move(rows);
+
+    assert(visibility_.size() == cluster_count_ * row_stride());
+}
+
+const uint8_t* BSPTree::visible_clusters(int32_t from) const {
+    if(!has_visibility() || from < 0 || uint32_t(from) >= cluster_count_) {
+        return nullptr;
+    }
+
+    return &visibility_[from * row_stride()];
+}
+
+bool BSPTree::is_cluster_visible(int32_t from, int32_t to) const {
+    if(to < 0) {
+        return false;
+    }
+
+    auto row = visible_clusters(from);
+    if(!row) {
+        return true;
+    }
+
+    return (row[to >> 3] & (1 << (to & 7))) != 0;
+}
+
+bool BSPTree::leaf_visible(int32_t leaf, const uint8_t* row) const {
+    auto cluster = leaves[leaf].cluster;
+    if(cluster < 0) {
+        return false;
+    }
+
+    return !row || (row[cluster >> 3] & (1 << (cluster & 7))) != 0;
+}
+
+bool BSPTree::is_aabb_potentially_visible(const AABB& box, const uint8_t* row) const {
+    if(!row) {
+        return true;
+    }
+
+    if(nodes.empty()) {
+        return !leaves.empty() && leaf_visible(0, row);
+    }
+
+    auto centre = (box.min() + box.max()) * 0.5f;
+    auto extents = (box.max() - box.min()) * 0.5f;
+
+    /* Walk down every side of the tree the box touches, stopping at the
+     * first visible leaf */
+    std::vector<int32_t> pending = {0};
+    std::size_t visited = 0;
+    while(!pending.empty()) {
+        auto idx = pending.back();
+        pending.pop_back();
+
+        if(idx < 0) {
+            if(leaf_visible(-(idx + 1), row)) {
+                return true;
+            }
+            continue;
+        }
+
+        /* Only possible if the children loop, assume the box can be seen */
+        if(++visited > nodes.size()) {
+            return true;
+        }
+
+        auto& node = nodes[idx];
+        auto& plane = planes[node.plane];
+
+        float d = plane.normal.dot(centre) - plane.distance;
+        float r = (
+            std::abs(plane.normal.x) * extents.x +
+            std::abs(plane.normal.y) * extents.y +
+            std::abs(plane.normal.z) * extents.z
+        );
+
+        if(d >= -r) {
+            pending.push_back(node.children[0]);
+        }
+
+        if(d < r) {
+            pending.push_back(node.children[1]);
+        }
+    }
+
+    return false;
+}
+
+std::vector<uint8_t> BSPTree::decompress_row(const uint8_t* data, std::size_t size, uint32_t offset, uint32_t cluster_count) {
+    const uint32_t stride = (cluster_count + 7) / 8;
+
+    std::vector<uint8_t> row;
+    row.reserve(stride);
+
+    std::size_t i = offset;
+    while(row.size() < stride && i < size) {
+        if(data[i]) {
+            row.push_back(data[i++]);
+        } else {
+            /* A zero followed by the number of zero bytes */
+            uint32_t run = (i + 1 < size) ? data[i + 1] : 0;
+            row.insert(row.end(), std::min<uint32_t>(run, stride - row.size()), 0);
+            i += 2;
+        }
+    }
+
+    /* Truncated data, treat the rest as not visible */
+    row.resize(stride, 0);
+    return row;
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "../math/vec3.h"
+#include "../math/aabb.h"
+
+namespace smlt {
+
+/*
+ * The BSP tree and potentially visible set (PVS) of a compiled map, in the
+ * mesh's coordinate space. Loaders for formats which carry this information
+ * (e.g. Quake 2 .bsp files) stash a BSPTreePtr in the mesh's data under
+ * BSPTree::DATA_KEY, where the BSP geom culler picks it up.
+ */
+
+struct BSPPlane {
+    Vec3 normal;
+    float distance = 0.0f;
+};
+
+struct BSPNode {
+    uint32_t plane = 0;
+
+    /* Front and back children. A negative child is a leaf: -(leaf + 1) */
+    int32_t children[2] = {0, 0};
+};
+
+struct BSPLeaf {
+    /* -1 for leaves inside solid space */
+    int32_t cluster = -1;
+    AABB bounds;
+
+    /* Indexes into BSPTree::faces */
+    std::vector<uint32_t> faces;
+};
+
+/* A run of triangles in one of the mesh's submeshes */
+struct BSPFace {
+    std::string submesh;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+};
+
+class BSPTree;
+typedef std::shared_ptr<BSPTree> BSPTreePtr;
+
+class BSPTree {
+public:
+    static const char* DATA_KEY;
+
+    std::vector<BSPPlane> planes;
+    std::vector<BSPNode> nodes;
+    std::vector<BSPLeaf> leaves;
+    std::vector<BSPFace> faces;
+
+    /* Returns the leaf containing point, or -1 if the tree is empty or its
+     * children loop back on themselves */
+    int32_t find_leaf(const Vec3& point) const;
+
+    /* Returns the cluster containing point, or -1 if it's outside the map */
+    int32_t find_cluster(const Vec3& point) const;
+
+    /*
+     * Sets the visibility data. rows holds cluster_count bitsets of
+     * row_stride() bytes each, bit j of row i is set if cluster j can be
+     * seen from cluster i.
+     */
+    void set_visibility(uint32_t cluster_count, std::vector<uint8_t> rows);
+
+    bool has_visibility() const { return cluster_count_ > 0; }
+    uint32_t cluster_count() const { return cluster_count_; }
+    uint32_t row_stride() const { return (cluster_count_ + 7) / 8; }
+
+    /* The PVS row for a cluster, or nullptr if there is no visibility data */
+    const uint8_t* visible_clusters(int32_t from) const;
+
+    bool is_cluster_visible(int32_t from, int32_t to) const;
+
+    /*
+     * Returns true if any leaf the box overlaps is in one of the clusters
+     * set in row. A null row means everything is visible.
+     */
+    bool is_aabb_potentially_visible(const AABB& box, const uint8_t* row) const;
+
+    /*
+     * Expands a run-length encoded Quake-style PVS row (where a zero byte is
+     * followed by a count of zero bytes) into a plain bitset of
+     * (cluster_count + 7) / 8 bytes.
+     */
+    static std::vector<uint8_t> decompress_row(const uint8_t* data, std::size_t size, uint32_t offset, uint32_t cluster_count);
+
+private:
+    uint32_t cluster_count_ = 0;
+    std::vector<uint8_t> visibility_;
+
+    bool leaf_visible(int32_t leaf, const uint8_t* row) const;
+};
+
+}
@@ -30,6 +30,7 @@
 #include "private.h"
 
 #include "../procedural/mesh.h"
+#include "../utils/mesh/simplify.h"
 
 namespace smlt {
 
@@ -502,6 +503,125 @@ SubMesh* Mesh::find_submesh(const std::string& name) const {
     return nullptr;
 }
 
+std::vector<MeshPtr> Mesh::generate_lods(const std::vector<float>& ratios) {
+    if(ratios.size() >= DETAIL_LEVEL_MAX) {
+        throw std::logic_error("More LOD ratios were passed than there are detail levels");
+    }
+
+    if(is_animated()) {
+        throw std::logic_error("Generating LODs for animated meshes is not supported");
+    }
+
+    std::vector<Vec3> positions;
+    positions.reserve(vertex_data_->count());
+    for(uint32_t i = 0; i < vertex_data_->count(); ++i) {
+        auto p = vertex_data_->position_nd_at(i);
+        positions.push_back(Vec3(p.x, p.y, p.z));
+    }
+
+    /* All the triangles are simplified together, grouped by submesh, so the
+     * edges between submeshes stay where they are. Anything else (e.g. lines)
+     * is copied across untouched */
+    std::vector<SubMesh*> triangle_submeshes;
+    std::vector<SubMesh*> other_submeshes;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> groups;
+
+    for(auto submesh: each_submesh()) {
+        auto arrangement = submesh->arrangement();
+        if(arrangement != MESH_ARRANGEMENT_TRIANGLES &&
+            arrangement != MESH_ARRANGEMENT_TRIANGLE_STRIP &&
+            arrangement != MESH_ARRANGEMENT_TRIANGLE_FAN) {
+            other_submeshes.push_back(submesh.get());
+            continue;
+        }
+
+        uint32_t group = triangle_submeshes.size();
+        triangle_submeshes.push_back(submesh.get());
+
+        submesh->each_triangle([&](uint32_t a, uint32_t b, uint32_t c) {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+            groups.push_back(group);
+        });
+    }
+
+    const std::size_t triangle_count = groups.size();
+
+    std::vector<MeshPtr> lods;
+    std::vector<uint32_t> new_indexes;
+    std::vector<SubMesh*> lod_submeshes;
+
+    for(auto ratio: ratios) {
+        /* Each level starts from the last, which is much quicker than starting
+         * from the full mesh each time */
+        indices = utils::simplify_triangles(
+            positions, indices, std::size_t(triangle_count * ratio),
+            std::numeric_limits<float>::max(), &groups
+        );
+
+        auto lod = asset_manager().new_mesh(vertex_data_->vertex_specification());
+
+        new_indexes.assign(vertex_data_->count(), std::numeric_limits<uint32_t>::max());
+        auto copy_vertex = [&](uint32_t i) -> uint32_t {
+            if(new_indexes[i] == std::numeric_limits<uint32_t>::max()) {
+                new_indexes[i] = vertex_data_->copy_vertex_to_another(*lod->vertex_data_, i);
+            }
+
+            return new_indexes[i];
+        };
+
+        auto copy_submesh = [&](SubMesh* source, MeshArrangement arrangement) -> SubMesh* {
+            auto submesh = lod->new_submesh_with_material(
+                source->name(), source->material()->id(),
+                arrangement, source->index_data->index_type()
+            );
+
+            for(uint32_t slot = MATERIAL_SLOT1; slot < MATERIAL_SLOT_MAX; ++slot) {
+                auto material = source->material_at_slot((MaterialSlot) slot);
+                if(material) {
+                    submesh->set_material_at_slot((MaterialSlot) slot, material);
+                }
+            }
+
+            return submesh;
+        };
+
+        /* Submeshes which lose all their triangles are left out */
+        lod_submeshes.assign(triangle_submeshes.size(), nullptr);
+        for(std::size_t t = 0; t < groups.size(); ++t) {
+            auto& submesh = lod_submeshes[groups[t]];
+            if(!submesh) {
+                submesh = copy_submesh(triangle_submeshes[groups[t]], MESH_ARRANGEMENT_TRIANGLES);
+            }
+
+            for(uint32_t j = 0; j < 3; ++j) {
+                submesh->index_data->index(copy_vertex(indices[t * 3 + j]));
+            }
+        }
+
+        for(auto source: other_submeshes) {
+            auto submesh = copy_submesh(source, source->arrangement());
+            source->index_data->each([&](uint32_t i) {
+                submesh->index_data->index(copy_vertex(i));
+            });
+            lod_submeshes.push_back(submesh);
+        }
+
+        lod->vertex_data_->done();
+        for(auto submesh: lod_submeshes) {
+            if(submesh) {
+                submesh->index_data->done();
+            }
+        }
+
+        lods.push_back(lod);
+    }
+
+    return lods;
+}
+
 void Mesh::generate_adjacency_info() {
     adjacency_.reset(new AdjacencyInfo(this));
     adjacency_->rebuild();
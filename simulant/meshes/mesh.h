@@ -189,6 +189,14 @@ public:
     uint32_t animation_frames() const { return animation_frames_; }
     MeshAnimationType animation_type() const { return animation_type_; }
 
+    /* Generates simplified copies of this mesh for the lower detail levels, one
+     * for each ratio (the fraction of the triangles to keep). The meshes are
+     * returned in order so they can be passed to Actor::set_mesh() with
+     * DETAIL_LEVEL_NEAR, DETAIL_LEVEL_MID and so on. Each mesh only holds the
+     * vertices it uses, and the submeshes keep their names and materials.
+     * See utils::simplify_triangles() for what is kept in place */
+    std::vector<MeshPtr> generate_lods(const std::vector<float>& ratios={0.5f, 0.25f, 0.125f, 0.0625f});
+
     /* Generates adjacency information for this mesh. This is necessary for stencil shadowing
      * to work */
     void generate_adjacency_info();
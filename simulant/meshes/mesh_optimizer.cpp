@@ -0,0 +1,339 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "../logging.h"
+#include "../vertex_data.h"
+
+#include "mesh_optimizer.h"
+#include "mesh.h"
+#include "submesh.h"
+
+namespace smlt {
+
+const uint32_t MeshOptimizer::FIFO_CACHE_SIZE;
+
+namespace {
+
+/* The cache size the scoring assumes, it doesn't need to match the hardware */
+const int32_t FORSYTH_CACHE_SIZE = 32;
+
+float vertex_score(int32_t cache_position, uint32_t remaining_triangles) {
+    if(!remaining_triangles) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if(cache_position >= 0) {
+        if(cache_position < 3) {
+            /* Used by the last triangle, so whichever order we pick next these
+             * are about to be reused anyway */
+            score = 0.75f;
+        } else {
+            const float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scale, 1.5f);
+        }
+    }
+
+    /* Favour vertices with few triangles left, so they can be finished off */
+    score += 2.0f / std::sqrt(float(remaining_triangles));
+    return score;
+}
+
+bool is_triangles(SubMesh* submesh) {
+    return submesh->arrangement() == MESH_ARRANGEMENT_TRIANGLES;
+}
+
+std::size_t data_size(MeshPtr mesh) {
+    std::size_t ret = mesh->vertex_data->data_size();
+    for(auto submesh: mesh->each_submesh()) {
+        ret += submesh->index_data->data_size();
+    }
+    return ret;
+}
+
+}
+
+std::vector<uint32_t> MeshOptimizer::optimize_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertex_count) {
+    const uint32_t triangle_count = indices.size() / 3;
+
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    for(auto idx: indices) {
+        ++remaining[idx];
+    }
+
+    /* The triangles using each vertex */
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        offsets[i + 1] = offsets[i] + remaining[i];
+    }
+
+    std::vector<uint32_t> vertex_triangles(indices.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for(uint32_t i = 0; i < indices.size(); ++i) {
+            vertex_triangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int32_t> cache_position(vertex_count, -1);
+    std::vector<float> scores(vertex_count);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        scores[i] = vertex_score(-1, remaining[i]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    for(uint32_t t = 0; t < triangle_count; ++t) {
+        triangle_scores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> new_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    new_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t next_unemitted = 0;
+
+    auto best_in_range = [&](uint32_t begin, uint32_t end) -> int64_t {
+        int64_t best = -1;
+        float best_score = -std::numeric_limits<float>::max();
+
+        for(auto t = begin; t < end; ++t) {
+            if(!emitted[t] && triangle_scores[t] > best_score) {
+                best = t;
+                best_score = triangle_scores[t];
+            }
+        }
+
+        return best;
+    };
+
+    int64_t best = best_in_range(0, triangle_count);
+
+    while(best >= 0) {
+        const uint32_t* tri = &indices[best * 3];
+        emitted[best] = 1;
+        result.insert(result.end(), tri, tri + 3);
+
+        /* Take the triangle out of its vertices' lists */
+        for(uint32_t j = 0; j < 3; ++j) {
+            auto v = tri[j];
+            auto begin = vertex_triangles.begin() + offsets[v];
+            auto end = begin + remaining[v];
+
+            std::iter_swap(std::find(begin, end, uint32_t(best)), end - 1);
+            --remaining[v];
+        }
+
+        /* The triangle's vertices go to the front of the cache */
+        new_cache.assign(tri, tri + 3);
+        for(auto v: cache) {
+            if(v != tri[0] && v != tri[1] && v != tri[2]) {
+                new_cache.push_back(v);
+            }
+        }
+
+        for(uint32_t i = 0; i < new_cache.size(); ++i) {
+            auto v = new_cache[i];
+            cache_position[v] = (i < uint32_t(FORSYTH_CACHE_SIZE)) ? int32_t(i) : -1;
+            scores[v] = vertex_score(cache_position[v], remaining[v]);
+        }
+
+        /* Only the triangles around what's in the cache have changed score, and
+         * the best of those is almost always the best overall */
+        best = -1;
+        float best_score = -std::numeric_limits<float>::max();
+
+        for(auto v: new_cache) {
+            for(auto i = offsets[v]; i < offsets[v] + remaining[v]; ++i) {
+                auto t = vertex_triangles[i];
+                auto& score = triangle_scores[t];
+                score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+
+                if(score > best_score) {
+                    best = t;
+                    best_score = score;
+                }
+            }
+        }
+
+        if(new_cache.size() > uint32_t(FORSYTH_CACHE_SIZE)) {
+            new_cache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        std::swap(cache, new_cache);
+
+        if(best < 0) {
+            /* Nothing in the cache has anything left, carry on from the next
+             * triangle we haven't drawn */
+            while(next_unemitted < triangle_count && emitted[next_unemitted]) {
+                ++next_unemitted;
+            }
+
+            if(next_unemitted < triangle_count) {
+                best = next_unemitted;
+            }
+        }
+    }
+
+    return result;
+}
+
+float MeshOptimizer::calculate_acmr(const std::vector<uint32_t>& indices, uint32_t vertex_count) {
+    if(indices.empty()) {
+        return 0.0f;
+    }
+
+    /* A FIFO cache, a vertex is in the cache if it was added in the last
+     * FIFO_CACHE_SIZE misses */
+    std::vector<uint32_t> added_at(vertex_count, 0);
+    uint32_t misses = 0;
+
+    for(auto idx: indices) {
+        if(!added_at[idx] || misses + 1 - added_at[idx] > FIFO_CACHE_SIZE) {
+            ++misses;
+            added_at[idx] = misses;
+        }
+    }
+
+    return float(misses) / float(indices.size() / 3);
+}
+
+MeshOptimizerStats MeshOptimizer::optimize(MeshPtr mesh) {
+    MeshOptimizerStats stats;
+
+    auto vertices = mesh->vertex_data.get();
+    const uint32_t vertex_count = vertices->count();
+    const uint32_t stride = vertices->stride();
+
+    stats.vertices_before = vertex_count;
+    stats.bytes_before = data_size(mesh);
+
+    std::vector<std::vector<uint32_t>> submesh_indices;
+    std::vector<uint32_t> all_triangles;
+
+    for(auto submesh: mesh->each_submesh()) {
+        submesh_indices.push_back(submesh->index_data->all());
+        if(is_triangles(submesh.get())) {
+            auto& indices = submesh_indices.back();
+            all_triangles.insert(all_triangles.end(), indices.begin(), indices.end());
+        }
+    }
+
+    stats.acmr_before = calculate_acmr(all_triangles, vertex_count);
+
+    /* Merge identical vertices, each vertex maps to the first one with the
+     * same data. Animated meshes keep theirs, frame data is by index */
+    std::vector<uint32_t> remap(vertex_count);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        remap[i] = i;
+    }
+
+    const uint8_t* data = vertices->data();
+    if(!mesh->is_animated() && data) {
+        std::vector<uint32_t> order(remap);
+
+        auto compare = [data, stride](uint32_t lhs, uint32_t rhs) {
+            return std::memcmp(data + lhs * stride, data + rhs * stride, stride);
+        };
+
+        std::sort(order.begin(), order.end(), [&compare](uint32_t lhs, uint32_t rhs) {
+            auto r = compare(lhs, rhs);
+            return (r == 0) ? lhs < rhs : r < 0;
+        });
+
+        for(uint32_t i = 1; i < vertex_count; ++i) {
+            if(compare(order[i], order[i - 1]) == 0) {
+                remap[order[i]] = remap[order[i - 1]];
+            }
+        }
+    }
+
+    /* Reorder each submesh's triangles for the cache */
+    uint32_t submesh_index = 0;
+    for(auto submesh: mesh->each_submesh()) {
+        auto& indices = submesh_indices[submesh_index++];
+        for(auto& idx: indices) {
+            idx = remap[idx];
+        }
+
+        if(is_triangles(submesh.get())) {
+            indices = optimize_vertex_cache(indices, vertex_count);
+        }
+    }
+
+    /* Put the vertices in the order they're first used */
+    uint32_t new_vertex_count = vertex_count;
+    if(!mesh->is_animated() && data) {
+        const uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> new_index(vertex_count, unused);
+
+        new_vertex_count = 0;
+        for(auto& indices: submesh_indices) {
+            for(auto& idx: indices) {
+                if(new_index[idx] == unused) {
+                    new_index[idx] = new_vertex_count++;
+                }
+
+                idx = new_index[idx];
+            }
+        }
+
+        std::vector<uint8_t> old_data(data, data + vertex_count * stride);
+
+        vertices->resize(new_vertex_count);
+        auto out = vertices->data();
+        for(uint32_t i = 0; i < vertex_count; ++i) {
+            if(new_index[i] != unused) {
+                std::memcpy(out + new_index[i] * stride, &old_data[i * stride], stride);
+            }
+        }
+
+        vertices->done();
+    }
+
+    /* Write the indices back, 16 bit indices are used where possible. 8 bit
+     * ones aren't as many GPUs handle them slowly, if at all */
+    IndexType index_type = (new_vertex_count <= std::numeric_limits<uint16_t>::max() + 1u) ?
+        INDEX_TYPE_16_BIT : INDEX_TYPE_32_BIT;
+
+    submesh_index = 0;
+    all_triangles.clear();
+
+    for(auto submesh: mesh->each_submesh()) {
+        auto& indices = submesh_indices[submesh_index++];
+        auto index_data = submesh->index_data.get();
+
+        index_data->reset(
+            (index_data->index_type() == INDEX_TYPE_8_BIT && new_vertex_count <= 256) ?
+                INDEX_TYPE_8_BIT : index_type
+        );
+
+        if(!indices.empty()) {
+            index_data->index(&indices[0], indices.size());
+        }
+
+        index_data->done();
+
+        if(is_triangles(submesh.get())) {
+            all_triangles.insert(all_triangles.end(), indices.begin(), indices.end());
+        }
+    }
+
+    if(mesh->has_adjacency_info()) {
+        mesh->generate_adjacency_info();
+    }
+
+    stats.vertices_after = new_vertex_count;
+    stats.acmr_after = calculate_acmr(all_triangles, new_vertex_count);
+    stats.bytes_after = data_size(mesh);
+
+    return stats;
+}
+
+}
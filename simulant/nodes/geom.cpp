@@ -19,8 +19,12 @@
 
 #include "geom.h"
 #include "../stage.h"
+#include "../window.h"
+#include "../logging.h"
 #include "geoms/octree_culler.h"
 #include "geoms/quadtree_culler.h"
+#include "geoms/bsp_culler.h"
+#include "geoms/terrain_culler.h"
 #include "camera.h"
 
 namespace smlt {
@@ -46,17 +50,51 @@ bool Geom::init() {
         return false;
     }
 
-    if(culler_options_.type == GEOM_CULLER_TYPE_QUADTREE) {
-        culler_.reset(new QuadtreeCuller(this, mesh_ptr, culler_options_.quadtree_max_depth));
+    if(culler_options_.type == GEOM_CULLER_TYPE_BSP && !BSPCuller::mesh_has_tree(mesh_ptr)) {
+        L_WARN("Requested a BSP culler for a mesh without a BSP tree, falling back to the octree culler");
+        culler_options_.type = GEOM_CULLER_TYPE_OCTREE;
+    }
+
+    if(culler_options_.type == GEOM_CULLER_TYPE_TERRAIN && !TerrainCuller::mesh_has_terrain(mesh_ptr)) {
+        L_WARN("Requested a terrain culler for a mesh without terrain data, falling back to the quadtree culler");
+        culler_options_.type = GEOM_CULLER_TYPE_QUADTREE;
+    }
+
+    if(culler_options_.type == GEOM_CULLER_TYPE_BSP) {
+        culler_.reset(new BSPCuller(this, mesh_ptr));
+    } else if(culler_options_.type == GEOM_CULLER_TYPE_TERRAIN) {
+        culler_.reset(new TerrainCuller(
+            this, mesh_ptr,
+            culler_options_.terrain_chunk_size,
+            culler_options_.terrain_max_pixel_error
+        ));
+    } else if(culler_options_.type == GEOM_CULLER_TYPE_QUADTREE) {
+        culler_.reset(new QuadtreeCuller(
+            this, mesh_ptr,
+            culler_options_.quadtree_max_depth,
+            culler_options_.merge_by_material,
+            culler_options_.merge_level
+        ));
     } else {
         assert(culler_options_.type == GEOM_CULLER_TYPE_OCTREE);
-        culler_.reset(new OctreeCuller(this, mesh_ptr, culler_options_.octree_max_depth));
+        culler_.reset(new OctreeCuller(
+            this, mesh_ptr,
+            culler_options_.octree_max_depth,
+            culler_options_.merge_by_material,
+            culler_options_.merge_level
+        ));
     }
 
     /* FIXME: Transform and recalc */
     aabb_ = mesh_ptr->aabb();
 
     culler_->compile(desired_transform, desired_rotation);
+
+    if(culler_options_.type == GEOM_CULLER_TYPE_TERRAIN) {
+        /* The mesh may not have any vertices, the culler knows where the terrain is */
+        aabb_ = static_cast<TerrainCuller*>(culler_.get())->terrain_bounds();
+    }
+
     return true;
 }
 
@@ -67,6 +105,21 @@ const AABB &Geom::aabb() const {
 void Geom::_get_renderables(batcher::RenderQueue* render_queue, const CameraPtr camera, const DetailLevel detail_level) {
     _S_UNUSED(detail_level);
 
+    /* Partitioners may hand back a cached list of visible nodes without
+     * querying anything, so the viewpoint has to be set here on every gather */
+    if(culler_options_.type == GEOM_CULLER_TYPE_BSP) {
+        static_cast<BSPCuller*>(culler_.get())->set_viewpoint(camera->absolute_position());
+    } else if(culler_options_.type == GEOM_CULLER_TYPE_TERRAIN) {
+        /* Queues filled outside of a render sequence don't know their viewport */
+        auto height = render_queue->viewport_height();
+        if(!height) {
+            height = stage->window->height();
+        }
+
+        auto lod_scale = camera->projection_matrix()[5] * float(height) * 0.5f;
+        static_cast<TerrainCuller*>(culler_.get())->set_viewpoint(camera->absolute_position(), lod_scale);
+    }
+
     culler_->renderables_visible(camera->frustum(), render_queue);
 }
 
@@ -34,13 +34,37 @@ class GeomCuller;
 
 enum GeomCullerType {
     GEOM_CULLER_TYPE_OCTREE,
-    GEOM_CULLER_TYPE_QUADTREE
+    GEOM_CULLER_TYPE_QUADTREE,
+
+    /* Uses the BSP tree and PVS stashed in the mesh by the Q2 BSP loader,
+     * falls back to the octree culler if the mesh doesn't have one */
+    GEOM_CULLER_TYPE_BSP,
+
+    /* Draws a heightmap mesh as chunks with their own levels of detail (see
+     * TerrainCuller), falls back to the quadtree culler if the mesh has no
+     * TerrainData */
+    GEOM_CULLER_TYPE_TERRAIN
 };
 
 struct GeomCullerOptions {
     GeomCullerType type = GEOM_CULLER_TYPE_OCTREE;
     uint8_t octree_max_depth = 5;
     uint8_t quadtree_max_depth = 5;
+
+    /* If true, the triangles in each cell at merge_level and the cells beneath
+     * it are merged per material into pre-transformed buffers of their own. A
+     * visible cell then costs one draw call per material, at the expense of
+     * culling no finer than merge_level. Good for big static levels. */
+    bool merge_by_material = false;
+    uint8_t merge_level = 2;
+
+    /* The number of grid squares along each side of a terrain chunk, rounded
+     * down to a power of two no larger than 128 */
+    uint16_t terrain_chunk_size = 64;
+
+    /* How far, in pixels, a terrain chunk can be drawn from where the full
+     * detail surface would be before a finer level is used */
+    float terrain_max_pixel_error = 4.0f;
 };
 
 /**
@@ -75,6 +99,8 @@ public:
 
     const AABB& aabb() const override;
 
+    MeshID mesh_id() const { return mesh_id_; }
+
     void clean_up() override {
         StageNode::clean_up();
     }
@@ -0,0 +1,205 @@
+#include <unordered_map>
+
+#include "bsp_culler.h"
+
+#include "../../frustum.h"
+#include "../../meshes/mesh.h"
+#include "../geom.h"
+#include "../../material.h"
+#include "../../renderers/batching/render_queue.h"
+#include "../../renderers/batching/renderable.h"
+
+namespace smlt {
+
+static const uint32_t NO_BATCH = ~0u;
+
+BSPCuller::BSPCuller(Geom* geom, const MeshPtr mesh):
+    GeomCuller(geom, mesh) {
+
+    IndexType type = INDEX_TYPE_8_BIT;
+    for(auto submesh: mesh->each_submesh()) {
+        if(submesh->index_data->index_type() > type) {
+            type = submesh->index_data->index_type();
+        }
+    }
+
+    /* 8 bit indices are a slow path on most GPUs */
+    index_type_ = std::max(type, INDEX_TYPE_16_BIT);
+}
+
+bool BSPCuller::mesh_has_tree(const MeshPtr& mesh) {
+    return mesh && mesh->data->exists(BSPTree::DATA_KEY);
+}
+
+void BSPCuller::_compile(const Vec3& pos, const Quaternion& rot) {
+    tree_ = mesh_->data->get<BSPTreePtr>(BSPTree::DATA_KEY);
+
+    vertices_.reset(new VertexData(mesh_->vertex_data->vertex_specification()));
+    mesh_->vertex_data->clone_into(*vertices_);
+
+    Mat4 transform(rot, pos);
+    vertices_->transform_by(transform);
+    inverse_transform_ = transform.inversed();
+
+    std::unordered_map<std::string, uint32_t> batch_for_submesh;
+
+    for(auto submesh: mesh_->each_submesh()) {
+        MaterialBatch batch;
+        batch.material = submesh->material().get();
+        batch.all = std::make_shared<IndexData>(index_type_);
+        batch.visible = std::make_shared<IndexData>(index_type_);
+
+        auto& source = *submesh->index_data;
+        batch.all->reserve(source.count());
+        for(uint32_t i = 0; i < source.count(); ++i) {
+            batch.all->index(source.at(i));
+        }
+        batch.all->done();
+
+        batch_for_submesh[submesh->name()] = batches_.size();
+        batches_.push_back(batch);
+    }
+
+    face_batches_.clear();
+    for(auto& face: tree_->faces) {
+        auto it = batch_for_submesh.find(face.submesh);
+        face_batches_.push_back((it == batch_for_submesh.end()) ? NO_BATCH : it->second);
+    }
+
+    face_stamps_.assign(tree_->faces.size(), 0);
+
+    leaf_bounds_.clear();
+    for(auto& leaf: tree_->leaves) {
+        std::array<Vec3, 8> corners = leaf.bounds.corners();
+        for(auto& corner: corners) {
+            corner = corner.transformed_by(transform);
+        }
+
+        leaf_bounds_.push_back(AABB(&corners[0], corners.size()));
+    }
+}
+
+void BSPCuller::set_viewpoint(const Vec3& position) {
+    has_viewpoint_ = true;
+    cluster_ = (tree_) ? tree_->find_cluster(position.transformed_by(inverse_transform_)) : -1;
+}
+
+bool BSPCuller::is_potentially_visible(const AABB& box) const {
+    if(!has_viewpoint_ || !tree_) {
+        return true;
+    }
+
+    auto row = tree_->visible_clusters(cluster_);
+    if(!row) {
+        return true;
+    }
+
+    std::array<Vec3, 8> corners = box.corners();
+    for(auto& corner: corners) {
+        corner = corner.transformed_by(inverse_transform_);
+    }
+
+    return tree_->is_aabb_potentially_visible(AABB(&corners[0], corners.size()), row);
+}
+
+void BSPCuller::rebuild_visible_batches() {
+    if(++stamp_ == 0) {
+        /* Wrapped around, start again */
+        std::fill(face_stamps_.begin(), face_stamps_.end(), 0);
+        stamp_ = 1;
+    }
+
+    for(auto& batch: batches_) {
+        batch.visible->clear();
+    }
+
+    for(auto leaf: visible_leaves_) {
+        for(auto face: tree_->leaves[leaf].faces) {
+            if(face_stamps_[face] == stamp_ || face_batches_[face] == NO_BATCH) {
+                continue;
+            }
+
+            face_stamps_[face] = stamp_;
+
+            auto& source = tree_->faces[face];
+            auto& batch = batches_[face_batches_[face]];
+            auto& all = *batch.all;
+            auto& visible = *batch.visible;
+
+            for(uint32_t i = source.first_index; i < source.first_index + source.index_count; ++i) {
+                visible.index(all.at(i));
+            }
+        }
+    }
+
+    for(auto& batch: batches_) {
+        batch.visible->done();
+    }
+}
+
+void BSPCuller::emit(batcher::RenderQueue* render_queue, IndexData* indexes, Material* material) {
+    Renderable new_renderable;
+
+    new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
+    new_renderable.final_transformation = Mat4();
+    new_renderable.index_data = indexes;
+    new_renderable.vertex_data = vertices_.get();
+    new_renderable.render_priority = geom()->render_priority();
+    new_renderable.index_element_count = indexes->count();
+    new_renderable.is_visible = geom()->is_visible();
+    new_renderable.material = material;
+
+    render_queue->insert_renderable(std::move(new_renderable));
+    ++stats_.renderables_emitted;
+}
+
+void BSPCuller::_gather_renderables(const Frustum& frustum, batcher::RenderQueue* render_queue) {
+    /* No row (no viewpoint, no vis data, or the camera is outside the map)
+     * means everything in the frustum */
+    const uint8_t* row = (has_viewpoint_) ? tree_->visible_clusters(cluster_) : nullptr;
+
+    candidate_leaves_.clear();
+
+    for(uint32_t i = 0; i < tree_->leaves.size(); ++i) {
+        auto cluster = tree_->leaves[i].cluster;
+        if(cluster < 0) {
+            continue;
+        }
+
+        if(row && !(row[cluster >> 3] & (1 << (cluster & 7)))) {
+            continue;
+        }
+
+        ++stats_.cells_visited;
+
+        if(frustum.intersects_aabb(leaf_bounds_[i])) {
+            candidate_leaves_.push_back(i);
+        }
+    }
+
+    /* Only touch the index buffers when the set of visible leaves changes,
+     * which is rare while the camera is still or moving within a cluster */
+    if(candidate_leaves_ != visible_leaves_) {
+        std::swap(candidate_leaves_, visible_leaves_);
+        rebuild_visible_batches();
+    }
+
+    for(auto& batch: batches_) {
+        if(batch.visible->count()) {
+            emit(render_queue, batch.visible.get(), batch.material);
+        }
+    }
+
+    /* The viewpoint must be set again before the next gather */
+    has_viewpoint_ = false;
+}
+
+void BSPCuller::_all_renderables(batcher::RenderQueue* render_queue) {
+    for(auto& batch: batches_) {
+        if(batch.all->count()) {
+            emit(render_queue, batch.all.get(), batch.material);
+        }
+    }
+}
+
+}
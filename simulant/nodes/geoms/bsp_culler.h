@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "geom_culler.h"
+#include "../../vertex_data.h"
+#include "../../meshes/bsp_tree.h"
+
+namespace smlt {
+
+/*
+ * Culls a mesh which carries a BSP tree (see BSPTree) using the tree's
+ * potentially visible set. Only the faces of leaves in clusters visible from
+ * the viewpoint's cluster, whose bounds are in the frustum, are drawn, with
+ * one renderable per material.
+ *
+ * The viewpoint is set by the Geom before each gather, from the camera being
+ * drawn. If it isn't set (e.g. when gathering directly) every leaf in the
+ * frustum is drawn.
+ */
+class BSPCuller : public GeomCuller {
+public:
+    BSPCuller(Geom* geom, const MeshPtr mesh);
+
+    /* Returns true if mesh carries BSP data that this culler can use */
+    static bool mesh_has_tree(const MeshPtr& mesh);
+
+    /* Sets the (world space) position the next gather is made from */
+    void set_viewpoint(const Vec3& position);
+
+    /* The cluster the viewpoint was in, -1 if outside the map or unset */
+    int32_t viewpoint_cluster() const { return cluster_; }
+
+    /* Returns false if a world space box can't be seen from the viewpoint */
+    bool is_potentially_visible(const AABB& box) const;
+
+    const BSPTreePtr& tree() const { return tree_; }
+
+    /* Leaves which passed the PVS and frustum tests on the last gather */
+    uint32_t last_visible_leaf_count() const { return visible_leaves_.size(); }
+
+private:
+    void _compile(const Vec3& pos, const Quaternion& rot) override;
+    void _gather_renderables(const Frustum &frustum, batcher::RenderQueue* render_queue) override;
+    void _all_renderables(batcher::RenderQueue* queue) override;
+
+    struct MaterialBatch {
+        Material* material = nullptr;
+
+        /* Every triangle using the material */
+        std::shared_ptr<IndexData> all;
+
+        /* The triangles of the visible faces, rebuilt when the visible leaves change */
+        std::shared_ptr<IndexData> visible;
+    };
+
+    BSPTreePtr tree_;
+    std::unique_ptr<VertexData> vertices_;
+    std::vector<MaterialBatch> batches_;
+
+    /* Per tree face, the batch it belongs to */
+    std::vector<uint32_t> face_batches_;
+
+    /* Leaf bounds transformed into world space */
+    std::vector<AABB> leaf_bounds_;
+
+    Mat4 inverse_transform_;
+    IndexType index_type_ = INDEX_TYPE_16_BIT;
+
+    bool has_viewpoint_ = false;
+    int32_t cluster_ = -1;
+
+    std::vector<uint32_t> visible_leaves_;
+    std::vector<uint32_t> candidate_leaves_;
+
+    /* Stops faces shared by several leaves being added more than once */
+    std::vector<uint32_t> face_stamps_;
+    uint32_t stamp_ = 0;
+
+    void emit(batcher::RenderQueue* render_queue, IndexData* indexes, Material* material);
+    void rebuild_visible_batches();
+};
+
+}
@@ -1,8 +1,13 @@
+#include <cstring>
+#include <unordered_map>
+
 #include "geom_culler.h"
 #include "../../meshes/mesh.h"
 #include "../../asset_manager.h"
+#include "../../vertex_data.h"
 #include "../../renderers/batching/render_queue.h"
 #include "../../renderers/batching/renderable.h"
+#include "../../time_keeper.h"
 
 namespace smlt {
 
@@ -26,9 +31,13 @@ void GeomCuller::compile(const Vec3 &pos, const Quaternion &rot) {
         return;
     }
 
+    auto start = TimeKeeper::now_in_us();
+
     _compile(pos, rot); // Do whatever the subclass does
     compiled_ = true;
 
+    build_time_us_ = TimeKeeper::now_in_us() - start;
+
     /* Grab references to materials before releasing the mesh */
     for(auto submesh: mesh_->each_submesh()) {
         material_refs_.push_back(submesh->material());
@@ -39,6 +48,7 @@ void GeomCuller::compile(const Vec3 &pos, const Quaternion &rot) {
 }
 
 void GeomCuller::renderables_visible(const Frustum& frustum, batcher::RenderQueue* render_queue) {
+    stats_ = GeomCullerStats();
     _gather_renderables(frustum, render_queue);
 }
 
@@ -52,4 +62,53 @@ void GeomCuller::each_renderable(EachRenderableCallback cb) {
     }
 }
 
+MergedBatch GeomCuller::merge_triangles(Material* material, const VertexData& source, const std::vector<const IndexData*>& index_lists) {
+    std::unordered_map<uint32_t, uint32_t> remap;
+    std::vector<uint32_t> source_vertices;
+    std::vector<uint32_t> indexes;
+
+    for(auto list: index_lists) {
+        for(uint32_t i = 0; i < list->count(); ++i) {
+            auto idx = list->at(i);
+
+            auto it = remap.find(idx);
+            if(it == remap.end()) {
+                it = remap.insert(std::make_pair(idx, (uint32_t) source_vertices.size())).first;
+                source_vertices.push_back(idx);
+            }
+
+            indexes.push_back(it->second);
+        }
+    }
+
+    MergedBatch batch;
+    batch.material = material;
+    batch.vertices = std::make_shared<VertexData>(source.vertex_specification());
+    batch.vertices->resize(source_vertices.size());
+
+    auto stride = source.stride();
+    auto src = source.data();
+    auto dst = batch.vertices->data();
+
+    for(auto idx: source_vertices) {
+        std::memcpy(dst, src + (idx * stride), stride);
+        dst += stride;
+    }
+
+    batch.vertices->done();
+
+    auto type = (source_vertices.size() <= 0xFFFF) ? INDEX_TYPE_16_BIT : INDEX_TYPE_32_BIT;
+
+    batch.indices = std::make_shared<IndexData>(type);
+    batch.indices->reserve(indexes.size());
+
+    if(!indexes.empty()) {
+        batch.indices->index(&indexes[0], indexes.size());
+    }
+
+    batch.indices->done();
+
+    return batch;
+}
+
 }
@@ -28,6 +28,28 @@ typedef std::vector<RenderablePtr> RenderableList;
 typedef std::function<void (Renderable*)> EachRenderableCallback;
 
 class Renderer;
+class VertexData;
+class IndexData;
+
+/*
+ * All the triangles using a material from a culler cell and the cells
+ * beneath it, copied into their own compact vertex and index buffers
+ */
+struct MergedBatch {
+    Material* material = nullptr;
+    std::shared_ptr<VertexData> vertices;
+    std::shared_ptr<IndexData> indices;
+};
+
+typedef std::vector<MergedBatch> MergedBatchList;
+
+struct GeomCullerStats {
+    /* Cells which intersected the frustum during the last gather */
+    uint32_t cells_visited = 0;
+
+    /* Renderables sent to the render queue during the last gather */
+    uint32_t renderables_emitted = 0;
+};
 
 class GeomCuller {
 public:
@@ -42,12 +64,28 @@ public:
     void each_renderable(EachRenderableCallback cb);
 
     Geom* geom() const { return geom_; }
+
+    const GeomCullerStats& last_gather_stats() const { return stats_; }
+
+    /* How long compile() took, in microseconds */
+    uint64_t build_time_us() const { return build_time_us_; }
+
 protected:
     Geom* geom_ = nullptr;
     MeshPtr mesh_;
 
+    GeomCullerStats stats_;
+
+    /*
+     * Copies the vertices referenced by index_lists out of source into a new
+     * vertex buffer, and joins the indexes (remapped to the new buffer) into a
+     * single index buffer. The index type is the smallest that fits.
+     */
+    static MergedBatch merge_triangles(Material* material, const VertexData& source, const std::vector<const IndexData*>& index_lists);
+
 private:
     bool compiled_ = false;
+    uint64_t build_time_us_ = 0;
 
     virtual void _compile(const Vec3& pos, const Quaternion& rot) = 0;
     virtual void _gather_renderables(const Frustum& frustum, batcher::RenderQueue* render_queue) = 0;
@@ -144,29 +144,40 @@ public:
         visitor(nodes_[0]);
     }
 
+    /* Calls cb for each node intersecting the frustum. Nodes deeper than
+     * max_level aren't visited */
     template<typename Callback>
-    void traverse_visible(const Frustum& frustum, const Callback& cb) {
+    void traverse_visible(const Frustum& frustum, const Callback& cb, Level max_level=~0) {
         check_signature<Callback, TraverseCallback>();
 
         if(nodes_.empty()) {
             return;
         }
 
-        _visible_visitor(frustum, cb, nodes_[0]);
+        _visible_visitor(frustum, cb, nodes_[0], max_level);
     }
 
+    /* Returns the node at the given level which contains node */
+    Octree::Node* ancestor(const Octree::Node* node, Level level) {
+        assert(level <= node->level);
+        auto shift = node->level - level;
+        return &nodes_[calc_index(level, node->grid[0] >> shift, node->grid[1] >> shift, node->grid[2] >> shift)];
+    }
+
+    Level level_count() const { return levels_; }
+
     AABB bounds() const { return bounds_; }
     TreeData* data() const { return tree_data_.get(); }
 private:
     template<typename Callback>
-    void _visible_visitor(const Frustum& frustum, const Callback& callback, Octree::Node& node) {
+    void _visible_visitor(const Frustum& frustum, const Callback& callback, Octree::Node& node, Level max_level) {
         if(frustum.intersects_cube(node.centre, node.size * 2.0f)) {
             callback(&node);
 
-            if(!is_leaf(node)) {
+            if(!is_leaf(node) && node.level < max_level) {
                 for(auto child: node.child_indexes) {
                     assert(child < nodes_.size());
-                    _visible_visitor(frustum, callback, nodes_[child]);
+                    _visible_visitor(frustum, callback, nodes_[child], max_level);
                 }
             }
         }
@@ -26,6 +26,9 @@ struct TriangleData {
 
 struct CullerNodeData {
     std::unordered_map<MaterialID, TriangleData> triangles;
+
+    /* Only populated on cells at the merge level, when merging */
+    MergedBatchList merged;
 };
 
 
@@ -36,10 +39,12 @@ struct _OctreeCullerImpl {
     std::shared_ptr<CullerOctree> octree;
 };
 
-OctreeCuller::OctreeCuller(Geom *geom, const MeshPtr mesh, uint8_t max_depth):
+OctreeCuller::OctreeCuller(Geom *geom, const MeshPtr mesh, uint8_t max_depth, bool merge_by_material, uint8_t merge_level):
     GeomCuller(geom, mesh),
     pimpl_(new _OctreeCullerImpl()),
-    max_depth_(max_depth) {
+    max_depth_(max_depth),
+    merge_by_material_(merge_by_material),
+    merge_level_(merge_level) {
 
     /* Find the size of index we need to store all indices */
     IndexType type = INDEX_TYPE_8_BIT;
@@ -92,47 +97,93 @@ void OctreeCuller::_compile(const Vec3 &pos, const Quaternion &rot) {
             indexes.index(c);
         });
     }
+
+    if(merge_by_material_) {
+        merge_cells();
+    }
 }
 
-void OctreeCuller::_gather_renderables(const Frustum &frustum, batcher::RenderQueue* render_queue) {
-    auto cb = [this, render_queue](CullerOctree::Node* node) {
+void OctreeCuller::merge_cells() {
+    auto& tree = *pimpl_->octree;
+    merge_level_ = std::min<uint8_t>(merge_level_, tree.level_count() - 1);
+
+    /* Gather up the triangles of each cell at the merge level, and all the
+     * cells beneath it, grouped by material */
+    typedef std::pair<Material*, std::vector<const IndexData*>> MaterialTriangles;
+    std::unordered_map<CullerOctree::Node*, std::unordered_map<MaterialID, MaterialTriangles>> cells;
+
+    tree.traverse([&](CullerOctree::Node* node) {
+        if(node->level < merge_level_) {
+            return;
+        }
+
+        auto& cell = cells[tree.ancestor(node, merge_level_)];
         for(auto& p: node->data->triangles) {
-            if(node->data->triangles.empty()) continue;
+            auto& entry = cell[p.first];
+            entry.first = p.second.material;
+            entry.second.push_back(p.second.indexes.get());
+        }
+    });
 
-            Renderable new_renderable;
+    auto& vertices = *tree.data()->vertices;
 
-            new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
-            new_renderable.final_transformation = Mat4();
-            new_renderable.index_data = p.second.indexes.get();
-            new_renderable.vertex_data = pimpl_->octree->data()->vertices.get();
-            new_renderable.render_priority = this->geom()->render_priority();
-            new_renderable.index_element_count = new_renderable.index_data->count();
-            new_renderable.is_visible = this->geom()->is_visible();
-            new_renderable.material = p.second.material;
+    for(auto& cell: cells) {
+        for(auto& p: cell.second) {
+            cell.first->data->merged.push_back(
+                merge_triangles(p.second.first, vertices, p.second.second)
+            );
+        }
+    }
 
-            render_queue->insert_renderable(std::move(new_renderable));
+    /* The merged batches replace the original index data at and below the merge level */
+    tree.traverse([&](CullerOctree::Node* node) {
+        if(node->level >= merge_level_) {
+            node->data->triangles.clear();
         }
+    });
+}
+
+void OctreeCuller::emit_renderables(CullerNodeData* node, batcher::RenderQueue* render_queue) {
+    auto emit = [this, render_queue](const VertexData* vertices, const IndexData* indexes, Material* material) {
+        Renderable new_renderable;
+
+        new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
+        new_renderable.final_transformation = Mat4();
+        new_renderable.index_data = indexes;
+        new_renderable.vertex_data = vertices;
+        new_renderable.render_priority = this->geom()->render_priority();
+        new_renderable.index_element_count = new_renderable.index_data->count();
+        new_renderable.is_visible = this->geom()->is_visible();
+        new_renderable.material = material;
+
+        render_queue->insert_renderable(std::move(new_renderable));
+        ++stats_.renderables_emitted;
     };
 
-    pimpl_->octree->traverse_visible(frustum, cb);
+    for(auto& p: node->triangles) {
+        emit(pimpl_->octree->data()->vertices.get(), p.second.indexes.get(), p.second.material);
+    }
+
+    for(auto& batch: node->merged) {
+        emit(batch.vertices.get(), batch.indices.get(), batch.material);
+    }
 }
 
-void OctreeCuller::_all_renderables(batcher::RenderQueue* queue) {
-    auto cb = [this, queue](CullerOctree::Node* node) {
-        for(auto& p: node->data->triangles) {
-            Renderable new_renderable;
-
-            new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
-            new_renderable.final_transformation = Mat4();
-            new_renderable.index_data = p.second.indexes.get();
-            new_renderable.vertex_data = pimpl_->octree->data()->vertices.get();
-            new_renderable.render_priority = this->geom()->render_priority();
-            new_renderable.index_element_count = new_renderable.index_data->count();
-            new_renderable.is_visible = this->geom()->is_visible();
-            new_renderable.material = p.second.material;
-
-            queue->insert_renderable(std::move(new_renderable));
-        }
+void OctreeCuller::_gather_renderables(const Frustum &frustum, batcher::RenderQueue* render_queue) {
+    auto cb = [this, render_queue](CullerOctree::Node* node) {
+        ++stats_.cells_visited;
+        emit_renderables(node->data, render_queue);
+    };
+
+    /* When merging, everything beneath the merge level has been moved
+     * up into the cells at that level, so there's no need to go deeper */
+    Level max_level = (merge_by_material_) ? merge_level_ : Level(~0);
+    pimpl_->octree->traverse_visible(frustum, cb, max_level);
+}
+
+void OctreeCuller::_all_renderables(batcher::RenderQueue* render_queue) {
+    auto cb = [this, render_queue](CullerOctree::Node* node) {
+        emit_renderables(node->data, render_queue);
     };
 
     pimpl_->octree->traverse(cb);
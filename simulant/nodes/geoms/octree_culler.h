@@ -7,12 +7,13 @@
 namespace smlt {
 
 class RenderableFactory;
+struct CullerNodeData;
 
 struct _OctreeCullerImpl;
 
 class OctreeCuller : public GeomCuller {
 public:
-    OctreeCuller(Geom* geom, const MeshPtr mesh, uint8_t max_depth);
+    OctreeCuller(Geom* geom, const MeshPtr mesh, uint8_t max_depth, bool merge_by_material=false, uint8_t merge_level=2);
 
     AABB octree_bounds() const;
 
@@ -25,6 +26,12 @@ private:
 
     IndexType index_type_ = INDEX_TYPE_16_BIT;
     uint8_t max_depth_;
+
+    bool merge_by_material_ = false;
+    uint8_t merge_level_ = 2;
+
+    void merge_cells();
+    void emit_renderables(CullerNodeData* node, batcher::RenderQueue* render_queue);
 };
 
 }
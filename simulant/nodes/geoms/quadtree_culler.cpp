@@ -26,6 +26,9 @@ struct TriangleData {
 
 struct CullerNodeData {
     std::unordered_map<MaterialID, TriangleData> triangles;
+
+    /* Only populated on cells at the merge level, when merging */
+    MergedBatchList merged;
 };
 
 
@@ -36,10 +39,12 @@ struct _QuadtreeCullerImpl {
     std::shared_ptr<CullerQuadtree> quadtree;
 };
 
-QuadtreeCuller::QuadtreeCuller(Geom *geom, const MeshPtr mesh, uint8_t max_depth):
+QuadtreeCuller::QuadtreeCuller(Geom *geom, const MeshPtr mesh, uint8_t max_depth, bool merge_by_material, uint8_t merge_level):
     GeomCuller(geom, mesh),
     pimpl_(new _QuadtreeCullerImpl()),
-    max_depth_(max_depth) {
+    max_depth_(max_depth),
+    merge_by_material_(merge_by_material),
+    merge_level_(merge_level) {
 
     /* Find the size of index we need to store all indices */
     IndexType type = INDEX_TYPE_8_BIT;
@@ -90,45 +95,93 @@ void QuadtreeCuller::_compile(const Vec3& pos, const Quaternion& rot) {
             indexes.index(c);
         });
     }
+
+    if(merge_by_material_) {
+        merge_cells();
+    }
 }
 
-void QuadtreeCuller::_gather_renderables(const Frustum &frustum, batcher::RenderQueue* render_queue) {
-    auto cb = [this, render_queue](CullerQuadtree::Node* node) {
+void QuadtreeCuller::merge_cells() {
+    auto& tree = *pimpl_->quadtree;
+    merge_level_ = std::min<uint8_t>(merge_level_, tree.level_count() - 1);
+
+    /* Gather up the triangles of each cell at the merge level, and all the
+     * cells beneath it, grouped by material */
+    typedef std::pair<Material*, std::vector<const IndexData*>> MaterialTriangles;
+    std::unordered_map<CullerQuadtree::Node*, std::unordered_map<MaterialID, MaterialTriangles>> cells;
+
+    tree.traverse([&](CullerQuadtree::Node* node) {
+        if(node->level < merge_level_) {
+            return;
+        }
+
+        auto& cell = cells[tree.ancestor(node, merge_level_)];
         for(auto& p: node->data->triangles) {
-            Renderable new_renderable;
-
-            new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
-            new_renderable.final_transformation = Mat4();
-            new_renderable.index_data = p.second.indexes.get();
-            new_renderable.vertex_data = pimpl_->quadtree->data()->vertices.get();
-            new_renderable.render_priority = this->geom()->render_priority();
-            new_renderable.index_element_count = new_renderable.index_data->count();
-            new_renderable.is_visible = this->geom()->is_visible();
-            new_renderable.material = p.second.material;
-
-            render_queue->insert_renderable(std::move(new_renderable));
+            auto& entry = cell[p.first];
+            entry.first = p.second.material;
+            entry.second.push_back(p.second.indexes.get());
+        }
+    });
+
+    auto& vertices = *tree.data()->vertices;
+
+    for(auto& cell: cells) {
+        for(auto& p: cell.second) {
+            cell.first->data->merged.push_back(
+                merge_triangles(p.second.first, vertices, p.second.second)
+            );
+        }
+    }
+
+    /* The merged batches replace the original index data at and below the merge level */
+    tree.traverse([&](CullerQuadtree::Node* node) {
+        if(node->level >= merge_level_) {
+            node->data->triangles.clear();
         }
+    });
+}
+
+void QuadtreeCuller::emit_renderables(CullerNodeData* node, batcher::RenderQueue* render_queue) {
+    auto emit = [this, render_queue](const VertexData* vertices, const IndexData* indexes, Material* material) {
+        Renderable new_renderable;
+
+        new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
+        new_renderable.final_transformation = Mat4();
+        new_renderable.index_data = indexes;
+        new_renderable.vertex_data = vertices;
+        new_renderable.render_priority = this->geom()->render_priority();
+        new_renderable.index_element_count = new_renderable.index_data->count();
+        new_renderable.is_visible = this->geom()->is_visible();
+        new_renderable.material = material;
+
+        render_queue->insert_renderable(std::move(new_renderable));
+        ++stats_.renderables_emitted;
+    };
+
+    for(auto& p: node->triangles) {
+        emit(pimpl_->quadtree->data()->vertices.get(), p.second.indexes.get(), p.second.material);
+    }
+
+    for(auto& batch: node->merged) {
+        emit(batch.vertices.get(), batch.indices.get(), batch.material);
+    }
+}
+
+void QuadtreeCuller::_gather_renderables(const Frustum &frustum, batcher::RenderQueue* render_queue) {
+    auto cb = [this, render_queue](CullerQuadtree::Node* node) {
+        ++stats_.cells_visited;
+        emit_renderables(node->data, render_queue);
     };
 
-    pimpl_->quadtree->traverse_visible(frustum, cb);
+    /* When merging, everything beneath the merge level has been moved
+     * up into the cells at that level, so there's no need to go deeper */
+    Level max_level = (merge_by_material_) ? merge_level_ : Level(~0);
+    pimpl_->quadtree->traverse_visible(frustum, cb, max_level);
 }
 
 void QuadtreeCuller::_all_renderables(batcher::RenderQueue* render_queue) {
     auto cb = [this, render_queue](CullerQuadtree::Node* node) {
-        for(auto& p: node->data->triangles) {
-            Renderable new_renderable;
-
-            new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
-            new_renderable.final_transformation = Mat4();
-            new_renderable.index_data = p.second.indexes.get();
-            new_renderable.vertex_data = pimpl_->quadtree->data()->vertices.get();
-            new_renderable.render_priority = this->geom()->render_priority();
-            new_renderable.index_element_count = new_renderable.index_data->count();
-            new_renderable.is_visible = this->geom()->is_visible();
-            new_renderable.material = p.second.material;
-
-            render_queue->insert_renderable(std::move(new_renderable));
-        }
+        emit_renderables(node->data, render_queue);
     };
 
     pimpl_->quadtree->traverse(cb);
@@ -0,0 +1,647 @@
+#include <cmath>
+#include <algorithm>
+
+#include "terrain_culler.h"
+
+#include "../../frustum.h"
+#include "../../meshes/mesh.h"
+#include "../geom.h"
+#include "../../stage.h"
+#include "../../window.h"
+#include "../../material.h"
+#include "../../threads/thread_pool.h"
+#include "../../renderers/batching/render_queue.h"
+#include "../../renderers/batching/renderable.h"
+
+namespace smlt {
+
+const uint32_t TerrainCuller::MAX_QUEUED_CHUNKS;
+
+namespace {
+
+const uint32_t SIDE_NEG_Z = 0;
+const uint32_t SIDE_POS_X = 1;
+const uint32_t SIDE_POS_Z = 2;
+const uint32_t SIDE_NEG_X = 3;
+
+/* Chunks have at most 129 * 129 vertices, so that 16 bit indices will do */
+const uint16_t MAX_CHUNK_SIZE = 128;
+
+}
+
+TerrainCuller::TerrainCuller(Geom* geom, const MeshPtr mesh, uint16_t chunk_size, float max_pixel_error):
+    GeomCuller(geom, mesh),
+    chunk_size_(1),
+    max_pixel_error_(max_pixel_error) {
+
+    /* Round down to a power of two, so that every level divides the chunk evenly */
+    chunk_size = std::min(std::max<uint16_t>(chunk_size, 1), MAX_CHUNK_SIZE);
+    while(chunk_size_ * 2 <= chunk_size) {
+        chunk_size_ *= 2;
+    }
+}
+
+TerrainCuller::~TerrainCuller() {
+    /* The pool outlives us, so let anything queued finish before what it's
+     * using goes away */
+    wait_for_chunks();
+}
+
+bool TerrainCuller::mesh_has_terrain(const MeshPtr& mesh) {
+    return mesh && mesh->data->exists("terrain_data");
+}
+
+void TerrainCuller::set_viewpoint(const Vec3& position, float lod_scale) {
+    has_viewpoint_ = true;
+    viewpoint_ = position;
+    lod_scale_ = lod_scale;
+}
+
+float TerrainCuller::chunk_error(uint32_t chunk, uint32_t lod) const {
+    return chunks_.at(chunk).errors.at(lod);
+}
+
+int32_t TerrainCuller::drawn_lod(uint32_t chunk) const {
+    return chunks_.at(chunk).drawn;
+}
+
+bool TerrainCuller::lod_built(uint32_t chunk, uint32_t lod) const {
+    return bool(chunks_.at(chunk).lods.at(lod));
+}
+
+void TerrainCuller::wait_for_chunks() {
+    thread::Lock<thread::Mutex> g(built_lock_);
+    while(queued_count_) {
+        built_condition_.wait(built_lock_);
+    }
+}
+
+void TerrainCuller::_compile(const Vec3& pos, const Quaternion& rot) {
+    terrain_ = mesh_->data->get<TerrainData>("terrain_data");
+    transform_ = Mat4(rot, pos);
+
+    auto submesh = mesh_->first_submesh();
+    if(submesh) {
+        material_ = submesh->material();
+    }
+
+    /* The second texture coordinate spans the whole terrain, which is what
+     * splat maps use, so make sure there's room for it */
+    vertex_specification_ = mesh_->vertex_data->vertex_specification();
+    if(vertex_specification_.texcoord1_attribute == VERTEX_ATTRIBUTE_NONE) {
+        vertex_specification_.texcoord1_attribute = VERTEX_ATTRIBUTE_2F;
+    }
+
+    uint32_t quads_across = std::max<uint32_t>(terrain_.x_size, 2) - 1;
+    uint32_t quads_down = std::max<uint32_t>(terrain_.z_size, 2) - 1;
+
+    chunks_across_ = (quads_across + chunk_size_ - 1) / chunk_size_;
+    chunks_down_ = (quads_down + chunk_size_ - 1) / chunk_size_;
+
+    lod_count_ = 1;
+    while((1u << (lod_count_ - 1)) < chunk_size_) {
+        ++lod_count_;
+    }
+
+    chunks_.resize(chunks_across_ * chunks_down_);
+    for(uint32_t z = 0; z < chunks_down_; ++z) {
+        for(uint32_t x = 0; x < chunks_across_; ++x) {
+            auto& chunk = chunks_[(z * chunks_across_) + x];
+            chunk.x = x * chunk_size_;
+            chunk.z = z * chunk_size_;
+            chunk.lods.resize(lod_count_);
+            chunk.used.resize(lod_count_);
+        }
+    }
+
+    auto window = geom_->stage->window.get();
+    pool_ = (window) ? window->worker_pool.get() : nullptr;
+
+    /* The errors need every grid point, so this is the slow part of the compile */
+    auto prepare = [this](std::size_t begin, std::size_t end) {
+        for(auto i = begin; i < end; ++i) {
+            calculate_errors(chunks_[i]);
+            chunks_[i].lods.back() = build_chunk_vertices(chunks_[i], lod_count_ - 1);
+        }
+    };
+
+    if(pool_) {
+        pool_->parallel_for(chunks_.size(), 8, prepare);
+    } else {
+        prepare(0, chunks_.size());
+    }
+
+    nodes_.clear();
+    build_node(0, 0, chunks_across_, chunks_down_);
+    bounds_ = nodes_[0].bounds;
+}
+
+uint32_t TerrainCuller::build_node(uint32_t x0, uint32_t z0, uint32_t x1, uint32_t z1) {
+    uint32_t index = nodes_.size();
+    nodes_.push_back(Node());
+
+    if(x1 - x0 == 1 && z1 - z0 == 1) {
+        auto chunk = (z0 * chunks_across_) + x0;
+        nodes_[index].chunk = chunk;
+        nodes_[index].bounds = chunks_[chunk].bounds;
+        return index;
+    }
+
+    uint32_t xs[3] = {x0, (x1 - x0 > 1) ? (x0 + x1) / 2 : x1, x1};
+    uint32_t zs[3] = {z0, (z1 - z0 > 1) ? (z0 + z1) / 2 : z1, z1};
+
+    Vec3 min, max;
+    for(uint32_t j = 0; j < 2; ++j) {
+        for(uint32_t i = 0; i < 2; ++i) {
+            if(xs[i] == xs[i + 1] || zs[j] == zs[j + 1]) {
+                continue;
+            }
+
+            /* Careful, this can reallocate nodes_ */
+            auto child = build_node(xs[i], zs[j], xs[i + 1], zs[j + 1]);
+            auto& node = nodes_[index];
+            auto& bounds = nodes_[child].bounds;
+
+            if(!node.child_count) {
+                min = bounds.min();
+                max = bounds.max();
+            } else {
+                min = Vec3(std::min(min.x, bounds.min().x), std::min(min.y, bounds.min().y), std::min(min.z, bounds.min().z));
+                max = Vec3(std::max(max.x, bounds.max().x), std::max(max.y, bounds.max().y), std::max(max.z, bounds.max().z));
+            }
+
+            node.children[node.child_count++] = child;
+        }
+    }
+
+    nodes_[index].bounds = AABB(min, max);
+    return index;
+}
+
+void TerrainCuller::calculate_errors(Chunk& chunk) {
+    const int32_t size = chunk_size_;
+    const int32_t x0 = chunk.x;
+    const int32_t z0 = chunk.z;
+
+    auto height = [&](int32_t x, int32_t z) -> float {
+        return terrain_.height(x0 + x, z0 + z);
+    };
+
+    float min_height = height(0, 0);
+    float max_height = min_height;
+
+    for(int32_t z = 0; z <= size; ++z) {
+        for(int32_t x = 0; x <= size; ++x) {
+            min_height = std::min(min_height, height(x, z));
+            max_height = std::max(max_height, height(x, z));
+        }
+    }
+
+    chunk.errors.assign(lod_count_, 0.0f);
+
+    /* The error of a level is how far the full detail grid points are from its
+     * triangles, which are split the same way as the full detail ones */
+    for(uint32_t lod = 1; lod < lod_count_; ++lod) {
+        const int32_t step = 1 << lod;
+        const float inv_step = 1.0f / float(step);
+        float error = 0.0f;
+
+        for(int32_t z = 0; z <= size; ++z) {
+            int32_t cz = std::min((z / step) * step, size - step);
+            float fz = float(z - cz) * inv_step;
+
+            for(int32_t x = 0; x <= size; ++x) {
+                int32_t cx = std::min((x / step) * step, size - step);
+                float fx = float(x - cx) * inv_step;
+
+                float h00 = height(cx, cz);
+                float h10 = height(cx + step, cz);
+                float h01 = height(cx, cz + step);
+                float h11 = height(cx + step, cz + step);
+
+                float h = (fx + fz <= 1.0f) ?
+                    h00 + (h10 - h00) * fx + (h01 - h00) * fz :
+                    h11 + (h01 - h11) * (1.0f - fx) + (h10 - h11) * (1.0f - fz);
+
+                error = std::max(error, std::abs(height(x, z) - h));
+            }
+        }
+
+        chunk.errors[lod] = std::max(error, chunk.errors[lod - 1]);
+    }
+
+    /* The world space bounds of the chunk */
+    auto last_x = std::min<int32_t>(x0 + size, terrain_.x_size - 1);
+    auto last_z = std::min<int32_t>(z0 + size, terrain_.z_size - 1);
+
+    auto first = terrain_.position(x0, z0);
+    auto last = terrain_.position(last_x, last_z);
+
+    Vec3 corners[8];
+    for(uint32_t i = 0; i < 8; ++i) {
+        Vec3 corner(
+            (i & 1) ? last.x : first.x,
+            (i & 2) ? max_height : min_height,
+            (i & 4) ? last.z : first.z
+        );
+
+        corners[i] = corner.transformed_by(transform_);
+    }
+
+    chunk.bounds = AABB(corners, 8);
+}
+
+std::shared_ptr<VertexData> TerrainCuller::build_chunk_vertices(const Chunk& chunk, uint32_t lod) const {
+    const uint32_t step = 1 << lod;
+    const uint32_t quads = chunk_size_ >> lod;
+    const float largest = std::max(terrain_.x_size, terrain_.z_size);
+
+    auto vertices = std::make_shared<VertexData>(vertex_specification_);
+    vertices->resize((quads + 1) * (quads + 1));
+
+    for(uint32_t z = 0; z <= quads; ++z) {
+        /* Past the far edges of the terrain the vertices stay on the edge,
+         * the triangles there are squashed flat */
+        int32_t gz = std::min(chunk.z + (z * step), terrain_.z_size - 1);
+
+        for(uint32_t x = 0; x <= quads; ++x) {
+            int32_t gx = std::min(chunk.x + (x * step), terrain_.x_size - 1);
+
+            vertices->position(terrain_.position(gx, gz).transformed_by(transform_));
+            vertices->normal(terrain_.normal(gx, gz).rotated_by(transform_).normalized());
+            vertices->diffuse(smlt::Colour::WHITE);
+
+            // The same texture coordinates as the heightmap loader
+            vertices->tex_coord0(
+                (terrain_.texcoord0_repeat / largest) * float(gx),
+                (terrain_.texcoord0_repeat / largest) * float(gz)
+            );
+
+            vertices->tex_coord1(
+                float(gx) / float(terrain_.x_size),
+                float(gz) / float(terrain_.z_size)
+            );
+
+            vertices->move_next();
+        }
+    }
+
+    vertices->done();
+    return vertices;
+}
+
+std::vector<uint32_t> TerrainCuller::build_chunk_indices(uint32_t quads, const uint32_t edge_steps[4]) {
+    const uint32_t n = quads;
+    const uint32_t row = n + 1;
+
+    std::vector<uint32_t> indices;
+    indices.reserve(n * n * 6);
+
+    auto vertex = [row](uint32_t x, uint32_t z) -> uint32_t {
+        return (z * row) + x;
+    };
+
+    /* Adds a triangle, facing up whichever order the corners are in */
+    auto triangle = [&indices, row](uint32_t a, uint32_t b, uint32_t c) {
+        int32_t ax = a % row, az = a / row;
+        int32_t bx = b % row, bz = b / row;
+        int32_t cx = c % row, cz = c / row;
+
+        int32_t y = ((bz - az) * (cx - ax)) - ((bx - ax) * (cz - az));
+        if(y < 0) {
+            std::swap(b, c);
+        }
+
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+    };
+
+    if(n == 1) {
+        triangle(vertex(0, 0), vertex(0, 1), vertex(1, 0));
+        triangle(vertex(1, 0), vertex(0, 1), vertex(1, 1));
+        return indices;
+    }
+
+    /* The inside of the chunk is split like the heightmap loader splits it */
+    for(uint32_t z = 1; z + 2 <= n; ++z) {
+        for(uint32_t x = 1; x + 2 <= n; ++x) {
+            triangle(vertex(x, z), vertex(x, z + 1), vertex(x + 1, z));
+            triangle(vertex(x + 1, z), vertex(x, z + 1), vertex(x + 1, z + 1));
+        }
+    }
+
+    /* Each edge is a strip between the outside edge, which only uses every
+     * step'th vertex, and the line of vertices one in from it. The strips
+     * meet along the diagonals at the corners */
+    for(uint32_t side = 0; side < 4; ++side) {
+        uint32_t step = std::min(std::max(edge_steps[side], 1u), n);
+
+        /* t runs along the edge, depth is the distance in from it */
+        auto point = [&](uint32_t t, uint32_t depth) -> uint32_t {
+            switch(side) {
+                case SIDE_NEG_Z: return vertex(t, depth);
+                case SIDE_POS_X: return vertex(n - depth, t);
+                case SIDE_POS_Z: return vertex(t, n - depth);
+                case SIDE_NEG_X: default: return vertex(depth, t);
+            }
+        };
+
+        uint32_t outer = 0;
+        uint32_t inner = 1;
+
+        while(outer < n || inner < n - 1) {
+            bool advance_outer = inner == n - 1 || (outer < n && outer + step <= inner + 1);
+
+            if(advance_outer) {
+                triangle(point(outer, 0), point(outer + step, 0), point(inner, 1));
+                outer += step;
+            } else {
+                triangle(point(outer, 0), point(inner + 1, 1), point(inner, 1));
+                ++inner;
+            }
+        }
+    }
+
+    return indices;
+}
+
+const IndexData* TerrainCuller::chunk_indices(uint32_t lod, const uint32_t edge_steps[4]) {
+    uint64_t key = uint64_t(lod) << 32;
+    for(uint32_t i = 0; i < 4; ++i) {
+        key |= uint64_t(edge_steps[i] & 0xFF) << (i * 8);
+    }
+
+    auto it = indices_.find(key);
+    if(it == indices_.end()) {
+        auto indices = build_chunk_indices(chunk_size_ >> lod, edge_steps);
+
+        auto data = std::make_shared<IndexData>(INDEX_TYPE_16_BIT);
+        data->index(&indices[0], indices.size());
+        data->done();
+
+        it = indices_.insert(std::make_pair(key, data)).first;
+    }
+
+    return it->second.get();
+}
+
+uint32_t TerrainCuller::wanted_lod(const Chunk& chunk) const {
+    if(!has_viewpoint_) {
+        return 0;
+    }
+
+    /* The distance to the nearest point of the chunk's bounds */
+    auto& min = chunk.bounds.min();
+    auto& max = chunk.bounds.max();
+
+    Vec3 nearest(
+        std::min(std::max(viewpoint_.x, min.x), max.x),
+        std::min(std::max(viewpoint_.y, min.y), max.y),
+        std::min(std::max(viewpoint_.z, min.z), max.z)
+    );
+
+    float distance = (nearest - viewpoint_).length();
+    if(distance <= 0.0f) {
+        return 0;
+    }
+
+    /* The errors only grow with the level, so stop at the first that's too big */
+    uint32_t lod = 0;
+    while(lod + 1 < lod_count_ && (chunk.errors[lod + 1] * lod_scale_) / distance <= max_pixel_error_) {
+        ++lod;
+    }
+
+    return lod;
+}
+
+void TerrainCuller::request_lod(uint32_t chunk_index, uint32_t lod) {
+    auto& chunk = chunks_[chunk_index];
+    if(chunk.lods[lod] || (chunk.queued & (1u << lod))) {
+        return;
+    }
+
+    {
+        thread::Lock<thread::Mutex> g(built_lock_);
+        if(queued_count_ >= MAX_QUEUED_CHUNKS) {
+            /* Try again on the next gather */
+            return;
+        }
+
+        ++queued_count_;
+    }
+
+    chunk.queued |= (1u << lod);
+
+    /* Chunks are never added or removed once compiled, so the worker can
+     * safely hold on to this */
+    const Chunk* source = &chunk;
+
+    auto build = [this, source, chunk_index, lod]() {
+        BuiltChunk built;
+        built.chunk = chunk_index;
+        built.lod = lod;
+        built.vertices = build_chunk_vertices(*source, lod);
+
+        thread::Lock<thread::Mutex> g(built_lock_);
+        built_.push_back(built);
+        --queued_count_;
+        built_condition_.notify_all();
+    };
+
+    if(pool_) {
+        pool_->submit(build);
+    } else {
+        build();
+    }
+}
+
+void TerrainCuller::collect_built_chunks() {
+    std::vector<BuiltChunk> built;
+
+    {
+        thread::Lock<thread::Mutex> g(built_lock_);
+        std::swap(built, built_);
+    }
+
+    for(auto& b: built) {
+        auto& chunk = chunks_[b.chunk];
+        chunk.lods[b.lod] = b.vertices;
+        chunk.queued &= ~(1u << b.lod);
+
+        if(!chunk.resident) {
+            chunk.resident = true;
+            resident_.push_back(b.chunk);
+        }
+    }
+}
+
+void TerrainCuller::release_unused_lods() {
+    /* Throw away levels finer than the chunk needs from where the viewpoint
+     * is now, so memory doesn't fill up with full detail chunks as the
+     * viewpoint moves around. Chunks out of view keep what they'd need if the
+     * camera turned to face them. The viewpoint only belongs to the camera
+     * that gathered last, so levels any gather has wanted or drawn recently
+     * are kept too, otherwise several cameras would keep releasing the levels
+     * each other are using */
+    for(uint32_t i = 0; i < resident_.size();) {
+        auto& chunk = chunks_[resident_[i]];
+
+        uint32_t keep = wanted_lod(chunk);
+        if(chunk.drawn >= 0) {
+            keep = std::min(keep, uint32_t(chunk.drawn));
+        }
+
+        bool resident = false;
+        for(uint32_t lod = 0; lod + 1 < lod_count_; ++lod) {
+            if(lod < keep && gather_count_ - chunk.used[lod] > RELEASE_AFTER_GATHERS) {
+                chunk.lods[lod].reset();
+            }
+
+            resident = resident || chunk.lods[lod];
+        }
+
+        if(resident) {
+            ++i;
+        } else {
+            chunk.resident = false;
+            resident_[i] = resident_.back();
+            resident_.pop_back();
+        }
+    }
+}
+
+void TerrainCuller::emit_chunk(uint32_t chunk_index, batcher::RenderQueue* render_queue) {
+    auto& chunk = chunks_[chunk_index];
+    const uint32_t lod = chunk.drawn;
+    const uint32_t quads = chunk_size_ >> lod;
+
+    uint32_t x = chunk_index % chunks_across_;
+    uint32_t z = chunk_index / chunks_across_;
+
+    int32_t neighbours[4] = {
+        (z > 0) ? int32_t(chunk_index - chunks_across_) : -1,
+        (x + 1 < chunks_across_) ? int32_t(chunk_index + 1) : -1,
+        (z + 1 < chunks_down_) ? int32_t(chunk_index + chunks_across_) : -1,
+        (x > 0) ? int32_t(chunk_index - 1) : -1
+    };
+
+    /* Edges next to a coarser chunk use its vertices, the coarser chunk
+     * doesn't need to do anything. Chunks that weren't drawn can't be seen,
+     * so it doesn't matter if there's a crack next to them */
+    uint32_t steps[4];
+    for(uint32_t side = 0; side < 4; ++side) {
+        int32_t neighbour_lod = (neighbours[side] >= 0) ? chunks_[neighbours[side]].drawn : -1;
+        steps[side] = (neighbour_lod > int32_t(lod)) ?
+            std::min(1u << (neighbour_lod - lod), quads) : 1;
+    }
+
+    Renderable new_renderable;
+
+    new_renderable.arrangement = smlt::MESH_ARRANGEMENT_TRIANGLES;
+    new_renderable.final_transformation = Mat4();
+    new_renderable.index_data = chunk_indices(lod, steps);
+    new_renderable.vertex_data = chunk.lods[lod].get();
+    new_renderable.render_priority = geom()->render_priority();
+    new_renderable.index_element_count = new_renderable.index_data->count();
+    new_renderable.is_visible = geom()->is_visible();
+    new_renderable.material = material_.get();
+
+    render_queue->insert_renderable(std::move(new_renderable));
+    ++stats_.renderables_emitted;
+}
+
+void TerrainCuller::_gather_renderables(const Frustum& frustum, batcher::RenderQueue* render_queue) {
+    ++gather_count_;
+
+    collect_built_chunks();
+
+    for(auto chunk: drawn_) {
+        chunks_[chunk].drawn = -1;
+    }
+
+    visible_.clear();
+
+    std::vector<uint32_t> stack(1, 0);
+    while(!stack.empty()) {
+        auto& node = nodes_[stack.back()];
+        stack.pop_back();
+
+        if(!frustum.intersects_aabb(node.bounds)) {
+            continue;
+        }
+
+        ++stats_.cells_visited;
+
+        if(node.chunk >= 0) {
+            visible_.push_back(node.chunk);
+        } else {
+            stack.insert(stack.end(), node.children, node.children + node.child_count);
+        }
+    }
+
+    std::vector<uint32_t> wanted(visible_.size());
+    for(uint32_t i = 0; i < visible_.size(); ++i) {
+        wanted[i] = wanted_lod(chunks_[visible_[i]]);
+        chunks_[visible_[i]].used[wanted[i]] = gather_count_;
+        request_lod(visible_[i], wanted[i]);
+    }
+
+    /* Without workers the requests were built straight away */
+    collect_built_chunks();
+
+    /* Use the nearest level to the one we want which is ready. The coarsest
+     * always is */
+    for(uint32_t i = 0; i < visible_.size(); ++i) {
+        auto& chunk = chunks_[visible_[i]];
+        int32_t want = wanted[i];
+
+        for(int32_t offset = 0; chunk.drawn < 0; ++offset) {
+            if(want - offset >= 0 && chunk.lods[want - offset]) {
+                chunk.drawn = want - offset;
+            } else if(want + offset < int32_t(lod_count_) && chunk.lods[want + offset]) {
+                chunk.drawn = want + offset;
+            }
+        }
+
+        chunk.used[chunk.drawn] = gather_count_;
+    }
+
+    /* Every drawn level has to be known before the edges can be stitched */
+    for(auto chunk: visible_) {
+        emit_chunk(chunk, render_queue);
+    }
+
+    std::swap(drawn_, visible_);
+
+    release_unused_lods();
+}
+
+void TerrainCuller::_all_renderables(batcher::RenderQueue* render_queue) {
+    collect_built_chunks();
+
+    for(auto chunk: drawn_) {
+        chunks_[chunk].drawn = -1;
+    }
+
+    drawn_.clear();
+
+    /* Everything at whichever level is finest and ready */
+    for(uint32_t i = 0; i < chunks_.size(); ++i) {
+        auto& chunk = chunks_[i];
+        for(uint32_t lod = 0; lod < lod_count_; ++lod) {
+            if(chunk.lods[lod]) {
+                chunk.drawn = lod;
+                break;
+            }
+        }
+
+        drawn_.push_back(i);
+    }
+
+    for(auto chunk: drawn_) {
+        emit_chunk(chunk, render_queue);
+    }
+}
+
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include "geom_culler.h"
+#include "../../vertex_data.h"
+#include "../../loaders/heightmap_loader.h"
+#include "../../threads/mutex.h"
+#include "../../threads/condition.h"
+
+namespace smlt {
+
+namespace thread {
+class ThreadPool;
+}
+
+/*
+ * Draws a terrain built by the heightmap loader (or new_mesh_from_heights())
+ * from the heights in its TerrainData rather than from the mesh's triangles,
+ * so the mesh can be loaded with HeightmapSpecification::generate_mesh set to
+ * false.
+ *
+ * The terrain is split into square chunks of chunk_size grid squares, and
+ * each chunk has a number of levels of detail (geomipmaps), level l using
+ * every (1 << l)th grid point. On each gather the chunks are culled with a
+ * quadtree, and each visible chunk uses the coarsest level whose error,
+ * projected onto the screen, is no more than max_pixel_error. Edges next to
+ * a coarser chunk skip vertices to match it, so there are no cracks.
+ *
+ * The vertices of each chunk level are built on worker threads the first time
+ * they're needed, and the nearest level that's ready is drawn until then. The
+ * coarsest level is built up front so there's always something to draw.
+ *
+ * The viewpoint is set by the Geom before each gather. Without one every
+ * chunk is drawn at full detail.
+ */
+class TerrainCuller : public GeomCuller {
+public:
+    /* The most chunk levels which can be waiting to be built at once */
+    static const uint32_t MAX_QUEUED_CHUNKS = 32;
+
+    /* How many gathers a level can go unused before it's released. Each
+     * camera drawing the terrain gathers once per frame, so this is long
+     * enough for cameras taking turns not to throw away each other's levels */
+    static const uint32_t RELEASE_AFTER_GATHERS = 60;
+
+    TerrainCuller(Geom* geom, const MeshPtr mesh, uint16_t chunk_size=64, float max_pixel_error=4.0f);
+    ~TerrainCuller();
+
+    /* Returns true if mesh carries TerrainData that this culler can use */
+    static bool mesh_has_terrain(const MeshPtr& mesh);
+
+    /* Sets the (world space) position the next gather is made from. lod_scale
+     * converts a size at a distance of one unit into pixels, which for a
+     * perspective camera is projection_matrix()[5] * viewport_height / 2 */
+    void set_viewpoint(const Vec3& position, float lod_scale);
+
+    /* The world space bounds of the whole terrain */
+    const AABB& terrain_bounds() const { return bounds_; }
+
+    uint32_t chunks_across() const { return chunks_across_; }
+    uint32_t chunks_down() const { return chunks_down_; }
+    uint32_t chunk_count() const { return chunks_.size(); }
+    uint32_t lod_count() const { return lod_count_; }
+
+    /* The furthest the surface of the chunk at level lod is from the full
+     * detail surface, in world units */
+    float chunk_error(uint32_t chunk, uint32_t lod) const;
+
+    /* The level the chunk was drawn at in the last gather, or -1 if it wasn't drawn */
+    int32_t drawn_lod(uint32_t chunk) const;
+
+    /* True if the chunk's level is built and hasn't been released */
+    bool lod_built(uint32_t chunk, uint32_t lod) const;
+
+    /* Blocks until every chunk level that's been queued has been built. They're
+     * picked up by the next gather */
+    void wait_for_chunks();
+
+    /*
+     * Returns the triangles for a chunk of quads * quads grid squares, with the
+     * (quads + 1) * (quads + 1) vertices laid out row by row. edge_steps is
+     * the spacing of the vertices used along the -Z, +X, +Z and -X edges, which
+     * is greater than one where the neighbouring chunk is coarser.
+     */
+    static std::vector<uint32_t> build_chunk_indices(uint32_t quads, const uint32_t edge_steps[4]);
+
+private:
+    struct Chunk {
+        /* The first grid point of the chunk */
+        uint32_t x = 0;
+        uint32_t z = 0;
+
+        AABB bounds;
+        std::vector<float> errors;
+        std::vector<std::shared_ptr<VertexData>> lods;
+
+        /* The last gather each level was wanted or drawn in */
+        std::vector<uint64_t> used;
+
+        /* A bit for each level that's waiting to be built */
+        uint32_t queued = 0;
+
+        int32_t drawn = -1;
+
+        /* True if any level other than the coarsest is built */
+        bool resident = false;
+    };
+
+    struct Node {
+        AABB bounds;
+        int32_t chunk = -1;
+        uint32_t children[4];
+        uint8_t child_count = 0;
+    };
+
+    void _compile(const Vec3& pos, const Quaternion& rot) override;
+    void _gather_renderables(const Frustum& frustum, batcher::RenderQueue* render_queue) override;
+    void _all_renderables(batcher::RenderQueue* render_queue) override;
+
+    uint32_t build_node(uint32_t x0, uint32_t z0, uint32_t x1, uint32_t z1);
+    void calculate_errors(Chunk& chunk);
+
+    std::shared_ptr<VertexData> build_chunk_vertices(const Chunk& chunk, uint32_t lod) const;
+    const IndexData* chunk_indices(uint32_t lod, const uint32_t edge_steps[4]);
+
+    uint32_t wanted_lod(const Chunk& chunk) const;
+    void request_lod(uint32_t chunk, uint32_t lod);
+    void collect_built_chunks();
+    void release_unused_lods();
+
+    void emit_chunk(uint32_t chunk, batcher::RenderQueue* render_queue);
+
+    uint16_t chunk_size_;
+    float max_pixel_error_;
+
+    TerrainData terrain_;
+    VertexSpecification vertex_specification_;
+    Mat4 transform_;
+    MaterialPtr material_;
+
+    AABB bounds_;
+    uint32_t chunks_across_ = 0;
+    uint32_t chunks_down_ = 0;
+    uint32_t lod_count_ = 0;
+
+    std::vector<Chunk> chunks_;
+    std::vector<Node> nodes_;
+
+    bool has_viewpoint_ = false;
+    Vec3 viewpoint_;
+    float lod_scale_ = 1.0f;
+
+    uint64_t gather_count_ = 0;
+
+    std::vector<uint32_t> visible_;
+    std::vector<uint32_t> drawn_;
+    std::vector<uint32_t> resident_;
+
+    std::unordered_map<uint64_t, std::shared_ptr<IndexData>> indices_;
+
+    /* Chunk levels built by the workers, waiting to be collected by the next gather */
+    struct BuiltChunk {
+        uint32_t chunk;
+        uint32_t lod;
+        std::shared_ptr<VertexData> vertices;
+    };
+
+    thread::Mutex built_lock_;
+    thread::Condition built_condition_;
+    std::vector<BuiltChunk> built_;
+    uint32_t queued_count_ = 0;
+
+    /* The window's worker_pool, shared with the rest of the engine. The
+     * destructor waits for anything this culler queued on it */
+    thread::ThreadPool* pool_ = nullptr;
+};
+
+}
@@ -114,15 +114,15 @@ void Sprite::flip_vertically(bool value) {
 }
 
 void Sprite::update_texture_coordinates() {
-    uint8_t across = image_width_ / frame_width_;
+    uint8_t across = sheet_width_ / frame_width_;
 
     auto current_frame = animation_state_->current_frame();
     int x = current_frame % across;
     int y = current_frame / across;
 
-    float x0 = sprite_sheet_margin_ + (x * (sprite_sheet_spacing_ + frame_width_)) + sprite_sheet_padding_.first;
+    float x0 = sheet_x_ + sprite_sheet_margin_ + (x * (sprite_sheet_spacing_ + frame_width_)) + sprite_sheet_padding_.first;
     float x1 = x0 + (frame_width_ - sprite_sheet_padding_.first);
-    float y0 = sprite_sheet_margin_ + (y * (sprite_sheet_spacing_ + frame_height_)) + sprite_sheet_padding_.second;
+    float y0 = sheet_y_ + sprite_sheet_margin_ + (y * (sprite_sheet_spacing_ + frame_height_)) + sprite_sheet_padding_.second;
     float y1 = y0 + (frame_height_ - sprite_sheet_padding_.second);
 
     x0 = x0 / float(image_width_);
@@ -170,8 +170,22 @@ void Sprite::set_spritesheet(TextureID texture_id, uint32_t frame_width, uint32_
     sprite_sheet_spacing_ = attrs.spacing;
     sprite_sheet_padding_ = std::make_pair(attrs.padding_horizontal, attrs.padding_vertical);
 
-    image_width_ = stage->assets->texture(texture_id)->width();
-    image_height_ = stage->assets->texture(texture_id)->height();
+    texture_id_ = texture_id;
+
+    auto texture = stage->assets->texture(texture_id);
+    _set_spritesheet_region(texture_id, 0, 0, texture->width(), texture->height());
+}
+
+void Sprite::_set_spritesheet_region(TextureID texture_id, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    auto texture = stage->assets->texture(texture_id);
+
+    image_width_ = texture->width();
+    image_height_ = texture->height();
+
+    sheet_x_ = x;
+    sheet_y_ = y;
+    sheet_width_ = width;
+    sheet_height_ = height;
 
     //Hold a reference to the new material
     auto mat = stage->assets->new_material_from_texture(texture_id);
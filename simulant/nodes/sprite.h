@@ -104,6 +104,18 @@ private:
     float image_width_ = 0;
     float image_height_ = 0;
 
+    /* The area of the texture used as the spritesheet. This is the whole
+     * image unless the sprite has been moved onto a TextureAtlas page */
+    float sheet_x_ = 0;
+    float sheet_y_ = 0;
+    float sheet_width_ = 0;
+    float sheet_height_ = 0;
+
+    TextureID texture_id_;
+
+    friend class TextureAtlas;
+    void _set_spritesheet_region(TextureID texture_id, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
     float alpha_ = 1.0f;
 
     void update_texture_coordinates();
@@ -30,6 +30,10 @@ void StageNode::clean_up() {
 
     detach(); // Make sure we're not connected to anything
 
+    if(stage_ && stage_ != this) {
+        stage_->_cancel_bounds_update(this);
+    }
+
     TwoPhaseConstructed::clean_up();
 }
 
@@ -183,6 +187,14 @@ void StageNode::recalc_bounds_if_necessary() const {
 
 void StageNode::mark_transformed_aabb_dirty() {
     transformed_aabb_dirty_ = true;
+
+    /* Nothing is guaranteed to read the bounds each frame, and the
+     * partitioner only hears about a move through signal_bounds_updated, so
+     * the stage recalculates them before the partitioner next applies its
+     * writes. The stage's own bounds never change */
+    if(stage_ && stage_ != this) {
+        stage_->_queue_bounds_update(this);
+    }
 }
 
 void StageNode::update(float dt) {
@@ -109,6 +109,7 @@ class StageNode:
     DEFINE_SIGNAL(CleanedUpSignal, signal_cleaned_up);
 
     friend class StageNodeIterator;
+    friend class Stage;
 
 public:
     class StageNodeIteratorPair {
@@ -230,6 +231,11 @@ public:
     ShadowReceive shadow_receive() const { return shadow_receive_; }
     void set_shadow_receive(ShadowReceive receive) { shadow_receive_ = receive; }
 
+    /* Occluders hide the nodes behind them when occlusion culling is enabled
+     * on the render sequence. Only actors and geoms can be occluders */
+    bool is_occluder() const { return is_occluder_; }
+    void set_occluder(bool value) { is_occluder_ = value; }
+
     StageNode* find_child_with_name(const std::string& name);
 
     /* Return a list of renderables to pass into the render queue */
@@ -269,9 +275,15 @@ private:
     mutable AABB transformed_aabb_;
     mutable bool transformed_aabb_dirty_ = false;
 
+    /* Set while the node is waiting in the stage's list of bounds updates,
+     * guarded by the stage's lock */
+    bool bounds_update_queued_ = false;
+
     // By default, always cast and receive shadows
     ShadowCast shadow_cast_ = SHADOW_CAST_ALWAYS;
     ShadowReceive shadow_receive_ = SHADOW_RECEIVE_ALWAYS;
+
+    bool is_occluder_ = false;
 };
 
 
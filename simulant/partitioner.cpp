@@ -4,6 +4,8 @@
 #include "nodes/particle_system.h"
 #include "nodes/geom.h"
 #include "nodes/light.h"
+#include "nodes/camera.h"
+#include "stage.h"
 
 namespace smlt {
 
@@ -88,7 +90,20 @@ void Partitioner::remove_light(LightID obj) {
 }
 
 void Partitioner::_apply_writes() {
-    for(auto& p: staged_writes_) {
+    /* Stages bounds updates for everything that moved since last time */
+    if(stage_) {
+        stage_->_flush_bounds_updates();
+    }
+
+    /* Take the writes so far, anything staged while applying them (e.g. by a
+     * bounds recalculation) is picked up next time */
+    std::map<UniqueIDKey, WriteSlots> writes;
+    {
+        thread::Lock<thread::Mutex> lock(staging_lock_);
+        std::swap(writes, staged_writes_);
+    }
+
+    for(auto& p: writes) {
         bool remove_first = p.second.bits & (1 << WRITE_OPERATION_MAX);
 
         /* FIXME: This breaks if the order was update -> remove -> add */
@@ -117,9 +132,141 @@ void Partitioner::_apply_writes() {
                 apply_staged_write(p.first, p.second.slot[WRITE_OPERATION_REMOVE]);
             }
         }
+
+        if(!visibility_caches_.empty()) {
+            update_visibility_caches(p.first);
+        }
+    }
+}
+
+static UniqueIDKey node_key(StageNode* node) {
+    if(auto actor = dynamic_cast<Actor*>(node)) {
+        return make_unique_id_key(actor->id());
+    } else if(auto geom = dynamic_cast<Geom*>(node)) {
+        return make_unique_id_key(geom->id());
+    } else if(auto ps = dynamic_cast<ParticleSystem*>(node)) {
+        return make_unique_id_key(ps->id());
+    }
+
+    assert(0 && "Not implemented");
+    return UniqueIDKey(typeid(StageNode), 0);
+}
+
+void Partitioner::visible_from(CameraID camera_id, std::vector<LightID>& lights_out, std::vector<StageNode*>& geom_out) {
+    /* Forget any cameras which have gone */
+    for(auto it = visibility_caches_.begin(); it != visibility_caches_.end();) {
+        if(!stage->has_camera(it->first)) {
+            it = visibility_caches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    auto camera = stage->camera(camera_id);
+    auto& cache = visibility_caches_[camera_id];
+
+    if(!cache.valid || cache.view_matrix != camera->view_matrix() || cache.projection_matrix != camera->projection_matrix()) {
+        cache.lights_out.clear();
+        cache.geom_out.clear();
+
+        lights_and_geometry_visible_from(camera_id, cache.lights_out, cache.geom_out);
+        ++visibility_queries_run_;
+
+        cache.valid = true;
+        cache.dirty = false;
+        cache.view_matrix = camera->view_matrix();
+        cache.projection_matrix = camera->projection_matrix();
+        cache.frustum = camera->frustum();
+
+        cache.nodes.clear();
+        cache.lights.clear();
+
+        if(culls_by_frustum_only()) {
+            cache.lights.insert(cache.lights_out.begin(), cache.lights_out.end());
+            for(auto node: cache.geom_out) {
+                cache.nodes.insert(std::make_pair(node_key(node), node));
+            }
+        }
+    } else if(cache.dirty) {
+        cache.lights_out.assign(cache.lights.begin(), cache.lights.end());
+
+        cache.geom_out.clear();
+        for(auto& p: cache.nodes) {
+            cache.geom_out.push_back(p.second);
+        }
+
+        cache.dirty = false;
+    }
+
+    lights_out.insert(lights_out.end(), cache.lights_out.begin(), cache.lights_out.end());
+    geom_out.insert(geom_out.end(), cache.geom_out.begin(), cache.geom_out.end());
+}
+
+void Partitioner::update_visibility_caches(const UniqueIDKey& key) {
+    if(!culls_by_frustum_only()) {
+        for(auto& p: visibility_caches_) {
+            p.second.valid = false;
+        }
+        return;
+    }
+
+    /* Find where the node is now, if it still exists */
+    StageNode* node = nullptr;
+    LightPtr light;
+    AABB bounds;
+
+    if(key.first == typeid(Light)) {
+        light = stage->light(make_unique_id_from_key<LightID>(key));
+        if(light) {
+            bounds = light->transformed_aabb();
+        }
+    } else if(key.first == typeid(Actor)) {
+        auto actor = stage->actor(make_unique_id_from_key<ActorID>(key));
+        if(actor) {
+            node = actor;
+            bounds = actor->transformed_aabb();
+        }
+    } else if(key.first == typeid(Geom)) {
+        auto geom = stage->geom(make_unique_id_from_key<GeomID>(key));
+        if(geom) {
+            node = geom;
+            bounds = geom->aabb();
+        }
+    } else if(key.first == typeid(ParticleSystem)) {
+        auto ps = stage->particle_system(make_unique_id_from_key<ParticleSystemID>(key));
+        if(ps) {
+            node = ps;
+            bounds = ps->transformed_aabb();
+        }
     }
 
-    staged_writes_.clear();
+    for(auto& p: visibility_caches_) {
+        auto& cache = p.second;
+        if(!cache.valid) {
+            continue;
+        }
+
+        if(key.first == typeid(Light)) {
+            auto light_id = make_unique_id_from_key<LightID>(key);
+            bool visible = light && (
+                light->type() == LIGHT_TYPE_DIRECTIONAL || cache.frustum.intersects_aabb(bounds)
+            );
+
+            if(visible) {
+                cache.lights.insert(light_id);
+            } else {
+                cache.lights.erase(light_id);
+            }
+        } else {
+            if(node && cache.frustum.intersects_aabb(bounds)) {
+                cache.nodes[key] = node;
+            } else {
+                cache.nodes.erase(key);
+            }
+        }
+
+        cache.dirty = true;
+    }
 }
 
 
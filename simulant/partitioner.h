@@ -23,6 +23,7 @@
 #include <set>
 #include <map>
 #include <vector>
+#include <unordered_map>
 
 #include "generic/property.h"
 #include "generic/managed.h"
@@ -30,6 +31,7 @@
 #include "types.h"
 #include "interfaces.h"
 #include "nodes/stage_node.h"
+#include "frustum.h"
 
 namespace smlt {
 
@@ -86,17 +88,45 @@ public:
         std::vector<StageNode*>& geom_out
     ) = 0;
 
+    /*
+     * Returns what lights_and_geometry_visible_from() would, but remembers the
+     * result for each camera. While nothing is written and the camera doesn't
+     * move the result is reused as-is, so pipelines sharing a camera, and
+     * still scenes, only cull once. If things move but the camera doesn't,
+     * partitioners which only cull by frustum have the cached result updated
+     * with just the things that changed (in _apply_writes()).
+     */
+    void visible_from(
+        CameraID camera_id,
+        std::vector<LightID>& lights_out,
+        std::vector<StageNode*>& geom_out
+    );
+
+    /* How many times visible_from() has had to call
+     * lights_and_geometry_visible_from() */
+    uint64_t visibility_queries_run() const { return visibility_queries_run_; }
+
     virtual MeshID debug_mesh_id() { return MeshID(); }
 protected:
+    /* Return true if lights_and_geometry_visible_from() returns exactly the
+     * lights and nodes whose bounds intersect the camera frustum, plus all
+     * directional lights */
+    virtual bool culls_by_frustum_only() const { return false; }
+
     Property<Partitioner, Stage> stage = { this, &Partitioner::stage_ };
 
     Stage* get_stage() const { return stage_; }
 
     virtual void apply_staged_write(const UniqueIDKey& key, const StagedWrite& write) = 0;
 
+    /* Bounds updates can arrive from behaviours running on worker threads,
+     * so this is guarded by staging_lock_ */
     template<typename ID>
     void stage_write(const ID& id, const StagedWrite& op) {
         auto key = make_unique_id_key(id);
+
+        thread::Lock<thread::Mutex> lock(staging_lock_);
+
         auto& value = staged_writes_[key];
         value.slot[op.operation] = op;
 
@@ -120,6 +150,29 @@ private:
     };
 
     std::map<UniqueIDKey, WriteSlots> staged_writes_;
+
+    struct VisibilityCache {
+        bool valid = false;
+
+        /* The sets have changed since the lists were built */
+        bool dirty = false;
+
+        Mat4 view_matrix;
+        Mat4 projection_matrix;
+        Frustum frustum;
+
+        /* Only kept for partitioners which cull by frustum only */
+        std::map<UniqueIDKey, StageNode*> nodes;
+        std::set<LightID> lights;
+
+        std::vector<LightID> lights_out;
+        std::vector<StageNode*> geom_out;
+    };
+
+    std::unordered_map<CameraID, VisibilityCache> visibility_caches_;
+    uint64_t visibility_queries_run_ = 0;
+
+    void update_visibility_caches(const UniqueIDKey& key);
 };
 
 }
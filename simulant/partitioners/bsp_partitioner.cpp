@@ -0,0 +1,110 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "../stage.h"
+#include "../nodes/camera.h"
+#include "../nodes/actor.h"
+#include "../nodes/light.h"
+#include "../nodes/particle_system.h"
+#include "../nodes/geom.h"
+#include "../nodes/geoms/bsp_culler.h"
+
+#include "bsp_partitioner.h"
+
+namespace smlt {
+
+bool BSPPartitioner::potentially_visible(const AABB& box) const {
+    for(auto culler: cullers_) {
+        if(culler->is_potentially_visible(box)) {
+            return true;
+        }
+    }
+
+    /* Nothing to test against means everything is visible */
+    return cullers_.empty();
+}
+
+void BSPPartitioner::lights_and_geometry_visible_from(
+        CameraID camera_id, std::vector<LightID> &lights_out,
+        std::vector<StageNode*> &geom_out) {
+
+    auto camera = stage->camera(camera_id);
+    auto frustum = camera->frustum();
+    auto position = camera->absolute_position();
+
+    /* Find the camera's cluster in each BSP geom first, so everything
+     * else can be checked against the PVS */
+    cullers_.clear();
+    for(auto& key: all_nodes_) {
+        if(key.first != typeid(Geom)) {
+            continue;
+        }
+
+        auto geom = stage->geom(make_unique_id_from_key<GeomID>(key));
+        auto culler = dynamic_cast<BSPCuller*>(geom->culler.get());
+        if(culler) {
+            culler->set_viewpoint(position);
+            cullers_.push_back(culler);
+        }
+    }
+
+    for(auto& key: all_nodes_) {
+        if(key.first == typeid(Light)) {
+            auto light = stage->light(make_unique_id_from_key<LightID>(key));
+            if(light->type() == LIGHT_TYPE_DIRECTIONAL) {
+                lights_out.push_back(light->id());
+            } else {
+                auto aabb = light->transformed_aabb();
+                if(frustum.intersects_aabb(aabb) && potentially_visible(aabb)) {
+                    lights_out.push_back(light->id());
+                }
+            }
+        } else if(key.first == typeid(Actor)) {
+            auto actor = stage->actor(make_unique_id_from_key<ActorID>(key));
+            auto aabb = actor->transformed_aabb();
+            if(frustum.intersects_aabb(aabb) && potentially_visible(aabb)) {
+                geom_out.push_back(actor);
+            }
+        } else if(key.first == typeid(Geom)) {
+            /* Geoms do their own culling against the PVS */
+            auto geom = stage->geom(make_unique_id_from_key<GeomID>(key));
+            if(frustum.intersects_aabb(geom->aabb())) {
+                geom_out.push_back(geom);
+            }
+        } else if(key.first == typeid(ParticleSystem)) {
+            auto ps = stage->particle_system(make_unique_id_from_key<ParticleSystemID>(key));
+            auto aabb = ps->transformed_aabb();
+            if(frustum.intersects_aabb(aabb) && potentially_visible(aabb)) {
+                geom_out.push_back(ps);
+            }
+        } else {
+            assert(0 && "Not implemented");
+        }
+    }
+}
+
+void BSPPartitioner::apply_staged_write(const UniqueIDKey& key, const StagedWrite &write) {
+    if(write.operation == WRITE_OPERATION_ADD) {
+        all_nodes_.insert(key);
+    } else if(write.operation == WRITE_OPERATION_REMOVE) {
+        all_nodes_.erase(key);
+    }
+}
+
+}
@@ -0,0 +1,57 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../partitioner.h"
+
+namespace smlt {
+
+class BSPCuller;
+
+/*
+ * A partitioner for indoor levels loaded from BSP maps. Geoms using the BSP
+ * culler (GEOM_CULLER_TYPE_BSP) are told where the camera is, so they only
+ * draw what's in the camera's potentially visible set. Actors, particle
+ * systems and point lights are frustum culled and then dropped if they are
+ * not in a cluster that can be seen.
+ *
+ * Without any BSP geoms in the stage this behaves like the FrustumPartitioner.
+ */
+class BSPPartitioner : public Partitioner {
+public:
+    BSPPartitioner(Stage* ss):
+        Partitioner(ss) {}
+
+    void lights_and_geometry_visible_from(
+        CameraID camera_id,
+        std::vector<LightID> &lights_out,
+        std::vector<StageNode*> &geom_out
+    );
+
+private:
+    void apply_staged_write(const UniqueIDKey& key, const StagedWrite& write);
+
+    std::set<UniqueIDKey> all_nodes_;
+
+    std::vector<BSPCuller*> cullers_;
+
+    bool potentially_visible(const AABB& box) const;
+};
+
+}
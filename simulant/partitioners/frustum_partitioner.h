@@ -35,6 +35,9 @@ public:
         std::vector<StageNode*> &geom_out
     );
 
+protected:
+    bool culls_by_frustum_only() const override { return true; }
+
 private:
     void apply_staged_write(const UniqueIDKey& key, const StagedWrite& write);
 
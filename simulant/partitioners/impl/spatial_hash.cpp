@@ -1,4 +1,5 @@
 #include <cmath>
+#include <algorithm>
 #include "../../frustum.h"
 #include "spatial_hash.h"
 #include "../../utils/endian.h"
@@ -131,30 +132,36 @@ void generate_boxes_for_frustum(const Frustum& frustum, std::vector<AABB>& resul
     }
 }
 
-HGSHEntryList SpatialHash::find_objects_within_frustum(const Frustum &frustum) {
+template<typename Vector>
+void SpatialHash::gather_objects_within_frustum(const Frustum& frustum, Vector& results) {
     static std::vector<AABB> boxes; // Static to avoid repeated allocations
 
     generate_boxes_for_frustum(frustum, boxes);
 
-    HGSHEntryList results;
+    auto first = results.size();
 
     for(auto& box: boxes) {
-        for(auto& result: find_objects_within_box(box)) {
-            if(frustum.intersects_aabb(result->hash_aabb())) {
-                results.insert(result);
-            }
-        }
+        gather_objects_within_box(box, results);
     }
 
-    return results;
-}
+    /* Objects span several cells, so drop the duplicates before testing
+     * them against the frustum */
+    auto begin = results.begin() + first;
+    std::sort(begin, results.end());
 
-HGSHEntryList SpatialHash::find_objects_within_box(const AABB &box) {
-    HGSHEntryList objects;
+    auto end = std::unique(begin, results.end());
+    end = std::remove_if(begin, end, [&frustum](SpatialHashEntry* entry) {
+        return !frustum.intersects_aabb(entry->hash_aabb());
+    });
+
+    results.erase(end, results.end());
+}
 
+template<typename Vector>
+void SpatialHash::gather_objects_within_box(const AABB& box, Vector& objects) {
     auto cell_size = find_cell_size_for_box(box);
 
-    auto gather_objects = [](Index& index, const Key& key, HGSHEntryList& objects) {
+    auto gather_objects = [](Index& index, const Key& key, Vector& objects) {
         auto it = index.lower_bound(key);
         if(it == index.end()) {
             return;
@@ -163,7 +170,7 @@ HGSHEntryList SpatialHash::find_objects_within_box(const AABB &box) {
         // First, iterate the index to find a key which isn't a descendent of this one
         // then break
         while(it != index.end() && key.is_ancestor_of(it->first)) {
-            objects.insert(it->second.begin(), it->second.end());
+            objects.insert(objects.end(), it->second.begin(), it->second.end());
             ++it;
         }
 
@@ -173,12 +180,14 @@ HGSHEntryList SpatialHash::find_objects_within_box(const AABB &box) {
             path = path.parent_key();
             it = index.find(path);
             if(it != index.end() && path.is_ancestor_of(it->first)) {
-                objects.insert(it->second.begin(), it->second.end());
+                objects.insert(objects.end(), it->second.begin(), it->second.end());
             }
         }
     };
 
-    KeyList seen;
+    /* A box has 8 corners, so at most 8 distinct keys */
+    Key seen[8];
+    std::size_t seen_count = 0;
 
     for(auto& corner: box.corners()) {
         auto key = make_key(
@@ -187,14 +196,31 @@ HGSHEntryList SpatialHash::find_objects_within_box(const AABB &box) {
             corner.y,
             corner.z
         );
-        seen.insert(key);
+
+        if(std::find(seen, seen + seen_count, key) == seen + seen_count) {
+            seen[seen_count++] = key;
+        }
     }
 
-    for(auto& key: seen) {
-        gather_objects(index_, key, objects);
+    for(std::size_t i = 0; i < seen_count; ++i) {
+        gather_objects(index_, seen[i], objects);
     }
+}
+
+HGSHEntryList SpatialHash::find_objects_within_frustum(const Frustum &frustum) {
+    std::vector<SpatialHashEntry*> results;
+    gather_objects_within_frustum(frustum, results);
+    return HGSHEntryList(results.begin(), results.end());
+}
+
+void SpatialHash::find_objects_within_frustum(const Frustum& frustum, FrameVector<SpatialHashEntry*>& out) {
+    gather_objects_within_frustum(frustum, out);
+}
 
-    return objects;
+HGSHEntryList SpatialHash::find_objects_within_box(const AABB &box) {
+    std::vector<SpatialHashEntry*> objects;
+    gather_objects_within_box(box, objects);
+    return HGSHEntryList(objects.begin(), objects.end());
 }
 
 int32_t SpatialHash::find_cell_size_for_box(const AABB &box) const {
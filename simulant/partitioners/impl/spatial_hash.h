@@ -6,6 +6,7 @@
 #include <ostream>
 #include <unordered_set>
 #include "../../interfaces.h"
+#include "../../generic/frame_arena.h"
 
 /*
  * Hierarchical Grid Spatial Hash implementation
@@ -129,11 +130,22 @@ public:
     HGSHEntryList find_objects_within_box(const AABB& box);
     HGSHEntryList find_objects_within_frustum(const Frustum& frustum);
 
+    /* Appends the objects within the frustum to out, each only once. Used
+     * when rendering, where the results are thrown away every frame */
+    void find_objects_within_frustum(const Frustum& frustum, FrameVector<SpatialHashEntry*>& out);
+
     friend std::ostream &operator<<(std::ostream &os, const SpatialHash &hash);
 
 private:
     void erase_object_from_key(Key key, SpatialHashEntry* object);
 
+    /* These append to out, and may add the same object more than once */
+    template<typename Vector>
+    void gather_objects_within_box(const AABB& box, Vector& out);
+
+    template<typename Vector>
+    void gather_objects_within_frustum(const Frustum& frustum, Vector& out);
+
     int32_t find_cell_size_for_box(const AABB& box) const;
     void insert_object_for_key(Key key, SpatialHashEntry* entry);
 
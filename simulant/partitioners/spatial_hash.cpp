@@ -6,6 +6,7 @@
 #include "../nodes/geom.h"
 #include "../nodes/geoms/geom_culler.h"
 #include "../stage.h"
+#include "../window.h"
 
 namespace smlt {
 
@@ -187,7 +188,9 @@ void SpatialHashPartitioner::lights_and_geometry_visible_from(
     thread::ReadLock<thread::SharedMutex> lock(lock_);
 
     auto frustum = stage->camera(camera_id)->frustum();
-    auto entries = hash_->find_objects_within_frustum(frustum);
+
+    FrameVector<SpatialHashEntry*> entries{FrameAllocator<SpatialHashEntry*>(stage->window->frame_arena->local())};
+    hash_->find_objects_within_frustum(frustum, entries);
 
     for(auto& entry: entries) {
         auto pentry = static_cast<PartitionerEntry*>(entry);
@@ -53,6 +53,9 @@ public:
         std::vector<StageNode*> &geom_out
     );
 
+protected:
+    bool culls_by_frustum_only() const override { return true; }
+
 private:
     void stage_add_actor(ActorID obj);
     void stage_remove_actor(ActorID obj);
@@ -19,10 +19,11 @@
 
 #include <unordered_map>
 
-#include "generic/algorithm.h"
+#include "generic/frame_arena.h"
 #include "render_sequence.h"
 #include "stage.h"
 #include "nodes/actor.h"
+#include "nodes/geom.h"
 #include "nodes/camera.h"
 #include "nodes/light.h"
 
@@ -46,6 +47,8 @@ RenderSequence::RenderSequence(Window *window):
     render_options.backface_culling_enabled = true;
     render_options.point_size = 1;
 
+    occlusion_culler_.set_thread_pool(window->worker_pool.get());
+
     clean_up_connection_ = window->signal_post_idle().connect([&]() {
         pipeline_manager_->clean_up();
     });
@@ -168,17 +171,69 @@ void RenderSequence::set_renderer(Renderer* renderer) {
 }
 
 void RenderSequence::run() {
-    targets_rendered_this_frame_.clear();
+    /* Each pipeline is drawn as soon as it's been gathered. Some nodes rewrite
+     * buffers they share between cameras while gathering (particle billboards,
+     * the BSP culler's visible faces), so gathering every pipeline first
+     * would draw them all with the last camera's data */
+    prepare_pipelines(true);
+    finish();
+}
 
+void RenderSequence::prepare() {
+    prepare_pipelines(false);
+}
+
+void RenderSequence::prepare_pipelines(bool draw_each) {
     /* Perform any pre-rendering tasks */
     renderer_->pre_render();
 
+    if(geometry_snapshots_enabled_) {
+        /* The last frame has been drawn, so anything it didn't use can go */
+        geometry_snapshot_.collect();
+    }
+
+    if(draw_each) {
+        targets_rendered_this_frame_.clear();
+    }
+
+    prepared_count_ = 0;
+    nodes_occluded_ = 0;
+    ++prepare_count_;
+
     int actors_rendered = 0;
     for(auto& pipeline: ordered_pipelines_) {
-        run_pipeline(pipeline, actors_rendered);
+        auto before = prepared_count_;
+        prepare_pipeline(pipeline, actors_rendered);
+
+        if(draw_each && prepared_count_ > before) {
+            draw_pipeline(*prepared_[before]);
+        }
     }
 
     window->stats->set_subactors_rendered(actors_rendered);
+    window->stats->set_nodes_occluded(nodes_occluded_);
+}
+
+void RenderSequence::draw() {
+    targets_rendered_this_frame_.clear();
+
+    for(std::size_t i = 0; i < prepared_count_; ++i) {
+        draw_pipeline(*prepared_[i]);
+    }
+}
+
+void RenderSequence::finish() {
+    for(std::size_t i = 0; i < prepared_count_; ++i) {
+        auto& prepared = *prepared_[i];
+
+        // Trigger a signal to indicate the stage has been rendered
+        prepared.stage->signal_stage_post_render()(prepared.camera_id, prepared.viewport);
+
+        signal_pipeline_finished_(*prepared.pipeline);
+        prepared.queue.clear();
+    }
+
+    prepared_count_ = 0;
 }
 
 
@@ -187,15 +242,11 @@ uint64_t generate_frame_id() {
     return ++frame_id;
 }
 
-void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_rendered) {
+void RenderSequence::prepare_pipeline(PipelinePtr pipeline_stage, int &actors_rendered) {
     /*
-     * This is where rendering actually happens.
-     *
-     * FIXME: This needs some serious thought regarding thread-safety. There is no locking here
-     * and another thread could be adding/removing objects, updating the partitioner, or changing materials
-     * and/or textures on renderables. We need to make sure that we render a consistent snapshot of the world
-     * which means figuring out some kind of locking around the render queue building and traversal, or
-     * some deep-copying (of materials/textures/renderables) to make sure that nothing changes during traversal
+     * Everything the pipeline's camera can see is gathered into a render queue
+     * here, along with copies of the state that drawing needs, so that
+     * draw_pipeline() doesn't need to look at the stage at all.
      */
     uint64_t frame_id = generate_frame_id();
 
@@ -212,29 +263,25 @@ void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_render
         return;
     }
 
-    RenderTarget& target = *window_; //FIXME: Should be window or texture
-
-    /*
-     *  Render targets can specify whether their buffer should be cleared at the start of each frame. We do this the first
-     *  time we hit a render target when processing the pipelines. We keep track of the targets that have been rendered each frame
-     *  and this list is cleared at the start of run().
-     */
-    if(targets_rendered_this_frame_.find(&target) == targets_rendered_this_frame_.end()) {
-        if(target.clear_every_frame_flags()) {
-            Viewport view(smlt::VIEWPORT_TYPE_FULL, target.clear_every_frame_colour());
-            view.clear(target, target.clear_every_frame_flags());
-        }
-
-        targets_rendered_this_frame_.insert(&target);
+    if(prepared_count_ == prepared_.size()) {
+        prepared_.push_back(std::unique_ptr<PreparedPipeline>(new PreparedPipeline()));
     }
 
-    auto& viewport = pipeline_stage->viewport;
-
-    uint32_t clear = pipeline_stage->clear_flags();
-    if(clear) {
-        viewport->clear(target, clear); //Implicitly calls apply
-    } else {
-        viewport->apply(target); //FIXME apply shouldn't exist, it ties Viewport to OpenGL...
+    auto& prepared = *prepared_[prepared_count_++];
+    prepared.pipeline = pipeline_stage;
+    prepared.stage = stage;
+    prepared.camera_id = camera->id();
+    prepared.viewport = *pipeline_stage->viewport.get();
+    prepared.clear_flags = pipeline_stage->clear_flags();
+    prepared.frame_id = frame_id;
+
+    auto& viewport = prepared.viewport;
+    auto& render_queue = prepared.queue;
+
+    if(geometry_snapshots_enabled_) {
+        /* Copies are kept per gather, so that a buffer rewritten for a later
+         * pipeline doesn't change what this one draws */
+        geometry_snapshot_.begin_gather(prepared_count_ - 1);
     }
 
     signal_pipeline_started_(*pipeline_stage);
@@ -247,21 +294,47 @@ void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_render
 
     static std::vector<LightID> light_ids;
     static std::vector<StageNode*> nodes_visible;
+    static std::vector<uint32_t> renderable_lights;
+    static std::vector<uint32_t> candidate_lights;
 
     /* Empty out, but leave capacity to prevent constant allocations */
     light_ids.resize(0);
     nodes_visible.resize(0);
 
-    // Gather the lights and geometry visible to the camera
-    stage->partitioner->lights_and_geometry_visible_from(camera->id(), light_ids, nodes_visible);
+    // Gather the lights and geometry visible to the camera, other pipelines
+    // using the same camera share the result
+    stage->partitioner->visible_from(camera->id(), light_ids, nodes_visible);
 
-    // Get the actual lights from the IDs
-    auto lights_visible = map<decltype(light_ids), std::vector<LightPtr>>(
-        light_ids, [&](const LightID& light_id) -> LightPtr { return stage->light(light_id); }
-    );
+    if(occlusion_culling_enabled_) {
+        nodes_occluded_ += cull_occluded(camera, nodes_visible);
+    }
+
+    // Get the actual lights from the IDs, these are only needed until the queue has copied them
+    FrameVector<LightPtr> lights_visible{FrameAllocator<LightPtr>(window->frame_arena->local())};
+    lights_visible.reserve(light_ids.size());
+
+    for(auto& light_id: light_ids) {
+        lights_visible.push_back(stage->light(light_id));
+    }
 
     // Reset it, ready for this pipeline
-    render_queue_.reset(stage, window->renderer.get(), camera);
+    render_queue.reset(stage, window->renderer.get(), camera);
+    render_queue.set_viewport_height(viewport.height_in_pixels(*window_));
+
+    // Renderables point at the queue's copies of the lights, by index into lights_visible
+    render_queue.set_lights(lights_visible.data(), lights_visible.size());
+
+    // Bin the lights into view space clusters, pipelines sharing a camera see
+    // the same lights so they can share the grid too
+    if(light_grid_frame_ != prepare_count_ || light_grid_camera_ != camera->id()) {
+        light_grid_.build(
+            camera->view_matrix(), camera->projection_matrix(),
+            lights_visible.data(), lights_visible.size()
+        );
+
+        light_grid_frame_ = prepare_count_;
+        light_grid_camera_ = camera->id();
+    }
 
     // Mark the visible objects as visible
     for(auto& node: nodes_visible) {
@@ -269,22 +342,40 @@ void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_render
             continue;
         }
 
-        auto renderable_lights = filter(lights_visible, [&node](const LightPtr& light) -> bool {
+        // Only the lights in the clusters the node covers can reach it
+        candidate_lights.resize(0);
+        light_grid_.lights_for(node->transformed_aabb(), candidate_lights);
+
+        renderable_lights.resize(0);
+
+        for(auto i: candidate_lights) {
+            auto& light = lights_visible[i];
+
             // Filter by whether or not the renderable bounds intersects the light bounds
+            bool affected = false;
             if(light->type() == LIGHT_TYPE_DIRECTIONAL) {
-                return true;
+                affected = true;
             } else if(light->type() == LIGHT_TYPE_SPOT_LIGHT) {
-                return node->transformed_aabb().intersects_aabb(light->transformed_aabb());
+                affected = node->transformed_aabb().intersects_aabb(light->transformed_aabb());
             } else {
-                return node->transformed_aabb().intersects_sphere(light->absolute_position(), light->range() * 2);
+                affected = node->transformed_aabb().intersects_sphere(light->absolute_position(), light->range() * 2);
             }
-        });
+
+            if(affected) {
+                renderable_lights.push_back(i);
+            }
+        }
+
+        auto centre = node->centre();
 
         std::partial_sort(
             renderable_lights.begin(),
             renderable_lights.begin() + std::min(MAX_LIGHTS_PER_RENDERABLE, (uint32_t) renderable_lights.size()),
             renderable_lights.end(),
-            [=](LightPtr lhs, LightPtr rhs) {
+            [&](uint32_t lhs_index, uint32_t rhs_index) {
+                auto& lhs = lights_visible[lhs_index];
+                auto& rhs = lights_visible[rhs_index];
+
                 /* FIXME: Sorting by the centre point is problematic. A renderable is made up
                  * of many polygons, by choosing the light closest to the center you may find that
                  * that polygons far away from the center aren't affected by lights when they should be.
@@ -295,8 +386,8 @@ void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_render
                     return false;
                 }
 
-                float lhs_dist = (node->centre() - lhs->position()).length_squared();
-                float rhs_dist = (node->centre() - rhs->position()).length_squared();
+                float lhs_dist = (centre - lhs->position()).length_squared();
+                float rhs_dist = (centre - rhs->position()).length_squared();
                 return lhs_dist < rhs_dist;
             }
         );
@@ -308,14 +399,14 @@ void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_render
         auto level = pipeline_stage->detail_level_at_distance(distance_to_camera);
 
         /* Push any renderables for this node */
-        auto initial = render_queue_.renderable_count();
-        node->_get_renderables(&render_queue_, camera, level);
+        auto initial = render_queue.renderable_count();
+        node->_get_renderables(&render_queue, camera, level);
 
         // FIXME: Change _get_renderables to return the number inserted
-        auto count = render_queue_.renderable_count() - initial;
+        auto count = render_queue.renderable_count() - initial;
 
         for(auto i = initial; i < initial + count; ++i) {
-            auto renderable = render_queue_.renderable(i);
+            auto renderable = render_queue.renderable(i);
 
             assert(
                 renderable->arrangement == MESH_ARRANGEMENT_LINES ||
@@ -330,26 +421,75 @@ void RenderSequence::run_pipeline(PipelinePtr pipeline_stage, int &actors_render
             assert(renderable->index_data);
             assert(renderable->vertex_data);
 
-            for(auto i = 0u; i < MAX_LIGHTS_PER_RENDERABLE; ++i) {
-                renderable->lights_affecting_this_frame[i] = (i < renderable_lights.size()) ? renderable_lights[i] : nullptr;
+            if(geometry_snapshots_enabled_) {
+                renderable->vertex_data = geometry_snapshot_.vertex_data(renderable->vertex_data);
+                renderable->index_data = geometry_snapshot_.index_data(renderable->index_data);
+            }
+
+            for(auto j = 0u; j < MAX_LIGHTS_PER_RENDERABLE; ++j) {
+                renderable->lights_affecting_this_frame[j] = (j < renderable_lights.size()) ?
+                    render_queue.light_state(renderable_lights[j]) : nullptr;
             }
         }
     }
 
-    actors_rendered += render_queue_.renderable_count();
+    actors_rendered += render_queue.renderable_count();
+}
 
-    using namespace std::placeholders;
+std::size_t RenderSequence::cull_occluded(CameraPtr camera, std::vector<StageNode*>& nodes) {
+    occlusion_culler_.begin(camera->view_matrix(), camera->projection_matrix());
 
-    auto visitor = renderer_->get_render_queue_visitor(camera);
+    // Occluders which aren't visible can't hide anything on screen
+    for(auto node: nodes) {
+        if(!node->is_occluder() || !node->is_visible()) {
+            continue;
+        }
 
-    // Render the visible objects
-    render_queue_.traverse(visitor.get(), frame_id);
+        MeshPtr mesh;
+        if(auto actor = dynamic_cast<Actor*>(node)) {
+            mesh = actor->base_mesh();
+        } else if(auto geom = dynamic_cast<Geom*>(node)) {
+            mesh = geom->stage->assets->mesh(geom->mesh_id());
+        }
 
-    // Trigger a signal to indicate the stage has been rendered
-    stage->signal_stage_post_render()(camera->id(), viewport);
+        occlusion_culler_.add_occluder(node->absolute_transformation(), mesh);
+    }
 
-    signal_pipeline_finished_(*pipeline_stage);
-    render_queue_.clear();
+    if(!occlusion_culler_.triangle_count()) {
+        return 0;
+    }
+
+    occlusion_culler_.rasterize();
+    return occlusion_culler_.cull(nodes);
+}
+
+void RenderSequence::draw_pipeline(PreparedPipeline& prepared) {
+    RenderTarget& target = *window_; //FIXME: Should be window or texture
+
+    /*
+     *  Render targets can specify whether their buffer should be cleared at the start of each frame. We do this the first
+     *  time we hit a render target when processing the pipelines. We keep track of the targets that have been rendered each frame
+     *  and this list is cleared at the start of draw().
+     */
+    if(targets_rendered_this_frame_.find(&target) == targets_rendered_this_frame_.end()) {
+        if(target.clear_every_frame_flags()) {
+            Viewport view(smlt::VIEWPORT_TYPE_FULL, target.clear_every_frame_colour());
+            renderer_->clear(target, view, target.clear_every_frame_flags());
+        }
+
+        targets_rendered_this_frame_.insert(&target);
+    }
+
+    if(prepared.clear_flags) {
+        renderer_->clear(target, prepared.viewport, prepared.clear_flags); //Implicitly applies the viewport
+    } else {
+        renderer_->apply_viewport(target, prepared.viewport);
+    }
+
+    auto visitor = renderer_->get_render_queue_visitor();
+
+    // Render the visible objects
+    prepared.queue.traverse(visitor.get(), prepared.frame_id);
 }
 
 }
@@ -31,6 +31,9 @@
 #include "viewport.h"
 #include "partitioner.h"
 #include "pipeline.h"
+#include "renderers/batching/geometry_snapshot.h"
+#include "renderers/batching/light_grid.h"
+#include "renderers/batching/occlusion_culler.h"
 
 namespace smlt {
 
@@ -75,8 +78,41 @@ public:
     //void set_batcher(Batcher::ptr batcher);
     void set_renderer(Renderer *renderer);
 
+    /* Renders every active pipeline. Unlike prepare(), draw() then finish(),
+     * each pipeline is drawn straight after it's gathered */
     void run();
 
+    /*
+     * Rendering is split in three so that the drawing can overlap the next
+     * frame's updates. prepare() gathers what each pipeline can see into render
+     * queues, along with copies of the camera, lights and fog. draw() then only
+     * reads those queues, and finish() fires the post render signals.
+     *
+     * Nothing may be destroyed between prepare() and finish(), but nodes can
+     * be moved. Materials and textures are still read while drawing, so they
+     * shouldn't be changed while draw() is running.
+     */
+    void prepare();
+    void draw();
+    void finish();
+
+    /* When enabled, prepare() also copies the vertex and index data that the
+     * render queues use so that meshes can be changed while draw() runs. Each
+     * pipeline gets its own copies, which are only copied again when the data
+     * changes */
+    void set_geometry_snapshots_enabled(bool value) { geometry_snapshots_enabled_ = value; }
+    bool geometry_snapshots_enabled() const { return geometry_snapshots_enabled_; }
+
+    const batcher::GeometrySnapshot& geometry_snapshot() const { return geometry_snapshot_; }
+
+    /* When enabled, nodes hidden behind occluders (see StageNode::set_occluder)
+     * are removed after the partitioner has gathered what the camera can see.
+     * This is done on the CPU, spread across worker threads */
+    void set_occlusion_culling_enabled(bool value) { occlusion_culling_enabled_ = value; }
+    bool occlusion_culling_enabled() const { return occlusion_culling_enabled_; }
+
+    const batcher::OcclusionCuller& occlusion_culler() const { return occlusion_culler_; }
+
     sig::signal<void (Pipeline&)>& signal_pipeline_started() { return signal_pipeline_started_; }
     sig::signal<void (Pipeline&)>& signal_pipeline_finished() { return signal_pipeline_finished_; }
 
@@ -94,13 +130,46 @@ public:
     }
 
 private:    
+    struct PreparedPipeline {
+        PipelinePtr pipeline;
+        Stage* stage = nullptr;
+        CameraID camera_id;
+        Viewport viewport;
+        uint32_t clear_flags = 0;
+        uint64_t frame_id = 0;
+
+        batcher::RenderQueue queue;
+    };
+
     void sort_pipelines(bool acquire_lock=false);
-    void run_pipeline(PipelinePtr stage, int& actors_rendered);
+    void prepare_pipelines(bool draw_each);
+    void prepare_pipeline(PipelinePtr stage, int& actors_rendered);
+    void draw_pipeline(PreparedPipeline& prepared);
+
+    /* Removes the nodes hidden by the occluders among them, returns how many were removed */
+    std::size_t cull_occluded(CameraPtr camera, std::vector<StageNode*>& nodes);
 
     Window* window_ = nullptr;
     Renderer* renderer_ = nullptr;
 
-    batcher::RenderQueue render_queue_;
+    /* Kept between frames so the queues hold on to their allocations, only
+     * the first prepared_count_ are in use */
+    std::vector<std::unique_ptr<PreparedPipeline>> prepared_;
+    std::size_t prepared_count_ = 0;
+
+    bool geometry_snapshots_enabled_ = false;
+    batcher::GeometrySnapshot geometry_snapshot_;
+
+    /* Built for the first pipeline using a camera each frame, and shared
+     * with any others using the same one */
+    batcher::LightGrid light_grid_;
+    CameraID light_grid_camera_;
+    uint64_t light_grid_frame_ = 0;
+    uint64_t prepare_count_ = 0;
+
+    bool occlusion_culling_enabled_ = false;
+    batcher::OcclusionCuller occlusion_culler_;
+    uint32_t nodes_occluded_ = 0;
 
     thread::Mutex pipeline_lock_;
     std::list<PipelinePtr> ordered_pipelines_;
@@ -0,0 +1,136 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "geometry_snapshot.h"
+#include "../../vertex_data.h"
+
+namespace smlt {
+namespace batcher {
+
+const VertexData* GeometrySnapshot::vertex_data(const VertexData* source) {
+    if(!source) {
+        return nullptr;
+    }
+
+    auto& copies = vertex_copies_[source];
+    if(copies.size() <= gather_) {
+        copies.resize(gather_ + 1);
+    }
+
+    auto& copy = copies[gather_];
+
+    bool stale = !copy.data || copy.source_uuid != source->uuid() || copy.last_updated != source->last_updated();
+
+    /* clone_into fails if the vertex specification changed */
+    if(stale && (!copy.data || !source->clone_into(*copy.data))) {
+        copy.data = VertexData::create(source->vertex_specification());
+        source->clone_into(*copy.data);
+    }
+
+    if(stale) {
+        /* Bumps the copy's last_updated() so renderers re-upload it */
+        copy.data->done();
+
+        copy.source_uuid = source->uuid();
+        copy.last_updated = source->last_updated();
+        bytes_copied_ += source->data_size();
+    }
+
+    copy.used = true;
+    return copy.data.get();
+}
+
+const IndexData* GeometrySnapshot::index_data(const IndexData* source) {
+    if(!source) {
+        return nullptr;
+    }
+
+    auto& copies = index_copies_[source];
+    if(copies.size() <= gather_) {
+        copies.resize(gather_ + 1);
+    }
+
+    auto& copy = copies[gather_];
+
+    bool stale = !copy.data || copy.source_uuid != source->uuid() || copy.last_updated != source->last_updated();
+
+    if(stale && (!copy.data || !source->clone_into(*copy.data))) {
+        copy.data = IndexData::create(source->index_type());
+        source->clone_into(*copy.data);
+    }
+
+    if(stale) {
+        copy.data->done();
+
+        copy.source_uuid = source->uuid();
+        copy.last_updated = source->last_updated();
+        bytes_copied_ += source->data_size();
+    }
+
+    copy.used = true;
+    return copy.data.get();
+}
+
+template<typename Map>
+static void collect_unused(Map& sources) {
+    for(auto it = sources.begin(); it != sources.end();) {
+        bool used = false;
+        for(auto& copy: it->second) {
+            if(!copy.used) {
+                copy.data.reset();
+            }
+
+            used = used || copy.used;
+            copy.used = false;
+        }
+
+        if(!used) {
+            it = sources.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+template<typename Map>
+static std::size_t count_copies(const Map& sources) {
+    std::size_t count = 0;
+    for(auto& p: sources) {
+        for(auto& copy: p.second) {
+            count += (copy.data) ? 1 : 0;
+        }
+    }
+
+    return count;
+}
+
+void GeometrySnapshot::collect() {
+    collect_unused(vertex_copies_);
+    collect_unused(index_copies_);
+
+    gather_ = 0;
+    bytes_copied_ = 0;
+}
+
+std::size_t GeometrySnapshot::copy_count() const {
+    return count_copies(vertex_copies_) + count_copies(index_copies_);
+}
+
+}
+}
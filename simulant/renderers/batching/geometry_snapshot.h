@@ -0,0 +1,81 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../../generic/uniquely_identifiable.h"
+
+namespace smlt {
+
+class VertexData;
+class IndexData;
+
+namespace batcher {
+
+/*
+ * Keeps copies of the vertex and index data that renderables point at, so a
+ * render queue can still be drawn while the meshes (or particle systems, or
+ * animated actors) it came from are being changed on another thread.
+ *
+ * Each gather (one per pipeline) gets copies of its own, because some nodes
+ * rewrite the same buffer for each camera while gathering. Data is only
+ * copied again when its last_updated() time changes, so static geometry costs
+ * one copy per gather that draws it. Copies which weren't asked for between
+ * two calls to collect() are freed.
+ */
+class GeometrySnapshot {
+public:
+    /* Following copies belong to the given gather, counting from zero each frame */
+    void begin_gather(std::size_t gather) { gather_ = gather; }
+
+    const VertexData* vertex_data(const VertexData* source);
+    const IndexData* index_data(const IndexData* source);
+
+    /* Frees the copies which weren't used since the last call */
+    void collect();
+
+    std::size_t copy_count() const;
+
+    /* Bytes copied since the last collect() */
+    std::size_t bytes_copied() const { return bytes_copied_; }
+
+private:
+    template<typename T>
+    struct Copy {
+        /* Addresses get reused, the uuid tells us it's really the same source */
+        uuid64 source_uuid = 0;
+        uint64_t last_updated = 0;
+        std::shared_ptr<T> data;
+        bool used = false;
+    };
+
+    /* Indexed by gather */
+    std::unordered_map<const VertexData*, std::vector<Copy<VertexData>>> vertex_copies_;
+    std::unordered_map<const IndexData*, std::vector<Copy<IndexData>>> index_copies_;
+
+    std::size_t gather_ = 0;
+    std::size_t bytes_copied_ = 0;
+};
+
+}
+}
@@ -0,0 +1,174 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cstring>
+#include <unordered_map>
+
+#include "instancing.h"
+#include "renderable.h"
+#include "../../vertex_data.h"
+
+namespace smlt {
+namespace batcher {
+
+static uint32_t read_index(const uint8_t* data, IndexType type, std::size_t i) {
+    switch(type) {
+        case INDEX_TYPE_8_BIT: return data[i];
+        case INDEX_TYPE_16_BIT: return ((const uint16_t*) data)[i];
+        case INDEX_TYPE_32_BIT: return ((const uint32_t*) data)[i];
+    default:
+        return 0;
+    }
+}
+
+void InstanceMerger::build_unique_vertices(const Renderable* renderable) {
+    auto idata = renderable->index_data;
+
+    if(idata == index_data_ && idata->last_updated() == index_data_version_ && renderable->index_element_count == index_count_) {
+        return;
+    }
+
+    index_data_ = idata;
+    index_data_version_ = idata->last_updated();
+    index_count_ = renderable->index_element_count;
+
+    unique_vertices_.clear();
+    remapped_indices_.clear();
+
+    /* Mesh vertex data is shared between submeshes, so only the vertices
+     * this renderable actually references are copied for each instance */
+    std::unordered_map<uint32_t, uint32_t> remap;
+
+    auto data = idata->data();
+    auto type = idata->index_type();
+
+    for(std::size_t i = 0; i < index_count_; ++i) {
+        auto idx = read_index(data, type, i);
+
+        auto it = remap.find(idx);
+        if(it == remap.end()) {
+            it = remap.insert(std::make_pair(idx, (uint32_t) unique_vertices_.size())).first;
+            unique_vertices_.push_back(idx);
+        }
+
+        remapped_indices_.push_back(it->second);
+    }
+}
+
+bool InstanceMerger::can_merge(const Renderable* renderable) {
+    if(!renderable->vertex_data || !renderable->index_data || !renderable->index_element_count) {
+        return false;
+    }
+
+    auto& spec = renderable->vertex_data->vertex_specification();
+    if(spec.position_attribute != VERTEX_ATTRIBUTE_3F) {
+        return false;
+    }
+
+    if(spec.has_normals() && spec.normal_attribute != VERTEX_ATTRIBUTE_3F) {
+        return false;
+    }
+
+    /* Strips and fans can't be joined together without degenerates */
+    if(renderable->arrangement != MESH_ARRANGEMENT_TRIANGLES &&
+       renderable->arrangement != MESH_ARRANGEMENT_LINES &&
+       renderable->arrangement != MESH_ARRANGEMENT_QUADS) {
+        return false;
+    }
+
+    build_unique_vertices(renderable);
+
+    return (
+        !unique_vertices_.empty() &&
+        unique_vertices_.size() <= MAX_MERGEABLE_INSTANCE_VERTICES &&
+        unique_vertices_.size() * spec.stride() <= MAX_MERGED_VERTEX_BYTES
+    );
+}
+
+std::size_t InstanceMerger::merge(const Renderable* const* renderables, std::size_t count, VertexData& vertices, IndexData& indices) {
+    if(!count || !can_merge(renderables[0])) {
+        return 0;
+    }
+
+    auto source = renderables[0]->vertex_data;
+    auto& spec = source->vertex_specification();
+    const uint32_t stride = spec.stride();
+
+    const std::size_t per_instance = unique_vertices_.size();
+    std::size_t fit = std::min<std::size_t>(
+        MAX_MERGED_VERTICES / per_instance,
+        MAX_MERGED_VERTEX_BYTES / (per_instance * stride)
+    );
+
+    fit = std::min(fit, count);
+
+    if(!(vertices.vertex_specification() == spec)) {
+        vertices.reset(spec);
+    }
+
+    vertices.resize(fit * per_instance);
+
+    const bool has_normals = spec.has_normals();
+    const uint32_t position_offset = spec.position_offset(false);
+    const uint32_t normal_offset = (has_normals) ? spec.normal_offset(false) : 0;
+
+    const uint8_t* src = source->data();
+    uint8_t* dst = vertices.data();
+
+    index_buffer_.clear();
+    index_buffer_.reserve(fit * remapped_indices_.size());
+
+    for(std::size_t i = 0; i < fit; ++i) {
+        const Mat4& transform = renderables[i]->final_transformation;
+        const uint32_t base = i * per_instance;
+
+        for(auto idx: unique_vertices_) {
+            std::memcpy(dst, src + (idx * stride), stride);
+
+            Vec3 p;
+            std::memcpy(&p, dst + position_offset, sizeof(Vec3));
+            p = p.transformed_by(transform);
+            std::memcpy(dst + position_offset, &p, sizeof(Vec3));
+
+            if(has_normals) {
+                Vec3 n;
+                std::memcpy(&n, dst + normal_offset, sizeof(Vec3));
+                n = n.rotated_by(transform).normalized();
+                std::memcpy(dst + normal_offset, &n, sizeof(Vec3));
+            }
+
+            dst += stride;
+        }
+
+        for(auto idx: remapped_indices_) {
+            index_buffer_.push_back(base + idx);
+        }
+    }
+
+    vertices.done();
+
+    indices.clear();
+    indices.index(&index_buffer_[0], index_buffer_.size());
+    indices.done();
+
+    return fit;
+}
+
+}
+}
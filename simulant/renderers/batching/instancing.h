@@ -0,0 +1,82 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace smlt {
+
+struct Renderable;
+class VertexData;
+class IndexData;
+
+namespace batcher {
+
+/*
+ * Renderers which can't instance on the GPU can use InstanceMerger to
+ * pre-transform a batch of identical renderables (as passed to
+ * RenderQueueVisitor::visit_instanced) into a single vertex and index buffer
+ * which can be drawn with one call and an identity model matrix.
+ *
+ * This is only worthwhile for small meshes, so meshes with more than
+ * MAX_MERGEABLE_INSTANCE_VERTICES unique vertices are rejected.
+ */
+
+/* Largest number of (unique) vertices an instance can have to be merged */
+const uint32_t MAX_MERGEABLE_INSTANCE_VERTICES = 512;
+
+/* Merged output is limited so indices stay 16 bit and buffers
+ * stay within a single shared VBO slot */
+const uint32_t MAX_MERGED_VERTICES = 65535;
+const uint32_t MAX_MERGED_VERTEX_BYTES = 256 * 1024;
+
+class InstanceMerger {
+public:
+    /* Returns true if renderables sharing this one's geometry can be merged */
+    bool can_merge(const Renderable* renderable);
+
+    /*
+     * Writes pre-transformed copies of as many of the renderables as will fit
+     * into vertices and indices (which are overwritten). The vertex data is reset
+     * to the renderables' vertex specification if necessary, and indices should be
+     * 16 bit. All the renderables must share vertex and index data.
+     *
+     * Returns the number of renderables that were merged, which will be zero
+     * if can_merge() is false for them.
+     */
+    std::size_t merge(const Renderable* const* renderables, std::size_t count, VertexData& vertices, IndexData& indices);
+
+private:
+    /* The last geometry we calculated unique indices for */
+    const IndexData* index_data_ = nullptr;
+    uint64_t index_data_version_ = 0;
+    std::size_t index_count_ = 0;
+
+    /* The vertices referenced by the index data, and the indices remapped to them */
+    std::vector<uint32_t> unique_vertices_;
+    std::vector<uint32_t> remapped_indices_;
+
+    std::vector<uint32_t> index_buffer_;
+
+    void build_unique_vertices(const Renderable* renderable);
+};
+
+}
+}
@@ -0,0 +1,265 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "light_grid.h"
+#include "../../nodes/light.h"
+
+namespace smlt {
+namespace batcher {
+
+const uint32_t LightGrid::TILES_X;
+const uint32_t LightGrid::TILES_Y;
+const uint32_t LightGrid::SLICES;
+const uint32_t LightGrid::CLUSTER_COUNT;
+
+/* The view space bounds of a world space box */
+static void view_bounds(const Mat4& view, const Vec3& min, const Vec3& max, Vec3& out_min, Vec3& out_max) {
+    const float big = std::numeric_limits<float>::max();
+
+    out_min = Vec3(big, big, big);
+    out_max = Vec3(-big, -big, -big);
+
+    for(uint32_t i = 0; i < 8; ++i) {
+        Vec3 corner(
+            (i & 1) ? max.x : min.x,
+            (i & 2) ? max.y : min.y,
+            (i & 4) ? max.z : min.z
+        );
+
+        auto p = corner.transformed_by(view);
+
+        out_min.x = std::min(out_min.x, p.x);
+        out_min.y = std::min(out_min.y, p.y);
+        out_min.z = std::min(out_min.z, p.z);
+        out_max.x = std::max(out_max.x, p.x);
+        out_max.y = std::max(out_max.y, p.y);
+        out_max.z = std::max(out_max.z, p.z);
+    }
+}
+
+void LightGrid::build(const Mat4& view, const Mat4& projection, const LightPtr* lights, std::size_t count) {
+    view_ = view;
+    projection_ = projection;
+
+    /* Recover the clip planes from the projection matrix */
+    perspective_ = projection[15] == 0.0f;
+    if(perspective_) {
+        near_ = projection[14] / (projection[10] - 1.0f);
+        far_ = projection[14] / (projection[10] + 1.0f);
+    } else {
+        near_ = (projection[14] + 1.0f) / projection[10];
+        far_ = (projection[14] - 1.0f) / projection[10];
+    }
+
+    if(perspective_) {
+        near_ = std::max(near_, 0.0001f);
+        log_depth_ratio_ = std::log(std::max(far_ / near_, 1.0001f));
+    }
+
+    light_count_ = count;
+
+    directional_.clear();
+    light_ranges_.resize(count);
+    light_on_screen_.assign(count, 0);
+    offsets_.assign(CLUSTER_COUNT + 1, 0);
+
+    for(std::size_t i = 0; i < count; ++i) {
+        auto& light = lights[i];
+
+        if(light->type() == LIGHT_TYPE_DIRECTIONAL) {
+            directional_.push_back(i);
+            continue;
+        }
+
+        Vec3 min, max;
+        if(light->type() == LIGHT_TYPE_SPOT_LIGHT) {
+            auto aabb = light->transformed_aabb();
+            view_bounds(view_, aabb.min(), aabb.max(), min, max);
+        } else {
+            /* Matches the sphere the render sequence tests nodes against,
+             * which is twice the light's range */
+            auto p = light->absolute_position();
+            auto r = light->range() * 2;
+            view_bounds(view_, p - Vec3(r, r, r), p + Vec3(r, r, r), min, max);
+        }
+
+        auto& range = light_ranges_[i];
+        if(!range_for_view_box(min, max, range)) {
+            continue;
+        }
+
+        light_on_screen_[i] = 1;
+
+        /* Count first, so the lists can be packed together */
+        for(auto z = range.z0; z <= range.z1; ++z) {
+            for(auto y = range.y0; y <= range.y1; ++y) {
+                for(auto x = range.x0; x <= range.x1; ++x) {
+                    ++offsets_[cluster_index(x, y, z) + 1];
+                }
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < CLUSTER_COUNT; ++i) {
+        offsets_[i + 1] += offsets_[i];
+    }
+
+    cluster_lights_.resize(offsets_[CLUSTER_COUNT]);
+
+    /* Fill each cluster from its start, stepping the start along as we go
+     * and then shifting them all back afterwards */
+    for(std::size_t i = 0; i < count; ++i) {
+        if(!light_on_screen_[i]) {
+            continue;
+        }
+
+        auto& range = light_ranges_[i];
+        for(auto z = range.z0; z <= range.z1; ++z) {
+            for(auto y = range.y0; y <= range.y1; ++y) {
+                for(auto x = range.x0; x <= range.x1; ++x) {
+                    cluster_lights_[offsets_[cluster_index(x, y, z)]++] = i;
+                }
+            }
+        }
+    }
+
+    for(uint32_t i = CLUSTER_COUNT; i > 0; --i) {
+        offsets_[i] = offsets_[i - 1];
+    }
+    offsets_[0] = 0;
+
+    seen_.assign(count, 0);
+    stamp_ = 0;
+}
+
+void LightGrid::lights_for(const AABB& bounds, std::vector<uint32_t>& out) const {
+    out.insert(out.end(), directional_.begin(), directional_.end());
+
+    if(cluster_lights_.empty()) {
+        return;
+    }
+
+    Vec3 min, max;
+    view_bounds(view_, bounds.min(), bounds.max(), min, max);
+
+    Range range;
+    if(!range_for_view_box(min, max, range)) {
+        return;
+    }
+
+    if(++stamp_ == 0) {
+        std::fill(seen_.begin(), seen_.end(), 0);
+        stamp_ = 1;
+    }
+
+    for(auto z = range.z0; z <= range.z1; ++z) {
+        for(auto y = range.y0; y <= range.y1; ++y) {
+            for(auto x = range.x0; x <= range.x1; ++x) {
+                auto cluster = cluster_index(x, y, z);
+
+                for(auto i = offsets_[cluster]; i < offsets_[cluster + 1]; ++i) {
+                    auto light = cluster_lights_[i];
+                    if(seen_[light] != stamp_) {
+                        seen_[light] = stamp_;
+                        out.push_back(light);
+                    }
+                }
+            }
+        }
+    }
+}
+
+uint32_t LightGrid::slice_for_depth(float depth) const {
+    float s = 0.0f;
+    if(perspective_) {
+        s = std::log(std::max(depth, near_) / near_) / log_depth_ratio_;
+    } else {
+        s = (depth - near_) / (far_ - near_);
+    }
+
+    auto slice = int32_t(s * SLICES);
+    return (uint32_t) std::max(0, std::min(int32_t(SLICES) - 1, slice));
+}
+
+bool LightGrid::range_for_view_box(const Vec3& min, const Vec3& max, Range& range) const {
+    /* The camera looks down -Z */
+    float nearest = -max.z;
+    float furthest = -min.z;
+
+    if(furthest < near_ || nearest > far_) {
+        return false;
+    }
+
+    range.z0 = slice_for_depth(std::max(nearest, near_));
+    range.z1 = slice_for_depth(std::min(furthest, far_));
+
+    if(perspective_ && nearest < near_) {
+        /* Crosses the near plane so the projection can't be trusted, this
+         * only happens for things around the camera so just cover the screen */
+        range.x0 = range.y0 = 0;
+        range.x1 = TILES_X - 1;
+        range.y1 = TILES_Y - 1;
+        return true;
+    }
+
+    const float big = std::numeric_limits<float>::max();
+    float min_x = big, min_y = big;
+    float max_x = -big, max_y = -big;
+
+    for(uint32_t i = 0; i < 8; ++i) {
+        Vec4 corner(
+            (i & 1) ? max.x : min.x,
+            (i & 2) ? max.y : min.y,
+            (i & 4) ? max.z : min.z,
+            1.0f
+        );
+
+        auto clip = projection_ * corner;
+        float x = clip.x / clip.w;
+        float y = clip.y / clip.w;
+
+        min_x = std::min(min_x, x);
+        min_y = std::min(min_y, y);
+        max_x = std::max(max_x, x);
+        max_y = std::max(max_y, y);
+    }
+
+    if(max_x < -1.0f || min_x > 1.0f || max_y < -1.0f || min_y > 1.0f) {
+        return false;
+    }
+
+    auto tile = [](float ndc, uint32_t tiles) -> uint32_t {
+        auto t = int32_t((ndc * 0.5f + 0.5f) * tiles);
+        return (uint32_t) std::max(0, std::min(int32_t(tiles) - 1, t));
+    };
+
+    range.x0 = tile(min_x, TILES_X);
+    range.x1 = tile(max_x, TILES_X);
+    range.y0 = tile(min_y, TILES_Y);
+    range.y1 = tile(max_y, TILES_Y);
+
+    return true;
+}
+
+}
+}
@@ -0,0 +1,96 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../../types.h"
+
+namespace smlt {
+namespace batcher {
+
+/*
+ * Splits the camera's view into clusters (screen tiles, each cut into depth
+ * slices which get longer with distance) and records which lights reach each
+ * one. Something on screen then only needs to look at the lights in the
+ * clusters its bounds cover, rather than every visible light.
+ *
+ * The lists are conservative, lights_for() can return lights which don't
+ * actually reach the bounds, but never misses one that does. Directional
+ * lights reach everything.
+ */
+class LightGrid {
+public:
+    static const uint32_t TILES_X = 8;
+    static const uint32_t TILES_Y = 8;
+    static const uint32_t SLICES = 16;
+    static const uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+    void build(const Mat4& view, const Mat4& projection, const LightPtr* lights, std::size_t count);
+
+    /* Appends the indexes (into the lights passed to build()) of the lights
+     * which may reach the given world space bounds, each only once */
+    void lights_for(const AABB& bounds, std::vector<uint32_t>& out) const;
+
+    std::size_t light_count() const { return light_count_; }
+
+    /* The number of entries across all the cluster lists */
+    std::size_t assignment_count() const { return cluster_lights_.size(); }
+
+private:
+    struct Range {
+        uint32_t x0, x1, y0, y1, z0, z1;
+    };
+
+    Mat4 view_;
+    Mat4 projection_;
+    bool perspective_ = true;
+    float near_ = 1.0f;
+    float far_ = 1000.0f;
+    float log_depth_ratio_ = 1.0f;
+
+    std::size_t light_count_ = 0;
+
+    std::vector<uint32_t> directional_;
+
+    /* Each cluster's lights are cluster_lights_[offsets_[i]] to
+     * cluster_lights_[offsets_[i + 1]] */
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> cluster_lights_;
+
+    std::vector<Range> light_ranges_;
+    std::vector<uint8_t> light_on_screen_;
+
+    /* Used to avoid returning a light twice */
+    mutable std::vector<uint32_t> seen_;
+    mutable uint32_t stamp_ = 0;
+
+    /* Fills range with the clusters overlapped by a view space box. Returns
+     * false if the box is entirely off screen */
+    bool range_for_view_box(const Vec3& min, const Vec3& max, Range& range) const;
+    uint32_t slice_for_depth(float depth) const;
+
+    uint32_t cluster_index(uint32_t x, uint32_t y, uint32_t z) const {
+        return (z * TILES_Y + y) * TILES_X + x;
+    }
+};
+
+}
+}
@@ -0,0 +1,288 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cmath>
+#include <algorithm>
+
+#include "occlusion_culler.h"
+#include "../../meshes/mesh.h"
+#include "../../nodes/stage_node.h"
+#include "../../threads/thread_pool.h"
+
+namespace smlt {
+namespace batcher {
+
+const uint32_t OcclusionCuller::WIDTH;
+const uint32_t OcclusionCuller::HEIGHT;
+const uint32_t OcclusionCuller::TILE_SIZE;
+const uint32_t OcclusionCuller::TILES_X;
+const uint32_t OcclusionCuller::TILES_Y;
+
+/* Anything with a smaller w than this is treated as crossing the near plane */
+static const float MIN_W = 0.00001f;
+
+/* Below this many nodes it's not worth waking the workers */
+static const std::size_t MIN_CULL_BATCH = 64;
+
+OcclusionCuller::OcclusionCuller(thread::ThreadPool* pool):
+    pool_(pool) {
+
+    depth_.assign(WIDTH * HEIGHT, 1.0f);
+    tiles_.assign(TILES_X * TILES_Y, 1.0f);
+}
+
+void OcclusionCuller::begin(const Mat4& view, const Mat4& projection) {
+    view_projection_ = projection * view;
+
+    triangles_.clear();
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+    std::fill(tiles_.begin(), tiles_.end(), 1.0f);
+}
+
+void OcclusionCuller::add_occluder(const Mat4& transformation, MeshPtr mesh) {
+    if(!mesh) {
+        return;
+    }
+
+    auto& vertices = *mesh->vertex_data;
+    auto transform = view_projection_ * transformation;
+
+    clip_.resize(vertices.count());
+    for(uint32_t i = 0; i < vertices.count(); ++i) {
+        clip_[i] = transform * vertices.position_nd_at(i);
+    }
+
+    for(auto submesh: mesh->each_submesh()) {
+        submesh->each_triangle([this](uint32_t a, uint32_t b, uint32_t c) {
+            add_clip_triangle(clip_[a], clip_[b], clip_[c]);
+        });
+    }
+}
+
+void OcclusionCuller::add_triangle(const Vec3& a, const Vec3& b, const Vec3& c) {
+    add_clip_triangle(
+        view_projection_ * Vec4(a, 1.0f),
+        view_projection_ * Vec4(b, 1.0f),
+        view_projection_ * Vec4(c, 1.0f)
+    );
+}
+
+void OcclusionCuller::add_clip_triangle(const Vec4& a, const Vec4& b, const Vec4& c) {
+    /* Rather than clipping, triangles crossing the near plane are dropped.
+     * That only means they hide less than they could */
+    if(a.w < MIN_W || b.w < MIN_W || c.w < MIN_W) {
+        return;
+    }
+
+    Triangle tri;
+
+    const Vec4* in[3] = {&a, &b, &c};
+    for(uint32_t i = 0; i < 3; ++i) {
+        auto& p = *in[i];
+        tri.v[i] = Vec3(
+            (p.x / p.w * 0.5f + 0.5f) * WIDTH,
+            (p.y / p.w * 0.5f + 0.5f) * HEIGHT,
+            p.z / p.w * 0.5f + 0.5f
+        );
+    }
+
+    float min_x = std::min(tri.v[0].x, std::min(tri.v[1].x, tri.v[2].x));
+    float max_x = std::max(tri.v[0].x, std::max(tri.v[1].x, tri.v[2].x));
+    tri.min_y = std::min(tri.v[0].y, std::min(tri.v[1].y, tri.v[2].y));
+    tri.max_y = std::max(tri.v[0].y, std::max(tri.v[1].y, tri.v[2].y));
+
+    if(max_x < 0.0f || min_x > WIDTH || tri.max_y < 0.0f || tri.min_y > HEIGHT) {
+        return;
+    }
+
+    triangles_.push_back(tri);
+}
+
+void OcclusionCuller::rasterize() {
+    if(pool_ && !triangles_.empty()) {
+        pool_->parallel_for(TILES_Y, 1, [this](std::size_t begin, std::size_t end) {
+            for(auto i = begin; i < end; ++i) {
+                rasterize_band(i);
+            }
+        });
+    } else {
+        for(uint32_t i = 0; i < TILES_Y; ++i) {
+            rasterize_band(i);
+        }
+    }
+}
+
+void OcclusionCuller::rasterize_band(uint32_t band) {
+    /* Each band is a row of tiles, so bands can be drawn at the same time
+     * without sharing any pixels */
+    const int32_t band_y0 = band * TILE_SIZE;
+    const int32_t band_y1 = band_y0 + TILE_SIZE;
+
+    for(auto& tri: triangles_) {
+        if(tri.max_y < band_y0 || tri.min_y > band_y1) {
+            continue;
+        }
+
+        auto v0 = tri.v[0];
+        auto v1 = tri.v[1];
+        auto v2 = tri.v[2];
+
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if(std::abs(area) < 0.0001f) {
+            continue;
+        }
+
+        /* Occluders are drawn from both sides, so just fix the winding */
+        if(area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        float inv_area = 1.0f / area;
+
+        int32_t x0 = std::max(0, (int32_t) std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+        int32_t x1 = std::min(int32_t(WIDTH) - 1, (int32_t) std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+        int32_t y0 = std::max(band_y0, (int32_t) std::floor(tri.min_y));
+        int32_t y1 = std::min(band_y1 - 1, (int32_t) std::ceil(tri.max_y));
+
+        /* Edge functions step by a constant per pixel along a row */
+        float e0_dx = -(v2.y - v1.y), e1_dx = -(v0.y - v2.y), e2_dx = -(v1.y - v0.y);
+
+        for(int32_t y = y0; y <= y1; ++y) {
+            float px = x0 + 0.5f;
+            float py = y + 0.5f;
+
+            float e0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+            float e1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+            float e2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+
+            float* row = &depth_[y * WIDTH];
+
+            for(int32_t x = x0; x <= x1; ++x) {
+                if(e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                    float z = (e0 * v0.z + e1 * v1.z + e2 * v2.z) * inv_area;
+                    row[x] = std::min(row[x], z);
+                }
+
+                e0 += e0_dx;
+                e1 += e1_dx;
+                e2 += e2_dx;
+            }
+        }
+    }
+
+    /* Reduce the band to its row of tiles */
+    for(uint32_t tx = 0; tx < TILES_X; ++tx) {
+        float furthest = 0.0f;
+        for(int32_t y = band_y0; y < band_y1; ++y) {
+            const float* row = &depth_[y * WIDTH + tx * TILE_SIZE];
+            for(uint32_t x = 0; x < TILE_SIZE; ++x) {
+                furthest = std::max(furthest, row[x]);
+            }
+        }
+
+        tiles_[band * TILES_X + tx] = furthest;
+    }
+}
+
+bool OcclusionCuller::is_visible(const AABB& bounds) const {
+    float min_x = WIDTH, min_y = HEIGHT, max_x = 0.0f, max_y = 0.0f;
+    float nearest = 1.0f;
+
+    for(auto& corner: bounds.corners()) {
+        auto p = view_projection_ * Vec4(corner, 1.0f);
+        if(p.w < MIN_W) {
+            return true;
+        }
+
+        float x = (p.x / p.w * 0.5f + 0.5f) * WIDTH;
+        float y = (p.y / p.w * 0.5f + 0.5f) * HEIGHT;
+
+        min_x = std::min(min_x, x);
+        min_y = std::min(min_y, y);
+        max_x = std::max(max_x, x);
+        max_y = std::max(max_y, y);
+        nearest = std::min(nearest, p.z / p.w * 0.5f + 0.5f);
+    }
+
+    if(nearest < 0.0f) {
+        return true;
+    }
+
+    /* Off screen is for the frustum culling to decide */
+    if(max_x < 0.0f || min_x > WIDTH || max_y < 0.0f || min_y > HEIGHT) {
+        return true;
+    }
+
+    auto tile = [](float v, uint32_t tile_count) -> int32_t {
+        return std::max(0, std::min(int32_t(tile_count) - 1, int32_t(v) / int32_t(TILE_SIZE)));
+    };
+
+    auto tx0 = tile(std::max(min_x, 0.0f), TILES_X);
+    auto tx1 = tile(std::max(max_x, 0.0f), TILES_X);
+    auto ty0 = tile(std::max(min_y, 0.0f), TILES_Y);
+    auto ty1 = tile(std::max(max_y, 0.0f), TILES_Y);
+
+    for(auto ty = ty0; ty <= ty1; ++ty) {
+        for(auto tx = tx0; tx <= tx1; ++tx) {
+            if(nearest <= tiles_[ty * TILES_X + tx]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+std::size_t OcclusionCuller::cull(std::vector<StageNode*>& nodes) {
+    /* Bounds are calculated lazily, so fetch them here rather than on
+     * the workers */
+    bounds_.resize(nodes.size());
+    visible_.resize(nodes.size());
+
+    for(std::size_t i = 0; i < nodes.size(); ++i) {
+        bounds_[i] = nodes[i]->transformed_aabb();
+    }
+
+    auto test = [this, &nodes](std::size_t begin, std::size_t end) {
+        for(auto i = begin; i < end; ++i) {
+            visible_[i] = nodes[i]->is_occluder() || is_visible(bounds_[i]);
+        }
+    };
+
+    if(pool_ && nodes.size() >= MIN_CULL_BATCH * 2) {
+        pool_->parallel_for(nodes.size(), MIN_CULL_BATCH, test);
+    } else {
+        test(0, nodes.size());
+    }
+
+    std::size_t kept = 0;
+    for(std::size_t i = 0; i < nodes.size(); ++i) {
+        if(visible_[i]) {
+            nodes[kept++] = nodes[i];
+        }
+    }
+
+    auto culled = nodes.size() - kept;
+    nodes.resize(kept);
+    return culled;
+}
+
+}
+}
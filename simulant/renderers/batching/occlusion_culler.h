@@ -0,0 +1,114 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../../types.h"
+
+namespace smlt {
+
+class StageNode;
+
+namespace thread {
+    class ThreadPool;
+}
+
+namespace batcher {
+
+/*
+ * Hides nodes which are behind occluders (e.g. buildings or level walls).
+ *
+ * The occluders are drawn into a small depth buffer on the CPU, which is
+ * then reduced to a hierarchical-Z buffer holding the furthest depth of each
+ * tile. A node is hidden if its bounds are behind that depth in every tile
+ * they cover on screen.
+ *
+ * The test is conservative, anything which is even partly uncovered, or
+ * which crosses the near plane, is kept. Occluders should be simple, closed
+ * meshes as every triangle is drawn each time begin() is called.
+ *
+ * If a thread pool is passed, drawing and testing are spread across its
+ * workers.
+ */
+class OcclusionCuller {
+public:
+    static const uint32_t WIDTH = 256;
+    static const uint32_t HEIGHT = 128;
+    static const uint32_t TILE_SIZE = 8;
+    static const uint32_t TILES_X = WIDTH / TILE_SIZE;
+    static const uint32_t TILES_Y = HEIGHT / TILE_SIZE;
+
+    OcclusionCuller(thread::ThreadPool* pool=nullptr);
+
+    void set_thread_pool(thread::ThreadPool* pool) { pool_ = pool; }
+
+    /* Clears the buffers and any queued occluders, ready for a new view */
+    void begin(const Mat4& view, const Mat4& projection);
+
+    /* Queues the triangles of a mesh, or a single world space triangle, to be
+     * drawn by rasterize() */
+    void add_occluder(const Mat4& transformation, MeshPtr mesh);
+    void add_triangle(const Vec3& a, const Vec3& b, const Vec3& c);
+
+    /* Draws the queued occluders and builds the hierarchical-Z buffer */
+    void rasterize();
+
+    /* Returns false if the world space bounds are hidden by the occluders */
+    bool is_visible(const AABB& bounds) const;
+
+    /* Removes the hidden nodes, keeping the rest in order. Occluders are
+     * never removed. Returns how many nodes were removed */
+    std::size_t cull(std::vector<StageNode*>& nodes);
+
+    std::size_t triangle_count() const { return triangles_.size(); }
+
+    /* Depth in the range [0, 1], where 1 is the far plane. Exposed for
+     * debugging and tests */
+    float depth_at(uint32_t x, uint32_t y) const { return depth_[y * WIDTH + x]; }
+    float tile_depth_at(uint32_t x, uint32_t y) const { return tiles_[y * TILES_X + x]; }
+
+private:
+    /* Screen space, x and y in pixels and z as depth */
+    struct Triangle {
+        Vec3 v[3];
+        float min_y;
+        float max_y;
+    };
+
+    thread::ThreadPool* pool_ = nullptr;
+
+    Mat4 view_projection_;
+
+    std::vector<Triangle> triangles_;
+    std::vector<float> depth_;
+    std::vector<float> tiles_;
+
+    /* Scratch space, kept to avoid allocating each frame */
+    std::vector<Vec4> clip_;
+    std::vector<AABB> bounds_;
+    std::vector<uint8_t> visible_;
+
+    void add_clip_triangle(const Vec4& a, const Vec4& b, const Vec4& c);
+    void rasterize_band(uint32_t band);
+};
+
+}
+}
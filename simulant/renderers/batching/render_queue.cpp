@@ -25,6 +25,7 @@
 #include "../../nodes/geom.h"
 #include "../../nodes/geoms/geom_culler.h"
 #include "../../nodes/camera.h"
+#include "../../nodes/light.h"
 
 #include "render_queue.h"
 #include "../../partitioner.h"
@@ -50,9 +51,35 @@ void RenderQueue::reset(Stage* stage, RenderGroupFactory* factory, CameraPtr cam
     render_group_factory_ = factory;
     camera_ = camera;
 
+    view_matrix_ = camera->view_matrix();
+    projection_matrix_ = camera->projection_matrix();
+    ambient_light_ = stage->ambient_light();
+    fog_ = *stage->fog;
+    viewport_height_ = 0;
+
     clear();
 }
 
+void RenderQueue::set_lights(const LightPtr* lights, std::size_t count) {
+    lights_.clear();
+
+    for(std::size_t i = 0; i < count; ++i) {
+        auto& light = lights[i];
+
+        LightState state;
+        state.type = light->type();
+        state.position = light->absolute_position();
+        state.ambient = light->ambient();
+        state.diffuse = light->diffuse();
+        state.specular = light->specular();
+        state.constant_attenuation = light->constant_attenuation();
+        state.linear_attenuation = light->linear_attenuation();
+        state.quadratic_attenuation = light->quadratic_attenuation();
+
+        lights_.push_back(state);
+    }
+}
+
 void RenderQueue::insert_renderable(Renderable&& src_renderable) {
     /*
      * Adds a renderable to the correct render groups. This goes through the
@@ -108,6 +135,66 @@ void RenderQueue::clear() {
     }
 
     renderables_.clear();
+    lights_.clear();
+}
+
+void RenderQueue::gather_instances(const SortedRenderables& queue) const {
+    /*
+     * Groups the opaque renderables in the queue by the things that would otherwise
+     * force a separate draw call: geometry, material pass and lights. Each entry
+     * in the queue is then tagged with the batch it belongs to (or -1 if it's
+     * blended, or its batch wasn't big enough to be worth it).
+     */
+
+    instance_lookup_.clear();
+    instance_batches_.clear();
+    instance_batch_for_entry_.clear();
+
+    auto lights_hash = [](const Renderable* renderable) -> std::size_t {
+        std::size_t seed = 0;
+        for(auto& light: renderable->lights_affecting_this_frame) {
+            seed ^= std::hash<const LightState*>()(light) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    };
+
+    for(auto& p: queue) {
+        const RenderGroup& group = p.first;
+        const Renderable* renderable = &renderables_[p.second];
+
+        if(group.sort_key.is_blended) {
+            instance_batch_for_entry_.push_back(-1);
+            continue;
+        }
+
+        auto key = std::make_tuple(
+            renderable->vertex_data,
+            renderable->index_data,
+            renderable->index_element_count,
+            (uint32_t) renderable->arrangement,
+            (const MaterialPass*) renderable->material->pass(group.sort_key.pass),
+            lights_hash(renderable)
+        );
+
+        auto it = instance_lookup_.find(key);
+        if(it == instance_lookup_.end()) {
+            it = instance_lookup_.insert(std::make_pair(key, instance_batches_.size())).first;
+            instance_batches_.push_back(InstanceBatch());
+        } else if(instance_batches_[it->second].renderables[0]->lights_affecting_this_frame != renderable->lights_affecting_this_frame) {
+            // Hash collision on the lights, just draw this one on its own
+            instance_batch_for_entry_.push_back(-1);
+            continue;
+        }
+
+        instance_batches_[it->second].renderables.push_back(renderable);
+        instance_batch_for_entry_.push_back(it->second);
+    }
+
+    for(auto& batch_id: instance_batch_for_entry_) {
+        if(batch_id >= 0 && instance_batches_[batch_id].renderables.size() < MIN_INSTANCE_BATCH_SIZE) {
+            batch_id = -1;
+        }
+    }
 }
 
 void RenderQueue::traverse(RenderQueueVisitor* visitor, uint64_t frame_id) const {
@@ -121,10 +208,35 @@ void RenderQueue::traverse(RenderQueueVisitor* visitor, uint64_t frame_id) const
 
         const RenderGroup* last_group = nullptr;
 
+        if(instancing_enabled_) {
+            gather_instances(queue);
+        }
+
+        std::size_t entry = 0;
         for(auto& p: queue) {
             const RenderGroup* current_group = &p.first;
             const Renderable* renderable = &renderables_[p.second];
 
+            InstanceBatch* batch = nullptr;
+            if(instancing_enabled_) {
+                auto batch_id = instance_batch_for_entry_[entry];
+                if(batch_id >= 0) {
+                    batch = &instance_batches_[batch_id];
+                }
+            }
+
+            ++entry;
+
+            if(batch) {
+                /* The whole batch is drawn when we reach its first (closest)
+                 * renderable, so skip the rest */
+                if(batch->visited) {
+                    continue;
+                }
+
+                batch->visited = true;
+            }
+
             /* We do this here so that we don't change render group unless something in the
              * new group is visible */
             if(!last_group || *current_group != *last_group) {
@@ -151,7 +263,7 @@ void RenderQueue::traverse(RenderQueueVisitor* visitor, uint64_t frame_id) const
             }
 
             for(Iteration i = 0; i < iterations; ++i) {
-                LightPtr next = nullptr;
+                const LightState* next = nullptr;
 
                 // Pass down the light if necessary, otherwise just pass nullptr
                 if(!lights.empty()) {
@@ -165,7 +277,12 @@ void RenderQueue::traverse(RenderQueueVisitor* visitor, uint64_t frame_id) const
                 } else if(pass_iteration_type == ITERATION_TYPE_N || pass_iteration_type == ITERATION_TYPE_ONCE) {
                     visitor->apply_lights(&lights[0], (uint8_t) lights.size());
                 }
-                visitor->visit(renderable, material_pass, i);
+
+                if(batch) {
+                    visitor->visit_instanced(&batch->renderables[0], batch->renderables.size(), material_pass, i);
+                } else {
+                    visitor->visit(renderable, material_pass, i);
+                }
             }
 
             last_group = current_group;
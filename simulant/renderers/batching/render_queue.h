@@ -20,10 +20,13 @@
 
 #include <list>
 #include <set>
+#include <tuple>
+#include <unordered_map>
 
 #include "../../generic/containers/contiguous_map.h"
 
 #include "../../types.h"
+#include "../../fog_settings.h"
 #include "../../threads/shared_mutex.h"
 #include "../../generic/vector_pool.h"
 #include "../../macros.h"
@@ -32,9 +35,36 @@ namespace smlt {
 
 class MaterialPass;
 class Renderer;
+class VertexData;
+class IndexData;
 struct Renderable;
 class Light;
 
+/*
+ * What the renderer needs to know about a light. The visible lights are
+ * copied into these when a queue is built, so nothing reads the Light itself
+ * while the queue is drawn.
+ */
+struct LightState {
+    LightType type = LIGHT_TYPE_POINT;
+
+    /* The absolute position, or the direction for directional lights */
+    Vec3 position;
+
+    Colour ambient;
+    Colour diffuse;
+    Colour specular;
+
+    float constant_attenuation = 1.0f;
+    float linear_attenuation = 0.0f;
+    float quadratic_attenuation = 0.0f;
+
+    /* Position as a homogeneous coordinate, w is 0 for directional lights */
+    Vec4 homogeneous_position() const {
+        return Vec4(position, (type == LIGHT_TYPE_DIRECTIONAL) ? 0.0f : 1.0f);
+    }
+};
+
 namespace batcher {
 
 struct RenderGroupKey {
@@ -121,9 +151,23 @@ public:
     virtual void change_render_group(const RenderGroup* prev, const RenderGroup* next) = 0;
 
     virtual void change_material_pass(const MaterialPass* prev, const MaterialPass* next) = 0;
-    virtual void apply_lights(const LightPtr* lights, const uint8_t count) = 0;
+    /* lights has count entries, any of which may be null */
+    virtual void apply_lights(const LightState* const* lights, const uint8_t count) = 0;
 
     virtual void visit(const Renderable*, const MaterialPass*, Iteration) = 0;
+
+    /*
+     * Called instead of visit() when the queue finds several opaque renderables which
+     * share vertex data, index data, material pass and lights. Renderers which can draw
+     * these in a single call should override this, by default each renderable is
+     * just visited in turn.
+     */
+    virtual void visit_instanced(const Renderable* const* renderables, std::size_t count, const MaterialPass* pass, Iteration iteration) {
+        for(std::size_t i = 0; i < count; ++i) {
+            visit(renderables[i], pass, iteration);
+        }
+    }
+
     virtual void end_traversal(const RenderQueue& queue, Stage* stage) = 0;
 };
 
@@ -154,6 +198,10 @@ private:
 };
 
 
+/* Renderables which share geometry are only passed to visit_instanced() if
+ * there are at least this many of them */
+const std::size_t MIN_INSTANCE_BATCH_SIZE = 2;
+
 class RenderQueue {
 public:
     typedef std::function<void (bool, const RenderGroup*, Renderable*, MaterialPass*, Light*, Iteration)> TraverseCallback;
@@ -162,6 +210,23 @@ public:
 
     void reset(Stage* stage, RenderGroupFactory* render_group_factory, CameraPtr camera);
 
+    /* Copies the lights, renderables refer to them with light_state() */
+    void set_lights(const LightPtr* lights, std::size_t count);
+    const LightState* light_state(std::size_t i) const { return &lights_[i]; }
+    std::size_t light_count() const { return lights_.size(); }
+
+    /* These are copied from the camera and stage by reset(), so the queue
+     * can be drawn while they change */
+    const Mat4& view_matrix() const { return view_matrix_; }
+    const Mat4& projection_matrix() const { return projection_matrix_; }
+    const Colour& ambient_light() const { return ambient_light_; }
+    const FogSettings& fog() const { return fog_; }
+
+    /* The height of the viewport the queue is drawn into, in pixels. Zero
+     * after reset() until the render sequence sets it */
+    void set_viewport_height(uint32_t pixels) { viewport_height_ = pixels; }
+    uint32_t viewport_height() const { return viewport_height_; }
+
     void insert_renderable(Renderable&& renderable); // IMPORTANT, must update RenderGroups if they exist already
     void clear();
 
@@ -174,6 +239,14 @@ public:
     Renderable* renderable(const std::size_t i) {
         return &renderables_[i];
     }
+
+    /* When enabled (the default) opaque renderables which share geometry and
+     * material pass are gathered together and passed to the visitor with
+     * visit_instanced(). Blended renderables are never gathered as that would
+     * break their back-to-front ordering */
+    void set_instancing_enabled(bool value) { instancing_enabled_ = value; }
+    bool instancing_enabled() const { return instancing_enabled_; }
+
 private:
     // std::map is ordered, so by using the RenderGroup as the key we
     // minimize GL state changes (e.g. if a RenderGroupImpl orders by TextureID, then ShaderID
@@ -185,11 +258,35 @@ private:
     RenderGroupFactory* render_group_factory_ = nullptr;
     CameraPtr camera_;
 
+    Mat4 view_matrix_;
+    Mat4 projection_matrix_;
+    Colour ambient_light_;
+    FogSettings fog_;
+    uint32_t viewport_height_ = 0;
+    std::vector<LightState> lights_;
+
     std::vector<Renderable> renderables_;
     std::array<SortedRenderables, RENDER_PRIORITY_MAX - RENDER_PRIORITY_MIN> priority_queues_;
 
     void clean_empty_batches();
 
+    bool instancing_enabled_ = true;
+
+    /* Scratch space for gathering instances during traverse(), kept
+     * around to avoid allocating each frame */
+    typedef std::tuple<const VertexData*, const IndexData*, std::size_t, uint32_t, const MaterialPass*, std::size_t> InstanceKey;
+
+    struct InstanceBatch {
+        std::vector<const Renderable*> renderables;
+        bool visited = false;
+    };
+
+    mutable std::unordered_map<InstanceKey, std::size_t> instance_lookup_;
+    mutable std::vector<InstanceBatch> instance_batches_;
+    mutable std::vector<int32_t> instance_batch_for_entry_;
+
+    void gather_instances(const SortedRenderables& queue) const;
+
     mutable thread::Mutex queue_lock_;
 };
 
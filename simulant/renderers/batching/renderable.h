@@ -64,7 +64,7 @@ struct Renderable final {
     Mat4 final_transformation;
     Material* material = nullptr;
     bool is_visible = true;
-    std::array<LightPtr, MAX_LIGHTS_PER_RENDERABLE> lights_affecting_this_frame;
+    std::array<const LightState*, MAX_LIGHTS_PER_RENDERABLE> lights_affecting_this_frame = {};
 
     smlt::Vec3 centre;
 };
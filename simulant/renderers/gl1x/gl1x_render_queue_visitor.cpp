@@ -6,6 +6,11 @@
     #include "../glad/glad/glad.h"
 #endif
 
+#ifndef GL_HALF_FLOAT
+/* ARB_half_float_vertex, which glad doesn't generate for GL 2.1 */
+#define GL_HALF_FLOAT 0x140B
+#endif
+
 #include "gl1x_render_queue_visitor.h"
 #include "gl1x_renderer.h"
 #include "gl1x_render_group_impl.h"
@@ -19,15 +24,14 @@
 namespace smlt {
 
 
-GL1RenderQueueVisitor::GL1RenderQueueVisitor(GL1XRenderer* renderer, CameraPtr camera):
-    renderer_(renderer),
-    camera_(camera) {
+GL1RenderQueueVisitor::GL1RenderQueueVisitor(GL1XRenderer* renderer):
+    renderer_(renderer) {
 
 }
 
 void GL1RenderQueueVisitor::start_traversal(const batcher::RenderQueue& queue, uint64_t frame_id, Stage* stage) {
-    _S_UNUSED(queue);
     _S_UNUSED(frame_id);
+    _S_UNUSED(stage);
 
     /* Set up default client state before the run. This is necessary
      * so that the boolean flags get correctly set */
@@ -40,31 +44,36 @@ void GL1RenderQueueVisitor::start_traversal(const batcher::RenderQueue& queue, u
         disable_texcoord_array(i, true);
     }
 
-    global_ambient_ = stage->ambient_light();
+    view_matrix_ = queue.view_matrix();
+    projection_matrix_ = queue.projection_matrix();
+
+    global_ambient_ = queue.ambient_light();
     GLCheck(glLightModelfv, GL_LIGHT_MODEL_AMBIENT, &global_ambient_.r);
 
-    if(!stage->fog->is_enabled()) {
+    auto& fog = queue.fog();
+
+    if(!fog.is_enabled()) {
         GLCheck(glDisable, GL_FOG);
     } else {
         GLCheck(glEnable, GL_FOG);
-        switch(stage->fog->type()) {
+        switch(fog.type()) {
         case FOG_TYPE_EXP: {
             GLCheck(glFogi, GL_FOG_MODE, GL_EXP);
-            GLCheck(glFogf, GL_FOG_DENSITY, stage->fog->exp_density());
+            GLCheck(glFogf, GL_FOG_DENSITY, fog.exp_density());
         } break;
         case FOG_TYPE_EXP2: {
             GLCheck(glFogi, GL_FOG_MODE, GL_EXP2);
-            GLCheck(glFogf, GL_FOG_DENSITY, stage->fog->exp_density());
+            GLCheck(glFogf, GL_FOG_DENSITY, fog.exp_density());
         } break;
         case FOG_TYPE_LINEAR:
         default: {
             GLCheck(glFogi, GL_FOG_MODE, GL_LINEAR);
-            GLCheck(glFogf, GL_FOG_START, stage->fog->linear_start());
-            GLCheck(glFogf, GL_FOG_END, stage->fog->linear_end());
+            GLCheck(glFogf, GL_FOG_START, fog.linear_start());
+            GLCheck(glFogf, GL_FOG_END, fog.linear_end());
         } break;
         }
 
-        GLCheck(glFogfv, GL_FOG_COLOR, &stage->fog->colour().r);
+        GLCheck(glFogfv, GL_FOG_COLOR, &fog.colour().r);
     }
 }
 
@@ -283,29 +292,29 @@ void GL1RenderQueueVisitor::change_material_pass(const MaterialPass* prev, const
     }
 }
 
-void GL1RenderQueueVisitor::apply_lights(const LightPtr* lights, const uint8_t count) {
+void GL1RenderQueueVisitor::apply_lights(const LightState* const* lights, const uint8_t count) {
     if(!count) {
         return;
     }
 
-    Light* current = nullptr;
+    const LightState* current = nullptr;
 
-    const LightState disabled_state;
+    const GLLightState disabled_state;
 
     bool matrix_loaded = false;
 
     for(uint8_t i = 0; i < MAX_LIGHTS_PER_RENDERABLE; ++i) {
         current = (i < count) ? lights[i] : nullptr;
 
-        auto state = (current) ? LightState(
+        auto state = (current) ? GLLightState(
             true,
-            Vec4(current->absolute_position(), (current->type() == LIGHT_TYPE_DIRECTIONAL) ? 0 : 1),
-            current->diffuse(),
-            current->ambient(),
-            current->specular(),
-            current->constant_attenuation(),
-            current->linear_attenuation(),
-            current->quadratic_attenuation()
+            current->homogeneous_position(),
+            current->diffuse,
+            current->ambient,
+            current->specular,
+            current->constant_attenuation,
+            current->linear_attenuation,
+            current->quadratic_attenuation
         ) : disabled_state;
 
         /* No need to update this light */
@@ -321,9 +330,7 @@ void GL1RenderQueueVisitor::apply_lights(const LightPtr* lights, const uint8_t c
                 GLCheck(glMatrixMode, GL_MODELVIEW);
                 GLCheck(glPushMatrix);
 
-                const Mat4& view = camera_->view_matrix();
-
-                GLCheck(glLoadMatrixf, view.data());
+                GLCheck(glLoadMatrixf, view_matrix_.data());
                 matrix_loaded = true;
             }
 
@@ -437,6 +444,28 @@ static GLenum convert_index_type(IndexType type) {
     }
 }
 
+static GLenum convert_attribute_type(VertexAttribute attr) {
+    switch(attr) {
+    case VERTEX_ATTRIBUTE_4UB: return GL_UNSIGNED_BYTE;
+    case VERTEX_ATTRIBUTE_PACKED_VEC4_1I: return GL_UNSIGNED_INT_2_10_10_10_REV;
+    case VERTEX_ATTRIBUTE_2H:
+    case VERTEX_ATTRIBUTE_4H: return GL_HALF_FLOAT;
+    case VERTEX_ATTRIBUTE_4B: return GL_BYTE;
+    default:
+        return GL_FLOAT;
+    }
+}
+
+static GLint attribute_component_count(VertexAttribute attr) {
+    switch(attr) {
+    case VERTEX_ATTRIBUTE_2F:
+    case VERTEX_ATTRIBUTE_2H: return 2;
+    case VERTEX_ATTRIBUTE_3F: return 3;
+    default:
+        return 4;
+    }
+}
+
 void GL1RenderQueueVisitor::do_visit(const Renderable* renderable, const MaterialPass* material_pass, batcher::Iteration iteration) {
     _S_UNUSED(material_pass);
     _S_UNUSED(iteration);
@@ -448,10 +477,9 @@ void GL1RenderQueueVisitor::do_visit(const Renderable* renderable, const Materia
     }
 
     const Mat4 model = renderable->final_transformation;
-    const Mat4& view = camera_->view_matrix();
-    const Mat4& projection = camera_->projection_matrix();
+    const Mat4& projection = projection_matrix_;
 
-    Mat4 modelview = view * model;
+    Mat4 modelview = view_matrix_ * model;
 
     GLCheck(glMatrixMode, GL_MODELVIEW);
     GLCheck(glLoadMatrixf, modelview.data());
@@ -475,8 +503,8 @@ void GL1RenderQueueVisitor::do_visit(const Renderable* renderable, const Materia
         enable_vertex_arrays();
         GLCheck(
             glVertexPointer,
-            (spec.position_attribute == VERTEX_ATTRIBUTE_2F) ? 2 : (spec.position_attribute == VERTEX_ATTRIBUTE_3F) ? 3 : 4,
-            GL_FLOAT,
+            attribute_component_count(spec.position_attribute),
+            convert_attribute_type(spec.position_attribute),
             stride,
             ((const uint8_t*) vertex_data) + spec.position_offset(false)
         );
@@ -504,8 +532,9 @@ void GL1RenderQueueVisitor::do_visit(const Renderable* renderable, const Materia
     if(has_normals) {
         enable_normal_arrays();
 
-        auto type = (spec.normal_attribute == VERTEX_ATTRIBUTE_PACKED_VEC4_1I) ?
-            GL_UNSIGNED_INT_2_10_10_10_REV : GL_FLOAT;
+        /* Byte normals (VERTEX_ATTRIBUTE_4B) are normalized by GL, the
+         * fourth byte is padding and is skipped by the stride */
+        auto type = convert_attribute_type(spec.normal_attribute);
 
         /*
          * According to the ARB_vertex_type_2_10_10_10_rev extension, glNormalPointer
@@ -529,6 +558,13 @@ void GL1RenderQueueVisitor::do_visit(const Renderable* renderable, const Materia
     for(uint8_t i = 0; i < MAX_TEXTURE_UNITS; ++i) {
         bool enabled = spec.has_texcoordX(i);
 
+        if(enabled && spec.texcoordX_attribute(i) == VERTEX_ATTRIBUTE_2US) {
+            /* glTexCoordPointer can't take unsigned shorts, and wouldn't
+             * normalize them if it could */
+            L_WARN_ONCE("Normalized short texture coordinates aren't supported by the GL1 renderer");
+            enabled = false;
+        }
+
         if(enabled) {
             enable_texcoord_array(i);
             auto offset = spec.texcoordX_offset(i, false);
@@ -536,8 +572,8 @@ void GL1RenderQueueVisitor::do_visit(const Renderable* renderable, const Materia
             GLCheck(glClientActiveTexture, GL_TEXTURE0 + i);
             GLCheck(
                 glTexCoordPointer,
-                (spec.texcoordX_attribute(i) == VERTEX_ATTRIBUTE_2F) ? 2 : (spec.texcoordX_attribute(i) == VERTEX_ATTRIBUTE_3F) ? 3 : 4,
-                GL_FLOAT,
+                attribute_component_count(spec.texcoordX_attribute(i)),
+                convert_attribute_type(spec.texcoordX_attribute(i)),
                 stride,
                 ((const uint8_t*) vertex_data) + offset
             );
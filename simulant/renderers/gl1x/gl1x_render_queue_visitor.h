@@ -11,7 +11,7 @@ class GL1XRenderer;
 struct GL1RenderState {
     Renderable* renderable;
     MaterialPass* pass;
-    LightPtr light;
+    const LightState* light;
     batcher::Iteration iteration;
     GL1RenderGroupImpl* render_group_impl;
 };
@@ -19,7 +19,7 @@ struct GL1RenderState {
 
 class GL1RenderQueueVisitor : public batcher::RenderQueueVisitor {
 public:
-    GL1RenderQueueVisitor(GL1XRenderer* renderer, CameraPtr camera);
+    GL1RenderQueueVisitor(GL1XRenderer* renderer);
 
     void start_traversal(const batcher::RenderQueue& queue, uint64_t frame_id, Stage* stage);
     void visit(const Renderable* renderable, const MaterialPass* pass, batcher::Iteration);
@@ -27,15 +27,15 @@ public:
 
     void change_render_group(const batcher::RenderGroup *prev, const batcher::RenderGroup *next);
     void change_material_pass(const MaterialPass* prev, const MaterialPass* next);
-    void apply_lights(const LightPtr* lights, const uint8_t count);
+    void apply_lights(const LightState* const* lights, const uint8_t count);
 
 private:
     GL1XRenderer* renderer_;
-    CameraPtr camera_;
+    Mat4 view_matrix_;
+    Mat4 projection_matrix_;
     Colour global_ambient_;
 
     const MaterialPass* pass_ = nullptr;
-    LightPtr light_;
 
     GL1RenderGroupImpl* current_group_ = nullptr;
 
@@ -60,7 +60,7 @@ private:
 
     uint32_t default_texture_name_ = 0;
 
-    struct LightState {
+    struct GLLightState {
         bool initialized = false;
         bool enabled = false;
         Vec4 position;
@@ -71,8 +71,8 @@ private:
         float linear_att = 0;
         float quadratic_att = 0;
 
-        LightState() = default;
-        LightState(bool enabled, Vec4 pos, Colour diffuse, Colour ambient, Colour specular, float constant_att, float linear_att, float quadratic_att):
+        GLLightState() = default;
+        GLLightState(bool enabled, Vec4 pos, Colour diffuse, Colour ambient, Colour specular, float constant_att, float linear_att, float quadratic_att):
             enabled(enabled),
             position(pos),
             diffuse(diffuse),
@@ -82,11 +82,11 @@ private:
             linear_att(linear_att),
             quadratic_att(quadratic_att) {}
 
-        bool operator!=(const LightState& rhs) const {
+        bool operator!=(const GLLightState& rhs) const {
             return !(*this == rhs);
         }
 
-        bool operator==(const LightState& rhs) const {
+        bool operator==(const GLLightState& rhs) const {
             if(enabled != rhs.enabled) return false;
             if(position != rhs.position) return false;
             if(diffuse != rhs.diffuse) return false;
@@ -100,7 +100,7 @@ private:
         }
     };
 
-    LightState light_states_[MAX_LIGHTS_PER_RENDERABLE];
+    GLLightState light_states_[MAX_LIGHTS_PER_RENDERABLE];
 };
 
 
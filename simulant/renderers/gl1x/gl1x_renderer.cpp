@@ -70,13 +70,28 @@ void GL1XRenderer::init_context() {
     std::cout << _F("\tVersion: {0}\n\n").format(GL_version);
     std::cout << _F("\tExtensions: {0}\n\n").format(GL_extensions);
 
+    detect_capabilities();
+
     GLCheck(glEnable, GL_DEPTH_TEST);
     GLCheck(glDepthFunc, GL_LEQUAL);
     GLCheck(glEnable, GL_CULL_FACE);
 }
 
-std::shared_ptr<batcher::RenderQueueVisitor> GL1XRenderer::get_render_queue_visitor(CameraPtr camera) {
-    return std::make_shared<GL1RenderQueueVisitor>(this, camera);
+bool GL1XRenderer::supports_vertex_attribute(VertexAttribute attr) const {
+    switch(attr) {
+        case VERTEX_ATTRIBUTE_2H:
+        case VERTEX_ATTRIBUTE_4H:
+            return has_half_float_vertex_;
+        case VERTEX_ATTRIBUTE_2US:
+            /* Fixed function texcoord arrays can't be normalized */
+            return false;
+        default:
+            return true;
+    }
+}
+
+std::shared_ptr<batcher::RenderQueueVisitor> GL1XRenderer::get_render_queue_visitor() {
+    return std::make_shared<GL1RenderQueueVisitor>(this);
 }
 
 smlt::GL1XRenderer::GL1XRenderer(smlt::Window *window):
@@ -41,10 +41,12 @@ public:
         const float distance_to_camera
     ) override;
 
-    std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor(CameraPtr camera) override;
+    std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor() override;
 
     void init_context() override;
 
+    bool supports_vertex_attribute(VertexAttribute attr) const override;
+
     std::string name() const override {
         return "gl1x";
     }
@@ -52,6 +54,14 @@ public:
     void prepare_to_render(const Renderable *renderable) override {
         _S_UNUSED(renderable);
     }
+
+    void apply_viewport(const RenderTarget& target, const Viewport& viewport) override {
+        GLRenderer::apply_viewport(target, viewport);
+    }
+
+    void clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags) override {
+        GLRenderer::clear(target, viewport, clear_flags);
+    }
 private:
     void on_texture_prepare(TexturePtr texture) override {
         GLRenderer::on_texture_prepare(texture);
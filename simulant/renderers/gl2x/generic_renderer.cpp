@@ -29,6 +29,11 @@
 #include "vbo_manager.h"
 
 #include "../glad/glad/glad.h"
+
+#ifndef GL_HALF_FLOAT
+/* ARB_half_float_vertex, which glad doesn't generate for GL 2.1 */
+#define GL_HALF_FLOAT 0x140B
+#endif
 #include "../../utils/gl_error.h"
 #include "../../window.h"
 
@@ -85,7 +90,7 @@ batcher::RenderGroupKey GenericRenderer::prepare_render_group(
     );
 }
 
-void GenericRenderer::set_light_uniforms(const MaterialPass* pass, GPUProgram* program, const LightPtr light) {
+void GenericRenderer::set_light_uniforms(const MaterialPass* pass, GPUProgram* program, const LightState* light) {
     auto pos_property = pass->property_value(LIGHT_POSITION_PROPERTY);
     auto amb_property = pass->property_value(LIGHT_AMBIENT_PROPERTY);
     auto diff_property = pass->property_value(LIGHT_DIFFUSE_PROPERTY);
@@ -96,8 +101,7 @@ void GenericRenderer::set_light_uniforms(const MaterialPass* pass, GPUProgram* p
 
     auto pos_loc = program->locate_uniform(pos_property->shader_variable(), true);
     if(pos_loc > -1) {
-        auto pos = (light) ? light->absolute_position() : Vec3();
-        auto vec = (light) ? Vec4(pos, (light->type() == LIGHT_TYPE_DIRECTIONAL) ? 0.0 : 1.0) : Vec4();
+        auto vec = (light) ? light->homogeneous_position() : Vec4();
         program->set_uniform_vec4(pos_loc, vec);
     }
 
@@ -105,37 +109,37 @@ void GenericRenderer::set_light_uniforms(const MaterialPass* pass, GPUProgram* p
     if(amb_loc > -1) {
         program->set_uniform_colour(
             amb_loc,
-            (light) ? light->ambient() : Colour::NONE
+            (light) ? light->ambient : Colour::NONE
         );
     }
 
     auto diff_loc = program->locate_uniform(diff_property->shader_variable(), true);
     if(diff_loc > -1) {
-        auto diffuse = (light) ? light->diffuse() : smlt::Colour::NONE;
+        auto diffuse = (light) ? light->diffuse : smlt::Colour::NONE;
         program->set_uniform_colour(diff_loc, diffuse);
     }
 
     auto spec_loc = program->locate_uniform(spec_property->shader_variable(), true);
     if(spec_loc > -1) {
-        auto specular = (light) ? light->specular() : smlt::Colour::NONE;
+        auto specular = (light) ? light->specular : smlt::Colour::NONE;
         program->set_uniform_colour(spec_loc, specular);
     }
 
     auto ca_loc = program->locate_uniform(ca_property->shader_variable(), true);
     if(ca_loc > -1) {
-        auto att = (light) ? light->constant_attenuation() : 0;
+        auto att = (light) ? light->constant_attenuation : 0;
         program->set_uniform_float(ca_loc, att);
     }
 
     auto la_loc = program->locate_uniform(la_property->shader_variable(), true);
     if(la_loc > -1) {
-        auto att = (light) ? light->linear_attenuation() : 0;
+        auto att = (light) ? light->linear_attenuation : 0;
         program->set_uniform_float(la_loc, att);
     }
 
     auto qa_loc = program->locate_uniform(qa_property->shader_variable(), true);
     if(qa_loc > -1) {
-        auto att = (light) ? light->quadratic_attenuation() : 0;
+        auto att = (light) ? light->quadratic_attenuation : 0;
         program->set_uniform_float(qa_loc, att);
     }
 }
@@ -252,13 +256,39 @@ void send_attribute(int32_t loc,
         auto attr_size = vertex_attribute_size(attr_for_type);
         auto stride = vertex_spec.stride();
 
-        auto type = (attr_for_type == VERTEX_ATTRIBUTE_4UB) ? GL_UNSIGNED_BYTE :
-                    (attr_for_type == VERTEX_ATTRIBUTE_PACKED_VEC4_1I) ? GL_UNSIGNED_INT_2_10_10_10_REV : GL_FLOAT;
-
-        auto size = (attr_for_type == VERTEX_ATTRIBUTE_4UB) ? GL_BGRA :
-                    (attr_for_type == VERTEX_ATTRIBUTE_PACKED_VEC4_1I) ? 4 : attr_size / sizeof(float);
+        GLenum type = GL_FLOAT;
+        GLint size = attr_size / sizeof(float);
+        GLboolean normalized = GL_FALSE;
 
-        auto normalized = (attr_for_type == VERTEX_ATTRIBUTE_4UB) ? GL_TRUE : GL_FALSE;
+        switch(attr_for_type) {
+            case VERTEX_ATTRIBUTE_4UB:
+                type = GL_UNSIGNED_BYTE;
+                size = GL_BGRA;
+                normalized = GL_TRUE;
+            break;
+            case VERTEX_ATTRIBUTE_PACKED_VEC4_1I:
+                type = GL_UNSIGNED_INT_2_10_10_10_REV;
+                size = 4;
+            break;
+            case VERTEX_ATTRIBUTE_2H:
+            case VERTEX_ATTRIBUTE_4H:
+                type = GL_HALF_FLOAT;
+                size = attr_size / sizeof(uint16_t);
+            break;
+            case VERTEX_ATTRIBUTE_4B:
+                /* Shaders read the normal as a vec3, so the padding byte is ignored */
+                type = GL_BYTE;
+                size = 4;
+                normalized = GL_TRUE;
+            break;
+            case VERTEX_ATTRIBUTE_2US:
+                type = GL_UNSIGNED_SHORT;
+                size = 2;
+                normalized = GL_TRUE;
+            break;
+            default:
+                break;
+        }
 
         GLCheck(glVertexAttribPointer,
             loc,
@@ -347,8 +377,8 @@ void GenericRenderer::set_blending_mode(BlendType type) {
 }
 
 
-std::shared_ptr<batcher::RenderQueueVisitor> GenericRenderer::get_render_queue_visitor(CameraPtr camera) {
-    return std::make_shared<GL2RenderQueueVisitor>(this, camera);
+std::shared_ptr<batcher::RenderQueueVisitor> GenericRenderer::get_render_queue_visitor() {
+    return std::make_shared<GL2RenderQueueVisitor>(this);
 }
 
 smlt::GPUProgramID smlt::GenericRenderer::new_or_existing_gpu_program(const std::string &vertex_shader_source, const std::string &fragment_shader_source) {
@@ -379,9 +409,8 @@ smlt::GPUProgramPtr smlt::GenericRenderer::gpu_program(const smlt::GPUProgramID
     return program_manager_.get(program_id);
 }
 
-GL2RenderQueueVisitor::GL2RenderQueueVisitor(GenericRenderer* renderer, CameraPtr camera):
-    renderer_(renderer),
-    camera_(camera) {
+GL2RenderQueueVisitor::GL2RenderQueueVisitor(GenericRenderer* renderer):
+    renderer_(renderer) {
 
 }
 
@@ -389,15 +418,48 @@ void GL2RenderQueueVisitor::visit(const Renderable* renderable, const MaterialPa
     do_visit(renderable, material_pass, iteration);
 }
 
+void GL2RenderQueueVisitor::visit_instanced(const Renderable* const* renderables, std::size_t count, const MaterialPass* material_pass, batcher::Iteration iteration) {
+    auto& merger = renderer_->instance_merger_;
+
+    if(!merger.can_merge(renderables[0])) {
+        batcher::RenderQueueVisitor::visit_instanced(renderables, count, material_pass, iteration);
+        return;
+    }
+
+    std::size_t done = 0;
+    while(done < count) {
+        auto& merged = renderer_->next_merged_instances(renderables[0]->vertex_data->vertex_specification());
+
+        auto consumed = merger.merge(
+            renderables + done, count - done, *merged.vertices, *merged.indices
+        );
+
+        assert(consumed);
+
+        /* The merged vertices are already in world space */
+        Renderable batch = *renderables[done];
+        batch.vertex_data = merged.vertices.get();
+        batch.index_data = merged.indices.get();
+        batch.index_element_count = merged.indices->count();
+        batch.final_transformation = Mat4();
+
+        do_visit(&batch, material_pass, iteration);
+
+        done += consumed;
+    }
+}
+
 void GL2RenderQueueVisitor::start_traversal(const batcher::RenderQueue& queue, uint64_t frame_id, Stage* stage) {
-    global_ambient_ = stage->ambient_light();
+    queue_ = &queue;
+    global_ambient_ = queue.ambient_light();
+    renderer_->merged_instances_used_ = 0;
 }
 
 void GL2RenderQueueVisitor::end_traversal(const batcher::RenderQueue &queue, Stage* stage) {
 
 }
 
-void GL2RenderQueueVisitor::apply_lights(const LightPtr* lights, const uint8_t count) {
+void GL2RenderQueueVisitor::apply_lights(const LightState* const* lights, const uint8_t count) {
     if(count == 1) {
         renderer_->set_light_uniforms(pass_, program_, lights[0]);
     } else {
@@ -538,11 +600,9 @@ void GL2RenderQueueVisitor::change_material_pass(const MaterialPass* prev, const
    // rebind_attribute_locations_if_necessary(next, program_);
 }
 
-void GenericRenderer::set_renderable_uniforms(const MaterialPass* pass, GPUProgram* program, const Renderable* renderable, Camera* camera) {
+void GenericRenderer::set_renderable_uniforms(const MaterialPass* pass, GPUProgram* program, const Renderable* renderable, const Mat4& view, const Mat4& projection) {
     //Calculate the modelview-projection matrix    
     const Mat4 model = renderable->final_transformation;
-    const Mat4& view = camera->view_matrix();
-    const Mat4& projection = camera->projection_matrix();
 
     Mat4 modelview = view * model;
     Mat4 modelview_projection = projection * modelview;
@@ -626,7 +686,10 @@ void GL2RenderQueueVisitor::change_render_group(const batcher::RenderGroup *prev
 }
 
 void GL2RenderQueueVisitor::do_visit(const Renderable* renderable, const MaterialPass* material_pass, batcher::Iteration iteration) {
-    renderer_->set_renderable_uniforms(material_pass, program_, renderable, camera_);
+    renderer_->set_renderable_uniforms(
+        material_pass, program_, renderable,
+        queue_->view_matrix(), queue_->projection_matrix()
+    );
     renderer_->prepare_to_render(renderable);
     renderer_->set_auto_attributes_on_shader(program_, renderable, renderer_->buffer_stash_.get());
     renderer_->send_geometry(renderable, renderer_->buffer_stash_.get());
@@ -702,6 +765,8 @@ void GenericRenderer::init_context() {
     L_INFO(_F("\tRenderer: {0}\n").format(GL_renderer));
     L_INFO(_F("\tVersion: {0}\n").format(GL_version));
 
+    detect_capabilities();
+
     GLCheck(glEnable, GL_DEPTH_TEST);
     GLCheck(glDepthFunc, GL_LEQUAL);
     GLCheck(glEnable, GL_CULL_FACE);
@@ -711,6 +776,17 @@ void GenericRenderer::init_context() {
     }
 }
 
+GenericRenderer::MergedInstances& GenericRenderer::next_merged_instances(const VertexSpecification& spec) {
+    if(merged_instances_used_ == merged_instances_.size()) {
+        MergedInstances merged;
+        merged.vertices = VertexData::create(spec);
+        merged.indices = IndexData::create(INDEX_TYPE_16_BIT);
+        merged_instances_.push_back(merged);
+    }
+
+    return merged_instances_[merged_instances_used_++];
+}
+
 void GenericRenderer::prepare_to_render(const Renderable *renderable) {
     /* Here we allocate VBOs for the renderable if necessary, and then upload
      * any new data */
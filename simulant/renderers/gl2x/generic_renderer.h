@@ -26,6 +26,7 @@
 #include "../gl_renderer.h"
 #include "../../material.h"
 #include "../batching/render_queue.h"
+#include "../batching/instancing.h"
 
 namespace smlt {
 
@@ -37,31 +38,31 @@ class GPUBuffer;
 struct RenderState {
     Renderable* renderable;
     MaterialPass* pass;
-    const Light* light;
+    const LightState* light;
     batcher::Iteration iteration;
     GL2RenderGroupImpl* render_group_impl;
 };
 
 class GL2RenderQueueVisitor : public batcher::RenderQueueVisitor {
 public:
-    GL2RenderQueueVisitor(GenericRenderer* renderer, CameraPtr camera);
+    GL2RenderQueueVisitor(GenericRenderer* renderer);
 
     void start_traversal(const batcher::RenderQueue& queue, uint64_t frame_id, Stage* stage);
     void visit(const Renderable* renderable, const MaterialPass* pass, batcher::Iteration);
+    void visit_instanced(const Renderable* const* renderables, std::size_t count, const MaterialPass* pass, batcher::Iteration iteration) override;
     void end_traversal(const batcher::RenderQueue &queue, Stage* stage);
 
     void change_render_group(const batcher::RenderGroup *prev, const batcher::RenderGroup *next);
     void change_material_pass(const MaterialPass* prev, const MaterialPass* next);
-    void apply_lights(const LightPtr* lights, const uint8_t count);
+    void apply_lights(const LightState* const* lights, const uint8_t count);
 
 private:
     GenericRenderer* renderer_;
-    CameraPtr camera_;
+    const batcher::RenderQueue* queue_ = nullptr;
     Colour global_ambient_;
 
     GPUProgram* program_ = nullptr;
     const MaterialPass* pass_ = nullptr;
-    const Light* light_ = nullptr;
 
     GL2RenderGroupImpl* current_group_ = nullptr;
 
@@ -90,13 +91,21 @@ public:
 
     void init_context() override;
 
-    std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor(CameraPtr camera) override;
+    std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor() override;
 
     GPUProgramID new_or_existing_gpu_program(const std::string& vertex_shader_source, const std::string& fragment_shader_source) override;
 
     GPUProgramPtr gpu_program(const GPUProgramID& program_id) const override;
     GPUProgramID current_gpu_program_id() const override;
     bool supports_gpu_programs() const override { return true; }
+
+    bool supports_vertex_attribute(VertexAttribute attr) const override {
+        if(attr == VERTEX_ATTRIBUTE_2H || attr == VERTEX_ATTRIBUTE_4H) {
+            return has_half_float_vertex_;
+        }
+
+        return true;
+    }
     GPUProgramID default_gpu_program_id() const override;
 
     std::string name() const override {
@@ -104,15 +113,23 @@ public:
     }
 
     void prepare_to_render(const Renderable* renderable) override;
+
+    void apply_viewport(const RenderTarget& target, const Viewport& viewport) override {
+        GLRenderer::apply_viewport(target, viewport);
+    }
+
+    void clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags) override {
+        GLRenderer::clear(target, viewport, clear_flags);
+    }
 private:
     GPUProgramManager program_manager_;
     GPUProgramID default_gpu_program_id_;
 
     std::shared_ptr<VBOManager> buffer_manager_;
 
-    void set_light_uniforms(const MaterialPass* pass, GPUProgram* program, const LightPtr light);
+    void set_light_uniforms(const MaterialPass* pass, GPUProgram* program, const LightState* light);
     void set_material_uniforms(const MaterialPass *pass, GPUProgram* program);
-    void set_renderable_uniforms(const MaterialPass* pass, GPUProgram* program, const Renderable* renderable, Camera* camera);
+    void set_renderable_uniforms(const MaterialPass* pass, GPUProgram* program, const Renderable* renderable, const Mat4& view, const Mat4& projection);
     void set_stage_uniforms(const MaterialPass* pass, GPUProgram* program, const Colour& global_ambient);
 
     void set_auto_attributes_on_shader(GPUProgram *program, const Renderable* buffer, GPUBuffer* buffers);
@@ -122,6 +139,20 @@ private:
     /* Stashed here in prepare_to_render and used later for that renderable */
     std::shared_ptr<GPUBuffer> buffer_stash_;
 
+    /* GL 2.1 has no instanced draw calls, so batches of identical renderables
+     * are pre-transformed into these buffers and drawn in one go. They're kept
+     * between frames so that their VBO slots are reused */
+    struct MergedInstances {
+        std::shared_ptr<VertexData> vertices;
+        std::shared_ptr<IndexData> indices;
+    };
+
+    batcher::InstanceMerger instance_merger_;
+    std::vector<MergedInstances> merged_instances_;
+    std::size_t merged_instances_used_ = 0;
+
+    MergedInstances& next_merged_instances(const VertexSpecification& spec);
+
     friend class GL2RenderQueueVisitor;
 
     void on_texture_prepare(TexturePtr texture) override {
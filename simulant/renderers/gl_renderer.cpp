@@ -1,8 +1,13 @@
+#include <cstdlib>
+#include <cstring>
+
 #include "gl_renderer.h"
 
 #include "../window.h"
+#include "../viewport.h"
 #include "../utils/gl_error.h"
 #include "../utils/gl_thread_check.h"
+#include "../logging.h"
 
 
 /* This file should only contain things shared between GL1 + GL2 so include
@@ -32,6 +37,16 @@ void GLRenderer::on_texture_register(TextureID tex_id, TexturePtr texture) {
             GLCheck(glGenTextures, 1, &gl_tex);
         });
         yield_coroutine();
+    } else if(!GLThreadCheck::is_current()) {
+        /* Updates run on a worker thread when rendering is pipelined. The
+         * texture can't be uploaded before the next pre_render() anyway, and
+         * idle tasks run before that */
+        win_->idle->add_once([texture]() {
+            GLuint gl_tex;
+            GLCheck(glGenTextures, 1, &gl_tex);
+            texture->_set_renderer_specific_id(gl_tex);
+        });
+        return;
     } else {
         GLCheck(glGenTextures, 1, &gl_tex);
     }
@@ -49,6 +64,10 @@ void GLRenderer::on_texture_unregister(TextureID tex_id, Texture* texture) {
             GLCheck(glDeleteTextures, 1, &gl_tex);
         });
         yield_coroutine();
+    } else if(!GLThreadCheck::is_current()) {
+        win_->idle->add_once([gl_tex]() {
+            GLCheck(glDeleteTextures, 1, &gl_tex);
+        });
     } else {
         GLCheck(glDeleteTextures, 1, &gl_tex);
     }
@@ -225,4 +244,79 @@ void GLRenderer::on_texture_prepare(TexturePtr texture) {
     }
 }
 
+void GLRenderer::apply_viewport(const RenderTarget& target, const Viewport& viewport) {
+    GLCheck(glDisable, GL_SCISSOR_TEST);
+
+    double x = viewport.x() * target.width();
+    double y = viewport.y() * target.height();
+    double width = viewport.width() * target.width();
+    double height = viewport.height() * target.height();
+
+    GLCheck(glEnable, GL_SCISSOR_TEST);
+    GLCheck(glScissor, x, y, width, height);
+    GLCheck(glViewport, x, y, width, height);
+}
+
+void GLRenderer::clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags) {
+    apply_viewport(target, viewport);
+
+    auto& colour = viewport.colour();
+    GLCheck(glClearColor, colour.r, colour.g, colour.b, colour.a);
+
+    uint32_t gl_clear_flags = 0;
+    if((clear_flags & BUFFER_CLEAR_COLOUR_BUFFER) == BUFFER_CLEAR_COLOUR_BUFFER) {
+        gl_clear_flags |= GL_COLOR_BUFFER_BIT;
+    }
+
+    if((clear_flags & BUFFER_CLEAR_DEPTH_BUFFER) == BUFFER_CLEAR_DEPTH_BUFFER) {
+        gl_clear_flags |= GL_DEPTH_BUFFER_BIT;
+
+        // Without this clearing the depth will do nothing.
+        GLCheck(glDepthMask, GL_TRUE);
+    }
+
+    if((clear_flags & BUFFER_CLEAR_STENCIL_BUFFER) == BUFFER_CLEAR_STENCIL_BUFFER) {
+        gl_clear_flags |= GL_STENCIL_BUFFER_BIT;
+    }
+
+    GLCheck(glClear, gl_clear_flags);
+}
+
+/* Extensions are a space separated list, so check for a whole word */
+static bool has_extension(const char* extensions, const char* name) {
+    if(!extensions) {
+        return false;
+    }
+
+    const auto length = strlen(name);
+    const char* it = extensions;
+    while((it = strstr(it, name))) {
+        bool starts = (it == extensions || *(it - 1) == ' ');
+        bool ends = (it[length] == ' ' || it[length] == '\0');
+        if(starts && ends) {
+            return true;
+        }
+
+        it += length;
+    }
+
+    return false;
+}
+
+void GLRenderer::detect_capabilities() {
+#ifdef _arch_dreamcast
+    has_half_float_vertex_ = false;
+#else
+    const char* version = (const char*) glGetString(GL_VERSION);
+    const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+
+    has_half_float_vertex_ = (version && atoi(version) >= 3) ||
+        has_extension(extensions, "GL_ARB_half_float_vertex");
+#endif
+
+    if(!has_half_float_vertex_) {
+        L_INFO("Half float vertex attributes aren't supported");
+    }
+}
+
 }
@@ -8,6 +8,9 @@
 
 namespace smlt {
 
+class Viewport;
+class RenderTarget;
+
 /*
  * Shared functionality between the GL1.x and GL2.x renderers
  * I hate mixin style classes (implementation inheritance) but as
@@ -24,9 +27,19 @@ protected:
     void on_texture_unregister(TextureID tex_id, Texture* texture);
     void on_texture_prepare(TexturePtr texture);
 
+    void apply_viewport(const RenderTarget& target, const Viewport& viewport);
+    void clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags);
+
     uint32_t convert_texture_format(TextureFormat format);
     uint32_t convert_texel_type(TextureTexelType type);
 
+    /* Checks the extensions and version of the current context, call
+     * this from init_context() */
+    void detect_capabilities();
+
+    /* GL 3.0 or ARB_half_float_vertex, needed for VERTEX_ATTRIBUTE_2H/4H */
+    bool has_half_float_vertex_ = false;
+
     thread::Mutex texture_object_mutex_;
     std::unordered_map<TextureID, uint32_t> texture_objects_;
 
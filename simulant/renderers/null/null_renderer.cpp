@@ -0,0 +1,211 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "null_renderer.h"
+
+#include "../../texture.h"
+#include "../../vertex_data.h"
+#include "../../window.h"
+
+namespace smlt {
+
+void NullRenderStats::accumulate(const NullRenderStats& other) {
+    traversals += other.traversals;
+    draw_calls += other.draw_calls;
+    instanced_draw_calls += other.instanced_draw_calls;
+    renderables_drawn += other.renderables_drawn;
+    elements_drawn += other.elements_drawn;
+    render_group_changes += other.render_group_changes;
+    material_pass_changes += other.material_pass_changes;
+    light_changes += other.light_changes;
+    viewport_changes += other.viewport_changes;
+    clears += other.clears;
+    bytes_uploaded += other.bytes_uploaded;
+}
+
+NullRenderQueueVisitor::NullRenderQueueVisitor(NullRenderer* renderer):
+    renderer_(renderer) {
+
+}
+
+void NullRenderQueueVisitor::start_traversal(const batcher::RenderQueue& queue, uint64_t frame_id, Stage* stage) {
+    _S_UNUSED(queue);
+    _S_UNUSED(frame_id);
+    _S_UNUSED(stage);
+
+    renderer_->frame_stats_.traversals++;
+}
+
+void NullRenderQueueVisitor::change_render_group(const batcher::RenderGroup* prev, const batcher::RenderGroup* next) {
+    _S_UNUSED(prev);
+    _S_UNUSED(next);
+
+    renderer_->frame_stats_.render_group_changes++;
+}
+
+void NullRenderQueueVisitor::change_material_pass(const MaterialPass* prev, const MaterialPass* next) {
+    _S_UNUSED(prev);
+    _S_UNUSED(next);
+
+    renderer_->frame_stats_.material_pass_changes++;
+}
+
+void NullRenderQueueVisitor::apply_lights(const LightState* const* lights, const uint8_t count) {
+    _S_UNUSED(lights);
+    _S_UNUSED(count);
+
+    renderer_->frame_stats_.light_changes++;
+}
+
+void NullRenderQueueVisitor::visit(const Renderable* renderable, const MaterialPass* pass, batcher::Iteration iteration) {
+    _S_UNUSED(pass);
+    _S_UNUSED(iteration);
+
+    auto element_count = renderable->index_element_count;
+    if(!element_count) {
+        return;
+    }
+
+    renderer_->prepare_to_render(renderable);
+
+    auto& stats = renderer_->frame_stats_;
+    stats.draw_calls++;
+    stats.renderables_drawn++;
+    stats.elements_drawn += element_count;
+
+    renderer_->window->stats->increment_polygons_rendered(renderable->arrangement, element_count);
+}
+
+void NullRenderQueueVisitor::visit_instanced(const Renderable* const* renderables, std::size_t count, const MaterialPass* pass, batcher::Iteration iteration) {
+    _S_UNUSED(pass);
+    _S_UNUSED(iteration);
+
+    if(!count || !renderables[0]->index_element_count) {
+        return;
+    }
+
+    /* Instances share their geometry so it's only uploaded once */
+    renderer_->prepare_to_render(renderables[0]);
+
+    auto element_count = renderables[0]->index_element_count;
+
+    auto& stats = renderer_->frame_stats_;
+    stats.draw_calls++;
+    stats.instanced_draw_calls++;
+    stats.renderables_drawn += count;
+    stats.elements_drawn += element_count * count;
+
+    for(std::size_t i = 0; i < count; ++i) {
+        renderer_->window->stats->increment_polygons_rendered(renderables[i]->arrangement, element_count);
+    }
+}
+
+void NullRenderQueueVisitor::end_traversal(const batcher::RenderQueue& queue, Stage* stage) {
+    _S_UNUSED(queue);
+    _S_UNUSED(stage);
+}
+
+batcher::RenderGroupKey NullRenderer::prepare_render_group(
+    batcher::RenderGroup* group,
+    const Renderable* renderable,
+    const MaterialPass* material_pass,
+    const uint8_t pass_number,
+    const bool is_blended,
+    const float distance_to_camera) {
+
+    _S_UNUSED(group);
+    _S_UNUSED(renderable);
+    _S_UNUSED(material_pass);
+
+    return batcher::generate_render_group_key(
+        pass_number,
+        is_blended,
+        distance_to_camera
+    );
+}
+
+std::shared_ptr<batcher::RenderQueueVisitor> NullRenderer::get_render_queue_visitor() {
+    return std::make_shared<NullRenderQueueVisitor>(this);
+}
+
+void NullRenderer::prepare_to_render(const Renderable* renderable) {
+    /* Anything that's changed since we last saw it would need uploading */
+    auto vertex_data = renderable->vertex_data;
+    auto it = vertex_uploads_.find(vertex_data);
+    if(it == vertex_uploads_.end() || it->second != vertex_data->last_updated()) {
+        vertex_uploads_[vertex_data] = vertex_data->last_updated();
+        frame_stats_.bytes_uploaded += vertex_data->data_size();
+    }
+
+    auto index_data = renderable->index_data;
+    auto jt = index_uploads_.find(index_data);
+    if(jt == index_uploads_.end() || jt->second != index_data->last_updated()) {
+        index_uploads_[index_data] = index_data->last_updated();
+        frame_stats_.bytes_uploaded += index_data->data_size();
+    }
+}
+
+void NullRenderer::apply_viewport(const RenderTarget& target, const Viewport& viewport) {
+    _S_UNUSED(target);
+    _S_UNUSED(viewport);
+
+    frame_stats_.viewport_changes++;
+}
+
+void NullRenderer::clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags) {
+    _S_UNUSED(clear_flags);
+
+    apply_viewport(target, viewport);
+    frame_stats_.clears++;
+}
+
+NullRenderStats NullRenderer::total_stats() const {
+    NullRenderStats total = previous_stats_;
+    total.accumulate(frame_stats_);
+    return total;
+}
+
+void NullRenderer::on_pre_render() {
+    previous_stats_.accumulate(frame_stats_);
+    frame_stats_ = NullRenderStats();
+}
+
+void NullRenderer::on_texture_prepare(TexturePtr texture) {
+    /* Behave like the GL renderers so that textures end up in the same
+     * state, just without the GPU */
+    if(texture->_data_dirty() && texture->auto_upload()) {
+        frame_stats_.bytes_uploaded += texture->data().size();
+
+        if(texture->free_data_mode() == TEXTURE_FREE_DATA_AFTER_UPLOAD) {
+            texture->free();
+        }
+
+        if(texture->mipmap_generation() == MIPMAP_GENERATE_COMPLETE && !texture->has_mipmaps()) {
+            texture->_set_has_mipmaps(true);
+        }
+
+        texture->_set_data_clean();
+    }
+
+    if(texture->_params_dirty()) {
+        texture->_set_params_clean();
+    }
+}
+
+}
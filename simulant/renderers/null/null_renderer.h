@@ -0,0 +1,123 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <unordered_map>
+
+#include "../renderer.h"
+
+namespace smlt {
+
+/*
+ * Counts of what a real renderer would have done during a frame
+ */
+struct NullRenderStats {
+    uint32_t traversals = 0;
+    uint32_t draw_calls = 0;
+    uint32_t instanced_draw_calls = 0;
+    uint32_t renderables_drawn = 0;
+    uint32_t elements_drawn = 0;
+
+    uint32_t render_group_changes = 0;
+    uint32_t material_pass_changes = 0;
+    uint32_t light_changes = 0;
+
+    uint32_t viewport_changes = 0;
+    uint32_t clears = 0;
+
+    /* Vertex, index and texture data that would have been sent to the GPU */
+    uint64_t bytes_uploaded = 0;
+
+    void accumulate(const NullRenderStats& other);
+};
+
+class NullRenderer;
+
+class NullRenderQueueVisitor : public batcher::RenderQueueVisitor {
+public:
+    NullRenderQueueVisitor(NullRenderer* renderer);
+
+    void start_traversal(const batcher::RenderQueue& queue, uint64_t frame_id, Stage* stage) override;
+    void change_render_group(const batcher::RenderGroup* prev, const batcher::RenderGroup* next) override;
+    void change_material_pass(const MaterialPass* prev, const MaterialPass* next) override;
+    void apply_lights(const LightState* const* lights, const uint8_t count) override;
+    void visit(const Renderable* renderable, const MaterialPass* pass, batcher::Iteration iteration) override;
+    void visit_instanced(const Renderable* const* renderables, std::size_t count, const MaterialPass* pass, batcher::Iteration iteration) override;
+    void end_traversal(const batcher::RenderQueue& queue, Stage* stage) override;
+
+private:
+    NullRenderer* renderer_;
+};
+
+/*
+ * A renderer that doesn't need a GL context. Everything up to the point of
+ * talking to the GPU happens as normal (partitioning, building and traversing
+ * the render queue) but draw calls, state changes and uploads are just
+ * counted. This is used by the HeadlessWindow for measuring the CPU side of
+ * a frame.
+ */
+class NullRenderer : public Renderer {
+public:
+    friend class NullRenderQueueVisitor;
+
+    NullRenderer(Window* window):
+        Renderer(window) {}
+
+    batcher::RenderGroupKey prepare_render_group(
+        batcher::RenderGroup* group,
+        const Renderable* renderable,
+        const MaterialPass* material_pass,
+        const uint8_t pass_number,
+        const bool is_blended,
+        const float distance_to_camera
+    ) override;
+
+    std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor() override;
+
+    void init_context() override {}
+
+    std::string name() const override {
+        return "null";
+    }
+
+    void prepare_to_render(const Renderable* renderable) override;
+
+    void apply_viewport(const RenderTarget& target, const Viewport& viewport) override;
+    void clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags) override;
+
+    /* What happened during the current (or most recent) frame */
+    const NullRenderStats& frame_stats() const { return frame_stats_; }
+
+    /* What has happened since the renderer was created */
+    NullRenderStats total_stats() const;
+
+private:
+    void on_pre_render() override;
+    void on_texture_prepare(TexturePtr texture) override;
+
+    NullRenderStats frame_stats_;
+    NullRenderStats previous_stats_;
+
+    /* The last_updated() time of each buffer when it was last "uploaded" */
+    std::unordered_map<const VertexData*, uint64_t> vertex_uploads_;
+    std::unordered_map<const IndexData*, uint64_t> index_uploads_;
+};
+
+}
@@ -43,6 +43,8 @@ bool Renderer::is_texture_registered(TextureID texture_id) const {
 }
 
 void Renderer::pre_render() {
+    on_pre_render();
+
     thread::Lock<thread::Mutex> lock(texture_registry_mutex_);
     for(auto wptr: texture_registry_){
         if(auto ptr = wptr.second.lock()) {
@@ -33,6 +33,8 @@ namespace smlt {
 
 class SubActor;
 class Window;
+class Viewport;
+class RenderTarget;
 
 class Renderer:
     public batcher::RenderGroupFactory {
@@ -43,7 +45,9 @@ public:
     Renderer(Window* window):
         window_(window) {}
 
-    virtual std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor(CameraPtr camera) = 0;
+    /* The visitor draws a RenderQueue. Everything it needs (camera matrices,
+     * lights, fog) is copied into the queue when it's built */
+    virtual std::shared_ptr<batcher::RenderQueueVisitor> get_render_queue_visitor() = 0;
 
     Property<Renderer, Window> window = { this, &Renderer::window_ };
 
@@ -65,10 +69,22 @@ public:
     /* This function is called just before drawing the renderable, it can be
      * used to upload any data to VRAM if necessary */
     virtual void prepare_to_render(const Renderable* renderable) = 0;
+
+    /* Restricts drawing to the area of the target covered by the viewport */
+    virtual void apply_viewport(const RenderTarget& target, const Viewport& viewport) = 0;
+
+    /* Applies the viewport and clears the buffers in clear_flags to the viewport's colour */
+    virtual void clear(const RenderTarget& target, const Viewport& viewport, uint32_t clear_flags) = 0;
 public:
     // Render support flags
     virtual bool supports_gpu_programs() const { return false; }
 
+    /* Returns false if vertex data with this attribute can't be drawn */
+    virtual bool supports_vertex_attribute(VertexAttribute attr) const {
+        _S_UNUSED(attr);
+        return true;
+    }
+
     void register_texture(TextureID tex_id, TexturePtr texture);
 
     void unregister_texture(TextureID texture_id, Texture* texture);
@@ -87,6 +103,12 @@ private:
 
     Window* window_ = nullptr;
 
+    /*
+     * Called at the start of each frame, before any textures are prepared
+     * or pipelines are run
+     */
+    virtual void on_pre_render() {}
+
     /*
      * Called when a texture is created. This should do whatever is necessary to
      * prepare a texture for later upload
@@ -1,5 +1,6 @@
 
 #include "renderer_config.h"
+#include "null/null_renderer.h"
 
 #ifdef _arch_dreamcast
     #include "gl1x/gl1x_renderer.h"
@@ -19,6 +20,7 @@ Renderer::ptr new_renderer(Window* window, const char* name) {
      *
      * - "gl2x"
      * - "gl1x"
+     * - "null" (counts draw calls rather than drawing, available everywhere)
      *
      * If a renderer is unsupported a message will be logged and a null pointer returned
      */
@@ -48,6 +50,8 @@ Renderer::ptr new_renderer(Window* window, const char* name) {
 #else
         return std::make_shared<GenericRenderer>(window);
 #endif
+    } else if(std::string("null") == name) {
+        return std::make_shared<NullRenderer>(window);
     }
 
     return NOT_SUPPORTED;
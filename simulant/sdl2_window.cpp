@@ -24,8 +24,11 @@
 
 #include "sound_drivers/openal_sound_driver.h"
 #include "sound_drivers/null_sound_driver.h"
+#include "sound_drivers/software_sound_driver.h"
+#include "sound_drivers/openal_audio_sink.h"
 
 #include "renderers/renderer_config.h"
+#include "utils/gl_error.h"
 
 static const std::string SDL_CONTROLLER_DB =
 #include "input/sdl/gamecontrollerdb.txt"
@@ -280,6 +283,12 @@ std::shared_ptr<SoundDriver> SDL2Window::create_sound_driver() {
     if(selected == "null") {
         L_DEBUG("Null sound driver activated");
         return std::make_shared<NullSoundDriver>(this);
+    } else if(selected == "software") {
+        L_DEBUG("Software sound driver activated");
+        return std::make_shared<SoftwareSoundDriver>(this, std::make_shared<OpenALAudioSink>());
+    } else if(selected == "wav") {
+        L_DEBUG("Software sound driver activated, writing to simulant.wav");
+        return std::make_shared<SoftwareSoundDriver>(this, std::make_shared<WAVAudioSink>("simulant.wav"));
     } else {
         if(selected != "openal") {
             L_WARN(_F("Unknown sound driver ({0}) falling back to OpenAL").format(selected));
@@ -483,6 +492,7 @@ void SDL2Window::destroy_window() {
 
 void SDL2Window::swap_buffers() {
     SDL_GL_SwapWindow(screen_);
+    GLChecker::end_of_frame_check();
 }
 
 bool SDL2Window::initialize_screen(Screen *screen) {
@@ -7,32 +7,40 @@
 namespace smlt {
 
 MeshSilhouette::MeshSilhouette(MeshPtr mesh, const Mat4& mesh_transformation, const LightPtr light):
+    MeshSilhouette(
+        mesh,
+        mesh_transformation,
+        light->type(),
+        (light->type() == LIGHT_TYPE_DIRECTIONAL) ? light->direction() : light->absolute_position(),
+        light->range()
+    ) {
+
+}
+
+MeshSilhouette::MeshSilhouette(MeshPtr mesh, const Mat4& mesh_transformation, LightType type, const Vec3& light_direction_or_position, float light_range):
     mesh_(mesh),
-    light_direction_or_position_(
-        (light->type() == LIGHT_TYPE_DIRECTIONAL) ? light->direction() : light->absolute_position()
-    ),
-    light_type_(light->type()) {
+    light_type_(type) {
 
-    mesh_transformation.extract_rotation_and_translation(inverse_mesh_rotation_, inverse_mesh_position_);
-    inverse_mesh_rotation_.inverse();
-    inverse_mesh_position_ = -inverse_mesh_position_;
+    /* Move the light into the mesh's local space, rather than transforming
+     * every vertex into world space */
+    auto inverse = mesh_transformation.inversed();
+
+    if(light_type_ == LIGHT_TYPE_DIRECTIONAL) {
+        local_light_ = light_direction_or_position.rotated_by(inverse);
+    } else {
+        local_light_ = light_direction_or_position.transformed_by(inverse);
+    }
 
     // Directional lights are always in range
     auto within_range = true;
 
-    if(light->type() == LIGHT_TYPE_POINT) {
-        // If it's a point light, we see if the meshes aabb intersects the
-        // radius of the light
-        // FIXME: Do we need to rotate the light position based on the mesh rotation?
-        //        the AABB won't be the same if the mesh is rotated, so probably the light
-        //        position should be rotated into the mesh identity first...
+    if(light_type_ != LIGHT_TYPE_DIRECTIONAL) {
+        // For point lights (and spot lights, the cone isn't taken into account yet)
+        // we see if the meshes aabb intersects the radius of the light
         within_range = mesh->aabb().intersects_sphere(
-            light_direction_or_position_ + inverse_mesh_position_,
-            light->range() * 2.0f // Range is radius, intersects_sphere takes diameter
+            local_light_,
+            light_range * 2.0f // Range is radius, intersects_sphere takes diameter
         );
-    } else if(light->type() == LIGHT_TYPE_SPOT_LIGHT) {
-        // FIXME: need to check spotlight cone for AABB intersection
-        assert(0 && "Not Implemented");
     }
 
     if(within_range) {
@@ -40,111 +48,261 @@ MeshSilhouette::MeshSilhouette(MeshPtr mesh, const Mat4& mesh_transformation, co
     }
 }
 
-const std::vector<SilhouetteEdge> &MeshSilhouette::edge_list() {
+const std::vector<SilhouetteEdge> &MeshSilhouette::edge_list() const {
     return edge_list_;
 }
 
 void MeshSilhouette::recalculate_silhouette() {
+    edge_list_.clear();
+    facing_.clear();
+
+    /* Generate mesh adjacency if we haven't already */
+    if(!mesh_->has_adjacency_info()) {
+        mesh_->generate_adjacency_info();
+    }
+
+    classify_faces();
+    calculate_edges();
+}
+
+void MeshSilhouette::classify_faces() {
     /*
-     * For directional lights we just need to make sure that
-     * we rotate the direction by the inverse of the mesh rotation
-     * then calculate the silhouette from there
-     *
-     * For point lights, we can transform the position of the light by the inverse(?)
-     * of the mesh transformation.
+     * Work out which faces point towards the light. The face planes are stored as
+     * separate float arrays so these loops have no branches or gathers and the
+     * compiler can turn them into SIMD on platforms that have it.
      */
 
-    edge_list_.clear();
+    const AdjacencyFaces& faces = mesh_->adjacency_info->faces();
+    const std::size_t count = faces.size();
+
+    facing_.resize(count);
+
+    const float* nx = faces.nx.data();
+    const float* ny = faces.ny.data();
+    const float* nz = faces.nz.data();
+    const float* d = faces.d.data();
+    uint8_t* out = facing_.data();
 
     if(light_type_ == LIGHT_TYPE_DIRECTIONAL) {
-        calculate_directional_silhouette();
-    } else if(light_type_ == LIGHT_TYPE_POINT) {
-        calculate_point_silhouette();
-    } else if(light_type_ == LIGHT_TYPE_SPOT_LIGHT) {
-        calculate_spot_silhouette();
+        // Reverse to be direction to, rather than from
+        const float lx = -local_light_.x;
+        const float ly = -local_light_.y;
+        const float lz = -local_light_.z;
+
+        for(std::size_t i = 0; i < count; ++i) {
+            out[i] = (nx[i] * lx + ny[i] * ly + nz[i] * lz) >= 0.0f;
+        }
+    } else {
+        const float eps = std::numeric_limits<float>::epsilon();
+        const float lx = local_light_.x;
+        const float ly = local_light_.y;
+        const float lz = local_light_.z;
+
+        for(std::size_t i = 0; i < count; ++i) {
+            out[i] = (nx[i] * lx + ny[i] * ly + nz[i] * lz + d[i]) > eps;
+        }
     }
 }
 
-void MeshSilhouette::calculate_directional_silhouette() {
-    auto light_direction = light_direction_or_position_;
-    light_direction = light_direction.rotated_by(inverse_mesh_rotation_);
-    light_direction = -light_direction; // Reverse to be direction to, rather than from
-
-    AdjacencyInfo* adj = mesh_->adjacency_info.get();
+void MeshSilhouette::calculate_edges() {
+    const AdjacencyEdges& edges = mesh_->adjacency_info->edges();
     VertexData* vertices = mesh_->vertex_data.get();
 
-    /* Generate mesh adjacency if we haven't already */
-    if(!adj) {
-        mesh_->generate_adjacency_info();
-        adj = mesh_->adjacency_info.get();
-    }
+    const std::size_t count = edges.size();
+    const int32_t* face0 = edges.face0.data();
+    const int32_t* face1 = edges.face1.data();
+    const uint8_t* facing = facing_.data();
 
-    adj->each_edge([&](std::size_t, const EdgeInfo& edge) {
-        auto d1 = edge.normals[0].dot(light_direction);
+    for(std::size_t i = 0; i < count; ++i) {
+        bool a = facing[face0[i]];
 
         // If we have only one triangle, the missing triangle is the opposite of the first
         // (e.g. if the only triangle is facing the light, the edge must be a silhouette,
         // likewise if a triangle is facing away from the light, we must assume that the edge
         // is part of the silhouette)
-        auto d2 = (edge.triangle_count == 2) ? edge.normals[1].dot(light_direction) : -d1;
+        bool b = (face1[i] >= 0) ? bool(facing[face1[i]]) : !a;
 
-        auto v1 = vertices->position_at<smlt::Vec3>(edge.indexes[0]);
-        auto v2 = vertices->position_at<smlt::Vec3>(edge.indexes[1]);
+        if(a == b) {
+            continue;
+        }
 
-        // If one normal is facing the light and one isn't then
-        // store the edge as a silhouette
-        if(d1 >= 0 && d2 < 0) {
-            edge_list_.push_back(SilhouetteEdge(*v1, *v2));
-        } else if(d1 < 0 && d1 >= 0) {
-            edge_list_.push_back(SilhouetteEdge(*v2, *v1));
+        auto v0 = *vertices->position_at<smlt::Vec3>(edges.v0[i]);
+        auto v1 = *vertices->position_at<smlt::Vec3>(edges.v1[i]);
+
+        // Keep the winding of whichever face points at the light
+        if(a) {
+            edge_list_.push_back(SilhouetteEdge(v0, v1));
+        } else {
+            edge_list_.push_back(SilhouetteEdge(v1, v0));
         }
-    });
+    }
 }
 
-void MeshSilhouette::calculate_point_silhouette() {
-    auto light_position = light_direction_or_position_;
+void extrude_shadow_volume(const MeshSilhouette& silhouette, const VertexData& vertices, const AdjacencyInfo& adjacency, bool include_caps, ShadowVolume& out) {
+    out.vertices.clear();
+    out.side_vertex_count = 0;
 
-    // Move the light into the mesh's local space (to prevent transforming vertex data)
-    light_position += inverse_mesh_position_;
+    auto& edges = silhouette.edge_list();
+    if(edges.empty()) {
+        return;
+    }
 
-    AdjacencyInfo* adj = mesh_->adjacency_info.get();
-    VertexData* vertices = mesh_->vertex_data.get();
+    const bool directional = silhouette.light_type() == LIGHT_TYPE_DIRECTIONAL;
+    const Vec3& light = silhouette.local_light();
 
-    if(!adj) {
-        mesh_->generate_adjacency_info();
-        adj = mesh_->adjacency_info.get();
+    /* Points are pushed to infinity away from the light by setting w = 0 */
+    auto extrude = [&](const Vec3& v) -> Vec4 {
+        return (directional) ? Vec4(light, 0.0f) : Vec4(v - light, 0.0f);
+    };
+
+    const auto& faces = adjacency.faces();
+
+    out.vertices.reserve(
+        (edges.size() * 6) + (include_caps ? faces.size() * 3 : 0)
+    );
+
+    for(auto& edge: edges) {
+        Vec4 v0(edge.first, 1.0f);
+        Vec4 v1(edge.second, 1.0f);
+        Vec4 v0_inf = extrude(edge.first);
+        Vec4 v1_inf = extrude(edge.second);
+
+        out.vertices.push_back(v1);
+        out.vertices.push_back(v0);
+        out.vertices.push_back(v0_inf);
+
+        out.vertices.push_back(v1);
+        out.vertices.push_back(v0_inf);
+        out.vertices.push_back(v1_inf);
     }
 
-    const float eps = std::numeric_limits<float>::epsilon();
+    out.side_vertex_count = out.vertices.size();
 
-    adj->each_edge([&](std::size_t, const EdgeInfo& edge) {
-        auto v1 = vertices->position_at<smlt::Vec3>(edge.indexes[0]);
-        auto v2 = vertices->position_at<smlt::Vec3>(edge.indexes[1]);
+    if(!include_caps) {
+        return;
+    }
 
-        // Just use one of the edge vertices to determine the light direction
-        auto light_direction = light_position - *v1;
+    for(uint32_t i = 0; i < faces.size(); ++i) {
+        auto& a = *vertices.position_at<Vec3>(faces.indexes[0][i]);
+        auto& b = *vertices.position_at<Vec3>(faces.indexes[1][i]);
+        auto& c = *vertices.position_at<Vec3>(faces.indexes[2][i]);
 
-        auto d1 = edge.normals[0].dot(light_direction);
+        if(silhouette.face_is_lit(i)) {
+            // Front cap, the lit faces themselves
+            out.vertices.push_back(Vec4(a, 1.0f));
+            out.vertices.push_back(Vec4(b, 1.0f));
+            out.vertices.push_back(Vec4(c, 1.0f));
+        } else if(!directional) {
+            // Back cap, the unlit faces projected to infinity. Directional
+            // lights extrude everything to a single point so there's nothing to draw
+            out.vertices.push_back(extrude(a));
+            out.vertices.push_back(extrude(b));
+            out.vertices.push_back(extrude(c));
+        }
+    }
+}
 
-        // If we have only one triangle, the missing triangle is the opposite of the first
-        // (e.g. if the only triangle is facing the light, the edge must be a silhouette,
-        // likewise if a triangle is facing away from the light, we must assume that the edge
-        // is part of the silhouette)
-        auto d2 = (edge.triangle_count == 2) ? edge.normals[1].dot(light_direction) : -d1;
-
-        // If one normal is facing the light and one isn't then
-        // store the edge as a silhouette
-        if(d1 > eps && d2 <= 0) {
-            edge_list_.push_back(SilhouetteEdge(*v1, *v2));
-        } else if(d1 <= 0 && d2 > eps) {
-            edge_list_.push_back(SilhouetteEdge(*v2, *v1));
+void ShadowVolumeManager::update(uint64_t frame_id, const std::vector<LightPtr>& lights, const std::vector<ShadowCaster>& casters, bool include_caps) {
+    std::vector<Entry*> stale;
+
+    for(auto& caster: casters) {
+        auto& mesh = caster.mesh;
+
+        /* Adjacency generation touches the mesh, so do it up front
+         * rather than on the workers */
+        if(!mesh->has_adjacency_info()) {
+            mesh->generate_adjacency_info();
         }
-    });
+
+        auto version = mesh->vertex_data->last_updated();
+
+        for(auto& light: lights) {
+            auto type = light->type();
+            auto position = (type == LIGHT_TYPE_DIRECTIONAL) ? light->direction() : light->absolute_position();
+            auto range = light->range();
+
+            auto& entry = entries_[key(mesh->id(), light->id())];
+
+            if(entry.frame_id == frame_id && entry.silhouette) {
+                // Already calculated this frame
+                continue;
+            }
+
+            bool changed = (
+                !entry.silhouette ||
+                entry.mesh != mesh ||
+                entry.mesh_version != version ||
+                entry.light_type != type ||
+                entry.light_range != range ||
+                entry.light_direction_or_position != position ||
+                entry.transformation != caster.transformation ||
+                entry.include_caps != include_caps
+            );
+
+            entry.frame_id = frame_id;
+
+            if(changed) {
+                entry.mesh = mesh;
+                entry.mesh_version = version;
+                entry.light_type = type;
+                entry.light_range = range;
+                entry.light_direction_or_position = position;
+                entry.transformation = caster.transformation;
+                entry.include_caps = include_caps;
+
+                stale.push_back(&entry);
+            }
+        }
+    }
+
+    auto recalculate = [&stale](std::size_t begin, std::size_t end) {
+        for(auto i = begin; i < end; ++i) {
+            auto entry = stale[i];
+
+            entry->silhouette = std::make_shared<MeshSilhouette>(
+                entry->mesh,
+                entry->transformation,
+                entry->light_type,
+                entry->light_direction_or_position,
+                entry->light_range
+            );
+
+            extrude_shadow_volume(
+                *entry->silhouette,
+                *entry->mesh->vertex_data,
+                *entry->mesh->adjacency_info,
+                entry->include_caps,
+                entry->volume
+            );
+        }
+    };
+
+    if(pool_) {
+        pool_->parallel_for(stale.size(), 1, recalculate);
+    } else {
+        recalculate(0, stale.size());
+    }
+
+    last_recalculated_ = stale.size();
+
+    /* Drop any volumes for meshes or lights that weren't passed this time around */
+    for(auto it = entries_.begin(); it != entries_.end();) {
+        if(it->second.frame_id != frame_id) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
-void MeshSilhouette::calculate_spot_silhouette() {
-    assert(0 && "Not implemented");
+const ShadowVolume* ShadowVolumeManager::volume(MeshID mesh, LightID light) const {
+    auto it = entries_.find(key(mesh, light));
+    return (it == entries_.end()) ? nullptr : &it->second.volume;
 }
 
+const MeshSilhouette* ShadowVolumeManager::silhouette(MeshID mesh, LightID light) const {
+    auto it = entries_.find(key(mesh, light));
+    return (it == entries_.end()) ? nullptr : it->second.silhouette.get();
 }
 
+}
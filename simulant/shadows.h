@@ -1,9 +1,13 @@
 #pragma once
 
+#include <unordered_map>
+
 #include "renderers/batching/renderable.h"
+#include "threads/thread_pool.h"
 
 namespace smlt {
 
+class AdjacencyInfo;
 
 enum ShadowMethod {
     SHADOW_METHOD_STENCIL_DEPTH_FAIL, // Standard
@@ -57,46 +61,120 @@ public:
     */
     MeshSilhouette(MeshPtr mesh, const Mat4& mesh_transformation, const LightPtr light);
 
+    /*
+     * As above, but takes the light parameters directly. This doesn't touch the
+     * light (or generate adjacency) so can be run from a worker thread as long as
+     * the mesh already has adjacency info
+     */
+    MeshSilhouette(MeshPtr mesh, const Mat4& mesh_transformation, LightType type, const Vec3& light_direction_or_position, float light_range);
+
     /*
      * Returns the list of vertex pairs which make up the calculated silhouette. Returns
      * an empty list if the mesh isn't influenced by the light
      */
-    const std::vector<SilhouetteEdge>& edge_list();
+    const std::vector<SilhouetteEdge>& edge_list() const;
+
+    /*
+     * Returns true if the face (as indexed by the mesh's AdjacencyInfo) faces the light.
+     * Only valid if the mesh was within range of the light
+     */
+    bool face_is_lit(uint32_t face) const { return face < facing_.size() && facing_[face]; }
+
+    /* The light direction or position, in the mesh's local space */
+    const Vec3& local_light() const { return local_light_; }
+    LightType light_type() const { return light_type_; }
 
 private:
     void recalculate_silhouette();
-    void calculate_directional_silhouette();
-    void calculate_point_silhouette();
-    void calculate_spot_silhouette();
+    void classify_faces();
+    void calculate_edges();
 
     std::vector<SilhouetteEdge> edge_list_;
 
+    /* One entry per adjacency face, 1 if the face points towards the light */
+    std::vector<uint8_t> facing_;
+
     smlt::MeshPtr mesh_;
-    smlt::Vec3 inverse_mesh_position_;
-    smlt::Quaternion inverse_mesh_rotation_;
-    smlt::Vec3 light_direction_or_position_;
+    smlt::Vec3 local_light_;
     LightType light_type_;
 };
 
+/*
+ * The extruded geometry for a silhouette, in the mesh's local space. This is a
+ * triangle list: the side quads of the silhouette edges, followed by the
+ * light-facing faces (front cap) and the extruded back-facing faces (back cap).
+ * Extruded vertices have w == 0 so they project to infinity.
+ */
+struct ShadowVolume {
+    std::vector<Vec4> vertices;
+    uint32_t side_vertex_count = 0;
+};
+
+struct ShadowCaster {
+    ShadowCaster(MeshPtr mesh, const Mat4& transformation):
+        mesh(mesh), transformation(transformation) {}
+
+    MeshPtr mesh;
+    Mat4 transformation;
+};
+
 class ShadowVolumeManager {
     /*
      * Calculates and stores the shadow volumes for a stage. ShadowManager::update should be
-     * called with the visible lights and shadow-casting renderables each time a camera view
+     * called with the visible lights and shadow-casting meshes each time a camera view
      * is rendered.
      *
      * Shadow volumes will not be updated in the following situations:
      *
-     * 1. The light <> renderable volume has already been calculated this frame
-     * 2. The light and renderable haven't moved since a previous frame
+     * 1. The light <> mesh volume has already been calculated this frame
+     * 2. The light and mesh haven't moved since a previous frame
      *
-     * ShadowVolumes are destroyed when the light or renderable are destroyed.
+     * Volumes which weren't part of the most recent update are discarded, so
+     * volumes for destroyed lights and meshes don't linger.
+     *
+     * If a thread pool is passed, recalculation and extrusion of the changed
+     * volumes is spread across its workers.
      */
 public:
-    void update(uint64_t frame_id, const std::vector<Light>& lights, const std::vector<RenderablePtr>& renderables);
+    ShadowVolumeManager(thread::ThreadPool* pool=nullptr):
+        pool_(pool) {}
 
-};
+    void update(uint64_t frame_id, const std::vector<LightPtr>& lights, const std::vector<ShadowCaster>& casters, bool include_caps=true);
+
+    /* Returns the volume for the mesh/light pair, or nullptr if it isn't cached */
+    const ShadowVolume* volume(MeshID mesh, LightID light) const;
+    const MeshSilhouette* silhouette(MeshID mesh, LightID light) const;
 
+    std::size_t cached_volume_count() const { return entries_.size(); }
+
+    /* How many volumes were recalculated by the last update() */
+    std::size_t last_recalculated_count() const { return last_recalculated_; }
+
+private:
+    struct Entry {
+        uint64_t frame_id = 0;
+        Mat4 transformation;
+        Vec3 light_direction_or_position;
+        float light_range = 0.0f;
+        LightType light_type = LIGHT_TYPE_POINT;
+        uint64_t mesh_version = 0;
+        bool include_caps = true;
+
+        MeshPtr mesh;
+        std::shared_ptr<MeshSilhouette> silhouette;
+        ShadowVolume volume;
+    };
+
+    thread::ThreadPool* pool_ = nullptr;
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::size_t last_recalculated_ = 0;
+
+    static uint64_t key(MeshID mesh, LightID light) {
+        return (uint64_t(mesh.value()) << 32) | uint64_t(light.value());
+    }
+};
 
+void extrude_shadow_volume(const MeshSilhouette& silhouette, const VertexData& vertices, const AdjacencyInfo& adjacency, bool include_caps, ShadowVolume& out);
 
 
 }
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace smlt {
+namespace sig {
+
+/*
+ * A move-only std::function replacement which stores small callables
+ * (lambdas capturing up to three pointers, or std::bind of a member function
+ * and an object pointer) inside the object rather than on the heap. Anything
+ * larger than INLINE_SIZE falls back to a heap allocation.
+ */
+template<typename> class InlineFunction;
+
+template<typename R, typename... Args>
+class InlineFunction<R (Args...)> {
+public:
+    static const std::size_t INLINE_SIZE = sizeof(void*) * 3;
+
+    InlineFunction() = default;
+
+    template<typename F, typename=typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, InlineFunction>::value
+    >::type>
+    InlineFunction(F&& func) {
+        assign(std::forward<F>(func));
+    }
+
+    InlineFunction(InlineFunction&& rhs) {
+        take(rhs);
+    }
+
+    InlineFunction& operator=(InlineFunction&& rhs) {
+        if(this != &rhs) {
+            reset();
+            take(rhs);
+        }
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() {
+        reset();
+    }
+
+    R operator()(Args... args) const {
+        return ops_->invoke(const_cast<void*>(static_cast<const void*>(&storage_)), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const {
+        return ops_ != nullptr;
+    }
+
+    void reset() {
+        if(ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    /* True if the callable lives on the heap, mainly for testing */
+    bool is_heap_allocated() const {
+        return ops_ && ops_->heap;
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void*, Args&&...);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void*);
+        bool heap;
+    };
+
+    template<typename F>
+    struct InlineOps {
+        static R invoke(void* storage, Args&&... args) {
+            return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+        }
+
+        static void move(void* dst, void* src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+
+        static void destroy(void* storage) {
+            static_cast<F*>(storage)->~F();
+        }
+
+        static const Ops* ops() {
+            static const Ops ops = {&invoke, &move, &destroy, false};
+            return &ops;
+        }
+    };
+
+    template<typename F>
+    struct HeapOps {
+        static R invoke(void* storage, Args&&... args) {
+            return (**static_cast<F**>(storage))(std::forward<Args>(args)...);
+        }
+
+        static void move(void* dst, void* src) {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+
+        static void destroy(void* storage) {
+            delete *static_cast<F**>(storage);
+        }
+
+        static const Ops* ops() {
+            static const Ops ops = {&invoke, &move, &destroy, true};
+            return &ops;
+        }
+    };
+
+    typename std::aligned_storage<INLINE_SIZE, alignof(void*)>::type storage_;
+    const Ops* ops_ = nullptr;
+
+    template<typename F>
+    void assign(F&& func) {
+        typedef typename std::decay<F>::type Func;
+
+        const bool fits = (
+            sizeof(Func) <= INLINE_SIZE &&
+            alignof(void*) % alignof(Func) == 0 &&
+            std::is_nothrow_move_constructible<Func>::value
+        );
+
+        place<Func>(std::forward<F>(func), std::integral_constant<bool, fits>());
+    }
+
+    template<typename Func, typename F>
+    void place(F&& func, std::true_type) {
+        new (&storage_) Func(std::forward<F>(func));
+        ops_ = InlineOps<Func>::ops();
+    }
+
+    template<typename Func, typename F>
+    void place(F&& func, std::false_type) {
+        *reinterpret_cast<Func**>(&storage_) = new Func(std::forward<F>(func));
+        ops_ = HeapOps<Func>::ops();
+    }
+
+    void take(InlineFunction& rhs) {
+        if(rhs.ops_) {
+            rhs.ops_->move(&storage_, &rhs.storage_);
+            ops_ = rhs.ops_;
+            rhs.ops_ = nullptr;
+        }
+    }
+};
+
+}
+}
@@ -0,0 +1,20 @@
+#include <cstdint>
+
+#include "signal.h"
+
+namespace smlt {
+namespace sig {
+
+/* Enough that unrelated signals rarely share a lock */
+static const std::size_t SIGNAL_LOCK_COUNT = 64;
+
+thread::Mutex& signal_lock(const void* signal) {
+    static thread::Mutex locks[SIGNAL_LOCK_COUNT];
+
+    /* Signals are members of objects, so the low bits say little */
+    auto address = reinterpret_cast<uintptr_t>(signal);
+    return locks[((address >> 4) ^ (address >> 10)) % SIGNAL_LOCK_COUNT];
+}
+
+}
+}
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 #include <algorithm>
 
-#include "../threads/atomic.h"
-#include "ring_buffer.h"
+#include "inline_function.h"
+#include "../threads/mutex.h"
 
 #define DEFINE_SIGNAL(prototype, name) \
     public: \
@@ -17,66 +19,34 @@
 namespace smlt {
 namespace sig {
 
-class ConnectionImpl;
-
-class Disconnector {
-public:
-    virtual ~Disconnector() {}
-
-    virtual bool disconnect(const ConnectionImpl& conn) = 0;
-    virtual bool connection_exists(const ConnectionImpl& conn) const = 0;
-};
-
-class Connection;
-
-class ConnectionImpl {
-public:
-    ConnectionImpl(Disconnector* parent, size_t id):
-        id_(id),
-        parent_(parent) {}
-
-    ConnectionImpl(const ConnectionImpl& rhs):
-        id_(rhs.id_),
-        parent_(rhs.parent_) {}
-
-    bool operator!=(const ConnectionImpl& rhs) const { return !(*this == rhs); }
-    bool operator==(const ConnectionImpl& rhs) const { return this->id_ == rhs.id_; }
-
-    ConnectionImpl& operator=(const ConnectionImpl& rhs) {
-        if(*this == rhs) {
-            return *this;
-        }
-
-        this->id_ = rhs.id_;
-        this->parent_ = rhs.parent_;
-
-        return *this;
-    }
-
-private:
-    size_t id_;
-    Disconnector* parent_;
-    friend class Connection;
+/*
+ * Shared between a signal and its connections so that a connection can tell
+ * whether the signal still exists. There's one of these per signal (created
+ * on the first connect) rather than one per connection.
+ */
+struct SignalLifetime {
+    void* signal = nullptr;
+    bool (*disconnect)(void* signal, uint32_t slot, uint32_t generation) = nullptr;
+    bool (*connection_exists)(const void* signal, uint32_t slot, uint32_t generation) = nullptr;
 };
 
 class Connection {
 public:
-    Connection():
-        impl_({}) {
+    Connection() = default;
 
-    }
-
-    Connection(std::shared_ptr<ConnectionImpl> impl):
-        impl_(impl) {}
+    Connection(const std::shared_ptr<SignalLifetime>& lifetime, uint32_t slot, uint32_t generation):
+        lifetime_(lifetime),
+        slot_(slot),
+        generation_(generation) {}
 
     bool disconnect() {
-        auto p = impl_.lock();
-        return p && p->parent_->disconnect(*p);
+        auto p = lifetime_.lock();
+        return p && p->disconnect(p->signal, slot_, generation_);
     }
 
     bool is_connected() const {
-        auto p = impl_.lock();
-        return p && p->parent_->connection_exists(*p);
+        auto p = lifetime_.lock();
+        return p && p->connection_exists(p->signal, slot_, generation_);
     }
 
     operator bool() const {
@@ -84,7 +54,9 @@ public:
     }
 
 private:
-    std::weak_ptr<ConnectionImpl> impl_;
+    std::weak_ptr<SignalLifetime> lifetime_;
+    uint32_t slot_ = 0;
+    uint32_t generation_ = 0;
 };
 
 class ScopedConnection {
@@ -146,76 +118,255 @@ private:
     }
 };
 
+/*
+ * Signals don't carry a lock of their own (most nodes have a dozen signals
+ * and never touch them from another thread), they share one of a fixed set
+ * picked by the signal's address. It's only held while the slots are being
+ * looked at or changed, never while a slot is called or destroyed, so slots
+ * are free to connect, disconnect or emit.
+ */
+thread::Mutex& signal_lock(const void* signal);
+
 template<typename> class ProtoSignal;
 
+/*
+ * Most signals have no more than a couple of slots connected, so the first
+ * INLINE_SLOTS live inside the signal itself and the callables are stored
+ * inline too (see InlineFunction). Connecting to an empty signal only
+ * allocates the shared control block, and connecting again allocates nothing.
+ *
+ * Connections refer to their slot by index and generation, so disconnecting
+ * is O(1). Slots may disconnect themselves (or others) while the signal is
+ * being emitted, they are cleaned up once the emission finishes. Slots
+ * connected during an emission aren't called until the next one, and freed
+ * slots are reused, so the call order isn't guaranteed to be the connection
+ * order once anything has been disconnected.
+ *
+ * Connecting and disconnecting are safe from any thread, including while
+ * another thread is emitting. A slot disconnected from another thread may
+ * still be called by an emission that's already running.
+ */
 template<typename R, typename... Args>
-class ProtoSignal<R (Args...)> : public Disconnector {
+class ProtoSignal<R (Args...)> {
 public:
     typedef R result;
-    typedef std::function<R (Args...)> callback;
+    typedef InlineFunction<R (Args...)> callback;
 
-    ProtoSignal() {
-        connection_counter_ = 0;
+    static const uint32_t INLINE_SLOTS = 2;
+
+    ProtoSignal() = default;
+
+    /* Connections belong to the signal they were made on, so copies start empty */
+    ProtoSignal(const ProtoSignal&) {}
+
+    ProtoSignal& operator=(const ProtoSignal&) {
+        return *this;
     }
 
-    Connection connect(const callback& func) {
-        size_t id = increment_counter();
-        auto conn_impl = std::make_shared<ConnectionImpl>(this, id);
-        links_.push_back({func, conn_impl});
-        return Connection(conn_impl);
+    template<typename F>
+    Connection connect(F&& func) {
+        /* Built outside the lock, copying the callable can run anything */
+        callback cb(std::forward<F>(func));
+
+        thread::Lock<thread::Mutex> lock(signal_lock(this));
+
+        if(!control_) {
+            control_ = std::make_shared<Control>();
+            control_->signal = this;
+            control_->disconnect = &ProtoSignal::disconnect_slot;
+            control_->connection_exists = &ProtoSignal::slot_connected;
+        }
+
+        uint32_t index = acquire_slot();
+        Slot& s = slot(index);
+        s.func = std::move(cb);
+        ++s.generation; // Odd generations are connected
+
+        if(emitting_) {
+            s.connected_during_emit = true;
+            pending_cleanup_ = true;
+        }
+
+        ++connection_count_;
+        return Connection(control_, index, s.generation);
     }
 
     void operator()(Args... args) {
-        for(auto& link: links_) {
-            link.func(args...);
+        EmitGuard guard(this);
+
+        /* Slots connected while we're emitting won't be called this time */
+        const uint32_t count = slot_capacity();
+        for(uint32_t i = 0; i < count; ++i) {
+            /* Overflow slots are allocated individually, so the reference
+             * survives other threads connecting while the lock is released */
+            Slot& s = slot(i);
+            if((s.generation & 1) && !s.connected_during_emit) {
+                guard.unlock();
+                s.func(args...);
+                guard.lock();
+            }
         }
     }
 
-    bool connection_exists(const ConnectionImpl& conn) const  {
-        for(auto link: links_) {
-            if(*link.conn_impl == conn) {
-                return true;
+    std::size_t connection_count() const {
+        thread::Lock<thread::Mutex> lock(signal_lock(this));
+        return connection_count_;
+    }
+
+private:
+    struct Slot {
+        callback func;
+        uint32_t generation = 0;
+        bool connected_during_emit = false;
+    };
+
+    /* Shared with the connections. Slots beyond INLINE_SLOTS live here too
+     * so that they don't cost the signal another pointer */
+    struct Control : public SignalLifetime {
+        std::vector<std::unique_ptr<Slot>> slots;
+        std::vector<uint32_t> free;
+    };
+
+    /* Holds the lock for the whole emission, apart from while slots are
+     * called, and tidies up after it even if a slot throws */
+    struct EmitGuard {
+        EmitGuard(ProtoSignal* signal):
+            signal(signal),
+            mutex(signal_lock(signal)) {
+
+            lock();
+            ++signal->emitting_;
+        }
+
+        ~EmitGuard() {
+            if(!locked) {
+                lock();
             }
+
+            std::vector<callback> released;
+            if(!--signal->emitting_ && signal->pending_cleanup_) {
+                signal->finish_emit(released);
+            }
+
+            unlock();
+
+            /* released is destroyed here, outside the lock */
+        }
+
+        void lock() {
+            mutex.lock();
+            locked = true;
+        }
+
+        void unlock() {
+            locked = false;
+            mutex.unlock();
         }
-        return false;
+
+        ProtoSignal* signal;
+        thread::Mutex& mutex;
+        bool locked = false;
+    };
+
+    Slot inline_[INLINE_SLOTS];
+    std::shared_ptr<Control> control_;
+
+    uint32_t connection_count_ = 0;
+    uint16_t emitting_ = 0;
+    bool pending_cleanup_ = false; // Set if finish_emit() has work to do
+
+    /* Everything below expects the signal's lock to be held */
+
+    uint32_t slot_capacity() const {
+        return INLINE_SLOTS + ((control_) ? control_->slots.size() : 0);
     }
 
-    bool disconnect(const ConnectionImpl& conn_impl) {
-        auto size = links_.size();
+    Slot& slot(uint32_t i) {
+        return (i < INLINE_SLOTS) ? inline_[i] : *control_->slots[i - INLINE_SLOTS];
+    }
 
-        for(auto it = links_.begin(); it != links_.end();) {
-            if((*it).conn_impl.get() == &conn_impl) {
-                it = links_.erase(it);
-            } else {
-                ++it;
+    const Slot& slot(uint32_t i) const {
+        return (i < INLINE_SLOTS) ? inline_[i] : *control_->slots[i - INLINE_SLOTS];
+    }
+
+    uint32_t acquire_slot() {
+        for(uint32_t i = 0; i < INLINE_SLOTS; ++i) {
+            if(!(inline_[i].generation & 1) && !inline_[i].func) {
+                return i;
             }
         }
 
-        return size != links_.size();
+        if(!control_->free.empty()) {
+            auto i = control_->free.back();
+            control_->free.pop_back();
+            return i;
+        }
+
+        control_->slots.push_back(std::unique_ptr<Slot>(new Slot()));
+        return INLINE_SLOTS + control_->slots.size() - 1;
     }
 
-    std::size_t connection_count() const {
-        return links_.size();
+    /* Hands back the callable so the caller can destroy it once unlocked */
+    callback release(uint32_t i) {
+        callback func = std::move(slot(i).func);
+        if(i >= INLINE_SLOTS) {
+            control_->free.push_back(i);
+        }
+
+        return func;
     }
 
-private:
-    thread::Atomic<size_t> connection_counter_ = {0};
+    /* Tidies up after slots were connected or disconnected mid-emit */
+    void finish_emit(std::vector<callback>& released) {
+        pending_cleanup_ = false;
 
-    struct Link {
-        callback func;
-        std::shared_ptr<ConnectionImpl> conn_impl;
-    };
+        const uint32_t count = slot_capacity();
+        for(uint32_t i = 0; i < count; ++i) {
+            Slot& s = slot(i);
+            s.connected_during_emit = false;
 
-    threadsafe::ring_buffer<Link> links_;
+            if(!(s.generation & 1) && s.func) {
+                released.push_back(release(i));
+            }
+        }
+    }
+
+    static bool disconnect_slot(void* self, uint32_t i, uint32_t generation) {
+        auto signal = static_cast<ProtoSignal*>(self);
+
+        callback released;
+        {
+            thread::Lock<thread::Mutex> lock(signal_lock(self));
+            if(!signal->is_connected(i, generation)) {
+                return false;
+            }
+
+            ++signal->slot(i).generation;
+            --signal->connection_count_;
+
+            if(signal->emitting_) {
+                /* The slot might be the one being called, so it
+                 * can't be destroyed until the emission is over */
+                signal->pending_cleanup_ = true;
+            } else {
+                released = signal->release(i);
+            }
+        }
+
+        return true;
+    }
 
-    inline size_t increment_counter() {
-        connection_counter_++;
-        return connection_counter_;
+    static bool slot_connected(const void* self, uint32_t i, uint32_t generation) {
+        thread::Lock<thread::Mutex> lock(signal_lock(self));
+        return static_cast<const ProtoSignal*>(self)->is_connected(i, generation);
     }
 
-    inline size_t decrement_counter() {
-        connection_counter_--;
-        return connection_counter_;
+    bool is_connected(uint32_t i, uint32_t generation) const {
+        return (
+            (generation & 1) &&
+            i < slot_capacity() &&
+            slot(i).generation == generation
+        );
     }
 };
 
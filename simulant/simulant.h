@@ -49,6 +49,7 @@
 #include "procedural/texture.h"
 #include "loader.h"
 #include "texture.h"
+#include "texture_atlas.h"
 #include "application.h"
 #include "debug.h"
 #include "nodes/sprite.h"
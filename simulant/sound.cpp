@@ -56,6 +56,8 @@ SourceInstance::SourceInstance(Source &parent, SoundID sound, AudioRepeat loop_s
     if(model == DISTANCE_MODEL_AMBIENT) {
         driver->set_source_as_ambient(source_);
     }
+
+    driver->set_source_priority(source_, parent_.priority_);
 }
 
 SourceInstance::~SourceInstance() {
@@ -74,21 +76,45 @@ void SourceInstance::start() {
         return;
     }
 
-    //Fill up two buffers to begin with
-    auto bs1 = stream_func_(buffers_[0]);
-    auto bs2 = stream_func_(buffers_[1]);
-
-    int to_queue = (bs1 && bs2) ? 2 : (bs1 || bs2)? 1 : 0;
+    // Nothing is queued when starting, so fill up every buffer to begin with
+    free_buffers_ = buffers_;
+    refill_buffers(parent_._sound_driver());
 
     SoundDriver* driver = parent_._sound_driver();
-
-    driver->queue_buffers_to_source(source_, to_queue, buffers_);
     driver->play_source(source_);
 }
 
 bool SourceInstance::is_playing() const {
+    if(is_dead_) {
+        return false;
+    }
+
+    /* If the decoder fell behind the driver will have stopped the source,
+     * but we're still playing as far as anyone else is concerned */
     SoundDriver* driver = parent_._sound_driver();
-    return driver->source_state(source_) == AUDIO_SOURCE_STATE_PLAYING;
+    return waiting_for_stream_ || driver->source_state(source_) == AUDIO_SOURCE_STATE_PLAYING;
+}
+
+bool SourceInstance::refill_buffers(SoundDriver* driver) {
+    waiting_for_stream_ = false;
+
+    while(!free_buffers_.empty()) {
+        AudioBufferID buffer = free_buffers_.back();
+        int32_t bytes = stream_func_(buffer);
+
+        if(bytes == STREAM_NOT_READY) {
+            // The decoder hasn't caught up, try again next update
+            waiting_for_stream_ = true;
+            return true;
+        } else if(!bytes) {
+            return false;
+        }
+
+        free_buffers_.pop_back();
+        driver->queue_buffers_to_source(source_, 1, {buffer});
+    }
+
+    return true;
 }
 
 void SourceInstance::update(float dt) {
@@ -118,30 +144,36 @@ void SourceInstance::update(float dt) {
     int32_t processed = driver->source_buffers_processed_count(source_);
 
     while(processed--) {
-        AudioBufferID buffer = driver->unqueue_buffers_from_source(source_, 1).back();
-
-        uint32_t bytes = stream_func_(buffer);
-
-        if(!bytes) {
-            // Just because we have nothing left to queue, doesn't mean that all buffers
-            // are finished, so wait for the last buffer to be unqueued
-            bool finished = driver->source_state(source_) == AUDIO_SOURCE_STATE_STOPPED;
-            if(finished) {
-                parent_.signal_stream_finished_();
-                if(loop_stream_ == AUDIO_REPEAT_FOREVER) {
-                    //Restart the sound
-                    auto sound = parent_.stage_->assets->sound(sound_);
-                    assert(sound);
-                    sound->init_source(*this);
-                    start();
-                } else {
-                    //Mark as dead
-                    is_dead_ = true;
-                }
-            }
+        free_buffers_.push_back(driver->unqueue_buffers_from_source(source_, 1).back());
+    }
+
+    if(free_buffers_.empty()) {
+        return;
+    }
+
+    bool more = refill_buffers(driver);
+    bool stopped = driver->source_state(source_) == AUDIO_SOURCE_STATE_STOPPED;
 
+    if(more) {
+        if(stopped && free_buffers_.size() < buffers_.size()) {
+            // We ran dry before the decoder caught up and the driver stopped
+            // the source, now there's data again so carry on
+            driver->play_source(source_);
+        }
+    } else if(stopped) {
+        // Just because we have nothing left to queue, doesn't mean that all buffers
+        // are finished, so wait for the last buffer to be unqueued
+        parent_.signal_stream_finished_();
+        if(loop_stream_ == AUDIO_REPEAT_FOREVER) {
+            //Restart the sound
+            auto sound = parent_.stage_->assets->sound(sound_);
+            assert(sound);
+            driver->stop_source(source_);
+            sound->init_source(*this);
+            start();
         } else {
-            driver->queue_buffers_to_source(source_, 1, {buffer});
+            //Mark as dead
+            is_dead_ = true;
         }
     }
 }
@@ -221,6 +253,14 @@ void Source::set_reference_distance(float dist) {
     }
 }
 
+void Source::set_priority(int32_t priority) {
+    priority_ = priority;
+
+    for(auto& instance: instances_) {
+        _sound_driver()->set_source_priority(instance->source_, priority);
+    }
+}
+
 void Source::set_gain(RangeValue<0, 1> gain) {
     for(auto& instance: instances_) {
         _sound_driver()->set_source_gain(instance->source_, gain);
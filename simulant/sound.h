@@ -23,6 +23,7 @@
 #include <list>
 
 #include "sound_driver.h"
+#include "audio_stream.h"
 
 #include "generic/managed.h"
 #include "generic/identifiable.h"
@@ -84,6 +85,8 @@ private:
     friend class SourceInstance;
 };
 
+/* Fills the buffer and returns the number of bytes, 0 once the stream has
+ * finished, or STREAM_NOT_READY if there's no data available yet */
 typedef std::function<int32_t (AudioBufferID)> StreamFunc;
 
 class Source;
@@ -107,6 +110,11 @@ private:
 
     AudioSourceID source_;
     std::vector<AudioBufferID> buffers_;
+
+    /* Buffers which have been played (or never queued) waiting for data */
+    std::vector<AudioBufferID> free_buffers_;
+    bool waiting_for_stream_ = false;
+
     SoundID sound_;
     StreamFunc stream_func_;
 
@@ -116,6 +124,8 @@ private:
     /* This is used to calculate the velocity */
     smlt::Vec3 previous_position_;
     bool first_update_ = true;
+
+    bool refill_buffers(SoundDriver* driver);
 public:
     SourceInstance(Source& parent, SoundID sound, AudioRepeat loop_stream, DistanceModel model=DISTANCE_MODEL_POSITIONAL);
     virtual ~SourceInstance();
@@ -146,6 +156,9 @@ public:
     void set_pitch(RangeValue<0, 1> pitch);
     void set_reference_distance(float dist);
 
+    /* When the driver runs out of voices higher priority sounds win */
+    void set_priority(int32_t priority);
+
 private:
     SoundDriver* _sound_driver() const;
 
@@ -153,6 +166,7 @@ private:
     Window* window_ = nullptr;
     SoundDriver* driver_ = nullptr;
     StageNode* node_ = nullptr;
+    int32_t priority_ = 0;
 
     std::list<SourceInstance::ptr> instances_;
     sig::signal<void ()> signal_stream_finished_;
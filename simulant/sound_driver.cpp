@@ -0,0 +1,37 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sound_driver.h"
+#include "audio_stream.h"
+
+namespace smlt {
+
+SoundDriver::~SoundDriver() {
+
+}
+
+std::shared_ptr<AudioStreamThread> SoundDriver::stream_thread() {
+    if(!stream_thread_) {
+        stream_thread_ = std::make_shared<AudioStreamThread>();
+    }
+
+    return stream_thread_;
+}
+
+}
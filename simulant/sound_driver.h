@@ -19,8 +19,10 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "macros.h"
 #include "generic/property.h"
 #include "math/vec3.h"
 #include "generic/range_value.h"
@@ -59,6 +61,7 @@ constexpr uint32_t audio_data_format_byte_size(AudioDataFormat format) {
 
 
 class Window;
+class AudioStreamThread;
 
 /* Basically a hacky abstraction over OpenAL with the thinking that the only other drivers will be:
  *
@@ -72,7 +75,7 @@ public:
     SoundDriver(Window* window):
         window_(window) {}
 
-    virtual ~SoundDriver() {}
+    virtual ~SoundDriver();
 
     virtual bool startup() = 0;
     virtual void shutdown() = 0;
@@ -105,8 +108,25 @@ public:
     virtual void set_source_reference_distance(AudioSourceID id, float dist) = 0;
     virtual void set_source_gain(AudioSourceID id, RangeValue<0, 1> value) = 0;
     virtual void set_source_pitch(AudioSourceID id, RangeValue<0, 1> value) = 0;
+
+    /* Only meaningful for drivers with a limited number of voices, higher
+     * priority sources are played in preference to lower ones */
+    virtual void set_source_priority(AudioSourceID id, int32_t priority) {
+        _S_UNUSED(id);
+        _S_UNUSED(priority);
+    }
+
+    /* Called once per frame after sources have been updated */
+    virtual void update(float dt) {
+        _S_UNUSED(dt);
+    }
+
+    /* The thread which decodes streamed sounds ahead of playback, shared by
+     * every source and started the first time it's needed */
+    std::shared_ptr<AudioStreamThread> stream_thread();
 private:
     Window* window_ = nullptr;
+    std::shared_ptr<AudioStreamThread> stream_thread_;
 };
 
 
@@ -0,0 +1,88 @@
+#include <cmath>
+
+#include "audio_sink.h"
+#include "../logging.h"
+
+namespace smlt {
+
+uint32_t AudioSink::frames_wanted(float dt, uint32_t frequency) {
+    remainder_ += dt * float(frequency);
+
+    float frames = std::floor(remainder_);
+    remainder_ -= frames;
+    return uint32_t(frames);
+}
+
+WAVAudioSink::~WAVAudioSink() {
+    close();
+}
+
+static void write_u32(std::ostream& out, uint32_t v) {
+    const char bytes[] = {char(v & 0xFF), char((v >> 8) & 0xFF), char((v >> 16) & 0xFF), char((v >> 24) & 0xFF)};
+    out.write(bytes, 4);
+}
+
+static void write_u16(std::ostream& out, uint16_t v) {
+    const char bytes[] = {char(v & 0xFF), char((v >> 8) & 0xFF)};
+    out.write(bytes, 2);
+}
+
+void WAVAudioSink::write_header(uint32_t data_bytes) {
+    const uint16_t channels = 2;
+    const uint16_t bits = 16;
+
+    file_.write("RIFF", 4);
+    write_u32(file_, 36 + data_bytes);
+    file_.write("WAVE", 4);
+
+    file_.write("fmt ", 4);
+    write_u32(file_, 16);
+    write_u16(file_, 1); // PCM
+    write_u16(file_, channels);
+    write_u32(file_, frequency_);
+    write_u32(file_, frequency_ * channels * (bits / 8));
+    write_u16(file_, channels * (bits / 8));
+    write_u16(file_, bits);
+
+    file_.write("data", 4);
+    write_u32(file_, data_bytes);
+}
+
+bool WAVAudioSink::open(uint32_t frequency) {
+    file_.open(path_.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file_.good()) {
+        L_ERROR(_F("Unable to open {0} for audio output").format(path_));
+        return false;
+    }
+
+    frequency_ = frequency;
+    data_bytes_ = 0;
+
+    // Sizes are filled in on close
+    write_header(0);
+    return true;
+}
+
+void WAVAudioSink::close() {
+    if(!file_.is_open()) {
+        return;
+    }
+
+    file_.seekp(0);
+    write_header(data_bytes_);
+    file_.close();
+}
+
+void WAVAudioSink::write(const int16_t* samples, uint32_t frames) {
+    if(!file_.is_open()) {
+        return;
+    }
+
+    for(uint32_t i = 0; i < frames * 2; ++i) {
+        write_u16(file_, uint16_t(samples[i]));
+    }
+
+    data_bytes_ += frames * 2 * sizeof(int16_t);
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace smlt {
+
+/*
+ * Where the SoftwareSoundDriver sends its mixed output. Samples are always
+ * interleaved 16 bit stereo.
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+
+    virtual bool open(uint32_t frequency) = 0;
+    virtual void close() {}
+
+    /* The number of frames which should be mixed now that dt seconds have
+     * passed. By default this just keeps pace with the clock */
+    virtual uint32_t frames_wanted(float dt, uint32_t frequency);
+
+    virtual void write(const int16_t* samples, uint32_t frames) = 0;
+
+private:
+    float remainder_ = 0.0f;
+};
+
+/* Throws everything away */
+class NullAudioSink : public AudioSink {
+public:
+    bool open(uint32_t) override { return true; }
+    void write(const int16_t*, uint32_t frames) override { frames_written_ += frames; }
+
+    uint64_t frames_written() const { return frames_written_; }
+
+private:
+    uint64_t frames_written_ = 0;
+};
+
+/* Writes a 16 bit stereo PCM .wav file, the header is completed on close() */
+class WAVAudioSink : public AudioSink {
+public:
+    WAVAudioSink(const std::string& path):
+        path_(path) {}
+
+    ~WAVAudioSink();
+
+    bool open(uint32_t frequency) override;
+    void close() override;
+    void write(const int16_t* samples, uint32_t frames) override;
+
+private:
+    void write_header(uint32_t data_bytes);
+
+    std::string path_;
+    std::ofstream file_;
+    uint32_t frequency_ = 0;
+    uint32_t data_bytes_ = 0;
+};
+
+}
@@ -1,4 +1,8 @@
+#include <algorithm>
+
 #include "null_sound_driver.h"
+#include "../time_keeper.h"
+#include "../macros.h"
 
 namespace smlt {
 
@@ -18,6 +22,7 @@ std::vector<AudioSourceID> NullSoundDriver::generate_sources(uint32_t count) {
     std::vector<AudioSourceID> ret;
     for(auto i = 0u; i < count; ++i) {
         ret.push_back(++source_counter_);
+        sources_[ret.back()] = Source();
     }
     return ret;
 }
@@ -26,51 +31,133 @@ std::vector<AudioBufferID> NullSoundDriver::generate_buffers(uint32_t count) {
     std::vector<AudioBufferID> ret;
     for(auto i = 0u; i < count; ++i) {
         ret.push_back(++buffer_counter_);
+        buffers_[ret.back()] = Buffer();
     }
     return ret;
 }
 
 void NullSoundDriver::destroy_buffers(const std::vector<AudioBufferID>& buffers) {
-
+    for(auto& buffer: buffers) {
+        buffers_.erase(buffer);
+    }
 }
 
 void NullSoundDriver::destroy_sources(const std::vector<AudioSourceID>& sources) {
     for(auto& src: sources) {
-        source_playing_.erase(src);
+        sources_.erase(src);
+    }
+}
+
+float NullSoundDriver::buffer_duration(AudioBufferID buffer) const {
+    auto it = buffers_.find(buffer);
+    if(it == buffers_.end() || !it->second.frequency) {
+        return 0.0f;
     }
+
+    auto& b = it->second;
+    return float(b.bytes) / float(audio_data_format_byte_size(b.format) * b.frequency);
+}
+
+void NullSoundDriver::advance(Source& source) const {
+    auto now = TimeKeeper::now_in_us();
+
+    if(source.playing) {
+        source.position += float(now - source.last_update) * 0.000001f * playback_speed_;
+
+        while(source.processed < source.queued.size()) {
+            auto duration = buffer_duration(source.queued[source.processed]);
+            if(source.position < duration) {
+                break;
+            }
+
+            source.position -= duration;
+            ++source.processed;
+        }
+
+        if(source.processed == source.queued.size()) {
+            // Out of data, like OpenAL the source stops
+            source.playing = false;
+            source.starved = true;
+            source.position = 0.0f;
+        }
+    }
+
+    source.last_update = now;
 }
 
 void NullSoundDriver::play_source(AudioSourceID source_id) {
-    source_playing_[source_id] = true;
+    auto& source = sources_[source_id];
+    advance(source);
+
+    if(!source.playing) {
+        if(source.starved) {
+            // Restarting something that ran dry
+            ++underrun_count_;
+        }
+
+        // Playing a stopped source starts from the first queued buffer
+        source.processed = 0;
+        source.position = 0.0f;
+        source.starved = false;
+        source.playing = true;
+    }
 }
 
 void NullSoundDriver::stop_source(AudioSourceID source_id) {
-    source_playing_[source_id] = false;
+    auto& source = sources_[source_id];
+
+    // Stopping marks every queued buffer as processed
+    source.processed = source.queued.size();
+    source.position = 0.0f;
+    source.playing = false;
+    source.starved = false;
 }
 
 void NullSoundDriver::queue_buffers_to_source(AudioSourceID source, uint32_t count, const std::vector<AudioBufferID>& buffers) {
-
+    auto& queued = sources_[source].queued;
+    count = std::min(count, (uint32_t) buffers.size());
+    queued.insert(queued.end(), buffers.begin(), buffers.begin() + count);
 }
 
-std::vector<AudioBufferID> NullSoundDriver::unqueue_buffers_from_source(AudioSourceID source, uint32_t count) {
-    return {};
+std::vector<AudioBufferID> NullSoundDriver::unqueue_buffers_from_source(AudioSourceID source_id, uint32_t count) {
+    auto& source = sources_[source_id];
+    advance(source);
+
+    count = std::min(count, source.processed);
+
+    std::vector<AudioBufferID> ret(source.queued.begin(), source.queued.begin() + count);
+    source.queued.erase(source.queued.begin(), source.queued.begin() + count);
+    source.processed -= count;
+    return ret;
 }
 
 void NullSoundDriver::upload_buffer_data(AudioBufferID buffer, AudioDataFormat format, const uint8_t* data, std::size_t bytes, uint32_t frequency) {
+    _S_UNUSED(data);
 
+    auto& b = buffers_[buffer];
+    b.bytes = bytes;
+    b.format = format;
+    b.frequency = frequency;
 }
 
-AudioSourceState NullSoundDriver::source_state(AudioSourceID source) {
-    if(source_playing_.at(source)) {
-        source_playing_[source] = false;
-        return AUDIO_SOURCE_STATE_PLAYING;
+AudioSourceState NullSoundDriver::source_state(AudioSourceID source_id) {
+    auto it = sources_.find(source_id);
+    if(it == sources_.end()) {
+        return AUDIO_SOURCE_STATE_STOPPED;
     }
 
-    return AUDIO_SOURCE_STATE_STOPPED;
+    advance(it->second);
+    return (it->second.playing) ? AUDIO_SOURCE_STATE_PLAYING : AUDIO_SOURCE_STATE_STOPPED;
 }
 
-int32_t NullSoundDriver::source_buffers_processed_count(AudioSourceID source) const {
-    return 0;
+int32_t NullSoundDriver::source_buffers_processed_count(AudioSourceID source_id) const {
+    auto it = sources_.find(source_id);
+    if(it == sources_.end()) {
+        return 0;
+    }
+
+    advance(it->second);
+    return it->second.processed;
 }
 
 
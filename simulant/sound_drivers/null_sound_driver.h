@@ -6,6 +6,11 @@
 
 namespace smlt {
 
+/*
+ * Doesn't output anything, but plays queued buffers against the clock like a
+ * real driver would. Sources stop when they run out of buffers, which makes
+ * decoder underruns measurable in tests.
+ */
 class NullSoundDriver : public SoundDriver {
 public:
     NullSoundDriver(Window* window):
@@ -39,11 +44,46 @@ public:
     void set_source_reference_distance(AudioSourceID id, float dist) override {}
     void set_source_gain(AudioSourceID id, RangeValue<0, 1> value) override {}
     void set_source_pitch(AudioSourceID id, RangeValue<0, 1> value) override {}
+
+    /* Scales the rate at which buffers are consumed, useful for putting streams
+     * under pressure in tests */
+    void set_playback_speed(float speed) { playback_speed_ = speed; }
+
+    /* The number of times a source ran out of buffers mid-playback and had to
+     * be restarted */
+    uint32_t underrun_count() const { return underrun_count_; }
+
 private:
+    struct Buffer {
+        std::size_t bytes = 0;
+        AudioDataFormat format = AUDIO_DATA_FORMAT_MONO16;
+        uint32_t frequency = 0;
+    };
+
+    struct Source {
+        std::vector<AudioBufferID> queued;
+        uint32_t processed = 0;
+
+        bool playing = false;
+        bool starved = false;
+
+        uint64_t last_update = 0;
+
+        /* Seconds played of the first unprocessed buffer */
+        float position = 0.0f;
+    };
+
+    void advance(Source& source) const;
+    float buffer_duration(AudioBufferID buffer) const;
+
     AudioSourceID source_counter_ = 0;
     AudioBufferID buffer_counter_ = 0;
 
-    std::map<AudioSourceID, bool> source_playing_;
+    float playback_speed_ = 1.0f;
+    uint32_t underrun_count_ = 0;
+
+    std::map<AudioBufferID, Buffer> buffers_;
+    mutable std::map<AudioSourceID, Source> sources_;
 };
 
 }
@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "openal_audio_sink.h"
+#include "al_error.h"
+#include "../logging.h"
+#include "../macros.h"
+
+namespace smlt {
+
+const uint32_t OpenALAudioSink::BUFFER_COUNT;
+const uint32_t OpenALAudioSink::BUFFER_FRAMES;
+
+OpenALAudioSink::~OpenALAudioSink() {
+    close();
+}
+
+bool OpenALAudioSink::open(uint32_t frequency) {
+    dev_ = alcOpenDevice(NULL);
+    if(!dev_) {
+        L_ERROR("Unable to initialize sound device");
+        return false;
+    }
+
+    ctx_ = alcCreateContext(dev_, NULL);
+    if(!ctx_) {
+        L_ERROR("Unable to create sound context");
+        return false;
+    }
+
+    alcMakeContextCurrent(ctx_);
+
+    frequency_ = frequency;
+
+    ALCheck(alGenSources, (ALuint) 1, &source_);
+    ALCheck(alSourcei, source_, AL_SOURCE_RELATIVE, AL_TRUE);
+
+    buffers_.resize(BUFFER_COUNT);
+    ALCheck(alGenBuffers, (ALuint) BUFFER_COUNT, &buffers_[0]);
+    free_buffers_ = buffers_;
+
+    return true;
+}
+
+void OpenALAudioSink::close() {
+    if(source_) {
+        ALCheck(alSourceStop, source_);
+        ALCheck(alDeleteSources, (ALuint) 1, &source_);
+        source_ = 0;
+    }
+
+    if(!buffers_.empty()) {
+        ALCheck(alDeleteBuffers, (ALuint) buffers_.size(), &buffers_[0]);
+        buffers_.clear();
+        free_buffers_.clear();
+    }
+
+    if(ctx_) {
+        alcDestroyContext(ctx_);
+        ctx_ = nullptr;
+    }
+
+    if(dev_) {
+        alcCloseDevice(dev_);
+        dev_ = nullptr;
+    }
+}
+
+void OpenALAudioSink::reclaim_buffers() {
+    ALint processed = 0;
+    ALCheck(alGetSourcei, source_, AL_BUFFERS_PROCESSED, &processed);
+
+    while(processed--) {
+        ALuint buffer = 0;
+        ALCheck(alSourceUnqueueBuffers, source_, (ALuint) 1, &buffer);
+        free_buffers_.push_back(buffer);
+    }
+}
+
+uint32_t OpenALAudioSink::frames_wanted(float dt, uint32_t frequency) {
+    _S_UNUSED(dt);
+    _S_UNUSED(frequency);
+
+    if(!source_) {
+        return 0;
+    }
+
+    reclaim_buffers();
+    return free_buffers_.size() * BUFFER_FRAMES;
+}
+
+void OpenALAudioSink::write(const int16_t* samples, uint32_t frames) {
+    while(frames && !free_buffers_.empty()) {
+        uint32_t count = std::min(frames, BUFFER_FRAMES);
+
+        ALuint buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+
+        ALCheck(alBufferData, buffer, AL_FORMAT_STEREO16, samples, (ALsizei) (count * 2 * sizeof(int16_t)), (ALsizei) frequency_);
+        ALCheck(alSourceQueueBuffers, source_, (ALuint) 1, &buffer);
+
+        samples += count * 2;
+        frames -= count;
+    }
+
+    ALint state = 0;
+    ALCheck(alGetSourcei, source_, AL_SOURCE_STATE, &state);
+    if(state != AL_PLAYING) {
+        // Either we're just starting, or we fell behind and OpenAL stopped
+        ALCheck(alSourcePlay, source_);
+    }
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#if defined(__APPLE__)
+#include <OpenAL/al.h>
+#include <OpenAL/alc.h>
+#else
+#include <AL/al.h>
+#include <AL/alc.h>
+#endif
+
+#include "audio_sink.h"
+
+namespace smlt {
+
+/*
+ * Plays the mixed output through a single streaming OpenAL source, so only one
+ * hardware voice is ever used regardless of how many sounds are playing.
+ */
+class OpenALAudioSink : public AudioSink {
+public:
+    static const uint32_t BUFFER_COUNT = 6;
+    static const uint32_t BUFFER_FRAMES = 1024;
+
+    ~OpenALAudioSink();
+
+    bool open(uint32_t frequency) override;
+    void close() override;
+
+    /* Keeps every buffer full, rather than following the clock */
+    uint32_t frames_wanted(float dt, uint32_t frequency) override;
+    void write(const int16_t* samples, uint32_t frames) override;
+
+private:
+    void reclaim_buffers();
+
+    ALCdevice* dev_ = nullptr;
+    ALCcontext* ctx_ = nullptr;
+
+    ALuint source_ = 0;
+    std::vector<ALuint> buffers_;
+    std::vector<ALuint> free_buffers_;
+
+    uint32_t frequency_ = 0;
+};
+
+}
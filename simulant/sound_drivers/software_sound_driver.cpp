@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <cmath>
+
+#include "software_sound_driver.h"
+#include "../logging.h"
+#include "../macros.h"
+#include "../math/utils.h"
+
+namespace smlt {
+
+const uint32_t SoftwareSoundDriver::MAX_MIX_FRAMES;
+constexpr float SoftwareSoundDriver::MIN_AUDIBLE_GAIN;
+
+SoftwareSoundDriver::SoftwareSoundDriver(Window* window, std::shared_ptr<AudioSink> sink, uint32_t voice_count, uint32_t frequency):
+    SoundDriver(window),
+    sink_(sink),
+    voice_count_(voice_count),
+    frequency_(frequency) {
+
+    accumulator_.resize(MAX_MIX_FRAMES * 2);
+    output_.resize(MAX_MIX_FRAMES * 2);
+}
+
+bool SoftwareSoundDriver::startup() {
+    if(!sink_ || !sink_->open(frequency_)) {
+        /* Keep mixing so that sources still play and finish, there's just
+         * nobody listening */
+        L_ERROR("Unable to open the audio output, sound will be silent");
+        sink_ = std::make_shared<NullAudioSink>();
+        sink_->open(frequency_);
+    }
+
+    sink_open_ = true;
+    return true;
+}
+
+void SoftwareSoundDriver::shutdown() {
+    if(sink_open_) {
+        sink_->close();
+        sink_open_ = false;
+    }
+}
+
+SoftwareSoundDriver::Buffer* SoftwareSoundDriver::buffer(AudioBufferID id) {
+    if(!id || id > buffers_.size() || !buffers_[id - 1].in_use) {
+        return nullptr;
+    }
+
+    return &buffers_[id - 1];
+}
+
+SoftwareSoundDriver::Source* SoftwareSoundDriver::source(AudioSourceID id) {
+    if(!id || id > sources_.size() || !sources_[id - 1].in_use) {
+        return nullptr;
+    }
+
+    return &sources_[id - 1];
+}
+
+const SoftwareSoundDriver::Source* SoftwareSoundDriver::source(AudioSourceID id) const {
+    return const_cast<SoftwareSoundDriver*>(this)->source(id);
+}
+
+std::vector<AudioSourceID> SoftwareSoundDriver::generate_sources(uint32_t count) {
+    std::vector<AudioSourceID> ret;
+
+    for(uint32_t i = 0; i < count; ++i) {
+        AudioSourceID id;
+        if(free_sources_.empty()) {
+            sources_.push_back(Source());
+            id = sources_.size();
+        } else {
+            id = free_sources_.back();
+            free_sources_.pop_back();
+
+            /* Keep the queue's capacity */
+            auto queued = std::move(sources_[id - 1].queued);
+            queued.clear();
+
+            sources_[id - 1] = Source();
+            sources_[id - 1].queued = std::move(queued);
+        }
+
+        sources_[id - 1].in_use = true;
+        ret.push_back(id);
+    }
+
+    return ret;
+}
+
+std::vector<AudioBufferID> SoftwareSoundDriver::generate_buffers(uint32_t count) {
+    std::vector<AudioBufferID> ret;
+
+    for(uint32_t i = 0; i < count; ++i) {
+        AudioBufferID id;
+        if(free_buffers_.empty()) {
+            buffers_.push_back(Buffer());
+            id = buffers_.size();
+        } else {
+            /* Recycled buffers keep their sample storage */
+            id = free_buffers_.back();
+            free_buffers_.pop_back();
+        }
+
+        buffers_[id - 1].in_use = true;
+        buffers_[id - 1].samples.clear();
+        ret.push_back(id);
+    }
+
+    return ret;
+}
+
+void SoftwareSoundDriver::destroy_buffers(const std::vector<AudioBufferID>& buffers) {
+    for(auto id: buffers) {
+        if(auto b = buffer(id)) {
+            b->in_use = false;
+            free_buffers_.push_back(id);
+        }
+    }
+}
+
+void SoftwareSoundDriver::destroy_sources(const std::vector<AudioSourceID>& sources) {
+    for(auto id: sources) {
+        if(auto s = source(id)) {
+            s->in_use = false;
+            s->state = AUDIO_SOURCE_STATE_STOPPED;
+            free_sources_.push_back(id);
+        }
+    }
+}
+
+void SoftwareSoundDriver::play_source(AudioSourceID source_id) {
+    auto s = source(source_id);
+    if(!s || s->state == AUDIO_SOURCE_STATE_PLAYING) {
+        return;
+    }
+
+    if(s->state == AUDIO_SOURCE_STATE_STOPPED) {
+        // Like OpenAL, playing a stopped source starts from the first queued buffer
+        s->processed = 0;
+        s->cursor = 0;
+    }
+
+    s->state = AUDIO_SOURCE_STATE_PLAYING;
+}
+
+void SoftwareSoundDriver::stop_source(AudioSourceID source_id) {
+    auto s = source(source_id);
+    if(!s) {
+        return;
+    }
+
+    s->state = AUDIO_SOURCE_STATE_STOPPED;
+    s->processed = s->queued.size();
+    s->cursor = 0;
+}
+
+void SoftwareSoundDriver::queue_buffers_to_source(AudioSourceID source_id, uint32_t count, const std::vector<AudioBufferID>& buffers) {
+    auto s = source(source_id);
+    if(!s) {
+        return;
+    }
+
+    count = std::min(count, (uint32_t) buffers.size());
+    s->queued.insert(s->queued.end(), buffers.begin(), buffers.begin() + count);
+}
+
+std::vector<AudioBufferID> SoftwareSoundDriver::unqueue_buffers_from_source(AudioSourceID source_id, uint32_t count) {
+    auto s = source(source_id);
+    if(!s) {
+        return {};
+    }
+
+    count = std::min(count, s->processed);
+
+    std::vector<AudioBufferID> ret(s->queued.begin(), s->queued.begin() + count);
+    s->queued.erase(s->queued.begin(), s->queued.begin() + count);
+    s->processed -= count;
+    return ret;
+}
+
+void SoftwareSoundDriver::upload_buffer_data(AudioBufferID buffer_id, AudioDataFormat format, const uint8_t* data, std::size_t bytes, uint32_t frequency) {
+    auto b = buffer(buffer_id);
+    if(!b) {
+        return;
+    }
+
+    b->frequency = frequency;
+
+    switch(format) {
+        case AUDIO_DATA_FORMAT_MONO16:
+        case AUDIO_DATA_FORMAT_STEREO16: {
+            b->channels = (format == AUDIO_DATA_FORMAT_MONO16) ? 1 : 2;
+            b->samples.resize(bytes / sizeof(int16_t));
+            if(!b->samples.empty()) {
+                std::copy(data, data + b->samples.size() * sizeof(int16_t), (uint8_t*) &b->samples[0]);
+            }
+        } break;
+        case AUDIO_DATA_FORMAT_MONO8:
+        case AUDIO_DATA_FORMAT_STEREO8: {
+            // 8 bit PCM is unsigned
+            b->channels = (format == AUDIO_DATA_FORMAT_MONO8) ? 1 : 2;
+            b->samples.resize(bytes);
+            for(std::size_t i = 0; i < bytes; ++i) {
+                b->samples[i] = int16_t((int(data[i]) - 128) << 8);
+            }
+        } break;
+        default:
+            L_WARN("Unsupported audio format uploaded to the software sound driver");
+            b->samples.clear();
+    }
+
+    // Drop any partial frame
+    b->samples.resize(b->frames() * b->channels);
+}
+
+AudioSourceState SoftwareSoundDriver::source_state(AudioSourceID source_id) {
+    auto s = source(source_id);
+    return (s) ? s->state : AUDIO_SOURCE_STATE_STOPPED;
+}
+
+int32_t SoftwareSoundDriver::source_buffers_processed_count(AudioSourceID source_id) const {
+    auto s = source(source_id);
+    return (s) ? s->processed : 0;
+}
+
+void SoftwareSoundDriver::set_source_as_ambient(AudioSourceID id) {
+    if(auto s = source(id)) {
+        s->ambient = true;
+    }
+}
+
+void SoftwareSoundDriver::set_listener_properties(const Vec3& position, const Quaternion& rotation, const Vec3& velocity) {
+    _S_UNUSED(velocity);
+
+    listener_position_ = position;
+    listener_right_ = rotation.right();
+}
+
+void SoftwareSoundDriver::set_source_properties(AudioSourceID id, const Vec3& position, const Quaternion& rotation, const Vec3& velocity) {
+    /* No cones or doppler, only position matters */
+    _S_UNUSED(rotation);
+    _S_UNUSED(velocity);
+
+    if(auto s = source(id)) {
+        s->position = position;
+    }
+}
+
+void SoftwareSoundDriver::set_source_reference_distance(AudioSourceID id, float dist) {
+    if(auto s = source(id)) {
+        s->reference_distance = std::max(dist, 0.0001f);
+    }
+}
+
+void SoftwareSoundDriver::set_source_gain(AudioSourceID id, RangeValue<0, 1> value) {
+    if(auto s = source(id)) {
+        s->gain = value;
+    }
+}
+
+void SoftwareSoundDriver::set_source_pitch(AudioSourceID id, RangeValue<0, 1> value) {
+    if(auto s = source(id)) {
+        // A pitch of zero would never finish
+        s->pitch = std::max((float) value, 0.01f);
+    }
+}
+
+void SoftwareSoundDriver::set_source_priority(AudioSourceID id, int32_t priority) {
+    if(auto s = source(id)) {
+        s->priority = priority;
+    }
+}
+
+bool SoftwareSoundDriver::is_source_virtual(AudioSourceID id) const {
+    auto s = source(id);
+    return !s || s->is_virtual;
+}
+
+void SoftwareSoundDriver::calculate_gains(Source& s) const {
+    /* Equal power panning, so a centred sound is sqrt(0.5) in each ear */
+    const float centre = 0.70710678f;
+
+    if(s.ambient) {
+        s.audibility = s.gain;
+        s.left = s.right = s.gain * centre;
+        return;
+    }
+
+    Vec3 dir = s.position - listener_position_;
+    float distance = dir.length();
+
+    /* Inverse distance clamped, the same as OpenAL's default model */
+    float attenuation = s.reference_distance / (
+        s.reference_distance + (std::max(distance, s.reference_distance) - s.reference_distance)
+    );
+
+    float pan = (distance > 0.0001f) ? (dir / distance).dot(listener_right_) : 0.0f;
+    pan = std::min(std::max(pan, -1.0f), 1.0f);
+
+    float angle = (pan + 1.0f) * 0.25f * PI;
+
+    s.audibility = s.gain * attenuation;
+    s.left = s.audibility * std::cos(angle);
+    s.right = s.audibility * std::sin(angle);
+}
+
+void SoftwareSoundDriver::assign_voices() {
+    playing_.clear();
+
+    for(uint32_t i = 0; i < sources_.size(); ++i) {
+        auto& s = sources_[i];
+        s.is_virtual = true;
+
+        if(!s.in_use || s.state != AUDIO_SOURCE_STATE_PLAYING) {
+            continue;
+        }
+
+        calculate_gains(s);
+        playing_.push_back(i);
+    }
+
+    /* Highest priority first, then the loudest */
+    auto real_count = std::min<std::size_t>(voice_count_, playing_.size());
+    std::partial_sort(
+        playing_.begin(), playing_.begin() + real_count, playing_.end(),
+        [this](uint32_t lhs, uint32_t rhs) -> bool {
+            auto& a = sources_[lhs];
+            auto& b = sources_[rhs];
+
+            if(a.priority != b.priority) {
+                return a.priority > b.priority;
+            }
+
+            return a.audibility > b.audibility;
+        }
+    );
+
+    real_voices_ = 0;
+    for(std::size_t i = 0; i < real_count; ++i) {
+        auto& s = sources_[playing_[i]];
+        if(s.audibility >= MIN_AUDIBLE_GAIN) {
+            s.is_virtual = false;
+            ++real_voices_;
+        }
+    }
+
+    virtual_voices_ = playing_.size() - real_voices_;
+}
+
+static void mix_mono(const int16_t* in, uint32_t frames, float left, float right, float* out) {
+    /* Kept simple so that the compiler can vectorise it */
+    for(uint32_t i = 0; i < frames; ++i) {
+        float v = float(in[i]);
+        out[i * 2] += v * left;
+        out[i * 2 + 1] += v * right;
+    }
+}
+
+static void mix_stereo(const int16_t* in, uint32_t frames, float left, float right, float* out) {
+    for(uint32_t i = 0; i < frames * 2; i += 2) {
+        out[i] += float(in[i]) * left;
+        out[i + 1] += float(in[i + 1]) * right;
+    }
+}
+
+static void mix_resampled(const int16_t* in, uint32_t in_frames, uint8_t channels, uint64_t cursor, uint32_t step, uint32_t frames, float left, float right, float* out) {
+    const float to_unit = 1.0f / 65536.0f;
+    const uint32_t last = in_frames - 1;
+
+    for(uint32_t i = 0; i < frames; ++i, cursor += step) {
+        uint32_t index = uint32_t(cursor >> 16);
+        uint32_t next = std::min(index + 1, last);
+        float t = float(cursor & 0xFFFF) * to_unit;
+
+        if(channels == 1) {
+            float v = float(in[index]) + (float(in[next]) - float(in[index])) * t;
+            out[i * 2] += v * left;
+            out[i * 2 + 1] += v * right;
+        } else {
+            float l = float(in[index * 2]) + (float(in[next * 2]) - float(in[index * 2])) * t;
+            float r = float(in[index * 2 + 1]) + (float(in[next * 2 + 1]) - float(in[index * 2 + 1])) * t;
+            out[i * 2] += l * left;
+            out[i * 2 + 1] += r * right;
+        }
+    }
+}
+
+void SoftwareSoundDriver::advance(Source& s, uint32_t frames, float* out) {
+    uint32_t done = 0;
+
+    while(done < frames && s.processed < s.queued.size()) {
+        auto b = buffer(s.queued[s.processed]);
+        if(!b || !b->frequency || !b->frames()) {
+            ++s.processed;
+            s.cursor = 0;
+            continue;
+        }
+
+        uint64_t end = uint64_t(b->frames()) << 16;
+
+        uint32_t step = std::max<uint32_t>(
+            1, uint32_t((double(b->frequency) / double(frequency_)) * double(s.pitch) * 65536.0)
+        );
+
+        /* Output frames until this buffer runs out */
+        uint64_t available = (end - s.cursor + step - 1) / step;
+        uint32_t count = (uint32_t) std::min<uint64_t>(frames - done, available);
+
+        if(out) {
+            /* Stereo data isn't positioned, the same as OpenAL */
+            float left = (b->channels == 1) ? s.left : s.audibility;
+            float right = (b->channels == 1) ? s.right : s.audibility;
+            float* dest = out + done * 2;
+
+            if(step == 65536) {
+                const int16_t* in = &b->samples[(s.cursor >> 16) * b->channels];
+                if(b->channels == 1) {
+                    mix_mono(in, count, left, right, dest);
+                } else {
+                    mix_stereo(in, count, left, right, dest);
+                }
+            } else {
+                mix_resampled(&b->samples[0], b->frames(), b->channels, s.cursor, step, count, left, right, dest);
+            }
+        }
+
+        s.cursor += uint64_t(step) * count;
+        done += count;
+
+        if(s.cursor >= end) {
+            // Carry any remainder into the next buffer
+            s.cursor -= end;
+            ++s.processed;
+        }
+    }
+
+    if(s.processed == s.queued.size()) {
+        // Ran out of data, the source stops just like an OpenAL one would
+        s.state = AUDIO_SOURCE_STATE_STOPPED;
+        s.cursor = 0;
+    }
+}
+
+void SoftwareSoundDriver::mix_block(uint32_t frames) {
+    float* acc = &accumulator_[0];
+    std::fill(acc, acc + frames * 2, 0.0f);
+
+    for(auto i: playing_) {
+        auto& s = sources_[i];
+        if(s.state == AUDIO_SOURCE_STATE_PLAYING) {
+            advance(s, frames, (s.is_virtual) ? nullptr : acc);
+        }
+    }
+
+    int16_t* out = &output_[0];
+    for(uint32_t i = 0; i < frames * 2; ++i) {
+        float v = std::min(std::max(acc[i], -32768.0f), 32767.0f);
+        out[i] = int16_t(v);
+    }
+
+    if(sink_open_) {
+        sink_->write(out, frames);
+    }
+}
+
+void SoftwareSoundDriver::mix(uint32_t frames) {
+    assign_voices();
+
+    while(frames) {
+        uint32_t count = std::min(frames, MAX_MIX_FRAMES);
+        mix_block(count);
+        frames -= count;
+    }
+}
+
+void SoftwareSoundDriver::update(float dt) {
+    if(!sink_open_) {
+        return;
+    }
+
+    uint32_t frames = sink_->frames_wanted(dt, frequency_);
+    if(frames) {
+        mix(frames);
+    }
+}
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../sound_driver.h"
+#include "../math/vec3.h"
+#include "../math/quaternion.h"
+#include "audio_sink.h"
+
+namespace smlt {
+
+/*
+ * Mixes every source in software and hands the result to an AudioSink, so the
+ * cost of audio is fixed no matter how many sounds are playing.
+ *
+ * Sources are cheap and unlimited, but only voice_count of them are mixed each
+ * update. The rest become "virtual" voices: they are chosen by priority and
+ * then by how loud they would be at the listener, and keep advancing through
+ * their buffers without being heard so they come back in the right place.
+ */
+class SoftwareSoundDriver : public SoundDriver {
+public:
+    static const uint32_t DEFAULT_VOICE_COUNT = 32;
+    static const uint32_t DEFAULT_OUTPUT_FREQUENCY = 44100;
+
+    /* Mixing is done in blocks of at most this many frames */
+    static const uint32_t MAX_MIX_FRAMES = 1024;
+
+    /* Anything quieter than this isn't worth a voice */
+    static constexpr float MIN_AUDIBLE_GAIN = 0.001f;
+
+    SoftwareSoundDriver(
+        Window* window,
+        std::shared_ptr<AudioSink> sink,
+        uint32_t voice_count=DEFAULT_VOICE_COUNT,
+        uint32_t frequency=DEFAULT_OUTPUT_FREQUENCY
+    );
+
+    bool startup() override;
+    void shutdown() override;
+
+    std::vector<AudioSourceID> generate_sources(uint32_t count) override;
+    std::vector<AudioBufferID> generate_buffers(uint32_t count) override;
+
+    void destroy_buffers(const std::vector<AudioBufferID>& buffers) override;
+    void destroy_sources(const std::vector<AudioSourceID>& sources) override;
+
+    void play_source(AudioSourceID source_id) override;
+    void stop_source(AudioSourceID source_id) override;
+
+    void queue_buffers_to_source(AudioSourceID source, uint32_t count, const std::vector<AudioBufferID>& buffers) override;
+    std::vector<AudioBufferID> unqueue_buffers_from_source(AudioSourceID source, uint32_t count) override;
+    void upload_buffer_data(AudioBufferID buffer, AudioDataFormat format, const uint8_t* data, std::size_t bytes, uint32_t frequency) override;
+
+    AudioSourceState source_state(AudioSourceID source) override;
+    int32_t source_buffers_processed_count(AudioSourceID source) const override;
+
+    void set_source_as_ambient(AudioSourceID id) override;
+    void set_listener_properties(const Vec3& position, const Quaternion& rotation, const Vec3& velocity) override;
+    void set_source_properties(AudioSourceID id, const Vec3& position, const Quaternion& rotation, const Vec3& velocity) override;
+
+    void set_source_reference_distance(AudioSourceID id, float dist) override;
+    void set_source_gain(AudioSourceID id, RangeValue<0, 1> value) override;
+    void set_source_pitch(AudioSourceID id, RangeValue<0, 1> value) override;
+    void set_source_priority(AudioSourceID id, int32_t priority) override;
+
+    void update(float dt) override;
+
+    /* Mixes the next frames of output and writes them to the sink */
+    void mix(uint32_t frames);
+
+    uint32_t voice_count() const { return voice_count_; }
+    uint32_t frequency() const { return frequency_; }
+
+    /* How the playing sources were split during the last mix */
+    uint32_t real_voice_count() const { return real_voices_; }
+    uint32_t virtual_voice_count() const { return virtual_voices_; }
+
+    /* Whether the source was mixed during the last mix */
+    bool is_source_virtual(AudioSourceID id) const;
+
+private:
+    struct Buffer {
+        bool in_use = false;
+
+        /* Always 16 bit, 1 or 2 interleaved channels. The vector keeps its
+         * capacity between uploads so streamed buffers don't reallocate */
+        std::vector<int16_t> samples;
+        uint8_t channels = 1;
+        uint32_t frequency = 0;
+
+        uint32_t frames() const { return samples.size() / channels; }
+    };
+
+    struct Source {
+        bool in_use = false;
+        AudioSourceState state = AUDIO_SOURCE_STATE_STOPPED;
+
+        std::vector<AudioBufferID> queued;
+        uint32_t processed = 0;
+
+        /* 16.16 fixed point frame position within the current buffer */
+        uint64_t cursor = 0;
+
+        Vec3 position;
+        bool ambient = false;
+        float gain = 1.0f;
+        float pitch = 1.0f;
+        float reference_distance = 1.0f;
+        int32_t priority = 0;
+
+        /* Calculated at the start of each mix */
+        float left = 0.0f;
+        float right = 0.0f;
+        float audibility = 0.0f;
+        bool is_virtual = true;
+    };
+
+    Buffer* buffer(AudioBufferID id);
+    Source* source(AudioSourceID id);
+    const Source* source(AudioSourceID id) const;
+
+    void calculate_gains(Source& source) const;
+    void assign_voices();
+
+    /* Moves the source on by frames, mixing into out unless it's null */
+    void advance(Source& source, uint32_t frames, float* out);
+
+    void mix_block(uint32_t frames);
+
+    std::shared_ptr<AudioSink> sink_;
+    uint32_t voice_count_;
+    uint32_t frequency_;
+    bool sink_open_ = false;
+
+    std::vector<Buffer> buffers_;
+    std::vector<AudioBufferID> free_buffers_;
+
+    std::vector<Source> sources_;
+    std::vector<AudioSourceID> free_sources_;
+
+    Vec3 listener_position_;
+    Vec3 listener_right_ = Vec3::POSITIVE_X;
+
+    /* Scratch space, sized once */
+    std::vector<uint32_t> playing_;
+    std::vector<float> accumulator_;
+    std::vector<int16_t> output_;
+
+    uint32_t real_voices_ = 0;
+    uint32_t virtual_voices_ = 0;
+};
+
+}
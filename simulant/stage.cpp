@@ -36,6 +36,7 @@
 #include "partitioners/null_partitioner.h"
 #include "partitioners/spatial_hash.h"
 #include "partitioners/frustum_partitioner.h"
+#include "partitioners/bsp_partitioner.h"
 #include "generic/manual_manager.h"
 
 namespace smlt {
@@ -405,6 +406,9 @@ void Stage::set_partitioner(AvailablePartitioner partitioner) {
         case PARTITIONER_HASH:
             partitioner_ = std::make_shared<SpatialHashPartitioner>(this);
         break;
+        case PARTITIONER_BSP:
+            partitioner_ = std::make_shared<BSPPartitioner>(this);
+        break;
         default: {
             throw std::logic_error("Invalid partitioner type specified");
         }
@@ -513,6 +517,42 @@ void Stage::on_actor_destroyed(ActorID actor_id) {
 
 }
 
+void Stage::_queue_bounds_update(StageNode* node) {
+    thread::Lock<thread::Mutex> lock(bounds_updates_lock_);
+    if(!node->bounds_update_queued_) {
+        node->bounds_update_queued_ = true;
+        bounds_updates_.push_back(node);
+    }
+}
+
+void Stage::_cancel_bounds_update(StageNode* node) {
+    thread::Lock<thread::Mutex> lock(bounds_updates_lock_);
+    if(node->bounds_update_queued_) {
+        node->bounds_update_queued_ = false;
+        bounds_updates_.erase(
+            std::remove(bounds_updates_.begin(), bounds_updates_.end(), node),
+            bounds_updates_.end()
+        );
+    }
+}
+
+void Stage::_flush_bounds_updates() {
+    {
+        thread::Lock<thread::Mutex> lock(bounds_updates_lock_);
+        std::swap(bounds_updates_, bounds_flushing_);
+        for(auto node: bounds_flushing_) {
+            node->bounds_update_queued_ = false;
+        }
+    }
+
+    /* Moving a node from a bounds listener queues it for next time */
+    for(auto node: bounds_flushing_) {
+        node->recalc_bounds_if_necessary();
+    }
+
+    bounds_flushing_.clear();
+}
+
 void Stage::clean_up_dead_objects() {
     actor_manager_->clean_up();
     light_manager_->clean_up();
@@ -209,9 +209,21 @@ public:
         return active_pipeline_count_ > 0;
     }
 
+    /* Nodes which have moved have their transformed bounds recalculated, and
+     * signal_bounds_updated fired, in one go by _flush_bounds_updates(). The
+     * partitioner calls that (on the main thread) before applying its writes.
+     * Nodes can move on worker threads, so the queue is guarded by a lock */
+    void _queue_bounds_update(StageNode* node);
+    void _cancel_bounds_update(StageNode* node);
+    void _flush_bounds_updates();
+
 private:
     AABB aabb_;
 
+    thread::Mutex bounds_updates_lock_;
+    std::vector<StageNode*> bounds_updates_;
+    std::vector<StageNode*> bounds_flushing_;
+
     ActorCreatedSignal signal_actor_created_;
     ActorDestroyedSignal signal_actor_destroyed_;
 
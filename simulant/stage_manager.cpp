@@ -69,48 +69,42 @@ StagePtr StageManager::destroy_stage(StageID s) {
 }
 
 
-static void _fixed_update(Stage* stage, float* dt) {
-    if(!stage->is_part_of_active_pipeline()) {
-        return;
-    }
-
-    for(auto stage_node: stage->each_descendent_and_self()) {
-        stage_node->fixed_update(*dt);
-    }
-}
-
 void StageManager::fixed_update(float dt) {
-    /* safe_each locks the entire loop */
-    stage_manager_->safe_each(_fixed_update, &dt);
-}
+    auto dispatcher = &behaviour_dispatcher_;
 
-static void _late_update(Stage* stage, float* dt) {
-    if(!stage->is_part_of_active_pipeline()) {
-        return;
-    }
+    /* safe_each locks the entire loop */
+    stage_manager_->safe_each([dispatcher](Stage* stage, float* dt) {
+        if(!stage->is_part_of_active_pipeline()) {
+            return;
+        }
 
-    for(auto stage_node: stage->each_descendent_and_self()) {
-        stage_node->late_update(*dt);
-    }
+        dispatcher->fixed_update(stage, *dt);
+    }, &dt);
 }
 
 void StageManager::late_update(float dt) {
-    stage_manager_->safe_each(_late_update, &dt);
-}
+    auto dispatcher = &behaviour_dispatcher_;
 
-static void _update(Stage* stage, float* dt) {
-    if(!stage->is_part_of_active_pipeline()) {
-        return;
-    }
+    stage_manager_->safe_each([dispatcher](Stage* stage, float* dt) {
+        if(!stage->is_part_of_active_pipeline()) {
+            return;
+        }
 
-    for(auto stage_node: stage->each_descendent_and_self()) {
-        stage_node->update(*dt);
-    }
+        dispatcher->late_update(stage, *dt);
+    }, &dt);
 }
 
 void StageManager::update(float dt) {
+    auto dispatcher = &behaviour_dispatcher_;
+
     //Update the stages
-    stage_manager_->safe_each(_update, &dt);
+    stage_manager_->safe_each([dispatcher](Stage* stage, float* dt) {
+        if(!stage->is_part_of_active_pipeline()) {
+            return;
+        }
+
+        dispatcher->update(stage, *dt);
+    }, &dt);
 }
 
 void StageManager::print_tree() {
@@ -26,6 +26,7 @@
 #include "types.h"
 
 #include "stage.h"
+#include "behaviours/behaviour_dispatcher.h"
 
 namespace smlt {
 
@@ -61,11 +62,16 @@ public:
 
     stage_iterator_pair each_stage();
 
+    /* Runs the behaviours of every stage's nodes during the update passes */
+    BehaviourDispatcher* behaviour_dispatcher() { return &behaviour_dispatcher_; }
+
     /* Implementation for TypedDestroyableObject (INTERNAL) */
     void destroy_object(Stage* object);
     void destroy_object_immediately(Stage* object);
 private:
     Window* window_ = nullptr;
+    BehaviourDispatcher behaviour_dispatcher_;
+
     void print_tree(StageNode* node, uint32_t& level);
 
 protected:
@@ -36,6 +36,24 @@ public:
     void increment_fixed_steps() { fixed_steps_run_++; }
     void increment_frames() { frames_run_++; }
 
+    /* Allocations made from the window's FrameArena during the last frame,
+     * and how many of those needed more memory from the heap. Once the
+     * arena has grown to fit a frame the latter should stay at zero */
+    uint32_t frame_arena_allocations() const { return frame_arena_allocations_; }
+    uint32_t frame_arena_heap_allocations() const { return frame_arena_heap_allocations_; }
+
+    void set_frame_arena_allocations(uint32_t allocations, uint32_t heap_allocations) {
+        frame_arena_allocations_ = allocations;
+        frame_arena_heap_allocations_ = heap_allocations;
+    }
+
+    /* Nodes removed by occlusion culling during the last frame, across
+     * all pipelines */
+    uint32_t nodes_occluded() const { return nodes_occluded_; }
+    void set_nodes_occluded(uint32_t value) {
+        nodes_occluded_ = value;
+    }
+
     void reset_polygons_rendered() {
         polygons_rendered_ = 0;
     }
@@ -55,6 +73,11 @@ private:
     uint64_t frames_run_ = 0;
 
     uint32_t polygons_rendered_ = 0;
+
+    uint32_t frame_arena_allocations_ = 0;
+    uint32_t frame_arena_heap_allocations_ = 0;
+
+    uint32_t nodes_occluded_ = 0;
 };
 
 
@@ -0,0 +1,486 @@
+//
+//   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+//
+//     This file is part of Simulant.
+//
+//     Simulant is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     Simulant is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+//
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "texture_atlas.h"
+#include "texture.h"
+#include "material.h"
+#include "font.h"
+#include "asset_manager.h"
+#include "logging.h"
+#include "meshes/mesh.h"
+#include "meshes/submesh.h"
+#include "nodes/sprite.h"
+#include "utils/rect_pack.h"
+
+namespace smlt {
+
+static uint16_t round_up(uint16_t value, uint16_t multiple) {
+    if(multiple <= 1) {
+        return value;
+    }
+
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+/* Expands an uncompressed byte-per-channel texture to RGBA8888. Returns false
+ * if the format isn't supported */
+static bool expand_to_rgba(const Texture& texture, std::vector<uint8_t>& out) {
+    if(texture.is_compressed() || texture.texel_type() != TEXTURE_TEXEL_TYPE_UNSIGNED_BYTE) {
+        return false;
+    }
+
+    const auto& data = texture.data();
+    const std::size_t pixels = texture.width() * texture.height();
+    const auto channels = texture.channels();
+
+    if(data.size() < pixels * channels) {
+        return false;
+    }
+
+    out.resize(pixels * 4);
+
+    for(std::size_t i = 0; i < pixels; ++i) {
+        const uint8_t* src = &data[i * channels];
+        uint8_t* dst = &out[i * 4];
+
+        switch(channels) {
+            case 1:
+                dst[0] = dst[1] = dst[2] = dst[3] = src[0];
+            break;
+            case 3:
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 255;
+            break;
+            case 4:
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = src[3];
+            break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+TextureAtlas::TextureAtlas(const TextureAtlasOptions& options):
+    options_(options) {
+
+}
+
+bool TextureAtlas::add_source(Source&& source) {
+    if(packed_) {
+        L_ERROR("Tried to add an image to a TextureAtlas which has already been packed");
+        return false;
+    }
+
+    if(!source.width || !source.height) {
+        L_WARN("Ignoring empty image passed to TextureAtlas");
+        return false;
+    }
+
+    sources_.push_back(std::move(source));
+    return true;
+}
+
+bool TextureAtlas::add_texture(TexturePtr texture) {
+    if(!texture) {
+        return false;
+    }
+
+    if(regions_by_texture_.count(texture->id())) {
+        return true;
+    }
+
+    Source source;
+    source.texture_id = texture->id();
+    source.width = texture->width();
+    source.height = texture->height();
+
+    if(!expand_to_rgba(*texture, source.rgba)) {
+        L_WARN(_F("Unable to add texture {0} to atlas. It must be uncompressed and still have its data").format(
+            texture->id()
+        ));
+        return false;
+    }
+
+    /* Reserve the key so that duplicate adds are ignored */
+    regions_by_texture_[texture->id()] = sources_.size();
+    if(!add_source(std::move(source))) {
+        regions_by_texture_.erase(texture->id());
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureAtlas::add_image(const std::string& name, uint16_t width, uint16_t height, const uint8_t* rgba) {
+    if(regions_by_name_.count(name)) {
+        L_WARN(_F("An image called {0} has already been added to the atlas").format(name));
+        return false;
+    }
+
+    Source source;
+    source.name = name;
+    source.width = width;
+    source.height = height;
+    source.rgba.assign(rgba, rgba + (width * height * 4));
+
+    regions_by_name_[name] = sources_.size();
+    if(!add_source(std::move(source))) {
+        regions_by_name_.erase(name);
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureAtlas::add_font(FontPtr font) {
+    if(!font || !font->texture_) {
+        return false;
+    }
+
+    return add_texture(font->texture_);
+}
+
+bool TextureAtlas::pack() {
+    if(packed_) {
+        return true;
+    }
+
+    const uint16_t align = std::max<uint16_t>(options_.alignment, 1);
+    const uint16_t gutter = round_up(options_.gutter, align);
+
+    const int page_units_w = options_.page_width / align;
+    const int page_units_h = options_.page_height / align;
+
+    regions_.assign(sources_.size(), AtlasRegion());
+
+    std::vector<stbrp_rect> pending;
+    pending.reserve(sources_.size());
+
+    bool success = true;
+    for(uint32_t i = 0; i < sources_.size(); ++i) {
+        auto& source = sources_[i];
+
+        stbrp_rect rect;
+        rect.id = i;
+        rect.w = round_up(source.width + (gutter * 2), align) / align;
+        rect.h = round_up(source.height + (gutter * 2), align) / align;
+        rect.was_packed = 0;
+
+        if(rect.w > page_units_w || rect.h > page_units_h) {
+            L_ERROR(_F("Image of size {0}x{1} is too large for the atlas page").format(
+                source.width, source.height
+            ));
+            success = false;
+            continue;
+        }
+
+        pending.push_back(rect);
+    }
+
+    std::vector<stbrp_node> nodes(page_units_w);
+
+    /* Fill a page at a time, carrying anything that didn't fit to the next one */
+    while(!pending.empty()) {
+        stbrp_context context;
+        stbrp_init_target(&context, page_units_w, page_units_h, &nodes[0], nodes.size());
+        stbrp_pack_rects(&context, &pending[0], pending.size());
+
+        const uint32_t page_index = pages_.size();
+        pages_.push_back(Page());
+
+        auto& page = pages_.back();
+        page.data.resize(options_.page_width * options_.page_height * 4, 0);
+
+        std::vector<stbrp_rect> remaining;
+        for(auto& rect: pending) {
+            if(!rect.was_packed) {
+                remaining.push_back(rect);
+                continue;
+            }
+
+            auto& source = sources_[rect.id];
+            auto& region = regions_[rect.id];
+
+            region.page = page_index;
+            region.x = (rect.x * align) + gutter;
+            region.y = (rect.y * align) + gutter;
+            region.width = source.width;
+            region.height = source.height;
+
+            region.uv_min = Vec2(
+                float(region.x) / float(options_.page_width),
+                float(region.y) / float(options_.page_height)
+            );
+
+            region.uv_max = Vec2(
+                float(region.x + region.width) / float(options_.page_width),
+                float(region.y + region.height) / float(options_.page_height)
+            );
+
+            blit(source, region, page);
+        }
+
+        /* Rects that didn't fit on an empty page never will */
+        if(remaining.size() == pending.size()) {
+            pages_.pop_back();
+            success = false;
+            break;
+        }
+
+        pending.swap(remaining);
+    }
+
+    /* We don't need the source pixels anymore */
+    for(auto& source: sources_) {
+        source.rgba.clear();
+        source.rgba.shrink_to_fit();
+    }
+
+    packed_ = true;
+    return success;
+}
+
+void TextureAtlas::blit(const Source& source, const AtlasRegion& region, Page& page) {
+    const int gutter = round_up(options_.gutter, std::max<uint16_t>(options_.alignment, 1));
+    const int pw = options_.page_width;
+    const int ph = options_.page_height;
+
+    const int x0 = std::max(int(region.x) - gutter, 0);
+    const int y0 = std::max(int(region.y) - gutter, 0);
+    const int x1 = std::min(int(region.x + region.width) + gutter, pw);
+    const int y1 = std::min(int(region.y + region.height) + gutter, ph);
+
+    /* Pixels in the gutter take the value of the nearest edge pixel, so filtering
+     * at the region edge (and in the smaller mips) samples the image itself */
+    for(int y = y0; y < y1; ++y) {
+        int sy = std::min(std::max(y - int(region.y), 0), int(source.height) - 1);
+
+        for(int x = x0; x < x1; ++x) {
+            int sx = std::min(std::max(x - int(region.x), 0), int(source.width) - 1);
+
+            const uint8_t* src = &source.rgba[((sy * source.width) + sx) * 4];
+            uint8_t* dst = &page.data[((y * pw) + x) * 4];
+
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = src[3];
+        }
+    }
+}
+
+bool TextureAtlas::build(AssetManager* assets) {
+    bool success = pack();
+
+    for(auto& page: pages_) {
+        if(page.texture) {
+            continue;
+        }
+
+        page.texture = assets->new_texture(
+            options_.page_width, options_.page_height, TEXTURE_FORMAT_RGBA8888
+        );
+
+        page.texture->set_data(page.data);
+        page.texture->set_texture_filter(options_.filter);
+        page.texture->set_mipmap_generation(options_.mipmap);
+        page.texture->set_texture_wrap(
+            TEXTURE_WRAP_CLAMP_TO_EDGE, TEXTURE_WRAP_CLAMP_TO_EDGE, TEXTURE_WRAP_CLAMP_TO_EDGE
+        );
+    }
+
+    return success;
+}
+
+bool TextureAtlas::has_region(TextureID texture) const {
+    return region(texture) != nullptr;
+}
+
+bool TextureAtlas::has_region(const std::string& name) const {
+    return region(name) != nullptr;
+}
+
+const AtlasRegion* TextureAtlas::region(TextureID texture) const {
+    auto it = regions_by_texture_.find(texture);
+    if(it == regions_by_texture_.end() || it->second >= regions_.size()) {
+        return nullptr;
+    }
+
+    auto& region = regions_[it->second];
+    return (region.width) ? &region : nullptr;
+}
+
+const AtlasRegion* TextureAtlas::region(const std::string& name) const {
+    auto it = regions_by_name_.find(name);
+    if(it == regions_by_name_.end() || it->second >= regions_.size()) {
+        return nullptr;
+    }
+
+    auto& region = regions_[it->second];
+    return (region.width) ? &region : nullptr;
+}
+
+MaterialPtr TextureAtlas::remapped_material(MaterialPtr original, TextureID source, const AtlasRegion& region) {
+    auto it = remapped_materials_.find(original->id());
+    if(it != remapped_materials_.end()) {
+        return it->second;
+    }
+
+    auto page = pages_.at(region.page).texture;
+
+    auto material = original->asset_manager().clone_material(original->id());
+    if(material->diffuse_map()->texture_id() == source) {
+        material->set_diffuse_map(page);
+    }
+
+    material->each([&](uint32_t, MaterialPass* pass) {
+        if(pass->diffuse_map()->texture_id() == source) {
+            pass->set_diffuse_map(page);
+        }
+    });
+
+    remapped_materials_[original->id()] = material;
+    return material;
+}
+
+uint32_t TextureAtlas::apply_to_mesh(MeshPtr mesh) {
+    if(!mesh || pages_.empty() || !pages_[0].texture) {
+        L_WARN("You must build() the TextureAtlas before applying it");
+        return 0;
+    }
+
+    auto vertex_data = mesh->vertex_data.get();
+    if(vertex_data->vertex_specification().texcoord0_attribute != VERTEX_ATTRIBUTE_2F) {
+        L_WARN("TextureAtlas can only remap meshes with 2D texcoord0");
+        return 0;
+    }
+
+    /* Track which region each vertex was remapped into, vertices are shared between
+     * submeshes so we must only touch each once */
+    std::vector<const AtlasRegion*> remapped(vertex_data->count(), nullptr);
+
+    uint32_t count = 0;
+    bool warned_wrap = false;
+
+    for(auto submesh: mesh->each_submesh()) {
+        auto material = submesh->material();
+        if(!material || !material->pass_count()) {
+            continue;
+        }
+
+        TextureID texture_id = material->pass(0)->diffuse_map()->texture_id();
+        auto region = this->region(texture_id);
+        if(!region) {
+            continue;
+        }
+
+        for(auto idx: submesh->index_data->all()) {
+            if(remapped[idx] == region) {
+                continue;
+            } else if(remapped[idx]) {
+                L_WARN("Vertex is shared by submeshes with different textures, UVs will be incorrect");
+                continue;
+            }
+
+            auto uv = *vertex_data->texcoord0_at<Vec2>(idx);
+
+            if(!warned_wrap && (uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f)) {
+                L_WARN("Texture coordinates outside 0..1 can't repeat once atlased");
+                warned_wrap = true;
+            }
+
+            vertex_data->move_to(idx);
+            vertex_data->tex_coord0(region->map_uv(uv));
+            remapped[idx] = region;
+        }
+
+        submesh->set_material(remapped_material(material, texture_id, *region));
+        ++count;
+    }
+
+    if(count) {
+        vertex_data->done();
+    }
+
+    return count;
+}
+
+bool TextureAtlas::apply_to_sprite(SpritePtr sprite) {
+    if(!sprite || !sprite->texture_id_) {
+        return false;
+    }
+
+    auto region = this->region(sprite->texture_id_);
+    if(!region || !pages_.at(region->page).texture) {
+        return false;
+    }
+
+    sprite->_set_spritesheet_region(
+        pages_[region->page].texture->id(),
+        region->x, region->y, region->width, region->height
+    );
+
+    return true;
+}
+
+bool TextureAtlas::apply_to_font(FontPtr font) {
+    if(!font || !font->texture_) {
+        return false;
+    }
+
+    auto region = this->region(font->texture_->id());
+    if(!region || !pages_.at(region->page).texture) {
+        return false;
+    }
+
+    /* Glyph positions are stored in pixels within the page. Baked TTF glyphs
+     * count rows from the start of the data, whereas FNT glyphs count from the
+     * other end (see Font::texture_coordinates_for_character) */
+    const int dy = (font->info_) ?
+        int(region->y) :
+        int(options_.page_height) - int(region->y) - int(font->page_height_);
+
+    for(auto& info: font->char_data_) {
+        info.x0 += region->x;
+        info.x1 += region->x;
+        info.y0 += dy;
+        info.y1 += dy;
+    }
+
+    font->page_width_ = options_.page_width;
+    font->page_height_ = options_.page_height;
+    font->texture_ = pages_[region->page].texture;
+
+    if(font->material_) {
+        font->material_->set_diffuse_map(font->texture_);
+    }
+
+    return true;
+}
+
+}
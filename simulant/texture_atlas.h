@@ -0,0 +1,182 @@
+/* *   Copyright (c) 2011-2017 Luke Benstead https://simulant-engine.appspot.com
+ *
+ *     This file is part of Simulant.
+ *
+ *     Simulant is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Lesser General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     Simulant is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Lesser General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Lesser General Public License
+ *     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "types.h"
+#include "texture.h"
+
+namespace smlt {
+
+class AssetManager;
+
+/*
+ * The location of a single packed image within an atlas.
+ *
+ * x, y, width and height are in pixels and describe the image itself, not
+ * including the gutter that surrounds it.
+ */
+struct AtlasRegion {
+    uint32_t page = 0;
+
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+
+    Vec2 uv_min;
+    Vec2 uv_max;
+
+    /* Maps a texture coordinate in the original image's 0..1 space into
+     * the page's texture space */
+    Vec2 map_uv(const Vec2& uv) const {
+        return Vec2(
+            uv_min.x + (uv.x * (uv_max.x - uv_min.x)),
+            uv_min.y + (uv.y * (uv_max.y - uv_min.y))
+        );
+    }
+};
+
+struct TextureAtlasOptions {
+    uint16_t page_width = 1024;
+    uint16_t page_height = 1024;
+
+    /* Number of pixels around each image which are filled by extruding
+     * the image's edges. This stops neighbouring images bleeding in when
+     * filtering. */
+    uint8_t gutter = 2;
+
+    /* Images are placed on multiples of this value so that region edges
+     * stay on texel boundaries in the smaller mip levels. A value of 4 keeps
+     * the first two mip levels free of bleeding */
+    uint8_t alignment = 4;
+
+    /* Applied to the page textures when they are created by build() */
+    TextureFilter filter = TEXTURE_FILTER_BILINEAR;
+    MipmapGenerate mipmap = MIPMAP_GENERATE_COMPLETE;
+};
+
+/*
+ * Packs many small images (textures, spritesheets, baked font glyph pages)
+ * into a handful of shared page textures so that the renderer can batch
+ * draws without rebinding textures.
+ *
+ * Usage:
+ *
+ *   TextureAtlas atlas;
+ *   atlas.add_texture(grass);
+ *   atlas.add_texture(rock);
+ *   atlas.add_font(font);
+ *   atlas.build(stage->assets.get());
+ *
+ *   atlas.apply_to_mesh(level_mesh);  // Remaps texcoord0 and swaps materials
+ *   atlas.apply_to_sprite(sprite);
+ *
+ * Packing is separate from texture creation: pack() only lays out the pages
+ * and fills their pixel data, which allows atlases to be generated offline
+ * and the pages written to disk with page_data().
+ */
+class TextureAtlas {
+public:
+    TextureAtlas(const TextureAtlasOptions& options=TextureAtlasOptions());
+
+    /* Queues a texture for packing. The texture must still have its data
+     * available (e.g. TEXTURE_FREE_DATA_NEVER, or not yet uploaded) and must
+     * be uncompressed. Returns false if the texture couldn't be added. */
+    bool add_texture(TexturePtr texture);
+
+    /* Queues raw RGBA8888 pixel data under the given name */
+    bool add_image(const std::string& name, uint16_t width, uint16_t height, const uint8_t* rgba);
+
+    /* Queues the glyph page of a font. After build(), apply_to_font() moves
+     * the font onto the atlas page */
+    bool add_font(FontPtr font);
+
+    /* Lays out all queued images into pages and fills the page data. Returns
+     * false if any image couldn't be placed (e.g. it's bigger than a page) */
+    bool pack();
+
+    /* Calls pack() if necessary, then creates a texture for each page using
+     * the passed asset manager */
+    bool build(AssetManager* assets);
+
+    std::size_t page_count() const { return pages_.size(); }
+    const std::vector<uint8_t>& page_data(uint32_t page) const { return pages_.at(page).data; }
+    TexturePtr page_texture(uint32_t page) const { return pages_.at(page).texture; }
+
+    bool has_region(TextureID texture) const;
+    bool has_region(const std::string& name) const;
+
+    const AtlasRegion* region(TextureID texture) const;
+    const AtlasRegion* region(const std::string& name) const;
+
+    /*
+     * Remaps texcoord0 of every submesh whose material's diffuse map is an
+     * atlased texture, and points the submesh at a material which uses the
+     * page texture instead. Materials are cloned once per atlas, so submeshes
+     * that shared a material continue to share one.
+     *
+     * Returns the number of submeshes that were remapped.
+     */
+    uint32_t apply_to_mesh(MeshPtr mesh);
+
+    /* Moves a sprite's spritesheet onto the atlas page if its texture was added */
+    bool apply_to_sprite(SpritePtr sprite);
+
+    /* Moves a font's glyphs onto the atlas page if it was added with add_font() */
+    bool apply_to_font(FontPtr font);
+
+private:
+    struct Source {
+        std::string name;
+        TextureID texture_id;
+        uint16_t width = 0;
+        uint16_t height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    struct Page {
+        std::vector<uint8_t> data;
+        TexturePtr texture;
+    };
+
+    TextureAtlasOptions options_;
+
+    std::vector<Source> sources_;
+    std::vector<AtlasRegion> regions_;
+    std::vector<Page> pages_;
+
+    std::unordered_map<std::string, uint32_t> regions_by_name_;
+    std::unordered_map<TextureID, uint32_t> regions_by_texture_;
+
+    /* Cloned materials which point at the pages, keyed on the original material */
+    std::unordered_map<MaterialID, MaterialPtr> remapped_materials_;
+
+    bool packed_ = false;
+
+    bool add_source(Source&& source);
+    void blit(const Source& source, const AtlasRegion& region, Page& page);
+    MaterialPtr remapped_material(MaterialPtr original, TextureID source, const AtlasRegion& region);
+};
+
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+
+#ifdef __WIN32__
+#include <windows.h>
+#elif !defined(_arch_dreamcast)
+#include <unistd.h>
+#endif
+
+#include "thread_pool.h"
+
+namespace smlt {
+namespace thread {
+
+ThreadPool::ThreadPool(std::size_t worker_count) {
+    for(std::size_t i = 0; i < worker_count; ++i) {
+        workers_.push_back(
+            std::unique_ptr<Thread>(new Thread(&ThreadPool::worker, this))
+        );
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        Lock<Mutex> g(lock_);
+        running_ = false;
+    }
+
+    condition_.notify_all();
+
+    for(auto& worker: workers_) {
+        worker->join();
+    }
+}
+
+std::size_t ThreadPool::hardware_concurrency() {
+#if defined(_arch_dreamcast)
+    return 1;
+#elif defined(__WIN32__)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return std::max<std::size_t>(info.dwNumberOfProcessors, 1);
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? std::size_t(count) : 1;
+#endif
+}
+
+bool ThreadPool::run_one() {
+    Task task;
+
+    {
+        Lock<Mutex> g(lock_);
+        if(next_task_ == tasks_.size()) {
+            return false;
+        }
+
+        task = std::move(tasks_[next_task_++]);
+
+        /* Reset the queue once it's drained so it doesn't grow forever */
+        if(next_task_ == tasks_.size()) {
+            tasks_.clear();
+            next_task_ = 0;
+        }
+    }
+
+    task();
+    return true;
+}
+
+void ThreadPool::worker() {
+    while(true) {
+        {
+            Lock<Mutex> g(lock_);
+            while(running_ && next_task_ == tasks_.size()) {
+                condition_.wait(lock_);
+            }
+
+            if(!running_) {
+                return;
+            }
+        }
+
+        run_one();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    if(workers_.empty()) {
+        task();
+        return;
+    }
+
+    {
+        Lock<Mutex> g(lock_);
+        tasks_.push_back(std::move(task));
+    }
+
+    condition_.notify_one();
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t min_chunk, const RangeFunc& func) {
+    if(!count) {
+        return;
+    }
+
+    min_chunk = std::max<std::size_t>(min_chunk, 1);
+
+    std::size_t chunks = std::min(workers_.size() + 1, (count + min_chunk - 1) / min_chunk);
+    if(chunks <= 1) {
+        func(0, count);
+        return;
+    }
+
+    const std::size_t chunk_size = (count + chunks - 1) / chunks;
+    chunks = (count + chunk_size - 1) / chunk_size;
+
+    /* Chunks are claimed from the group rather than queued one by one, so
+     * the caller only ever helps with its own range. Anything else in the
+     * queue (e.g. work from submit()) is left to the workers */
+    struct Group {
+        Mutex lock;
+        Condition done;
+        const RangeFunc* func = nullptr;
+        std::size_t count = 0;
+        std::size_t chunk_size = 0;
+        std::size_t chunks = 0;
+        std::size_t next = 0;
+        std::size_t remaining = 0;
+
+        void run() {
+            while(true) {
+                std::size_t begin;
+                {
+                    Lock<Mutex> l(lock);
+                    if(next == chunks) {
+                        /* Everything's claimed, func may be gone by now */
+                        return;
+                    }
+
+                    begin = (next++) * chunk_size;
+                }
+
+                (*func)(begin, std::min(count, begin + chunk_size));
+
+                Lock<Mutex> l(lock);
+                if(--remaining == 0) {
+                    done.notify_all();
+                }
+            }
+        }
+    };
+
+    auto group = std::make_shared<Group>();
+    group->func = &func;
+    group->count = count;
+    group->chunk_size = chunk_size;
+    group->chunks = chunks;
+    group->remaining = chunks;
+
+    {
+        Lock<Mutex> g(lock_);
+        for(std::size_t i = 1; i < chunks; ++i) {
+            tasks_.push_back([group]() { group->run(); });
+        }
+    }
+
+    condition_.notify_all();
+
+    /* Work through the chunks here too, if the workers are busy with
+     * something else we end up doing all of them */
+    group->run();
+
+    Lock<Mutex> l(group->lock);
+    while(group->remaining) {
+        group->done.wait(group->lock);
+    }
+}
+
+}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "thread.h"
+#include "mutex.h"
+#include "condition.h"
+
+namespace smlt {
+namespace thread {
+
+/*
+ * A fixed set of worker threads which process queued tasks.
+ *
+ * A pool with zero workers runs everything on the calling thread, which is
+ * what you want on single-core platforms like the Dreamcast. Tasks must not
+ * throw; an exception escaping a worker will terminate the program.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void ()> Task;
+    typedef std::function<void (std::size_t, std::size_t)> RangeFunc;
+
+    ThreadPool(std::size_t worker_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t worker_count() const { return workers_.size(); }
+
+    /*
+     * Splits the range [0, count) into chunks of at least min_chunk elements
+     * and calls func(begin, end) for each chunk across the workers. The
+     * calling thread processes chunks too, but never other queued tasks, and
+     * this function blocks until the entire range has been processed.
+     */
+    void parallel_for(std::size_t count, std::size_t min_chunk, const RangeFunc& func);
+
+    /*
+     * Queues task to be run by one of the workers and returns immediately.
+     * With no workers the task is run on the calling thread before this
+     * returns. Tasks still queued when the pool is destroyed are dropped.
+     */
+    void submit(Task task);
+
+    /* Returns the number of cores available, or 1 if that can't be determined */
+    static std::size_t hardware_concurrency();
+
+private:
+    std::vector<std::unique_ptr<Thread>> workers_;
+
+    Mutex lock_;
+    Condition condition_;
+
+    /* We avoid std::deque, see tools/find_std_deque.py */
+    std::vector<Task> tasks_;
+    std::size_t next_task_ = 0;
+
+    bool running_ = true;
+
+    void worker();
+
+    /* Pops and runs a single task. Returns false if the queue was empty */
+    bool run_one();
+};
+
+}
+}
@@ -53,6 +53,10 @@ void TimeKeeper::update() {
     delta_time_ = seconds.count();
 #endif
 
+    if(forced_delta_time_ > 0.0f) {
+        delta_time_ = forced_delta_time_;
+    }
+
     delta_time_ = std::min(DELTATIME_MAX, delta_time_);
 
     accumulator_ += delta_time_;
@@ -30,6 +30,12 @@ public:
 
     bool use_fixed_step();
 
+    /* When non-zero, update() advances time by exactly this much rather than
+     * by however long has really passed. This makes runs repeatable regardless
+     * of how fast frames are processed. */
+    void set_forced_delta_time(float dt) { forced_delta_time_ = dt; }
+    float forced_delta_time() const { return forced_delta_time_; }
+
     void restart() {
         total_time_ = delta_time_ = accumulator_ = 0.0f;
     }
@@ -45,6 +51,7 @@ private:
     float total_time_ = 0.0f;
     float delta_time_ = 0.0f;
     float fixed_step_ = 0.0f;
+    float forced_delta_time_ = 0.0f;
 };
 
 }
@@ -57,7 +57,11 @@ enum VertexAttribute {
     VERTEX_ATTRIBUTE_3F,
     VERTEX_ATTRIBUTE_4F,
     VERTEX_ATTRIBUTE_4UB,
-    VERTEX_ATTRIBUTE_PACKED_VEC4_1I // Packed 10, 10, 10, 2 vector
+    VERTEX_ATTRIBUTE_PACKED_VEC4_1I, // Packed 10, 10, 10, 2 vector
+    VERTEX_ATTRIBUTE_2H, // 2 half floats
+    VERTEX_ATTRIBUTE_4H, // 4 half floats, 3 component data sets w to 1
+    VERTEX_ATTRIBUTE_4B, // 4 signed normalized bytes, for normals (w is padding)
+    VERTEX_ATTRIBUTE_2US // 2 unsigned normalized shorts, for texcoords in the 0..1 range
 };
 
 class VertexSpecification;
@@ -122,6 +126,9 @@ public:
     static const VertexSpecification POSITION_ONLY;
     static const VertexSpecification POSITION_AND_DIFFUSE;
 
+    /* DEFAULT, but with byte normals and half float texture coordinates */
+    static const VertexSpecification COMPACT;
+
     VertexAttributeProperty position_attribute = {this, &VertexSpecification::position_attribute_};
     VertexAttributeProperty normal_attribute = {this, &VertexSpecification::normal_attribute_};
     VertexAttributeProperty texcoord0_attribute = {this, &VertexSpecification::texcoord0_attribute_};
@@ -310,7 +317,8 @@ enum MeshArrangement {
 enum AvailablePartitioner {
     PARTITIONER_NULL,
     PARTITIONER_FRUSTUM,
-    PARTITIONER_HASH
+    PARTITIONER_HASH,
+    PARTITIONER_BSP
 };
 
 enum LightType {
@@ -531,7 +539,11 @@ constexpr uint16_t vertex_attribute_size(VertexAttribute attr) {
        (attr == VERTEX_ATTRIBUTE_3F) ? sizeof(float) * 3 :
        (attr == VERTEX_ATTRIBUTE_4F) ? sizeof(float) * 4 :
        (attr == VERTEX_ATTRIBUTE_4UB) ? sizeof(uint8_t) * 4 :
-       (attr == VERTEX_ATTRIBUTE_PACKED_VEC4_1I) ? sizeof(uint32_t) : 0,
+       (attr == VERTEX_ATTRIBUTE_PACKED_VEC4_1I) ? sizeof(uint32_t) :
+       (attr == VERTEX_ATTRIBUTE_2H) ? sizeof(uint16_t) * 2 :
+       (attr == VERTEX_ATTRIBUTE_4H) ? sizeof(uint16_t) * 4 :
+       (attr == VERTEX_ATTRIBUTE_4B) ? sizeof(int8_t) * 4 :
+       (attr == VERTEX_ATTRIBUTE_2US) ? sizeof(uint16_t) * 2 : 0,
         BUFFER_ATTRIBUTE_ALIGNMENT
     );
 }
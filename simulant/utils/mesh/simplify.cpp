@@ -0,0 +1,351 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include "simplify.h"
+
+namespace smlt {
+namespace utils {
+
+namespace {
+
+/* The symmetric 4x4 matrix of summed squared distances to a set of planes,
+ * weighted by the area of the triangle each plane came from */
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double weight = 0;
+
+    void add_plane(double a, double b, double c, double d, double w) {
+        a2 += a * a * w; ab += a * b * w; ac += a * c * w; ad += a * d * w;
+        b2 += b * b * w; bc += b * c * w; bd += b * d * w;
+        c2 += c * c * w; cd += c * d * w;
+        d2 += d * d * w;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& rhs) {
+        a2 += rhs.a2; ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+        b2 += rhs.b2; bc += rhs.bc; bd += rhs.bd;
+        c2 += rhs.c2; cd += rhs.cd;
+        d2 += rhs.d2;
+        weight += rhs.weight;
+        return *this;
+    }
+
+    /* The mean squared distance of p from the planes */
+    double error(const Vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+
+        double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+            + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+            + c2 * z * z + 2 * cd * z
+            + d2;
+
+        return (weight > 0) ? std::abs(e) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double error;
+
+    bool operator<(const Collapse& rhs) const {
+        return error < rhs.error;
+    }
+};
+
+uint64_t edge_key(uint32_t a, uint32_t b) {
+    if(a > b) {
+        std::swap(a, b);
+    }
+
+    return (uint64_t(a) << 32) | uint64_t(b);
+}
+
+Vec3 triangle_normal(const Vec3& a, const Vec3& b, const Vec3& c) {
+    return (b - a).cross(c - a);
+}
+
+}
+
+std::vector<uint32_t> simplify_triangles(
+    const std::vector<Vec3>& positions,
+    const std::vector<uint32_t>& indices,
+    std::size_t target_triangle_count,
+    float max_error,
+    std::vector<uint32_t>* groups,
+    float* result_error) {
+
+    const uint32_t vertex_count = positions.size();
+
+    std::vector<uint32_t> triangles(indices);
+    std::vector<uint32_t> triangle_groups;
+    if(groups) {
+        triangle_groups = *groups;
+    } else {
+        triangle_groups.assign(triangles.size() / 3, 0);
+    }
+
+    /* Weld vertices by position, so seams don't look like open edges. Each
+     * vertex maps to the first vertex with the same position */
+    std::vector<uint32_t> order(vertex_count);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&positions](uint32_t lhs, uint32_t rhs) {
+        auto& a = positions[lhs];
+        auto& b = positions[rhs];
+        if(a.x != b.x) return a.x < b.x;
+        if(a.y != b.y) return a.y < b.y;
+        if(a.z != b.z) return a.z < b.z;
+        return lhs < rhs;
+    });
+
+    std::vector<uint32_t> welded(vertex_count);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        bool same = i > 0 && positions[order[i]] == positions[order[i - 1]];
+        welded[order[i]] = same ? welded[order[i - 1]] : order[i];
+    }
+
+    std::vector<uint8_t> used(vertex_count, 0);
+    for(auto idx: triangles) {
+        used[idx] = 1;
+    }
+
+    /* Lock anything on a seam */
+    std::vector<uint8_t> locked(vertex_count, 0);
+    std::vector<uint32_t> users(vertex_count, 0);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        if(used[i]) {
+            ++users[welded[i]];
+        }
+    }
+
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        if(users[welded[i]] > 1) {
+            locked[welded[i]] = 1;
+        }
+    }
+
+    /* Lock anything on an open or non-manifold edge, or on the boundary
+     * between groups */
+    std::unordered_map<uint64_t, uint32_t> edges;
+    std::vector<uint32_t> vertex_group(vertex_count, std::numeric_limits<uint32_t>::max());
+
+    for(std::size_t t = 0; t < triangles.size() / 3; ++t) {
+        for(uint32_t j = 0; j < 3; ++j) {
+            auto a = welded[triangles[t * 3 + j]];
+            auto b = welded[triangles[t * 3 + (j + 1) % 3]];
+            ++edges[edge_key(a, b)];
+
+            auto& group = vertex_group[a];
+            if(group == std::numeric_limits<uint32_t>::max()) {
+                group = triangle_groups[t];
+            } else if(group != triangle_groups[t]) {
+                locked[a] = 1;
+            }
+        }
+    }
+
+    for(auto& edge: edges) {
+        if(edge.second != 2) {
+            locked[edge.first >> 32] = 1;
+            locked[edge.first & 0xFFFFFFFF] = 1;
+        }
+    }
+
+    /* Build the quadrics from the planes of the triangles around each position */
+    std::vector<Quadric> quadrics(vertex_count);
+    for(std::size_t t = 0; t < triangles.size() / 3; ++t) {
+        auto a = welded[triangles[t * 3]];
+        auto b = welded[triangles[t * 3 + 1]];
+        auto c = welded[triangles[t * 3 + 2]];
+
+        auto n = triangle_normal(positions[a], positions[b], positions[c]);
+        float length = n.length();
+        if(length == 0.0f) {
+            continue;
+        }
+
+        n /= length;
+        double d = -n.dot(positions[a]);
+        double area = double(length) * 0.5;
+
+        for(auto v: {a, b, c}) {
+            quadrics[v].add_plane(n.x, n.y, n.z, d, area);
+        }
+    }
+
+    const double max_error_sq = double(max_error) * double(max_error);
+    double largest_error = 0.0;
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<uint8_t> touched(vertex_count);
+    std::vector<uint32_t> adjacency_offsets;
+    std::vector<uint32_t> adjacency;
+
+    /* Each pass picks the cheapest collapses which don't overlap, applies
+     * them and then rebuilds everything for the next pass */
+    while(triangles.size() / 3 > target_triangle_count) {
+        const std::size_t triangle_count = triangles.size() / 3;
+
+        adjacency_offsets.assign(vertex_count + 1, 0);
+        for(auto idx: triangles) {
+            ++adjacency_offsets[idx + 1];
+        }
+
+        for(uint32_t i = 0; i < vertex_count; ++i) {
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        }
+
+        adjacency.resize(triangles.size());
+        {
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for(std::size_t i = 0; i < triangles.size(); ++i) {
+                adjacency[fill[triangles[i]]++] = i / 3;
+            }
+        }
+
+        collapses.clear();
+        for(std::size_t t = 0; t < triangle_count; ++t) {
+            for(uint32_t j = 0; j < 3; ++j) {
+                auto from = triangles[t * 3 + j];
+                auto to = triangles[t * 3 + (j + 1) % 3];
+
+                for(uint32_t k = 0; k < 2; ++k) {
+                    if(!locked[welded[from]] && welded[from] != welded[to]) {
+                        Quadric q = quadrics[welded[from]];
+                        q += quadrics[welded[to]];
+
+                        Collapse c;
+                        c.from = from;
+                        c.to = to;
+                        c.error = q.error(positions[to]);
+                        collapses.push_back(c);
+                    }
+
+                    std::swap(from, to);
+                }
+            }
+        }
+
+        if(collapses.empty()) {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end());
+
+        for(uint32_t i = 0; i < vertex_count; ++i) {
+            remap[i] = i;
+        }
+
+        std::fill(touched.begin(), touched.end(), 0);
+
+        std::size_t remaining = triangle_count;
+        std::size_t collapsed = 0;
+
+        for(auto& c: collapses) {
+            if(c.error > max_error_sq || remaining <= target_triangle_count) {
+                break;
+            }
+
+            if(touched[c.from] || touched[c.to]) {
+                continue;
+            }
+
+            auto to_position = welded[c.to];
+
+            /* Reject the collapse if it would flip any triangle that survives it */
+            bool flips = false;
+            std::size_t removed = 0;
+
+            for(auto i = adjacency_offsets[c.from]; i < adjacency_offsets[c.from + 1]; ++i) {
+                auto t = adjacency[i];
+                auto tri = &triangles[t * 3];
+
+                if(welded[tri[0]] == to_position || welded[tri[1]] == to_position || welded[tri[2]] == to_position) {
+                    ++removed;
+                    continue;
+                }
+
+                Vec3 before[3], after[3];
+                for(uint32_t j = 0; j < 3; ++j) {
+                    before[j] = positions[tri[j]];
+                    after[j] = (tri[j] == c.from) ? positions[c.to] : before[j];
+                }
+
+                auto n0 = triangle_normal(before[0], before[1], before[2]);
+                auto n1 = triangle_normal(after[0], after[1], after[2]);
+
+                if(n0.dot(n1) <= 0.0f) {
+                    flips = true;
+                    break;
+                }
+            }
+
+            if(flips) {
+                continue;
+            }
+
+            remap[c.from] = c.to;
+            quadrics[to_position] += quadrics[welded[c.from]];
+            touched[c.to] = 1;
+
+            for(auto i = adjacency_offsets[c.from]; i < adjacency_offsets[c.from + 1]; ++i) {
+                auto t = adjacency[i];
+                touched[triangles[t * 3]] = 1;
+                touched[triangles[t * 3 + 1]] = 1;
+                touched[triangles[t * 3 + 2]] = 1;
+            }
+
+            largest_error = std::max(largest_error, c.error);
+            remaining -= removed;
+            ++collapsed;
+        }
+
+        if(!collapsed) {
+            break;
+        }
+
+        /* Apply the collapses and drop the triangles that have been squashed flat */
+        std::size_t kept = 0;
+        for(std::size_t t = 0; t < triangle_count; ++t) {
+            auto a = remap[triangles[t * 3]];
+            auto b = remap[triangles[t * 3 + 1]];
+            auto c = remap[triangles[t * 3 + 2]];
+
+            if(welded[a] == welded[b] || welded[b] == welded[c] || welded[a] == welded[c]) {
+                continue;
+            }
+
+            triangles[kept * 3] = a;
+            triangles[kept * 3 + 1] = b;
+            triangles[kept * 3 + 2] = c;
+            triangle_groups[kept] = triangle_groups[t];
+            ++kept;
+        }
+
+        triangles.resize(kept * 3);
+        triangle_groups.resize(kept);
+    }
+
+    if(groups) {
+        *groups = triangle_groups;
+    }
+
+    if(result_error) {
+        *result_error = std::sqrt(largest_error);
+    }
+
+    return triangles;
+}
+
+}
+}
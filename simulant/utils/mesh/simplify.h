@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../../types.h"
+
+namespace smlt {
+namespace utils {
+
+/*
+ * Reduces a triangle list using quadric error edge collapses.
+ *
+ * Vertices are only ever collapsed onto one of their neighbours, so the
+ * result indexes into the same vertex data and no attributes need
+ * interpolating. Vertices which can't move without changing the look of
+ * the mesh are locked in place:
+ *
+ *  - vertices on an open edge, so that holes don't appear
+ *  - vertices sharing a position with another vertex, which is how UV and
+ *    normal seams are stored
+ *  - vertices used by triangles in more than one group (e.g. submeshes with
+ *    different materials), if groups are passed
+ *
+ * groups, if not null, holds a value per triangle and is updated to match the
+ * triangles returned. Stops once target_triangle_count is reached or there
+ * are no collapses left which move the surface less than max_error (in the
+ * units of the positions). If result_error is passed it's set to the largest
+ * error of the collapses made.
+ */
+std::vector<uint32_t> simplify_triangles(
+    const std::vector<Vec3>& positions,
+    const std::vector<uint32_t>& indices,
+    std::size_t target_triangle_count,
+    float max_error,
+    std::vector<uint32_t>* groups=nullptr,
+    float* result_error=nullptr
+);
+
+}
+}
@@ -4,6 +4,7 @@
 #include "../types.h"
 
 #include "noise.h"
+#include "noise_batch.h"
 
 #define PI 3.14159265358979323846f
 #define PIOver180  (PI / 180.0f)
@@ -90,6 +91,130 @@ double Perlin::noise(double x, double y, double z) const {
     return lerp(w, a, b);
 }
 
+void Perlin::sample_lanes(const float* x, const float* y, const float* z, float* out) const {
+    const uint32_t N = BATCH_LANES;
+
+    /* This is noise() a lane at a time. Only the permutation lookups have to be
+     * done one lane after another, everything else can be vectorized */
+    int32_t X[N], Y[N], Z[N];
+    float fx[N], fy[N], fz[N];
+    float u[N], v[N], w[N];
+
+    for(uint32_t l = 0; l < N; ++l) {
+        int32_t ix = int32_t(x[l]);
+        int32_t iy = int32_t(y[l]);
+        int32_t iz = int32_t(z[l]);
+
+        /* Truncation rounds negative numbers up, rather than calling floor() */
+        ix -= (float(ix) > x[l]);
+        iy -= (float(iy) > y[l]);
+        iz -= (float(iz) > z[l]);
+
+        X[l] = ix & 255;
+        Y[l] = iy & 255;
+        Z[l] = iz & 255;
+
+        fx[l] = x[l] - float(ix);
+        fy[l] = y[l] - float(iy);
+        fz[l] = z[l] - float(iz);
+
+        u[l] = fx[l] * fx[l] * fx[l] * (fx[l] * (fx[l] * 6.0f - 15.0f) + 10.0f);
+        v[l] = fy[l] * fy[l] * fy[l] * (fy[l] * (fy[l] * 6.0f - 15.0f) + 10.0f);
+        w[l] = fz[l] * fz[l] * fz[l] * (fz[l] * (fz[l] * 6.0f - 15.0f) + 10.0f);
+    }
+
+    /* The hashes of the corners of each lane's cell, corner c being at
+     * (c & 1, (c >> 1) & 1, c >> 2) */
+    int32_t H[8][N];
+
+    for(uint32_t l = 0; l < N; ++l) {
+        /* Neighbouring samples are usually in the same cell */
+        if(l && X[l] == X[l - 1] && Y[l] == Y[l - 1] && Z[l] == Z[l - 1]) {
+            for(uint32_t c = 0; c < 8; ++c) {
+                H[c][l] = H[c][l - 1];
+            }
+            continue;
+        }
+
+        const auto A = p[X[l]] + Y[l];
+        const auto AA = p[A] + Z[l];
+        const auto AB = p[A + 1] + Z[l];
+        const auto B = p[X[l] + 1] + Y[l];
+        const auto BA = p[B] + Z[l];
+        const auto BB = p[B + 1] + Z[l];
+
+        H[0][l] = p[AA];
+        H[1][l] = p[BA];
+        H[2][l] = p[AB];
+        H[3][l] = p[BB];
+        H[4][l] = p[AA + 1];
+        H[5][l] = p[BA + 1];
+        H[6][l] = p[AB + 1];
+        H[7][l] = p[BB + 1];
+    }
+
+    /* grad() for each corner */
+    float n[8][N];
+
+    for(uint32_t c = 0; c < 8; ++c) {
+        const float ox = float(c & 1);
+        const float oy = float((c >> 1) & 1);
+        const float oz = float(c >> 2);
+
+        for(uint32_t l = 0; l < N; ++l) {
+            const int32_t h = H[c][l] & 15;
+            const float dx = fx[l] - ox;
+            const float dy = fy[l] - oy;
+            const float dz = fz[l] - oz;
+
+            /* The gradient grad() uses, worked out without branches so that
+             * this vectorizes. u is x or y, v is x, y or z */
+            const int32_t su = 1 - ((h & 1) << 1);
+            const int32_t sv = 1 - (h & 2);
+            const int32_t uy = h >> 3;
+            const int32_t vy = h < 4;
+            const int32_t vx = (h == 12) | (h == 14);
+            const int32_t vz = 1 - vy - vx;
+
+            n[c][l] = float(su * (1 - uy) + sv * vx) * dx +
+                float(su * uy + sv * vy) * dy +
+                float(sv * vz) * dz;
+        }
+    }
+
+    for(uint32_t l = 0; l < N; ++l) {
+        const float a0 = n[0][l] + u[l] * (n[1][l] - n[0][l]);
+        const float a1 = n[2][l] + u[l] * (n[3][l] - n[2][l]);
+        const float b0 = n[4][l] + u[l] * (n[5][l] - n[4][l]);
+        const float b1 = n[6][l] + u[l] * (n[7][l] - n[6][l]);
+
+        const float a = a0 + v[l] * (a1 - a0);
+        const float b = b0 + v[l] * (b1 - b0);
+
+        out[l] = a + w[l] * (b - a);
+    }
+}
+
+void Perlin::fill(const Grid& grid, float* out, thread::ThreadPool* pool) const {
+    fill(grid, FBm(), out, pool);
+}
+
+void Perlin::fill(const Grid& grid, const FBm& fbm, float* out, thread::ThreadPool* pool) const {
+    impl::fill_grid([this](const float* x, const float* y, const float* z, float* out) {
+        sample_lanes(x, y, z, out);
+    }, grid, fbm, out, pool);
+}
+
+void Perlin::fill(const float* x, const float* y, const float* z, std::size_t count, float* out, thread::ThreadPool* pool) const {
+    fill(x, y, z, count, FBm(), out, pool);
+}
+
+void Perlin::fill(const float* x, const float* y, const float* z, std::size_t count, const FBm& fbm, float* out, thread::ThreadPool* pool) const {
+    impl::fill_points([this](const float* x, const float* y, const float* z, float* out) {
+        sample_lanes(x, y, z, out);
+    }, x, y, z, count, fbm, out, pool);
+}
+
 PerlinOctave::PerlinOctave(int octaves, uint32_t seed):
     perlin_(seed),
     octaves_(octaves) {
@@ -112,5 +237,13 @@ double PerlinOctave::noise(double x, double y, double z) const {
     return result;
 }
 
+void PerlinOctave::fill(const Grid& grid, float* out, thread::ThreadPool* pool) const {
+    perlin_.fill(grid, FBm(octaves_), out, pool);
+}
+
+void PerlinOctave::fill(const float* x, const float* y, const float* z, std::size_t count, float* out, thread::ThreadPool* pool) const {
+    perlin_.fill(x, y, z, count, FBm(octaves_), out, pool);
+}
+
 }
 }
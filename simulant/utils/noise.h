@@ -3,11 +3,57 @@
 
 #include <random>
 #include <array>
+#include "../math/vec3.h"
 #include "../math/quaternion.h"
 
 namespace smlt {
+
+namespace thread {
+class ThreadPool;
+}
+
 namespace noise {
 
+/*
+ * The batch functions (fill()) work on this many samples at a time, in
+ * single precision, so the compiler can keep them in SIMD registers.
+ */
+const uint32_t BATCH_LANES = 8;
+
+/*
+ * A grid of sample points. Point (i, j, k) is at origin + (i * step.x,
+ * j * step.y, k * step.z), and the samples are stored with i changing
+ * fastest, then j, then k.
+ */
+struct Grid {
+    Grid() = default;
+    Grid(const Vec3& origin, const Vec3& step, uint32_t width, uint32_t height, uint32_t depth=1):
+        origin(origin), step(step), width(width), height(height), depth(depth) {}
+
+    Vec3 origin;
+    Vec3 step = Vec3(1, 1, 1);
+
+    uint32_t width = 1;
+    uint32_t height = 1;
+    uint32_t depth = 1;
+
+    std::size_t size() const { return std::size_t(width) * height * depth; }
+};
+
+/*
+ * Fractal Brownian motion: the sum of octaves of noise, octave n sampled at
+ * lacunarity^n times the frequency and gain^n times the amplitude of the
+ * first. The defaults are what PerlinOctave uses.
+ */
+struct FBm {
+    FBm(uint32_t octaves=1, float lacunarity=2.0f, float gain=0.5f):
+        octaves(octaves), lacunarity(lacunarity), gain(gain) {}
+
+    uint32_t octaves;
+    float lacunarity;
+    float gain;
+};
+
 class Perlin {
 public:
     Perlin(uint32_t seed=0);
@@ -28,7 +74,21 @@ public:
         return (noise(x, y, z) + 1.0) * 0.5;
     }
 
+    /*
+     * Fills out with the noise at each point of grid, or at each of the count
+     * points (x[i], y[i], z[i]); z can be null for 2D noise. These work in single
+     * precision, and agree with noise() to within about 1e-5 for coordinates
+     * up to a few hundred. If a pool is passed the work is split across its
+     * workers.
+     */
+    void fill(const Grid& grid, float* out, thread::ThreadPool* pool=nullptr) const;
+    void fill(const Grid& grid, const FBm& fbm, float* out, thread::ThreadPool* pool=nullptr) const;
+    void fill(const float* x, const float* y, const float* z, std::size_t count, float* out, thread::ThreadPool* pool=nullptr) const;
+    void fill(const float* x, const float* y, const float* z, std::size_t count, const FBm& fbm, float* out, thread::ThreadPool* pool=nullptr) const;
+
 private:
+    void sample_lanes(const float* x, const float* y, const float* z, float* out) const;
+
     std::array<int, 512> p;
     Quaternion rotation_;
 };
@@ -53,6 +113,10 @@ public:
         return (noise(x, y, z) + 1.0) * 0.5;
     }
 
+    /* Batch versions of noise(), see Perlin::fill() */
+    void fill(const Grid& grid, float* out, thread::ThreadPool* pool=nullptr) const;
+    void fill(const float* x, const float* y, const float* z, std::size_t count, float* out, thread::ThreadPool* pool=nullptr) const;
+
 private:
     Perlin perlin_;
     int octaves_;
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+
+#include "../threads/thread_pool.h"
+#include "noise.h"
+
+namespace smlt {
+namespace noise {
+
+/*
+ * The loops behind the fill() functions of the noise generators. They're
+ * templates on the kernel, which samples BATCH_LANES points reading from x, y
+ * and z and writing to out, so that it can be inlined into them.
+ */
+namespace impl {
+
+/* Roughly how many samples are worth handing to a worker */
+const std::size_t MIN_SAMPLES_PER_TASK = 4096;
+
+/* Runs the kernel over n (<= BATCH_LANES) points, summing the octaves into out */
+template<typename Kernel>
+void sample_octaves(const Kernel& kernel, const float* x, const float* y, const float* z, uint32_t n, const FBm& fbm, float* out) {
+    if(fbm.octaves == 1 && n == BATCH_LANES) {
+        /* The usual case, there's nothing to scale or sum */
+        kernel(x, y, z, out);
+        return;
+    }
+
+    alignas(32) float sx[BATCH_LANES];
+    alignas(32) float sy[BATCH_LANES];
+    alignas(32) float sz[BATCH_LANES];
+    alignas(32) float result[BATCH_LANES];
+    alignas(32) float total[BATCH_LANES] = {0};
+
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+
+    for(uint32_t octave = 0; octave < fbm.octaves; ++octave) {
+        for(uint32_t l = 0; l < BATCH_LANES; ++l) {
+            sx[l] = x[l] * frequency;
+            sy[l] = y[l] * frequency;
+            sz[l] = z[l] * frequency;
+        }
+
+        kernel(sx, sy, sz, result);
+
+        for(uint32_t l = 0; l < BATCH_LANES; ++l) {
+            total[l] += result[l] * amplitude;
+        }
+
+        frequency *= fbm.lacunarity;
+        amplitude *= fbm.gain;
+    }
+
+    std::copy(total, total + n, out);
+}
+
+template<typename Kernel>
+void fill_grid(const Kernel& kernel, const Grid& grid, const FBm& fbm, float* out, thread::ThreadPool* pool) {
+    const std::size_t width = grid.width;
+    const std::size_t rows = std::size_t(grid.height) * grid.depth;
+
+    auto fill_rows = [&](std::size_t begin, std::size_t end) {
+        alignas(32) float x[BATCH_LANES];
+        alignas(32) float y[BATCH_LANES];
+        alignas(32) float z[BATCH_LANES];
+
+        for(auto row = begin; row < end; ++row) {
+            auto j = row % grid.height;
+            auto k = row / grid.height;
+
+            std::fill(y, y + BATCH_LANES, grid.origin.y + float(j) * grid.step.y);
+            std::fill(z, z + BATCH_LANES, grid.origin.z + float(k) * grid.step.z);
+
+            float* row_out = out + (row * width);
+            for(std::size_t i = 0; i < width; i += BATCH_LANES) {
+                uint32_t n = std::min<std::size_t>(BATCH_LANES, width - i);
+
+                /* The lanes past the end of the row carry on along it, and are thrown away */
+                for(uint32_t l = 0; l < BATCH_LANES; ++l) {
+                    x[l] = grid.origin.x + float(i + l) * grid.step.x;
+                }
+
+                sample_octaves(kernel, x, y, z, n, fbm, row_out + i);
+            }
+        }
+    };
+
+    if(pool) {
+        pool->parallel_for(rows, std::max<std::size_t>(1, MIN_SAMPLES_PER_TASK / std::max<std::size_t>(1, width)), fill_rows);
+    } else {
+        fill_rows(0, rows);
+    }
+}
+
+template<typename Kernel>
+void fill_points(const Kernel& kernel, const float* x, const float* y, const float* z, std::size_t count, const FBm& fbm, float* out, thread::ThreadPool* pool) {
+    auto fill_range = [&](std::size_t begin, std::size_t end) {
+        alignas(32) float bx[BATCH_LANES] = {0};
+        alignas(32) float by[BATCH_LANES] = {0};
+        alignas(32) float bz[BATCH_LANES] = {0};
+
+        for(auto i = begin; i < end; i += BATCH_LANES) {
+            uint32_t n = std::min<std::size_t>(BATCH_LANES, end - i);
+
+            std::copy(x + i, x + i + n, bx);
+            std::copy(y + i, y + i + n, by);
+            if(z) {
+                std::copy(z + i, z + i + n, bz);
+            }
+
+            sample_octaves(kernel, bx, by, bz, n, fbm, out + i);
+        }
+    };
+
+    if(pool) {
+        pool->parallel_for(count, MIN_SAMPLES_PER_TASK, fill_range);
+    } else {
+        fill_range(0, count);
+    }
+}
+
+}
+
+}
+}
@@ -19,7 +19,9 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
 #include "simplex.h"
+#include "noise_batch.h"
 #include "../math/utils.h"
 
 namespace smlt {
@@ -230,4 +232,205 @@ float Simplex::noise(double x, double y, double z, double w) {
     return 27.0f * (float)(n0 + n1 + n2 + n3 + n4);
 }
 
+/*
+ * Finds the simplex that (x, y, z, 0) is in, the same way as noise(). cell is
+ * the skewed cell, offset is the distance from the cell's origin and rank is
+ * what simplex[c] gives: the rank of each coordinate of offset, from 0 for the
+ * smallest to 3 for the largest.
+ *
+ * Returns true if the point is within margin of the edge of the simplex.
+ */
+template<typename T>
+static bool locate_simplex(T x, T y, T z, T margin, int32_t* cell, int32_t* rank, T* offset) {
+    const T F4 = (std::sqrt(T(5)) - T(1)) / T(4);
+    const T G4 = (T(5) - std::sqrt(T(5))) / T(20);
+
+    const T s = (x + y + z) * F4;
+    const T xs = x + s;
+    const T ys = y + s;
+    const T zs = z + s;
+
+    /* fastfloor(), which rounds whole numbers <= 0 down too */
+    cell[0] = int32_t(xs) - !(xs > T(0));
+    cell[1] = int32_t(ys) - !(ys > T(0));
+    cell[2] = int32_t(zs) - !(zs > T(0));
+    cell[3] = int32_t(s) - !(s > T(0));
+
+    const T fx = xs - T(cell[0]);
+    const T fy = ys - T(cell[1]);
+    const T fz = zs - T(cell[2]);
+    const T fw = s - T(cell[3]);
+
+    int32_t near = (fx < margin) | (fx > T(1) - margin) | (fy < margin) | (fy > T(1) - margin) |
+        (fz < margin) | (fz > T(1) - margin) | (fw < margin) | (fw > T(1) - margin);
+
+    const T t = T(cell[0] + cell[1] + cell[2] + cell[3]) * G4;
+
+    offset[0] = x - (T(cell[0]) - t);
+    offset[1] = y - (T(cell[1]) - t);
+    offset[2] = z - (T(cell[2]) - t);
+    offset[3] = -(T(cell[3]) - t);
+
+    const int32_t xy = offset[0] > offset[1];
+    const int32_t xz = offset[0] > offset[2];
+    const int32_t yz = offset[1] > offset[2];
+    const int32_t xw = offset[0] > offset[3];
+    const int32_t yw = offset[1] > offset[3];
+    const int32_t zw = offset[2] > offset[3];
+
+    rank[0] = xy + xz + xw;
+    rank[1] = (1 - xy) + yz + yw;
+    rank[2] = (1 - xz) + (1 - yz) + zw;
+    rank[3] = (1 - xw) + (1 - yw) + (1 - zw);
+
+    auto close = [margin](T a, T b) -> int32_t {
+        return std::fabs(a - b) < margin;
+    };
+
+    /* When z is zero (2D noise) the z and w offsets are exactly equal in
+     * any precision, so that tie doesn't count */
+    near |= close(offset[0], offset[1]) | close(offset[0], offset[2]) | close(offset[1], offset[2]) |
+        close(offset[0], offset[3]) | close(offset[1], offset[3]) | (close(offset[2], offset[3]) & (z != T(0)));
+
+    return near;
+}
+
+void Simplex::sample_lanes(const float* x, const float* y, const float* z, float* out) const {
+    const uint32_t N = noise::BATCH_LANES;
+
+    /* This is noise(x, y, z, 0) a lane at a time, see there for how it works */
+    const float G4 = (5.0f - std::sqrt(5.0f)) / 20.0f;
+
+    /* The simplices don't quite line up at their edges, so a sample which
+     * single precision puts on the wrong side of one can be out by 1e-3. Those
+     * within this distance are placed again in double precision */
+    const float EDGE_MARGIN = 1e-3f;
+
+    int32_t C[4][N];
+    int32_t R[4][N];
+    float D[4][N];
+    int32_t near[N];
+
+    for(uint32_t l = 0; l < N; ++l) {
+        int32_t cell[4], rank[4];
+        float offset[4];
+
+        near[l] = locate_simplex(x[l], y[l], z[l], EDGE_MARGIN, cell, rank, offset);
+
+        C[0][l] = cell[0]; C[1][l] = cell[1]; C[2][l] = cell[2]; C[3][l] = cell[3];
+        R[0][l] = rank[0]; R[1][l] = rank[1]; R[2][l] = rank[2]; R[3][l] = rank[3];
+        D[0][l] = offset[0]; D[1][l] = offset[1]; D[2][l] = offset[2]; D[3][l] = offset[3];
+    }
+
+    /* The gradient index of each of the five corners. Corner c is offset by one
+     * along the c largest coordinates. This is the only part which can't be
+     * vectorized */
+    int32_t G[5][N];
+
+    for(uint32_t l = 0; l < N; ++l) {
+        if(near[l]) {
+            int32_t cell[4], rank[4];
+            double offset[4];
+
+            locate_simplex<double>(x[l], y[l], z[l], 0.0, cell, rank, offset);
+
+            for(uint32_t a = 0; a < 4; ++a) {
+                C[a][l] = cell[a];
+                R[a][l] = rank[a];
+                D[a][l] = float(offset[a]);
+            }
+        }
+
+        /* Neighbouring samples are usually in the same simplex. The fourth rank
+         * is whatever the other three leave, so it needn't be compared */
+        if(l && C[0][l] == C[0][l - 1] && C[1][l] == C[1][l - 1] && C[2][l] == C[2][l - 1] &&
+            C[3][l] == C[3][l - 1] && R[0][l] == R[0][l - 1] && R[1][l] == R[1][l - 1] &&
+            R[2][l] == R[2][l - 1]) {
+
+            for(uint32_t c = 0; c < 5; ++c) {
+                G[c][l] = G[c][l - 1];
+            }
+            continue;
+        }
+
+        int ii = C[0][l] & 255;
+        int jj = C[1][l] & 255;
+        int kk = C[2][l] & 255;
+        int ll = C[3][l] & 255;
+
+        for(int32_t c = 0; c < 5; ++c) {
+            /* Ranks are 0 to 3, so this is 1 when rank >= 4 - c */
+            int i1 = (R[0][l] + c) >> 2;
+            int j1 = (R[1][l] + c) >> 2;
+            int k1 = (R[2][l] + c) >> 2;
+            int l1 = (R[3][l] + c) >> 2;
+
+            G[c][l] = perm[ii + i1 + perm[jj + j1 + perm[kk + k1 + perm[ll + l1]]]] % 32;
+        }
+    }
+
+    float total[N] = {0};
+
+    for(int32_t c = 0; c < 5; ++c) {
+        const float skew = float(c) * G4;
+
+        for(uint32_t l = 0; l < N; ++l) {
+            const float dx = D[0][l] - float((R[0][l] + c) >> 2) + skew;
+            const float dy = D[1][l] - float((R[1][l] + c) >> 2) + skew;
+            const float dz = D[2][l] - float((R[2][l] + c) >> 2) + skew;
+            const float dw = D[3][l] - float((R[3][l] + c) >> 2) + skew;
+
+            /* grad4[gi] without the lookup. Every eighth entry has a zero in the
+             * same place, and the low three bits give the signs of the others */
+            const int32_t gi = G[c][l];
+            const int32_t e0 = int32_t((gi >> 3) == 0);
+            const int32_t e1 = int32_t((gi >> 3) == 1);
+            const int32_t e3 = int32_t((gi >> 3) == 3);
+            const int32_t s2 = 1 - ((gi >> 1) & 2);
+            const int32_t s1 = 1 - (gi & 2);
+            const int32_t s0 = 1 - ((gi & 1) << 1);
+
+            const float gx = float((1 - e0) * s2);
+            const float gy = float(e0 * s2 + (1 - e0 - e1) * s1);
+            const float gz = float((e0 + e1) * s1 + e3 * s0);
+            const float gw = float((1 - e3) * s0);
+
+            /* max(t, 0), written so that it vectorizes */
+            float t = 0.6f - dx * dx - dy * dy - dz * dz - dw * dw;
+            t = 0.5f * (t + std::fabs(t));
+            t *= t;
+
+            total[l] += t * t * (gx * dx + gy * dy + gz * dz + gw * dw);
+        }
+    }
+
+    for(uint32_t l = 0; l < N; ++l) {
+        out[l] = 27.0f * total[l];
+    }
+}
+
+void Simplex::fill(const noise::Grid& grid, float* out, thread::ThreadPool* pool) {
+    fill(grid, noise::FBm(), out, pool);
+}
+
+void Simplex::fill(const noise::Grid& grid, const noise::FBm& fbm, float* out, thread::ThreadPool* pool) {
+    init();
+
+    noise::impl::fill_grid([this](const float* x, const float* y, const float* z, float* out) {
+        sample_lanes(x, y, z, out);
+    }, grid, fbm, out, pool);
+}
+
+void Simplex::fill(const float* x, const float* y, const float* z, std::size_t count, float* out, thread::ThreadPool* pool) {
+    fill(x, y, z, count, noise::FBm(), out, pool);
+}
+
+void Simplex::fill(const float* x, const float* y, const float* z, std::size_t count, const noise::FBm& fbm, float* out, thread::ThreadPool* pool) {
+    init();
+
+    noise::impl::fill_points([this](const float* x, const float* y, const float* z, float* out) {
+        sample_lanes(x, y, z, out);
+    }, x, y, z, count, fbm, out, pool);
+}
+
 }
@@ -21,6 +21,7 @@
 #include <vector>
 #include <ctime>
 #include "../generic/managed.h"
+#include "noise.h"
 
 namespace smlt {
 
@@ -35,7 +36,18 @@ public:
     float noise(double x, double y, double z);
     float noise(double x, double y, double z, double w);
 
+    /* Batch versions of noise(x, y, z), with z as zero if it's null. See
+     * noise::Perlin::fill(), although these are only as accurate as single
+     * precision allows, about 1e-5 near the origin and 2e-4 a few hundred
+     * units out */
+    void fill(const noise::Grid& grid, float* out, thread::ThreadPool* pool=nullptr);
+    void fill(const noise::Grid& grid, const noise::FBm& fbm, float* out, thread::ThreadPool* pool=nullptr);
+    void fill(const float* x, const float* y, const float* z, std::size_t count, float* out, thread::ThreadPool* pool=nullptr);
+    void fill(const float* x, const float* y, const float* z, std::size_t count, const noise::FBm& fbm, float* out, thread::ThreadPool* pool=nullptr);
+
 private:
+    void sample_lanes(const float* x, const float* y, const float* z, float* out) const;
+
     std::vector<int> p;
 
     const int simplex[64][4] = {
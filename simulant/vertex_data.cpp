@@ -17,6 +17,8 @@
 //     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include "vertex_data.h"
 #include "window.h"
@@ -61,6 +63,213 @@ _S_FORCE_INLINE Vec3 unpack_vertex_attribute_vec3_1i(uint32_t p) {
     return ret;
 }
 
+uint16_t float_to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(float));
+
+    const uint16_t sign = (x >> 16) & 0x8000;
+    const int32_t exponent = int32_t((x >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = x & 0x7FFFFF;
+
+    if(((x >> 23) & 0xFF) == 0xFF) {
+        /* Infinity and NaN */
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    } else if(exponent >= 31) {
+        /* Too large, becomes infinity */
+        return sign | 0x7C00;
+    } else if(exponent <= 0) {
+        /* Too small for a normal half, so denormalize it (or flush to zero) */
+        if(exponent < -10) {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        const uint32_t shift = 14 - exponent;
+        uint16_t half = mantissa >> shift;
+        if((mantissa >> (shift - 1)) & 1) {
+            ++half;
+        }
+
+        return sign | half;
+    }
+
+    uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+
+    /* Round to nearest, a carry into the exponent is still correct */
+    if(mantissa & 0x1000) {
+        ++half;
+    }
+
+    return half;
+}
+
+float half_to_float(uint16_t h) {
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+
+    uint32_t x;
+    if(exponent == 0) {
+        if(!mantissa) {
+            x = sign;
+        } else {
+            /* Denormalized, shift it up until it's a normal float */
+            exponent = 127 - 15 + 1;
+            while(!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+
+            x = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+    } else if(exponent == 31) {
+        x = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float f;
+    std::memcpy(&f, &x, sizeof(float));
+    return f;
+}
+
+namespace {
+
+/* Reads an attribute in any format as floats. Missing components are zero apart
+ * from w, which is defw. Bytes colours are stored BGRA, so are swapped if bgra is set */
+Vec4 read_attribute(VertexAttribute attr, const uint8_t* ptr, float defw, bool bgra) {
+    Vec4 ret(0, 0, 0, defw);
+
+    switch(attr) {
+        case VERTEX_ATTRIBUTE_2F:
+            ret.x = ((const float*) ptr)[0];
+            ret.y = ((const float*) ptr)[1];
+        break;
+        case VERTEX_ATTRIBUTE_3F:
+            ret = Vec4(*((const Vec3*) ptr), defw);
+        break;
+        case VERTEX_ATTRIBUTE_4F:
+            ret = *((const Vec4*) ptr);
+        break;
+        case VERTEX_ATTRIBUTE_4UB:
+            ret = Vec4(ptr[0] / 255.0f, ptr[1] / 255.0f, ptr[2] / 255.0f, ptr[3] / 255.0f);
+            if(bgra) {
+                std::swap(ret.x, ret.z);
+            }
+        break;
+        case VERTEX_ATTRIBUTE_PACKED_VEC4_1I: {
+            uint32_t packed;
+            std::memcpy(&packed, ptr, sizeof(uint32_t));
+            auto v = unpack_vertex_attribute_vec3_1i(packed);
+            ret = Vec4(v, defw);
+        } break;
+        case VERTEX_ATTRIBUTE_2H:
+        case VERTEX_ATTRIBUTE_4H: {
+            uint16_t h[4];
+            const uint32_t count = (attr == VERTEX_ATTRIBUTE_2H) ? 2 : 4;
+            std::memcpy(h, ptr, sizeof(uint16_t) * count);
+
+            ret.x = half_to_float(h[0]);
+            ret.y = half_to_float(h[1]);
+            if(count == 4) {
+                ret.z = half_to_float(h[2]);
+                ret.w = half_to_float(h[3]);
+            }
+        } break;
+        case VERTEX_ATTRIBUTE_4B: {
+            const int8_t* b = (const int8_t*) ptr;
+            ret.x = std::max(b[0] / 127.0f, -1.0f);
+            ret.y = std::max(b[1] / 127.0f, -1.0f);
+            ret.z = std::max(b[2] / 127.0f, -1.0f);
+        } break;
+        case VERTEX_ATTRIBUTE_2US: {
+            uint16_t s[2];
+            std::memcpy(s, ptr, sizeof(uint16_t) * 2);
+            ret.x = s[0] / 65535.0f;
+            ret.y = s[1] / 65535.0f;
+        } break;
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+void write_attribute(VertexAttribute attr, uint8_t* ptr, const Vec4& v, bool bgra) {
+    switch(attr) {
+        case VERTEX_ATTRIBUTE_2F:
+            std::memcpy(ptr, &v, sizeof(float) * 2);
+        break;
+        case VERTEX_ATTRIBUTE_3F:
+            std::memcpy(ptr, &v, sizeof(float) * 3);
+        break;
+        case VERTEX_ATTRIBUTE_4F:
+            std::memcpy(ptr, &v, sizeof(float) * 4);
+        break;
+        case VERTEX_ATTRIBUTE_4UB:
+            ptr[0] = (uint8_t) clamp(((bgra) ? v.z : v.x) * 255.0f, 0, 255);
+            ptr[1] = (uint8_t) clamp(v.y * 255.0f, 0, 255);
+            ptr[2] = (uint8_t) clamp(((bgra) ? v.x : v.z) * 255.0f, 0, 255);
+            ptr[3] = (uint8_t) clamp(v.w * 255.0f, 0, 255);
+        break;
+        case VERTEX_ATTRIBUTE_PACKED_VEC4_1I: {
+            uint32_t packed = pack_vertex_attribute_vec3_1i(v.x, v.y, v.z);
+            std::memcpy(ptr, &packed, sizeof(uint32_t));
+        } break;
+        case VERTEX_ATTRIBUTE_2H:
+        case VERTEX_ATTRIBUTE_4H: {
+            uint16_t h[4] = {
+                float_to_half(v.x), float_to_half(v.y),
+                float_to_half(v.z), float_to_half(v.w)
+            };
+
+            const uint32_t count = (attr == VERTEX_ATTRIBUTE_2H) ? 2 : 4;
+            std::memcpy(ptr, h, sizeof(uint16_t) * count);
+        } break;
+        case VERTEX_ATTRIBUTE_4B: {
+            int8_t* b = (int8_t*) ptr;
+            b[0] = (int8_t) std::round(clamp(v.x, -1.0f, 1.0f) * 127.0f);
+            b[1] = (int8_t) std::round(clamp(v.y, -1.0f, 1.0f) * 127.0f);
+            b[2] = (int8_t) std::round(clamp(v.z, -1.0f, 1.0f) * 127.0f);
+            b[3] = 0;
+        } break;
+        case VERTEX_ATTRIBUTE_2US: {
+            uint16_t s[2] = {
+                (uint16_t) std::round(clamp(v.x, 0.0f, 1.0f) * 65535.0f),
+                (uint16_t) std::round(clamp(v.y, 0.0f, 1.0f) * 65535.0f)
+            };
+            std::memcpy(ptr, s, sizeof(uint16_t) * 2);
+        } break;
+        default:
+            break;
+    }
+}
+
+AttributeOffset offset_for_type(VertexAttributeType type, const VertexSpecification& spec) {
+    switch(type) {
+        case VERTEX_ATTRIBUTE_TYPE_POSITION: return spec.position_offset();
+        case VERTEX_ATTRIBUTE_TYPE_NORMAL: return spec.normal_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD0: return spec.texcoord0_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD1: return spec.texcoord1_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD2: return spec.texcoord2_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD3: return spec.texcoord3_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD4: return spec.texcoord4_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD5: return spec.texcoord5_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD6: return spec.texcoord6_offset();
+        case VERTEX_ATTRIBUTE_TYPE_TEXCOORD7: return spec.texcoord7_offset();
+        case VERTEX_ATTRIBUTE_TYPE_DIFFUSE: return spec.diffuse_offset();
+        case VERTEX_ATTRIBUTE_TYPE_SPECULAR: return spec.specular_offset();
+    default:
+        return INVALID_ATTRIBUTE_OFFSET;
+    }
+}
+
+bool is_colour(VertexAttributeType type) {
+    return type == VERTEX_ATTRIBUTE_TYPE_DIFFUSE || type == VERTEX_ATTRIBUTE_TYPE_SPECULAR;
+}
+
+}
+
 const VertexSpecification VertexSpecification::DEFAULT = VertexSpecification{
     VERTEX_ATTRIBUTE_3F,  // Position
 #ifdef _arch_dreamcast
@@ -82,6 +291,28 @@ const VertexSpecification VertexSpecification::DEFAULT = VertexSpecification{
     VERTEX_ATTRIBUTE_NONE
 };
 
+const VertexSpecification VertexSpecification::COMPACT = VertexSpecification{
+    VERTEX_ATTRIBUTE_3F, // Position
+#ifdef _arch_dreamcast
+    /* No half float vertex support on the Dreamcast, so only the
+     * normals shrink there */
+    VERTEX_ATTRIBUTE_PACKED_VEC4_1I, // Normal
+    VERTEX_ATTRIBUTE_2F, // UV
+#else
+    VERTEX_ATTRIBUTE_4B, // Normal
+    VERTEX_ATTRIBUTE_2H, // UV
+#endif
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_NONE,
+    VERTEX_ATTRIBUTE_4UB, // Diffuse
+    VERTEX_ATTRIBUTE_NONE
+};
+
 const VertexSpecification VertexSpecification::POSITION_ONLY = VertexSpecification{
     VERTEX_ATTRIBUTE_3F
 };
@@ -151,6 +382,11 @@ void VertexData::position_checks() {
 void VertexData::position(float x, float y, float z, float w) {
     position_checks();
 
+    if(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_4H) {
+        write_attribute(VERTEX_ATTRIBUTE_4H, &data_[cursor_offset()], Vec4(x, y, z, w), false);
+        return;
+    }
+
     assert(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_4F);
     Vec4* out = (Vec4*) &data_[cursor_offset()];
     *out = Vec4(x, y, z, w);
@@ -159,6 +395,11 @@ void VertexData::position(float x, float y, float z, float w) {
 void VertexData::position(float x, float y, float z) {
     position_checks();
 
+    if(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_4H) {
+        write_attribute(VERTEX_ATTRIBUTE_4H, &data_[cursor_offset()], Vec4(x, y, z, 1.0f), false);
+        return;
+    }
+
     assert(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_3F);
     Vec3* out = (Vec3*) &data_[cursor_offset()];
     *out = Vec3(x, y, z);
@@ -167,6 +408,11 @@ void VertexData::position(float x, float y, float z) {
 void VertexData::position(float x, float y) {
     position_checks();
 
+    if(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_2H) {
+        write_attribute(VERTEX_ATTRIBUTE_2H, &data_[cursor_offset()], Vec4(x, y, 0.0f, 1.0f), false);
+        return;
+    }
+
     assert(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_2F);
     Vec2* out = (Vec2*) &data_[cursor_offset()];
     *out = Vec2(x, y);
@@ -214,6 +460,11 @@ const Vec3* VertexData::normal_at<Vec3>(uint32_t idx) const {
 
     if(vertex_specification_.normal_attribute == VERTEX_ATTRIBUTE_3F) {
         return ((Vec3*) &data_[(idx * stride()) + vertex_specification_.normal_offset()]);
+    } else if(vertex_specification_.normal_attribute == VERTEX_ATTRIBUTE_4B) {
+        static Vec3 ret; // Same problem as below
+        auto n = read_attribute(VERTEX_ATTRIBUTE_4B, &data_[(idx * stride()) + vertex_specification_.normal_offset()], 0.0f, false);
+        ret = Vec3(n.x, n.y, n.z);
+        return &ret;
     } else {
         assert(vertex_specification_.normal_attribute == VERTEX_ATTRIBUTE_PACKED_VEC4_1I);
 
@@ -232,11 +483,28 @@ Vec4 VertexData::position_nd_at(uint32_t idx, float defz, float defw) const {
     } else if(attr == VERTEX_ATTRIBUTE_3F) {
         auto v = *position_at<Vec3>(idx);
         return Vec4(v.x, v.y, v.z, defw);
+    } else if(attr == VERTEX_ATTRIBUTE_2H) {
+        auto v = read_attribute(attr, &data_[idx * stride()], defw, false);
+        return Vec4(v.x, v.y, defz, defw);
+    } else if(attr == VERTEX_ATTRIBUTE_4H) {
+        return read_attribute(attr, &data_[idx * stride()], defw, false);
     } else {
         return *position_at<Vec4>(idx);
     }
 }
 
+Vec4 VertexData::attribute_nd_at(VertexAttributeType type, uint32_t idx) const {
+    auto attr = smlt::attribute_for_type(type, vertex_specification_);
+    auto offset = offset_for_type(type, vertex_specification_);
+    float defw = (type == VERTEX_ATTRIBUTE_TYPE_NORMAL) ? 0.0f : 1.0f;
+
+    if(offset == INVALID_ATTRIBUTE_OFFSET) {
+        return Vec4(0, 0, 0, defw);
+    }
+
+    return read_attribute(attr, &data_[(idx * stride()) + offset], defw, is_colour(type));
+}
+
 void VertexData::normal(float x, float y, float z) {
     auto offset = vertex_specification_.normal_offset();
 
@@ -249,6 +517,8 @@ void VertexData::normal(float x, float y, float z) {
     if(vertex_specification_.normal_attribute == VERTEX_ATTRIBUTE_3F) {
         Vec3* out = (Vec3*) ptr;
         *out = Vec3(x, y, z);
+    } else if(vertex_specification_.normal_attribute == VERTEX_ATTRIBUTE_4B) {
+        write_attribute(VERTEX_ATTRIBUTE_4B, ptr, Vec4(x, y, z, 0.0f), false);
     } else  {
         assert(vertex_specification_.normal_attribute == VERTEX_ATTRIBUTE_PACKED_VEC4_1I);
         uint32_t* packed = (uint32_t*) ptr;
@@ -267,6 +537,13 @@ void VertexData::tex_coordX(uint8_t which, float u, float v) {
         return;
     }
 
+    auto attr = vertex_specification_.texcoordX_attribute(which);
+    if(attr != VERTEX_ATTRIBUTE_2F) {
+        /* One of the compact formats */
+        write_attribute(attr, &data_[cursor_offset() + offset], Vec4(u, v, 0.0f, 1.0f), false);
+        return;
+    }
+
     Vec2* out = (Vec2*) &data_[cursor_offset() + offset];
     *out = Vec2(u, v);
 }
@@ -278,6 +555,11 @@ void VertexData::tex_coordX(uint8_t which, float u, float v, float w) {
         return;
     }
 
+    if(vertex_specification_.texcoordX_attribute(which) == VERTEX_ATTRIBUTE_4H) {
+        write_attribute(VERTEX_ATTRIBUTE_4H, &data_[cursor_offset() + offset], Vec4(u, v, w, 1.0f), false);
+        return;
+    }
+
     Vec3* out = (Vec3*) &data_[cursor_offset() + offset];
     *out = Vec3(u, v, w);
 }
@@ -289,6 +571,11 @@ void VertexData::tex_coordX(uint8_t which, float u, float v, float w, float x) {
         return;
     }
 
+    if(vertex_specification_.texcoordX_attribute(which) == VERTEX_ATTRIBUTE_4H) {
+        write_attribute(VERTEX_ATTRIBUTE_4H, &data_[cursor_offset() + offset], Vec4(u, v, w, x), false);
+        return;
+    }
+
     Vec4* out = (Vec4*) &data_[cursor_offset() + offset];
     *out = Vec4(u, v, w, x);
 }
@@ -516,6 +803,20 @@ void VertexData::interp_vertex(uint32_t source_idx, const VertexData &dest_state
             out.position(final);
         }
         break;
+        case VERTEX_ATTRIBUTE_2H: {
+            auto source = position_nd_at(source_idx);
+            auto dest = dest_state.position_nd_at(dest_idx);
+            Vec4 final = source + ((dest - source) * interp);
+            out.position(final.x, final.y);
+        }
+        break;
+        case VERTEX_ATTRIBUTE_4H: {
+            auto source = position_nd_at(source_idx);
+            auto dest = dest_state.position_nd_at(dest_idx);
+            Vec4 final = source + ((dest - source) * interp);
+            out.position(final.x, final.y, final.z, final.w);
+        }
+        break;
         default:
             L_WARN("Ignoring unsupported vertex position type");
     }
@@ -532,7 +833,7 @@ uint64_t VertexData::last_updated() const {
     return last_updated_;
 }
 
-bool VertexData::clone_into(VertexData& other) {
+bool VertexData::clone_into(VertexData& other) const {
     if(vertex_specification_ != other.vertex_specification_) {
         return false;
     }
@@ -545,6 +846,45 @@ bool VertexData::clone_into(VertexData& other) {
     return true;
 }
 
+void VertexData::repack(VertexSpecification vertex_specification) {
+    if(vertex_specification == vertex_specification_) {
+        return;
+    }
+
+    const auto old_specification = vertex_specification_;
+    const auto old_stride = stride_;
+
+    std::vector<uint8_t> old_data;
+    std::swap(old_data, data_);
+
+    vertex_specification_ = vertex_specification;
+    stride_ = vertex_specification.stride();
+    recalc_attributes();
+
+    data_.resize(vertex_count_ * stride_, 0);
+    cursor_position_ = 0;
+
+    for(int t = VERTEX_ATTRIBUTE_TYPE_POSITION; t <= VERTEX_ATTRIBUTE_TYPE_SPECULAR; ++t) {
+        auto type = (VertexAttributeType) t;
+
+        auto from = smlt::attribute_for_type(type, old_specification);
+        auto to = smlt::attribute_for_type(type, vertex_specification_);
+        if(!from || !to) {
+            continue;
+        }
+
+        auto from_offset = offset_for_type(type, old_specification);
+        auto to_offset = offset_for_type(type, vertex_specification_);
+        float defw = (type == VERTEX_ATTRIBUTE_TYPE_NORMAL) ? 0.0f : 1.0f;
+        bool bgra = is_colour(type);
+
+        for(uint32_t i = 0; i < vertex_count_; ++i) {
+            auto v = read_attribute(from, &old_data[(i * old_stride) + from_offset], defw, bgra);
+            write_attribute(to, &data_[(i * stride_) + to_offset], v, bgra);
+        }
+    }
+}
+
 static constexpr uint32_t calc_index_stride(IndexType type) {
     return (type == INDEX_TYPE_16_BIT) ? sizeof(uint16_t) : (type == INDEX_TYPE_8_BIT) ? sizeof(uint8_t) : sizeof(uint32_t);
 }
@@ -581,9 +921,19 @@ void IndexData::reset() {
     clear();
 }
 
+void IndexData::reset(IndexType type) {
+    clear();
+
+    index_type_ = type;
+    stride_ = calc_index_stride(type);
+}
+
 void IndexData::clear() {
     indices_.clear();
     count_ = 0;
+
+    min_index_ = ~0;
+    max_index_ = 0;
 }
 
 void IndexData::resize(uint32_t size) {
@@ -601,6 +951,20 @@ std::vector<uint32_t> IndexData::all() {
     return ret;
 }
 
+bool IndexData::clone_into(IndexData& other) const {
+    if(index_type_ != other.index_type_) {
+        return false;
+    }
+
+    other.indices_ = indices_;
+    other.stride_ = stride_;
+    other.count_ = count_;
+    other.min_index_ = min_index_;
+    other.max_index_ = max_index_;
+
+    return true;
+}
+
 void IndexData::done() {
     signal_update_complete_();
     last_updated_ = TimeKeeper::now_in_us();
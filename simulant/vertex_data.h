@@ -51,6 +51,11 @@ enum VertexAttributeType {
 
 VertexAttribute attribute_for_type(VertexAttributeType type, const VertexSpecification& spec);
 
+/* Conversions between floats and the half floats stored by the
+ * VERTEX_ATTRIBUTE_2H and VERTEX_ATTRIBUTE_4H attributes */
+uint16_t float_to_half(float f);
+float half_to_float(uint16_t h);
+
 class VertexData :
     public RefCounted<VertexData>,
     public UniquelyIdentifiable<VertexData>,
@@ -105,6 +110,13 @@ public:
      */
     Vec4 position_nd_at(uint32_t idx, float defz=0.0f, float defw=1.0f) const;
 
+    /*
+     * Returns any attribute of the vertex at idx as floats, whatever format
+     * it's stored in. Missing components are zero, apart from w which is 1
+     * (0 for normals). Colours are returned as RGBA.
+     */
+    Vec4 attribute_nd_at(VertexAttributeType type, uint32_t idx) const;
+
     void normal(float x, float y, float z);
     void normal(const Vec3& n);
 
@@ -168,12 +180,13 @@ public:
 
             Vec4 pos = position_nd_at(i);
             pos = transform * pos;
-            if(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_2F) {
+            VertexAttribute attr = vertex_specification_.position_attribute;
+            if(attr == VERTEX_ATTRIBUTE_2F || attr == VERTEX_ATTRIBUTE_2H) {
                 position(pos.x, pos.y);
-            } else if(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_3F) {
+            } else if(attr == VERTEX_ATTRIBUTE_3F) {
                 position(pos.x, pos.y, pos.z);
-            } else if(vertex_specification_.position_attribute == VERTEX_ATTRIBUTE_4F) {
-                position(pos);
+            } else if(attr == VERTEX_ATTRIBUTE_4F || attr == VERTEX_ATTRIBUTE_4H) {
+                position(pos.x, pos.y, pos.z, pos.w);
             } else {
                 L_ERROR("Attempted to transform unsupported position attribute type");
             }
@@ -202,7 +215,13 @@ public:
      *
      * Returns true on success, false otherwise.
     */
-    bool clone_into(VertexData& other);
+    bool clone_into(VertexData& other) const;
+
+    /* Converts every vertex to a different specification, for example to
+     * shrink the data with VertexSpecification::COMPACT. Attributes which aren't
+     * in the new specification are dropped, and new ones are zeroed. Call done()
+     * afterwards as you would after any other change. */
+    void repack(VertexSpecification vertex_specification);
 
 private:
     VertexSpecification vertex_specification_;
@@ -283,6 +302,9 @@ public:
 
     void reset();
 
+    /* Clears the indices and switches to a different index type */
+    void reset(IndexType type);
+
     void clear();
 
     void resize(uint32_t size);
@@ -336,7 +358,7 @@ public:
     void done();
     uint64_t last_updated() const;
 
-    uint32_t at(const uint32_t i) {
+    uint32_t at(const uint32_t i) const {
         auto ptr = &indices_[i * stride()];
 
         switch(index_type_) {
@@ -371,6 +393,9 @@ public:
 
     IndexType index_type() const { return index_type_; }
 
+    /* Copies the indices into other, which must have the same index type */
+    bool clone_into(IndexData& other) const;
+
 private:
     IndexType index_type_;
     std::vector<uint8_t> indices_;
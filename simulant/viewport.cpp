@@ -17,14 +17,9 @@
 //     along with Simulant.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include "viewport.h"
-#include "utils/gl_error.h"
+#include <stdexcept>
 
-#ifdef _arch_dreamcast
-    #include "../deps/libgl/include/gl.h"
-#else
-    #include "renderers/glad/glad/glad.h"
-#endif
+#include "viewport.h"
 
 namespace smlt {
 
@@ -45,7 +40,10 @@ Viewport::Viewport(ViewportType type, const Colour& colour):
     height_(0),
     type_(type),
     colour_(colour) {
-    
+
+    if(type_ != VIEWPORT_TYPE_CUSTOM) {
+        calculate_ratios_from_viewport(type_, x_, y_, width_, height_);
+    }
 }
 
 Viewport::Viewport(Ratio x, Ratio y, Ratio width, Ratio height, const Colour &colour):
@@ -62,47 +60,6 @@ void Viewport::set_colour(const smlt::Colour& colour) {
     colour_ = colour;
 }
 
-void Viewport::clear(const RenderTarget &target, uint32_t clear_flags) {
-    apply(target);
-
-    GLCheck(glClearColor, colour_.r, colour_.g, colour_.b, colour_.a);
-
-    uint32_t gl_clear_flags = 0;
-    if((clear_flags & BUFFER_CLEAR_COLOUR_BUFFER) == BUFFER_CLEAR_COLOUR_BUFFER) {
-        gl_clear_flags |= GL_COLOR_BUFFER_BIT;
-    }
-
-    if((clear_flags & BUFFER_CLEAR_DEPTH_BUFFER) == BUFFER_CLEAR_DEPTH_BUFFER) {
-        gl_clear_flags |= GL_DEPTH_BUFFER_BIT;
-
-        // Without this clearing the depth will do nothing.
-        GLCheck(glDepthMask, GL_TRUE);
-    }
-
-    if((clear_flags & BUFFER_CLEAR_STENCIL_BUFFER) == BUFFER_CLEAR_STENCIL_BUFFER) {
-        gl_clear_flags |= GL_STENCIL_BUFFER_BIT;
-    }
-
-    GLCheck(glClear, gl_clear_flags);
-}
-
-void Viewport::apply(const RenderTarget& target) {
-    if(type_ != VIEWPORT_TYPE_CUSTOM) {
-        calculate_ratios_from_viewport(type_, x_, y_, width_, height_);
-    }
-
-	GLCheck(glDisable, GL_SCISSOR_TEST);
-
-    double x = x_ * target.width();
-    double y = y_ * target.height();
-    double width = width_ * target.width();
-    double height = height_ * target.height();
-
-    GLCheck(glEnable, GL_SCISSOR_TEST);
-    GLCheck(glScissor, x, y, width, height);
-    GLCheck(glViewport, x, y, width, height);
-}
-
 uint32_t Viewport::width_in_pixels(const smlt::RenderTarget& target) const {
     return width_ * target.width();
 }
@@ -132,6 +89,10 @@ void calculate_ratios_from_viewport(ViewportType type, float& x, float& y, float
             x = 0; width = 1.0; height = (9.0f / 16.0f);
             y = (1.0f - height) / 2.0f;
         break;
+        case VIEWPORT_TYPE_BLACKBAR_16_BY_10:
+            x = 0; width = 1.0; height = (10.0f / 16.0f);
+            y = (1.0f - height) / 2.0f;
+        break;
         case VIEWPORT_TYPE_BLACKBAR_4_BY_3:
             x = 0; width = 1.0; height = (3.0f / 4.0f);
             y = (1.0f - height) / 2.0f;
@@ -55,14 +55,12 @@ public:
     Ratio width() const { return width_; }
     Ratio height() const { return height_; }
 
-    void clear(const RenderTarget& target, uint32_t clear_flags);
-    void apply(const RenderTarget& target);
-
     uint32_t width_in_pixels(const RenderTarget& target) const;
     uint32_t height_in_pixels(const RenderTarget& target) const;
 
     ViewportType type() const { return type_; }
 
+    const smlt::Colour& colour() const { return colour_; }
     void set_colour(const smlt::Colour& colour);
 private:
     Ratio x_;
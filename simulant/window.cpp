@@ -21,7 +21,6 @@
     #include <kos.h>
 #endif
 
-#include "utils/gl_error.h"
 #include "window.h"
 #include "platform.h"
 #include "input/input_state.h"
@@ -52,12 +51,12 @@
 #include "virtual_gamepad.h"
 #include "scenes/loading.h"
 #include "utils/gl_thread_check.h"
-#include "utils/gl_error.h"
 #include "utils/memory.h"
 
 #include "panels/stats_panel.h"
 #include "panels/partitioner_panel.h"
 #include "stage_manager.h"
+#include "threads/thread_pool.h"
 
 
 /* Icon to send to all screens on boot */
@@ -210,11 +209,17 @@ void Window::_clean_up() {
     backgrounds_->destroy_all();
     backgrounds_->clean_up();
 
+    update_thread_.reset();
+
     destroy_all_stages();
     StageManager::clean_up();
 
     render_sequence_.reset();
 
+    /* Everything using the workers has gone now */
+    behaviour_dispatcher()->set_thread_pool(nullptr);
+    worker_pool_.reset();
+
     if(sound_driver_) {
         sound_driver_->shutdown();
         sound_driver_.reset();
@@ -265,12 +270,18 @@ bool Window::_init() {
     sound_driver_ = create_sound_driver();
     sound_driver_->startup();
 
-    renderer_ = new_renderer(this, std::getenv("SIMULANT_RENDERER"));
+    renderer_ = create_renderer();
 
     bool result = create_window();
 
+    if(!worker_pool_) {
+        worker_pool_ = std::make_shared<thread::ThreadPool>(thread::ThreadPool::hardware_concurrency() - 1);
+        behaviour_dispatcher()->set_thread_pool(worker_pool_.get());
+    }
+
     // Initialize the render_sequence once we have a renderer
     render_sequence_ = std::make_shared<RenderSequence>(this);
+    render_sequence_->set_geometry_snapshots_enabled(pipelined_rendering_);
 
     if(result && !initialized_) {
         /* Swap buffers immediately after creation, this makes sure that
@@ -334,6 +345,10 @@ bool Window::_init() {
     return result;
 }
 
+std::shared_ptr<Renderer> Window::create_renderer() {
+    return new_renderer(this, std::getenv("SIMULANT_RENDERER"));
+}
+
 void Window::register_panel(uint8_t function_key, std::shared_ptr<Panel> panel) {
     PanelEntry entry;
     entry.panel = panel;
@@ -427,6 +442,62 @@ void Window::run_fixed_updates() {
     }
 }
 
+void Window::set_pipelined_rendering(bool value) {
+    if(value == pipelined_rendering_) {
+        return;
+    }
+
+    pipelined_rendering_ = value;
+
+    if(render_sequence_) {
+        render_sequence_->set_geometry_snapshots_enabled(value);
+    }
+
+    if(!value) {
+        update_thread_.reset();
+    }
+}
+
+void Window::run_pipelined_frame() {
+    /* The context lock is held throughout, so the context can't go away
+     * between preparing the frame and drawing it */
+    thread::Lock<thread::Mutex> rendering_lock(context_lock_);
+
+    /* Nothing is destroyed until StageManager::clean_up() runs after this, so
+     * the stages, pipelines and materials in the prepared frame stay alive
+     * until finish() */
+    bool render = has_context();
+    if(render) {
+        stats->reset_polygons_rendered();
+        render_sequence_->prepare();
+    }
+
+    if(!update_thread_) {
+        update_thread_ = std::make_shared<thread::ThreadPool>(1);
+    }
+
+    /* The calling thread always takes the first index, so the drawing stays
+     * on the thread which owns the context */
+    update_thread_->parallel_for(2, 1, [this, render](std::size_t begin, std::size_t end) {
+        for(auto i = begin; i < end; ++i) {
+            if(i == 0) {
+                if(render) {
+                    render_sequence_->draw();
+                    signal_pre_swap_();
+                    swap_buffers();
+                }
+            } else {
+                run_fixed_updates();
+                run_update();
+            }
+        }
+    });
+
+    if(render) {
+        render_sequence_->finish();
+    }
+}
+
 void Window::request_frame_time(float ms) {
     requested_frame_time_ms_ = ms;
 }
@@ -506,8 +577,15 @@ bool Window::run_frame() {
     input_manager_->update(dt); // Now update any manager stuff based on the new input state
     shared_assets->update(dt); // Update animated assets
 
-    run_fixed_updates();
-    run_update();
+    if(pipelined_rendering_) {
+        run_pipelined_frame();
+    } else {
+        run_fixed_updates();
+        run_update();
+    }
+
+    // Stage node sources have been updated now too, so let the driver mix
+    sound_driver_->update(dt);
 
     idle_.execute(); //Execute idle tasks before render
 
@@ -522,7 +600,7 @@ bool Window::run_frame() {
 
     /* Don't run the render sequence if we don't have a context, and don't update the resource
      * manager either because that probably needs a context too! */
-    {
+    if(!pipelined_rendering_) {
         thread::Lock<thread::Mutex> rendering_lock(context_lock_);
         if(has_context()) {
 
@@ -532,7 +610,6 @@ bool Window::run_frame() {
             signal_pre_swap_();
 
             swap_buffers();
-            GLChecker::end_of_frame_check();
 
             //std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
@@ -540,6 +617,12 @@ bool Window::run_frame() {
 
     signal_frame_finished_();
 
+    stats_.set_frame_arena_allocations(
+        frame_arena_.allocation_count(),
+        frame_arena_.heap_allocation_count()
+    );
+    frame_arena_.reset();
+
     /* We totally ignore the first frame as it can take a while and messes up
      * delta time for both updates (like particle systems) and FPS
      */
@@ -40,6 +40,7 @@
 #include "event_listener.h"
 #include "time_keeper.h"
 #include "stats_recorder.h"
+#include "generic/frame_arena.h"
 #include "screen.h"
 #include "coroutines/coroutine.h"
 
@@ -62,6 +63,10 @@ class InputState;
 class Loader;
 class LoaderType;
 class RenderSequence;
+
+namespace thread {
+    class ThreadPool;
+}
 class SceneImpl;
 class VirtualGamepad;
 class Renderer;
@@ -149,6 +154,18 @@ public:
     
     bool run_frame();
 
+    /*
+     * When enabled, each frame draws what the previous frame's updates left
+     * behind on this thread while the fixed updates and updates for the
+     * next frame run on a worker thread. This adds a frame of latency.
+     *
+     * Update code must not make OpenGL calls when this is enabled, and
+     * materials and textures shouldn't be changed while a frame is being
+     * drawn. Can also be enabled with SIMULANT_PIPELINED=1
+     */
+    void set_pipelined_rendering(bool value);
+    bool is_pipelined_rendering() const { return pipelined_rendering_; }
+
     void set_logging_level(LogLevel level);
 
     void stop_running() { is_running_ = false; }
@@ -309,6 +326,10 @@ protected:
     virtual bool create_window() = 0;
     virtual void destroy_window() = 0;
 
+    /* Called before create_window(). By default the renderer is chosen with
+     * the SIMULANT_RENDERER environment variable */
+    virtual std::shared_ptr<Renderer> create_renderer();
+
     Window(uint16_t width, uint16_t height, uint16_t bpp, bool fullscreen, bool enable_vsync);
 
     void set_paused(bool value=true);
@@ -382,12 +403,19 @@ private:
 
     std::shared_ptr<scenes::Loading> loading_;
     std::shared_ptr<smlt::RenderSequence> render_sequence_;
+
+    bool pipelined_rendering_ = false;
+    std::shared_ptr<thread::ThreadPool> update_thread_;
+    std::shared_ptr<thread::ThreadPool> worker_pool_;
     generic::DataCarrier data_carrier_;
     std::shared_ptr<VirtualGamepad> virtual_gamepad_;
     std::shared_ptr<TimeKeeper> time_keeper_;
 
     StatsRecorder stats_;
 
+    /* Reset after signal_frame_finished_ */
+    FrameArena frame_arena_;
+
     std::shared_ptr<SoundDriver> sound_driver_;
 
     virtual std::shared_ptr<SoundDriver> create_sound_driver() = 0;
@@ -437,12 +465,19 @@ public:
     Property<Window, InputManager> input = {this, &Window::input_manager_};
     Property<Window, InputState> input_state = {this, &Window::input_state_};
     Property<Window, StatsRecorder> stats = { this, &Window::stats_ };
+    Property<Window, FrameArena> frame_arena = { this, &Window::frame_arena_ };
     Property<Window, Platform> platform = {this, &Window::platform_};
 
+    /* Worker threads shared by everything in the engine which splits work
+     * up (behaviour updates, culling, terrain building). Callers of
+     * parallel_for() work too, so there's one less worker than cores */
+    Property<Window, thread::ThreadPool> worker_pool = {this, &Window::worker_pool_};
+
     SoundDriver* _sound_driver() const { return sound_driver_.get(); }
 
     void run_update();
     void run_fixed_updates();
+    void run_pipelined_frame();
     void request_frame_time(float ms);
 };
 
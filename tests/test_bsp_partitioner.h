@@ -0,0 +1,245 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/meshes/bsp_tree.h"
+#include "simulant/nodes/geoms/bsp_culler.h"
+#include "simulant/nodes/geom.h"
+
+namespace {
+
+using namespace smlt;
+
+class BSPPartitionerTests : public smlt::test::SimulantTestCase {
+public:
+    /*
+     * Two rooms either side of the plane x = 0. Cluster 0 (x < 0) can
+     * only see itself, cluster 1 (x >= 0) can see both.
+     */
+    BSPTreePtr two_room_tree(MeshPtr mesh) {
+        auto tree = std::make_shared<BSPTree>();
+
+        BSPPlane plane;
+        plane.normal = Vec3(1, 0, 0);
+        plane.distance = 0.0f;
+        tree->planes.push_back(plane);
+
+        BSPNode node;
+        node.plane = 0;
+        node.children[0] = -(1 + 1);
+        node.children[1] = -(0 + 1);
+        tree->nodes.push_back(node);
+
+        BSPLeaf left, right;
+        left.cluster = 0;
+        left.bounds = AABB(Vec3(-100, -100, -100), Vec3(0, 100, 100));
+        left.faces.push_back(0);
+
+        right.cluster = 1;
+        right.bounds = AABB(Vec3(0, -100, -100), Vec3(100, 100, 100));
+        right.faces.push_back(1);
+
+        tree->leaves.push_back(left);
+        tree->leaves.push_back(right);
+
+        for(auto name: {"left", "right"}) {
+            BSPFace face;
+            face.submesh = name;
+            face.first_index = 0;
+            face.index_count = mesh->find_submesh(name)->index_data->count();
+            tree->faces.push_back(face);
+        }
+
+        tree->set_visibility(2, {0x1, 0x3});
+        return tree;
+    }
+
+    MeshPtr two_room_mesh(StagePtr stage) {
+        auto mat1 = stage->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+        auto mat2 = stage->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("left", mat1, 1.0, 1.0, Vec3(-5, 0, -20));
+        mesh->new_submesh_as_rectangle("right", mat2, 1.0, 1.0, Vec3(5, 0, -20));
+        mesh->data->stash(two_room_tree(mesh), BSPTree::DATA_KEY);
+        return mesh;
+    }
+
+    void test_decompress_row() {
+        const uint8_t data[] = {0xFF, 0x05, 0x00, 0x02, 0x80};
+
+        auto row = BSPTree::decompress_row(data, sizeof(data), 1, 32);
+        assert_equal(4u, row.size());
+        assert_equal(0x05, row[0]);
+        assert_equal(0x00, row[1]);
+        assert_equal(0x00, row[2]);
+        assert_equal(0x80, row[3]);
+    }
+
+    void test_find_cluster_and_visibility() {
+        auto stage = window->new_stage();
+        auto tree = two_room_tree(two_room_mesh(stage));
+
+        assert_equal(0, tree->find_cluster(Vec3(-5, 0, 0)));
+        assert_equal(1, tree->find_cluster(Vec3(5, 0, 0)));
+
+        assert_true(tree->is_cluster_visible(0, 0));
+        assert_false(tree->is_cluster_visible(0, 1));
+        assert_true(tree->is_cluster_visible(1, 0));
+
+        auto row = tree->visible_clusters(0);
+        assert_false(tree->is_aabb_potentially_visible(AABB(Vec3(5, 0, 0), 1.0f), row));
+        assert_true(tree->is_aabb_potentially_visible(AABB(Vec3(0, 0, 0), 1.0f), row));
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_looping_tree_terminates() {
+        auto stage = window->new_stage();
+        auto tree = two_room_tree(two_room_mesh(stage));
+
+        // The back of the root now leads straight back to it
+        tree->nodes[0].children[1] = 0;
+
+        assert_equal(-1, tree->find_leaf(Vec3(-5, 0, 0)));
+        assert_equal(1, tree->find_leaf(Vec3(5, 0, 0)));
+
+        auto row = tree->visible_clusters(0);
+        assert_true(tree->is_aabb_potentially_visible(AABB(Vec3(-5, 0, 0), 1.0f), row));
+
+        window->destroy_stage(stage->id());
+    }
+
+    uint32_t gather_indexes(GeomPtr geom, CameraPtr camera) {
+        batcher::RenderQueue queue;
+        queue.reset(geom->stage.get(), window->renderer.get(), camera);
+        geom->culler->renderables_visible(camera->frustum(), &queue);
+
+        uint32_t count = 0;
+        for(uint32_t i = 0; i < queue.renderable_count(); ++i) {
+            count += queue.renderable(i)->index_element_count;
+        }
+
+        return count;
+    }
+
+    void test_culler_uses_pvs() {
+        auto stage = window->new_stage();
+        auto mesh = two_room_mesh(stage);
+        auto face_indexes = mesh->find_submesh("left")->index_data->count();
+
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_BSP;
+        auto geom = stage->new_geom_with_mesh(mesh->id(), options);
+
+        auto culler = dynamic_cast<BSPCuller*>(geom->culler.get());
+        assert_true(culler);
+
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+
+        // No viewpoint, everything in the frustum
+        assert_equal(face_indexes * 2, gather_indexes(geom, camera));
+
+        culler->set_viewpoint(Vec3(-5, 0, 0));
+        assert_equal(face_indexes, gather_indexes(geom, camera));
+        assert_equal(1u, culler->last_visible_leaf_count());
+
+        culler->set_viewpoint(Vec3(5, 0, 0));
+        assert_equal(face_indexes * 2, gather_indexes(geom, camera));
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_still_camera_keeps_using_pvs() {
+        auto stage = window->new_stage(PARTITIONER_BSP);
+        auto mesh = two_room_mesh(stage);
+
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_BSP;
+        auto geom = stage->new_geom_with_mesh(mesh->id(), options);
+        auto culler = dynamic_cast<BSPCuller*>(geom->culler.get());
+
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+        camera->move_to(-5, 0, 0);
+
+        // Both pipelines share the camera, so the second gets the cached result
+        PipelinePtr first = window->render(stage, camera);
+        PipelinePtr second = window->render(stage, camera);
+
+        auto queries = stage->partitioner->visibility_queries_run();
+
+        for(uint32_t i = 0; i < 2; ++i) {
+            window->run_frame();
+            assert_equal(0, culler->viewpoint_cluster());
+            assert_equal(1u, culler->last_visible_leaf_count());
+        }
+
+        // Nothing moved, so only the first frame culled
+        assert_equal(queries + 1, stage->partitioner->visibility_queries_run());
+
+        window->destroy_pipeline(first->id());
+        window->destroy_pipeline(second->id());
+        window->destroy_stage(stage->id());
+    }
+
+    void test_culler_falls_back_without_tree() {
+        auto stage = window->new_stage();
+        auto mat = stage->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", mat, 1.0, 1.0);
+
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_BSP;
+        auto geom = stage->new_geom_with_mesh(mesh->id(), options);
+
+        assert_false(dynamic_cast<BSPCuller*>(geom->culler.get()));
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_partitioner_hides_actors_outside_pvs() {
+        auto stage = window->new_stage(PARTITIONER_BSP);
+        auto mesh = two_room_mesh(stage);
+
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_BSP;
+        auto geom = stage->new_geom_with_mesh(mesh->id(), options);
+
+        auto box = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        box->new_submesh_as_box("box", stage->assets->new_material(), 1.0, 1.0, 1.0);
+        auto actor = stage->new_actor_with_mesh(box->id());
+        actor->move_to(5, 0, -20);
+
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+
+        auto visible = [&]() -> std::vector<StageNode*> {
+            std::vector<LightID> lights;
+            std::vector<StageNode*> nodes;
+
+            stage->partitioner->_apply_writes();
+            stage->partitioner->lights_and_geometry_visible_from(camera->id(), lights, nodes);
+            return nodes;
+        };
+
+        auto contains = [](const std::vector<StageNode*>& nodes, StageNode* node) {
+            return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+        };
+
+        camera->move_to(-5, 0, 0);
+        auto nodes = visible();
+        assert_true(contains(nodes, geom));
+        assert_false(contains(nodes, actor));
+
+        camera->move_to(5, 0, 0);
+        nodes = visible();
+        assert_true(contains(nodes, geom));
+        assert_true(contains(nodes, actor));
+
+        window->destroy_stage(stage->id());
+    }
+};
+
+}
@@ -23,6 +23,28 @@ public:
     const std::string name() const { return "test behaviour"; }
 };
 
+class ParallelBehaviour : public Behaviour, public RefCounted<ParallelBehaviour> {
+public:
+    BehaviourDataAccess data_access() const override {
+        return BEHAVIOUR_DATA_ACCESS_OWN_NODE;
+    }
+
+    void update(float dt) override {
+        _S_UNUSED(dt);
+
+        update_count++;
+        dispatched = BehaviourDispatcher::is_dispatching();
+
+        defer([this]() { deferred_count++; });
+    }
+
+    uint32_t update_count = 0;
+    uint32_t deferred_count = 0;
+    bool dispatched = false;
+
+    const std::string name() const { return "parallel behaviour"; }
+};
+
 
 class BehaviourTests : public smlt::test::SimulantTestCase {
 public:
@@ -50,6 +72,82 @@ public:
         actor->_update_thunk(0.0f);
         assert_equal(2u, behaviour->call_count);
     }
+
+    void test_parallel_behaviours_are_dispatched() {
+        auto stage = window->new_stage();
+
+        std::vector<ParallelBehaviour*> behaviours;
+        ActorPtr previous = nullptr;
+
+        for(int i = 0; i < 100; ++i) {
+            auto actor = stage->new_actor();
+
+            // Some are nested, these are batched with their parent
+            if(previous && i % 4 == 0) {
+                actor->set_parent(previous);
+            }
+
+            behaviours.push_back(actor->new_behaviour<ParallelBehaviour>());
+            previous = actor;
+        }
+
+        thread::ThreadPool pool(2);
+        BehaviourDispatcher dispatcher(&pool);
+        dispatcher.update(stage, 0.0f);
+
+        assert_false(BehaviourDispatcher::is_dispatching());
+
+        for(auto behaviour: behaviours) {
+            assert_equal(1u, behaviour->update_count);
+            assert_true(behaviour->dispatched);
+
+            // Ran at the end of the pass
+            assert_equal(1u, behaviour->deferred_count);
+        }
+    }
+
+    void test_parallel_behaviours_run_when_updated_directly() {
+        auto stage = window->new_stage();
+        auto actor = stage->new_actor();
+        auto behaviour = actor->new_behaviour<ParallelBehaviour>();
+
+        actor->update(0.0f);
+
+        assert_equal(1u, behaviour->update_count);
+        assert_false(behaviour->dispatched);
+        assert_equal(1u, behaviour->deferred_count);
+    }
+
+    void test_serial_behaviours_run_once_when_dispatched() {
+        auto stage = window->new_stage();
+        auto actor = stage->new_actor();
+
+        auto serial = actor->new_behaviour<TestBehaviour>();
+        auto parallel = actor->new_behaviour<ParallelBehaviour>();
+
+        BehaviourDispatcher dispatcher;
+        dispatcher.update(stage, 0.0f);
+
+        assert_equal(1u, serial->call_count);
+        assert_equal(1u, parallel->update_count);
+        assert_equal(1u, dispatcher.last_batch_size());
+    }
+
+    void test_parallel_behaviours_on_the_stage_run() {
+        auto stage = window->new_stage();
+        auto behaviour = stage->new_behaviour<ParallelBehaviour>();
+
+        thread::ThreadPool pool(2);
+        BehaviourDispatcher dispatcher(&pool);
+        dispatcher.update(stage, 0.0f);
+
+        assert_equal(1u, behaviour->update_count);
+        assert_true(behaviour->dispatched);
+        assert_equal(1u, behaviour->deferred_count);
+
+        // Nothing was handed to the workers
+        assert_equal(0u, dispatcher.last_batch_size());
+    }
 };
 
 
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/generic/frame_arena.h"
+#include "simulant/threads/thread.h"
+
+namespace {
+
+using namespace smlt;
+
+class FrameArenaTests : public smlt::test::SimulantTestCase {
+public:
+    void test_allocations_are_aligned() {
+        FrameArena arena(256);
+
+        arena.allocate(1, 1);
+        auto p = arena.allocate(16, 16);
+
+        assert_equal(0u, uint32_t(reinterpret_cast<uintptr_t>(p) % 16));
+        assert_equal(2u, arena.allocation_count());
+        assert_equal(17u, arena.bytes_used());
+    }
+
+    void test_reset_merges_blocks() {
+        FrameArena arena(64);
+
+        for(uint32_t i = 0; i < 10; ++i) {
+            arena.allocate(32, 8);
+        }
+
+        assert_true(arena.heap_allocation_count() > 1);
+        auto capacity = arena.capacity();
+
+        arena.reset();
+
+        assert_equal(0u, arena.allocation_count());
+        assert_equal(capacity, arena.capacity());
+
+        // The same work again fits in the merged block
+        for(uint32_t i = 0; i < 10; ++i) {
+            arena.allocate(32, 8);
+        }
+
+        assert_equal(10u, arena.allocation_count());
+        assert_equal(0u, arena.heap_allocation_count());
+    }
+
+    void test_vectors_use_the_arena() {
+        FrameArena arena(4096);
+
+        FrameVector<int> values{FrameAllocator<int>(&arena)};
+        for(int i = 0; i < 100; ++i) {
+            values.push_back(i);
+        }
+
+        assert_equal(99, values.back());
+        assert_true(arena.allocation_count() > 0);
+        assert_true(arena.bytes_used() >= sizeof(int) * 100);
+        assert_equal(1u, arena.heap_allocation_count());
+    }
+
+    void test_last_allocation_can_be_given_back() {
+        FrameArena arena(64);
+
+        auto first = arena.allocate(32, 8);
+        arena.deallocate(first, 32);
+
+        assert_true(arena.allocate(32, 8) == first);
+    }
+
+    void test_local_gives_other_threads_their_own_arena() {
+        FrameArena arena;
+        assert_true(arena.local() == &arena);
+
+        FrameArena* other = nullptr;
+        thread::Thread t([&]() {
+            other = arena.local();
+            other->allocate(8, 8);
+        });
+        t.join();
+
+        assert_is_not_null(other);
+        assert_true(other != &arena);
+        assert_equal(1u, arena.allocation_count());
+
+        arena.reset();
+        assert_equal(0u, other->allocation_count());
+    }
+
+    void test_frames_stop_allocating_from_the_heap() {
+        auto stage = window->new_stage();
+        stage->new_light_as_point(Vec3(0, 0, -5));
+        stage->new_actor()->move_to(0, 0, -5);
+        window->render(stage, stage->new_camera());
+
+        for(uint32_t i = 0; i < 5; ++i) {
+            window->run_frame();
+        }
+
+        assert_equal(0u, window->stats->frame_arena_heap_allocations());
+        assert_equal(0u, window->frame_arena->allocation_count());
+    }
+};
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/headless_window.h"
+#include "simulant/renderers/null/null_renderer.h"
+#include "simulant/render_sequence.h"
+
+namespace {
+
+using namespace smlt;
+
+class HeadlessWindowTests : public smlt::test::TestCase {
+public:
+    void set_up() {
+        TestCase::set_up();
+
+        headless_ = std::static_pointer_cast<HeadlessWindow>(
+            HeadlessWindow::create(nullptr, 640, 480, 0, false, false)
+        );
+        headless_->vfs->add_search_path("assets");
+        headless_->vfs->add_search_path("sample_data");
+        assert_true(headless_->_init());
+    }
+
+    void tear_down() {
+        headless_.reset();
+        TestCase::tear_down();
+    }
+
+    ActorPtr populate() {
+        auto stage = headless_->new_stage();
+
+        auto box = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        box->new_submesh_as_box("box", stage->assets->new_material(), 1.0, 1.0, 1.0);
+
+        auto actor = stage->new_actor_with_mesh(box->id());
+        actor->move_to(0, 0, -5);
+
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(45), 640.0f / 480.0f, 0.1, 100.0);
+
+        headless_->render(stage, camera);
+
+        return actor;
+    }
+
+    void test_renderer_is_null() {
+        assert_equal("null", headless_->renderer->name());
+        assert_is_not_null(headless_->null_renderer());
+    }
+
+    void test_draw_calls_are_recorded() {
+        populate();
+
+        auto renderer = headless_->null_renderer();
+
+        headless_->run_frame();
+        auto first = renderer->frame_stats();
+
+        assert_true(first.draw_calls > 0);
+        assert_true(first.clears > 0);
+        assert_true(first.bytes_uploaded > 0);
+
+        // Nothing changed, so there's nothing more to upload
+        headless_->run_frame();
+        assert_equal(first.draw_calls, renderer->frame_stats().draw_calls);
+        assert_equal((uint64_t) 0, renderer->frame_stats().bytes_uploaded);
+
+        assert_equal(first.draw_calls * 2, renderer->total_stats().draw_calls);
+    }
+
+    void test_time_advances_by_fixed_step() {
+        auto time_keeper = headless_->time_keeper.get();
+
+        headless_->run_frame();
+        headless_->run_frame();
+
+        assert_close(time_keeper->fixed_step(), time_keeper->delta_time(), 0.00001f);
+    }
+
+    void test_prepared_frame_is_unaffected_by_updates() {
+        auto actor = populate();
+        auto stage = actor->get_stage();
+
+        auto light = stage->new_light_as_point(Vec3(0, 0, -4));
+
+        auto sequence = headless_->render_sequence_;
+        sequence->set_geometry_snapshots_enabled(true);
+
+        sequence->prepare();
+        assert_equal(1u, sequence->prepared_count_);
+
+        auto& queue = sequence->prepared_[0]->queue;
+        assert_true(queue.renderable_count() > 0);
+        assert_equal(1u, queue.light_count());
+
+        auto renderable = queue.renderable(0);
+        auto source = actor->base_mesh()->vertex_data.get();
+
+        // Drawing reads copies, not the mesh itself
+        assert_not_equal(source, renderable->vertex_data);
+        assert_equal(source->count(), renderable->vertex_data->count());
+        assert_equal(queue.light_state(0), renderable->lights_affecting_this_frame[0]);
+
+        // Now pretend the next frame's updates are running
+        auto transform = renderable->final_transformation;
+        actor->move_to(1, 0, -5);
+        light->move_to(0, 10, 0);
+        source->move_to_start();
+        source->position(100, 100, 100);
+        source->done();
+
+        sequence->draw();
+
+        assert_true(headless_->null_renderer()->frame_stats().draw_calls > 0);
+        assert_true(renderable->final_transformation == transform);
+        assert_close(-4.0f, queue.light_state(0)->position.z, 0.0001f);
+        assert_not_equal(100.0f, renderable->vertex_data->position_at<Vec3>(0)->x);
+
+        sequence->finish();
+        assert_equal(0u, sequence->prepared_count_);
+
+        // Changed geometry is copied again, unchanged geometry isn't
+        sequence->prepare();
+        auto copied = sequence->geometry_snapshot().bytes_copied();
+        sequence->draw();
+        sequence->finish();
+
+        sequence->prepare();
+        assert_true(copied > 0);
+        assert_equal(0u, sequence->geometry_snapshot().bytes_copied());
+        sequence->draw();
+        sequence->finish();
+    }
+
+    void test_snapshots_are_kept_per_gather() {
+        batcher::GeometrySnapshot snapshot;
+
+        auto indexes = IndexData::create(INDEX_TYPE_16_BIT);
+        indexes->index(0);
+        indexes->index(1);
+        indexes->index(2);
+        indexes->done();
+
+        snapshot.begin_gather(0);
+        auto first = snapshot.index_data(indexes.get());
+
+        // Rewritten for the next pipeline's camera, like the BSP culler's visible faces
+        indexes->clear();
+        indexes->index(0);
+        indexes->done();
+
+        snapshot.begin_gather(1);
+        auto second = snapshot.index_data(indexes.get());
+
+        assert_not_equal(first, second);
+        assert_equal(3u, first->count());
+        assert_equal(1u, second->count());
+        assert_equal(2u, snapshot.copy_count());
+
+        // Next frame only the first pipeline draws it, so the other copy goes
+        snapshot.collect();
+        snapshot.begin_gather(0);
+        snapshot.index_data(indexes.get());
+        snapshot.collect();
+
+        assert_equal(1u, snapshot.copy_count());
+    }
+
+    void test_pipelined_frames_draw() {
+        populate();
+
+        headless_->set_pipelined_rendering(true);
+        assert_true(headless_->render_sequence_->geometry_snapshots_enabled());
+
+        auto renderer = headless_->null_renderer();
+
+        headless_->run_frame();
+        auto first = renderer->frame_stats();
+        assert_true(first.draw_calls > 0);
+
+        headless_->run_frame();
+        assert_equal(first.draw_calls, renderer->frame_stats().draw_calls);
+
+        headless_->set_pipelined_rendering(false);
+        assert_false(headless_->render_sequence_->geometry_snapshots_enabled());
+    }
+
+private:
+    std::shared_ptr<HeadlessWindow> headless_;
+};
+
+}
@@ -19,6 +19,50 @@ public:
         assert_equal(heightmap->data->get<TerrainData>("terrain_data").z_size, tex->height());
     }
 
+    void test_height_queries() {
+        auto stage = window->new_stage();
+
+        HeightmapSpecification spec;
+        spec.min_height = 0.0f;
+        spec.max_height = 10.0f;
+        spec.spacing = 2.0f;
+
+        // 3 x 2 grid, centred on the origin
+        auto terrain = stage->assets->new_mesh_from_heights(3, 2, {0.0f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f}, spec);
+        auto data = terrain->data->get<TerrainData>("terrain_data");
+
+        assert_close(-3.0f, data.position(0, 0).x, 0.0001f);
+        assert_close(4.0f, data.height(1, 1), 0.0001f);
+        assert_close(5.0f, data.height(10, 10), 0.0001f);
+
+        // Halfway between the first four points
+        assert_close(2.0f, data.height_at(-2.0f, -1.0f), 0.0001f);
+        assert_close(2.0f, terrain::get_height_at(terrain, -2.0f, -1.0f), 0.0001f);
+
+        // The vertices are where the heights say
+        assert_equal(6u, terrain->vertex_data->count());
+        assert_close(4.0f, terrain->vertex_data->position_at<Vec3>(4)->y, 0.0001f);
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_without_mesh() {
+        auto stage = window->new_stage();
+
+        HeightmapSpecification spec;
+        spec.generate_mesh = false;
+        spec.smooth_iterations = 2;
+
+        auto heightmap = stage->assets->new_mesh_from_heightmap("flare.tga", spec);
+        auto data = heightmap->data->get<TerrainData>("terrain_data");
+
+        assert_equal(0u, heightmap->vertex_data->count());
+        assert_equal(1u, heightmap->submesh_count());
+        assert_equal(data.x_size * data.z_size, data.heights->size());
+
+        window->destroy_stage(stage->id());
+    }
+
 };
 
 }
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/renderers/batching/light_grid.h"
+
+namespace {
+
+using namespace smlt;
+
+class LightGridTests : public smlt::test::SimulantTestCase {
+public:
+    void set_up() {
+        SimulantTestCase::set_up();
+
+        stage_ = window->new_stage();
+        camera_ = stage_->new_camera();
+        camera_->set_perspective_projection(Degrees(45.0), 1.0, 1.0, 100.0);
+    }
+
+    void tear_down() {
+        window->destroy_stage(stage_->id());
+        SimulantTestCase::tear_down();
+    }
+
+    void build(std::vector<LightPtr>& lights) {
+        grid_.build(camera_->view_matrix(), camera_->projection_matrix(), &lights[0], lights.size());
+    }
+
+    std::vector<uint32_t> lights_for(const Vec3& centre) {
+        std::vector<uint32_t> ret;
+        grid_.lights_for(AABB(centre - Vec3(0.5, 0.5, 0.5), centre + Vec3(0.5, 0.5, 0.5)), ret);
+        return ret;
+    }
+
+    bool contains(const std::vector<uint32_t>& values, uint32_t i) {
+        return std::find(values.begin(), values.end(), i) != values.end();
+    }
+
+    void test_nearby_lights_are_returned() {
+        std::vector<LightPtr> lights;
+        lights.push_back(stage_->new_light_as_point(Vec3(0, 0, -10)));
+        lights.push_back(stage_->new_light_as_point(Vec3(30, 30, -80)));
+        lights[0]->set_attenuation_from_range(5.0f);
+        lights[1]->set_attenuation_from_range(5.0f);
+
+        build(lights);
+
+        auto found = lights_for(Vec3(1, 0, -10));
+        assert_true(contains(found, 0));
+        assert_false(contains(found, 1));
+
+        found = lights_for(Vec3(30, 30, -79));
+        assert_false(contains(found, 0));
+        assert_true(contains(found, 1));
+    }
+
+    void test_point_lights_reach_twice_their_range() {
+        std::vector<LightPtr> lights;
+        lights.push_back(stage_->new_light_as_point(Vec3(0, 0, -40)));
+        lights[0]->set_attenuation_from_range(5.0f);
+
+        build(lights);
+
+        /* Outside the range, but inside the sphere nodes are lit by */
+        assert_true(contains(lights_for(Vec3(10, 0, -40)), 0));
+    }
+
+    void test_directional_lights_reach_everything() {
+        std::vector<LightPtr> lights;
+        lights.push_back(stage_->new_light_as_directional());
+
+        build(lights);
+
+        assert_true(contains(lights_for(Vec3(0, 0, -10)), 0));
+        assert_true(contains(lights_for(Vec3(20, -20, -90)), 0));
+    }
+
+    void test_lights_are_only_returned_once() {
+        std::vector<LightPtr> lights;
+        lights.push_back(stage_->new_light_as_point(Vec3(0, 0, -20)));
+        lights[0]->set_attenuation_from_range(50.0f);
+
+        build(lights);
+
+        /* Big enough to cover lots of clusters */
+        std::vector<uint32_t> found;
+        grid_.lights_for(AABB(Vec3(-10, -10, -40), Vec3(10, 10, -5)), found);
+
+        assert_equal(1u, found.size());
+        assert_true(grid_.assignment_count() > 1u);
+    }
+
+    void test_lights_off_screen_are_skipped() {
+        std::vector<LightPtr> lights;
+        lights.push_back(stage_->new_light_as_point(Vec3(0, 0, 20)));
+        lights[0]->set_attenuation_from_range(5.0f);
+
+        build(lights);
+
+        assert_equal(0u, grid_.assignment_count());
+        assert_true(lights_for(Vec3(0, 0, -10)).empty());
+    }
+
+private:
+    StagePtr stage_;
+    CameraPtr camera_;
+    batcher::LightGrid grid_;
+};
+
+}
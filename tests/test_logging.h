@@ -0,0 +1,138 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/logging.h"
+
+namespace {
+
+using namespace smlt;
+
+class RecordingHandler : public Handler {
+public:
+    std::vector<std::string> levels;
+    std::vector<std::string> messages;
+
+private:
+    void do_write_message(Logger* logger, const DateTime& time, const std::string& level, const std::string& message) override {
+        _S_UNUSED(logger);
+        _S_UNUSED(time);
+
+        levels.push_back(level);
+        messages.push_back(message);
+    }
+};
+
+struct CountsStreaming {
+    int* count;
+};
+
+std::ostream& operator<<(std::ostream& stream, const CountsStreaming& value) {
+    ++(*value.count);
+    return stream << "streamed";
+}
+
+/* Logs to another logger from inside a handler, i.e. on the writer thread */
+class ChattyHandler : public Handler {
+public:
+    ChattyHandler(Logger* other, uint32_t count):
+        other_(other),
+        count_(count) {}
+
+private:
+    Logger* other_;
+    uint32_t count_;
+
+    void do_write_message(Logger* logger, const DateTime& time, const std::string& level, const std::string& message) override {
+        _S_UNUSED(logger);
+        _S_UNUSED(time);
+        _S_UNUSED(level);
+        _S_UNUSED(message);
+
+        for(uint32_t i = 0; i < count_; ++i) {
+            other_->warn("chatter");
+        }
+    }
+};
+
+class LoggingTests : public smlt::test::SimulantTestCase {
+public:
+    void test_filtered_levels_are_not_formatted() {
+        auto logger = get_logger("test_filtered");
+        logger->set_level(LOG_LEVEL_WARN);
+
+        int count = 0;
+        CountsStreaming value{&count};
+
+        L_DEBUG_N("test_filtered", _F("{0}").format(value));
+        L_INFO_N("test_filtered", _F("{0}").format(value));
+        assert_equal(0, count);
+
+        L_WARN_N("test_filtered", _F("{0}").format(value));
+        assert_equal(1, count);
+    }
+
+    void test_async_logger_writes_in_order() {
+        auto handler = std::make_shared<RecordingHandler>();
+
+        auto logger = get_logger("test_async");
+        logger->set_level(LOG_LEVEL_DEBUG);
+        logger->add_handler(handler);
+        logger->set_async(true);
+
+        for(int i = 0; i < 100; ++i) {
+            logger->warn(_F("message {0}").format(i));
+        }
+
+        logger->flush();
+
+        assert_equal(100u, handler->messages.size());
+        assert_true(handler->messages[0].find("message 0") != std::string::npos);
+        assert_true(handler->messages[99].find("message 99") != std::string::npos);
+        assert_equal("WARN", handler->levels[0]);
+
+        logger->set_async(false);
+    }
+
+    void test_async_errors_are_flushed() {
+        auto handler = std::make_shared<RecordingHandler>();
+
+        auto logger = get_logger("test_async_error");
+        logger->add_handler(handler);
+        logger->set_async(true);
+
+        logger->error("Something went wrong");
+
+        // No flush needed, errors are written before error() returns
+        assert_equal(1u, handler->messages.size());
+        assert_equal("ERROR", handler->levels[0]);
+
+        logger->set_async(false);
+    }
+
+    void test_handlers_logging_when_the_buffer_is_full() {
+        auto recorder = std::make_shared<RecordingHandler>();
+
+        auto other = get_logger("test_async_other");
+        other->add_handler(recorder);
+        other->set_async(true);
+
+        /* More than the buffer holds, nothing drains it while the handler runs */
+        auto logger = get_logger("test_async_chatty");
+        logger->add_handler(std::make_shared<ChattyHandler>(other, 2000));
+        logger->set_async(true);
+
+        logger->warn("Start talking");
+
+        // Would never return if the writer thread waited on itself
+        logger->flush();
+        other->flush();
+
+        assert_true(recorder->messages.size() < 2000u);
+
+        logger->set_async(false);
+        other->set_async(false);
+    }
+};
+
+}
@@ -62,6 +62,68 @@ public:
 
     }
 
+    void test_stale_ids_are_detected() {
+        MyObjectManager manager;
+
+        auto first = manager.make()->id_;
+        manager.destroy(first);
+        manager.clean_up();
+
+        auto second = manager.make()->id_;
+
+        assert_not_equal(first, second);
+        assert_equal(PoolHandle::slot(first.value()), PoolHandle::slot(second.value()));
+        assert_false(manager.contains(first));
+        assert_is_null(manager.get(first));
+        assert_true(manager.contains(second));
+    }
+
+    void test_lookups_while_another_thread_allocates() {
+        MyObjectManager manager;
+        auto first = manager.make()->id_;
+
+        /* Enough objects that the pool adds chunks while we look up */
+        const uint32_t count = MyObjectManager::chunk_size * 8;
+        thread::Thread t([&]() {
+            for(uint32_t i = 0; i < count; ++i) {
+                manager.make();
+            }
+        });
+
+        for(uint32_t i = 0; i < count; ++i) {
+            assert_true(manager.get(first) != nullptr);
+            assert_true(manager.get(first)->id_ == first);
+        }
+
+        t.join();
+        assert_equal(count + 1, (uint32_t) manager.size());
+    }
+
+    void test_iteration_skips_released_objects() {
+        MyObjectManager manager;
+
+        std::vector<MyObjectID> ids;
+        for(uint32_t i = 0; i < MyObjectManager::chunk_size * 2; ++i) {
+            ids.push_back(manager.make()->id_);
+        }
+
+        for(uint32_t i = 0; i < ids.size(); i += 3) {
+            manager.destroy(ids[i]);
+        }
+
+        manager.clean_up();
+
+        std::size_t count = 0;
+        for(auto obj: manager._each()) {
+            assert_true(manager.contains(obj->id_));
+            assert_not_equal(PoolHandle::slot(obj->id_.value()) % 3, 0u);
+            ++count;
+        }
+
+        assert_equal(count, manager.size());
+        assert_equal(count, ids.size() - ((ids.size() + 2) / 3));
+    }
+
     void test_actors_are_freed() {
         auto stage = window->new_stage();
 
@@ -73,8 +135,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(stage->new_actor()->id(), actor);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = stage->new_actor()->id();
+        assert_not_equal(reused, actor);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(actor.value()));
     }
 
     void test_lights_are_freed() {
@@ -88,8 +152,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(stage->new_light_as_directional()->id(), light);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = stage->new_light_as_directional()->id();
+        assert_not_equal(reused, light);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(light.value()));
     }
 
     void test_particle_systems_are_freed() {
@@ -107,8 +173,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(stage->new_particle_system(script)->id(), particle_system);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = stage->new_particle_system(script)->id();
+        assert_not_equal(reused, particle_system);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(particle_system.value()));
     }
 
     void test_geoms_are_freed() {
@@ -124,8 +192,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(stage->new_geom_with_mesh(mesh)->id(), geom);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = stage->new_geom_with_mesh(mesh)->id();
+        assert_not_equal(reused, geom);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(geom.value()));
     }
 
     void test_cameras_are_freed() {
@@ -139,8 +209,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(stage->new_camera()->id(), camera);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = stage->new_camera()->id();
+        assert_not_equal(reused, camera);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(camera.value()));
     }
 
     void test_pipelines_are_freed() {
@@ -164,8 +236,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(window->new_stage()->id(), stage);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = window->new_stage()->id();
+        assert_not_equal(reused, stage);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(stage.value()));
     }
 
     void test_backgrounds_are_freed() {
@@ -183,7 +257,7 @@ public:
     void test_sprites_are_freed() {
         auto stage = window->new_stage();
 
-        auto sprite = stage->sprites->new_sprite();
+        auto sprite = stage->sprites->new_sprite()->id();
         stage->sprites->destroy_sprite(sprite);
 
         // Should be different, the original light is still lingering
@@ -191,8 +265,10 @@ public:
 
         window->run_frame();
 
-        // Same ID should be given back as it's been released
-        assert_equal(stage->sprites->new_sprite()->id(), sprite);
+        // The slot is reused, but with a new generation so the old ID is stale
+        auto reused = stage->sprites->new_sprite()->id();
+        assert_not_equal(reused, sprite);
+        assert_equal(PoolHandle::slot(reused.value()), PoolHandle::slot(sprite.value()));
     }
 };
 
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/utils/mesh/simplify.h"
+
+namespace {
+
+using namespace smlt;
+
+class MeshLODTests : public smlt::test::SimulantTestCase {
+public:
+    void set_up() {
+        SimulantTestCase::set_up();
+        stage_ = window->new_stage();
+    }
+
+    void tear_down() {
+        window->destroy_stage(stage_->id());
+        SimulantTestCase::tear_down();
+    }
+
+    uint32_t triangle_count(MeshPtr mesh) {
+        uint32_t count = 0;
+        for(auto submesh: mesh->each_submesh()) {
+            submesh->each_triangle([&](uint32_t, uint32_t, uint32_t) { ++count; });
+        }
+        return count;
+    }
+
+    void assert_bounds_close(const AABB& expected, const AABB& actual, float tolerance) {
+        assert_close(expected.min().x, actual.min().x, tolerance);
+        assert_close(expected.min().y, actual.min().y, tolerance);
+        assert_close(expected.min().z, actual.min().z, tolerance);
+        assert_close(expected.max().x, actual.max().x, tolerance);
+        assert_close(expected.max().y, actual.max().y, tolerance);
+        assert_close(expected.max().z, actual.max().z, tolerance);
+    }
+
+    void test_lods_reduce_triangles() {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_sphere("sphere", stage_->assets->new_material(), 2.0f, 48, 32);
+
+        auto original = triangle_count(mesh);
+        auto lods = mesh->generate_lods({0.5f, 0.25f, 0.1f});
+
+        assert_equal(3u, lods.size());
+
+        uint32_t last = original;
+        for(auto& lod: lods) {
+            auto count = triangle_count(lod);
+            assert_true(count < last);
+            assert_true(lod->vertex_data->count() < mesh->vertex_data->count());
+
+            // Vertices are never moved, so the bounds can only shrink a little
+            assert_bounds_close(mesh->aabb(), lod->aabb(), 0.1f);
+            last = count;
+        }
+
+        assert_true(triangle_count(lods.back()) <= original / 5);
+    }
+
+    void test_submeshes_keep_their_materials() {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        auto first = stage_->assets->new_material();
+        auto second = stage_->assets->new_material();
+
+        mesh->new_submesh_as_sphere("first", first, 2.0f, 24, 16);
+        mesh->new_submesh_as_box("second", second, 1.0f, 1.0f, 1.0f);
+
+        auto lods = mesh->generate_lods({0.5f});
+
+        assert_equal(2u, lods[0]->submesh_count());
+        assert_equal(first->id(), lods[0]->find_submesh("first")->material()->id());
+        assert_equal(second->id(), lods[0]->find_submesh("second")->material()->id());
+
+        // Every box vertex is on a seam, so the box can't change
+        assert_equal(36u, lods[0]->find_submesh("second")->index_data->count());
+    }
+
+    void test_lods_plug_into_detail_levels() {
+        auto mesh = stage_->assets->new_mesh_from_file("tank.obj");
+        auto lods = mesh->generate_lods();
+
+        auto actor = stage_->new_actor_with_mesh(mesh->id());
+        for(uint32_t i = 0; i < lods.size(); ++i) {
+            actor->set_mesh(lods[i]->id(), DetailLevel(DETAIL_LEVEL_NEAR + i));
+            assert_true(triangle_count(lods[i]) <= triangle_count(mesh));
+        }
+
+        assert_equal(lods.back(), actor->mesh(DETAIL_LEVEL_FARTHEST));
+    }
+
+    void test_open_edges_are_kept() {
+        // A flat grid, every vertex on the outside edge must stay put
+        std::vector<Vec3> positions;
+        std::vector<uint32_t> indices;
+
+        const uint32_t size = 10;
+        for(uint32_t z = 0; z <= size; ++z) {
+            for(uint32_t x = 0; x <= size; ++x) {
+                positions.push_back(Vec3(x, 0, z));
+            }
+        }
+
+        for(uint32_t z = 0; z < size; ++z) {
+            for(uint32_t x = 0; x < size; ++x) {
+                uint32_t i = z * (size + 1) + x;
+                indices.insert(indices.end(), {i, i + size + 1, i + 1});
+                indices.insert(indices.end(), {i + 1, i + size + 1, i + size + 2});
+            }
+        }
+
+        float error = 1.0f;
+        auto result = utils::simplify_triangles(positions, indices, 0, 0.001f, nullptr, &error);
+
+        assert_true(result.size() < indices.size());
+        assert_close(0.0f, error, 0.0001f);
+
+        for(uint32_t x = 0; x <= size; ++x) {
+            assert_true(std::find(result.begin(), result.end(), x) != result.end());
+        }
+    }
+
+private:
+    StagePtr stage_;
+};
+
+}
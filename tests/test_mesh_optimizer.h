@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/meshes/mesh_optimizer.h"
+
+namespace {
+
+using namespace smlt;
+
+class MeshOptimizerTests : public smlt::test::SimulantTestCase {
+public:
+    void set_up() {
+        SimulantTestCase::set_up();
+        stage_ = window->new_stage();
+    }
+
+    void tear_down() {
+        window->destroy_stage(stage_->id());
+        SimulantTestCase::tear_down();
+    }
+
+    /* The corners of every triangle, sorted, so meshes can be compared
+     * regardless of the order of their vertices and triangles */
+    std::vector<std::vector<float>> triangles(MeshPtr mesh) {
+        std::vector<std::vector<float>> ret;
+        for(auto submesh: mesh->each_submesh()) {
+            submesh->each_triangle([&](uint32_t a, uint32_t b, uint32_t c) {
+                std::vector<float> tri;
+                for(auto i: {a, b, c}) {
+                    auto p = mesh->vertex_data->position_at<Vec3>(i);
+                    auto uv = mesh->vertex_data->texcoord0_at<Vec2>(i);
+                    tri.insert(tri.end(), {p->x, p->y, p->z, uv->x, uv->y});
+                }
+                ret.push_back(tri);
+            });
+        }
+
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    void test_duplicate_vertices_are_merged() {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        auto material = stage_->assets->new_material();
+
+        // The second rectangle is an exact copy of the first
+        mesh->new_submesh_as_rectangle("first", material, 1.0f, 1.0f);
+        auto count = mesh->vertex_data->count();
+        mesh->new_submesh_as_rectangle("second", material, 1.0f, 1.0f);
+
+        auto before = triangles(mesh);
+        auto stats = MeshOptimizer().optimize(mesh);
+
+        assert_equal(count * 2, stats.vertices_before);
+        assert_equal(count, stats.vertices_after);
+        assert_equal(count, mesh->vertex_data->count());
+        assert_true(stats.bytes_saved() > 0u);
+        assert_true(before == triangles(mesh));
+    }
+
+    void test_cache_order_improves() {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_sphere("sphere", stage_->assets->new_material(), 1.0f, 32, 32);
+
+        auto before = triangles(mesh);
+        auto stats = MeshOptimizer().optimize(mesh);
+
+        assert_true(stats.acmr_after < stats.acmr_before);
+        assert_true(stats.acmr_after < 1.0f);
+        assert_true(before == triangles(mesh));
+    }
+
+    void test_index_type_shrinks() {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        auto submesh = mesh->new_submesh_with_material(
+            "tri", stage_->assets->new_material(), MESH_ARRANGEMENT_TRIANGLES, INDEX_TYPE_32_BIT
+        );
+
+        for(uint32_t i = 0; i < 3; ++i) {
+            mesh->vertex_data->position(Vec3(i, i * i, 0));
+            mesh->vertex_data->tex_coord0(0, 0);
+            mesh->vertex_data->diffuse(Colour::WHITE);
+            mesh->vertex_data->normal(0, 0, 1);
+            mesh->vertex_data->move_next();
+            submesh->index_data->index(i);
+        }
+
+        mesh->vertex_data->done();
+        submesh->index_data->done();
+
+        MeshOptimizer().optimize(mesh);
+
+        assert_equal(INDEX_TYPE_16_BIT, submesh->index_data->index_type());
+        assert_equal(3u, submesh->index_data->count());
+    }
+
+    void test_optimize_on_load() {
+        MeshLoadOptions options;
+        options.optimize = true;
+
+        auto plain = window->shared_assets->new_mesh_from_file("cube.obj");
+        auto optimized = window->shared_assets->new_mesh_from_file("cube.obj", VertexSpecification::DEFAULT, options);
+
+        assert_true(optimized->vertex_data->count() <= plain->vertex_data->count());
+        assert_true(triangles(plain) == triangles(optimized));
+    }
+
+private:
+    StagePtr stage_;
+};
+
+}
@@ -50,6 +50,87 @@ public:
         MeshSilhouette silhouette(mesh, Mat4(), light);
         assert_equal(0u, silhouette.edge_list().size());
     }
+
+    void test_rotated_mesh_uses_local_light() {
+        auto stage = window->new_stage();
+
+        auto mesh = window->shared_assets->new_mesh(smlt::VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", window->shared_assets->new_material(), 1.0, 1.0f);
+
+        auto light = stage->new_light_as_point();
+        light->move_to(0, 0, 10);
+
+        // Turned around the light is behind the rectangle, but the edges are all
+        // still a silhouette. The lit face should flip though.
+        MeshSilhouette front(mesh, Mat4(), light);
+        MeshSilhouette back(mesh, Mat4::as_rotation_y(Degrees(180)), light);
+
+        assert_equal(4u, front.edge_list().size());
+        assert_equal(4u, back.edge_list().size());
+        assert_true(front.face_is_lit(0));
+        assert_false(back.face_is_lit(0));
+    }
+
+    void test_volume_manager_caches_volumes() {
+        auto stage = window->new_stage();
+
+        auto mesh = window->shared_assets->new_mesh(smlt::VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", window->shared_assets->new_material(), 1.0, 1.0f);
+
+        auto light = stage->new_light_as_point();
+        light->move_to(0, 0, 10);
+
+        ShadowVolumeManager manager;
+        std::vector<LightPtr> lights = {light};
+        std::vector<ShadowCaster> casters = {ShadowCaster(mesh, Mat4())};
+
+        manager.update(1, lights, casters);
+        assert_equal(1u, manager.last_recalculated_count());
+
+        auto volume = manager.volume(mesh->id(), light->id());
+        assert_true(volume);
+
+        // 4 edges, 2 triangles each
+        assert_equal(24u, volume->side_vertex_count);
+
+        // Plus the two lit triangles as the front cap
+        assert_equal(30u, volume->vertices.size());
+
+        // Nothing moved, so nothing to do
+        manager.update(2, lights, casters);
+        assert_equal(0u, manager.last_recalculated_count());
+
+        light->move_to(0, 0, 5);
+        manager.update(3, lights, casters);
+        assert_equal(1u, manager.last_recalculated_count());
+
+        // Not passed in, so dropped
+        manager.update(4, lights, {});
+        assert_equal(0u, manager.cached_volume_count());
+    }
+
+    void test_volume_manager_with_thread_pool() {
+        auto stage = window->new_stage();
+        thread::ThreadPool pool(2);
+
+        std::vector<LightPtr> lights;
+        for(int i = 0; i < 4; ++i) {
+            auto light = stage->new_light_as_point();
+            light->move_to(i, 0, 10);
+            lights.push_back(light);
+        }
+
+        auto mesh = window->shared_assets->new_mesh(smlt::VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", window->shared_assets->new_material(), 1.0, 1.0f);
+
+        ShadowVolumeManager manager(&pool);
+        manager.update(1, lights, {ShadowCaster(mesh, Mat4())});
+
+        assert_equal(4u, manager.cached_volume_count());
+        for(auto& light: lights) {
+            assert_equal(4u, manager.silhouette(mesh->id(), light->id())->edge_list().size());
+        }
+    }
 };
 
 }
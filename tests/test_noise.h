@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "../simulant/utils/noise.h"
+#include "../simulant/utils/simplex.h"
+#include "../simulant/threads/thread_pool.h"
+
+namespace {
+
+using namespace smlt;
+
+class NoiseTest : public smlt::test::SimulantTestCase {
+public:
+    /* An odd sized grid, so rows don't fill a whole number of batches, which
+     * crosses zero so negative coordinates are covered too */
+    noise::Grid grid() {
+        return noise::Grid(Vec3(-13.3f, -7.1f, -2.7f), Vec3(0.173f, 0.291f, 0.517f), 37, 19, 11);
+    }
+
+    template<typename Func>
+    float max_grid_error(const noise::Grid& grid, const std::vector<float>& out, Func scalar) {
+        float ret = 0.0f;
+        for(uint32_t k = 0; k < grid.depth; ++k) {
+            for(uint32_t j = 0; j < grid.height; ++j) {
+                for(uint32_t i = 0; i < grid.width; ++i) {
+                    float x = grid.origin.x + float(i) * grid.step.x;
+                    float y = grid.origin.y + float(j) * grid.step.y;
+                    float z = grid.origin.z + float(k) * grid.step.z;
+
+                    auto idx = (((k * grid.height) + j) * grid.width) + i;
+                    ret = std::max(ret, std::abs(float(scalar(x, y, z)) - out[idx]));
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    void test_perlin_grid_matches_noise() {
+        noise::Perlin perlin(1234);
+
+        auto g = grid();
+        std::vector<float> out(g.size());
+        perlin.fill(g, &out[0]);
+
+        assert_true(max_grid_error(g, out, [&](float x, float y, float z) {
+            return perlin.noise(x, y, z);
+        }) < 1e-4f);
+    }
+
+    void test_perlin_octave_grid_matches_noise() {
+        noise::PerlinOctave perlin(4, 1234);
+
+        auto g = grid();
+        std::vector<float> out(g.size());
+        perlin.fill(g, &out[0]);
+
+        assert_true(max_grid_error(g, out, [&](float x, float y, float z) {
+            return perlin.noise(x, y, z);
+        }) < 1e-4f);
+    }
+
+    void test_simplex_grid_matches_noise() {
+        Simplex simplex(1234);
+
+        auto g = grid();
+        std::vector<float> out(g.size());
+        simplex.fill(g, &out[0]);
+
+        assert_true(max_grid_error(g, out, [&](float x, float y, float z) {
+            return simplex.noise(x, y, z);
+        }) < 1e-4f);
+    }
+
+    void test_simplex_fbm_matches_octaves() {
+        Simplex simplex(1234);
+        noise::FBm fbm(3, 2.0f, 0.4f);
+
+        auto g = grid();
+        std::vector<float> out(g.size());
+        simplex.fill(g, fbm, &out[0]);
+
+        assert_true(max_grid_error(g, out, [&](float x, float y, float z) {
+            return simplex.noise(x, y, z) +
+                0.4f * simplex.noise(x * 2.0f, y * 2.0f, z * 2.0f) +
+                0.16f * simplex.noise(x * 4.0f, y * 4.0f, z * 4.0f);
+        }) < 1e-4f);
+    }
+
+    void test_points_2d() {
+        noise::Perlin perlin(1234);
+        Simplex simplex(1234);
+
+        std::vector<float> x, y;
+        for(uint32_t i = 0; i < 101; ++i) {
+            x.push_back(float(i) * 0.37f - 20.0f);
+            y.push_back(float(i) * -0.11f + 5.0f);
+        }
+
+        std::vector<float> perlin_out(x.size()), simplex_out(x.size());
+        perlin.fill(&x[0], &y[0], nullptr, x.size(), &perlin_out[0]);
+        simplex.fill(&x[0], &y[0], nullptr, x.size(), &simplex_out[0]);
+
+        for(uint32_t i = 0; i < x.size(); ++i) {
+            assert_close(float(perlin.noise(x[i], y[i])), perlin_out[i], 1e-4f);
+            assert_close(simplex.noise(x[i], y[i]), simplex_out[i], 1e-4f);
+        }
+    }
+
+    void test_threaded_fill_matches() {
+        noise::PerlinOctave perlin(3, 1234);
+        thread::ThreadPool pool(2);
+
+        noise::Grid g(Vec3(), Vec3(0.1f, 0.1f, 0.0f), 300, 200);
+
+        std::vector<float> expected(g.size()), out(g.size());
+        perlin.fill(g, &expected[0]);
+        perlin.fill(g, &out[0], &pool);
+
+        assert_true(expected == out);
+    }
+};
+
+}
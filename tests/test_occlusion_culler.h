@@ -0,0 +1,112 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/renderers/batching/occlusion_culler.h"
+
+namespace {
+
+using namespace smlt;
+
+class OcclusionCullerTests : public smlt::test::SimulantTestCase {
+public:
+    void set_up() {
+        SimulantTestCase::set_up();
+
+        projection_ = Mat4::as_projection(Degrees(45.0), 2.0f, 1.0f, 100.0f);
+    }
+
+    /* A square facing the camera, centred on the view direction */
+    void add_wall(batcher::OcclusionCuller& culler, float size, float z) {
+        culler.add_triangle(Vec3(-size, -size, z), Vec3(size, -size, z), Vec3(size, size, z));
+        culler.add_triangle(Vec3(-size, -size, z), Vec3(size, size, z), Vec3(-size, size, z));
+    }
+
+    void test_bounds_behind_an_occluder_are_hidden() {
+        batcher::OcclusionCuller culler;
+        culler.begin(Mat4(), projection_);
+        add_wall(culler, 20.0f, -10.0f);
+        culler.rasterize();
+
+        assert_false(culler.is_visible(AABB(Vec3(-1, -1, -30), Vec3(1, 1, -28))));
+        assert_true(culler.is_visible(AABB(Vec3(-1, -1, -6), Vec3(1, 1, -4))));
+    }
+
+    void test_partly_covered_bounds_are_visible() {
+        batcher::OcclusionCuller culler;
+        culler.begin(Mat4(), projection_);
+        add_wall(culler, 1.0f, -10.0f);
+        culler.rasterize();
+
+        assert_true(culler.is_visible(AABB(Vec3(-10, -10, -30), Vec3(10, 10, -28))));
+        assert_false(culler.is_visible(AABB(Vec3(-0.2, -0.2, -30), Vec3(0.2, 0.2, -29.8))));
+    }
+
+    void test_begin_clears_the_buffer() {
+        batcher::OcclusionCuller culler;
+        culler.begin(Mat4(), projection_);
+        add_wall(culler, 20.0f, -10.0f);
+        culler.rasterize();
+
+        culler.begin(Mat4(), projection_);
+        culler.rasterize();
+
+        assert_equal(0u, culler.triangle_count());
+        assert_true(culler.is_visible(AABB(Vec3(-1, -1, -30), Vec3(1, 1, -28))));
+    }
+
+    void test_threaded_rasterization_matches() {
+        thread::ThreadPool pool(2);
+
+        batcher::OcclusionCuller serial;
+        batcher::OcclusionCuller threaded(&pool);
+
+        for(auto culler: {&serial, &threaded}) {
+            culler->begin(Mat4(), projection_);
+            add_wall(*culler, 3.0f, -10.0f);
+            culler->add_triangle(Vec3(-5, 0, -20), Vec3(5, -4, -15), Vec3(0, 6, -25));
+            culler->rasterize();
+        }
+
+        for(uint32_t y = 0; y < batcher::OcclusionCuller::HEIGHT; ++y) {
+            for(uint32_t x = 0; x < batcher::OcclusionCuller::WIDTH; ++x) {
+                assert_equal(serial.depth_at(x, y), threaded.depth_at(x, y));
+            }
+        }
+    }
+
+    void test_pipeline_reports_occluded_nodes() {
+        auto stage = window->new_stage();
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(45.0), 2.0, 1.0, 100.0);
+
+        auto wall_mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        wall_mesh->new_submesh_as_box("wall", stage->assets->new_material(), 40.0f, 40.0f, 1.0f);
+
+        auto box_mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        box_mesh->new_submesh_as_box("box", stage->assets->new_material(), 1.0f, 1.0f, 1.0f);
+
+        auto wall = stage->new_actor_with_mesh(wall_mesh->id());
+        wall->move_to(0, 0, -10);
+        wall->set_occluder(true);
+
+        stage->new_actor_with_mesh(box_mesh->id())->move_to(0, 0, -30);
+        stage->new_actor_with_mesh(box_mesh->id())->move_to(0, 0, -5);
+
+        window->render(stage, camera);
+        window->render_sequence()->set_occlusion_culling_enabled(true);
+        window->run_frame();
+
+        assert_equal(1u, window->stats->nodes_occluded());
+
+        window->render_sequence()->set_occlusion_culling_enabled(false);
+        window->run_frame();
+
+        assert_equal(0u, window->stats->nodes_occluded());
+    }
+
+private:
+    Mat4 projection_;
+};
+
+}
@@ -83,6 +83,96 @@ public:
         // Should be different renderables that came back
         assert_not_equal(ret1.material->id(), ret2.material->id());
     }
+
+    MeshPtr build_level(StagePtr stage) {
+        auto mat1 = stage->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+        auto mat2 = stage->assets->new_material_from_file(Material::BuiltIns::DIFFUSE_ONLY);
+
+        /* A grid of small boxes in front of the camera, alternating materials */
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        for(int z = 0; z < 16; ++z) {
+            for(int x = 0; x < 16; ++x) {
+                mesh->new_submesh_as_box(
+                    _F("box_{0}_{1}").format(x, z),
+                    ((x + z) % 2) ? mat1 : mat2,
+                    1.0, 1.0, 1.0,
+                    Vec3((x - 8) * 3.0f, 0, -10.0f - (z * 3.0f))
+                );
+            }
+        }
+
+        return mesh;
+    }
+
+    uint32_t gather(GeomPtr geom, CameraPtr camera, uint32_t* index_count) {
+        batcher::RenderQueue queue;
+        queue.reset(geom->stage.get(), window->renderer.get(), camera);
+        geom->culler->renderables_visible(camera->frustum(), &queue);
+
+        *index_count = 0;
+        for(auto i = 0u; i < queue.renderable_count(); ++i) {
+            *index_count += queue.renderable(i)->index_element_count;
+        }
+
+        return queue.renderable_count();
+    }
+
+    void test_merge_by_material() {
+        auto stage = window->new_stage();
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+
+        // Far enough back that the whole level is in view, so both draw the same triangles
+        camera->move_to(0, 0, 20);
+
+        auto mesh = build_level(stage);
+
+        auto plain = stage->new_geom_with_mesh(mesh->id());
+
+        GeomCullerOptions options;
+        options.merge_by_material = true;
+        options.merge_level = 1;
+        auto merged = stage->new_geom_with_mesh(mesh->id(), options);
+
+        uint32_t plain_indexes = 0, merged_indexes = 0;
+        auto plain_count = gather(plain, camera, &plain_indexes);
+        auto merged_count = gather(merged, camera, &merged_indexes);
+
+        /* Same triangles, far fewer draws */
+        assert_equal(plain_indexes, merged_indexes);
+        assert_true(merged_count < plain_count);
+
+        auto& stats = merged->culler->last_gather_stats();
+        assert_equal(merged_count, stats.renderables_emitted);
+
+        /* We never go deeper than the merge level */
+        assert_true(stats.cells_visited <= 1 + 8);
+    }
+
+    void test_merge_at_default_level() {
+        auto stage = window->new_stage();
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+
+        // Far enough back that the whole level is in view, so both draw the same triangles
+        camera->move_to(0, 0, 20);
+
+        auto mesh = build_level(stage);
+
+        auto plain = stage->new_geom_with_mesh(mesh->id());
+
+        GeomCullerOptions options;
+        options.merge_by_material = true;
+        auto merged = stage->new_geom_with_mesh(mesh->id(), options);
+
+        uint32_t plain_indexes = 0, merged_indexes = 0;
+        auto plain_count = gather(plain, camera, &plain_indexes);
+        auto merged_count = gather(merged, camera, &merged_indexes);
+
+        assert_true(plain_indexes > 0u);
+        assert_equal(plain_indexes, merged_indexes);
+        assert_true(merged_count < plain_count);
+    }
 };
 
 }
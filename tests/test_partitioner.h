@@ -170,6 +170,130 @@ public:
         partitioner._apply_writes();
         window->destroy_stage(stage->id());
     }
+
+    void test_visible_set_is_reused() {
+        auto stage = window->new_stage(PARTITIONER_HASH);
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(45), 1.0f, 0.1f, 100.0f);
+
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_box("box", stage->assets->new_material(), 1.0, 1.0, 1.0);
+        auto actor = stage->new_actor_with_mesh(mesh);
+        actor->move_to(0, 0, -5);
+
+        auto partitioner = stage->partitioner.get();
+        partitioner->_apply_writes();
+
+        std::vector<LightID> lights;
+        std::vector<StageNode*> nodes;
+
+        partitioner->visible_from(camera->id(), lights, nodes);
+        assert_equal(1u, nodes.size());
+
+        auto queries = partitioner->visibility_queries_run();
+
+        // A second pipeline with the same camera, nothing has changed
+        nodes.clear();
+        partitioner->_apply_writes();
+        partitioner->visible_from(camera->id(), lights, nodes);
+
+        assert_equal(1u, nodes.size());
+        assert_equal(queries, partitioner->visibility_queries_run());
+
+        // The camera moved, so it has to start again
+        camera->move_to(0, 0, 1);
+        nodes.clear();
+        partitioner->visible_from(camera->id(), lights, nodes);
+
+        assert_equal(1u, nodes.size());
+        assert_equal(queries + 1, partitioner->visibility_queries_run());
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_visible_set_follows_writes() {
+        auto stage = window->new_stage(PARTITIONER_HASH);
+        auto camera = stage->new_camera();
+        camera->set_perspective_projection(Degrees(45), 1.0f, 0.1f, 100.0f);
+
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_box("box", stage->assets->new_material(), 1.0, 1.0, 1.0);
+        auto actor = stage->new_actor_with_mesh(mesh);
+        actor->move_to(0, 0, -5);
+
+        auto partitioner = stage->partitioner.get();
+        partitioner->_apply_writes();
+
+        std::vector<LightID> lights;
+        std::vector<StageNode*> nodes;
+        partitioner->visible_from(camera->id(), lights, nodes);
+
+        auto queries = partitioner->visibility_queries_run();
+
+        // Behind the camera
+        actor->move_to(0, 0, 10);
+        partitioner->_apply_writes();
+
+        nodes.clear();
+        partitioner->visible_from(camera->id(), lights, nodes);
+        assert_equal(0u, nodes.size());
+
+        // New things in view are picked up
+        auto other = stage->new_actor_with_mesh(mesh);
+        other->move_to(0, 0, -10);
+        auto light = stage->new_light_as_point(Vec3(0, 0, -5));
+        partitioner->_apply_writes();
+
+        nodes.clear();
+        lights.clear();
+        partitioner->visible_from(camera->id(), lights, nodes);
+        assert_equal(1u, nodes.size());
+        assert_true(nodes[0] == other);
+        assert_equal(1u, lights.size());
+        assert_true(lights[0] == light->id());
+
+        // None of that needed a new query
+        assert_equal(queries, partitioner->visibility_queries_run());
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_bounds_are_updated_once_before_writes() {
+        auto stage = window->new_stage(PARTITIONER_HASH);
+
+        auto mesh = stage->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_box("box", stage->assets->new_material(), 1.0, 1.0, 1.0);
+        auto parent = stage->new_actor_with_mesh(mesh);
+        auto child = stage->new_actor_with_mesh(mesh);
+        child->set_parent(parent);
+
+        stage->partitioner->_apply_writes();
+
+        uint32_t updates = 0;
+        child->signal_bounds_updated().connect([&updates](const AABB&) { ++updates; });
+
+        // Moving doesn't recalculate anything straight away
+        for(uint32_t i = 0; i < 10; ++i) {
+            parent->move_to(0, 0, -float(i));
+        }
+
+        assert_equal(0u, updates);
+
+        stage->partitioner->_apply_writes();
+        assert_equal(1u, updates);
+        assert_close(-9.5f, child->transformed_aabb().min().z, 0.0001f);
+
+        // Nothing moved since
+        stage->partitioner->_apply_writes();
+        assert_equal(1u, updates);
+
+        // A destroyed node isn't left in the queue
+        child->move_to(0, 0, 1);
+        child->destroy_immediately();
+        stage->partitioner->_apply_writes();
+
+        window->destroy_stage(stage->id());
+    }
 };
 
 }
@@ -228,6 +228,114 @@ public:
 
         body->unregister_collision_listener(&listener);
     }
+    void test_threaded_stepping_gives_the_same_results() {
+        auto inline_sim = behaviours::RigidBodySimulation::create(window->time_keeper);
+        auto threaded_sim = behaviours::RigidBodySimulation::create(window->time_keeper);
+        threaded_sim->set_threaded_stepping(true);
+
+        auto actor1 = stage->new_actor();
+        auto body1 = actor1->new_behaviour<behaviours::RigidBody>(inline_sim.get());
+        body1->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+
+        auto actor2 = stage->new_actor();
+        auto body2 = actor2->new_behaviour<behaviours::RigidBody>(threaded_sim.get());
+        body2->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+
+        for(int i = 0; i < 10; ++i) {
+            inline_sim->fixed_update(1.0f / 60.0f);
+            threaded_sim->fixed_update(1.0f / 60.0f);
+        }
+
+        // Reading the position waits for the running step
+        assert_true(body1->position().y < 0.0f);
+        assert_close(body1->position().y, body2->position().y, 0.0001f);
+
+        threaded_sim->set_threaded_stepping(false);
+        assert_false(threaded_sim->is_threaded_stepping());
+    }
+
+    void test_threaded_stepping_calls_listeners_on_wait() {
+        physics->set_threaded_stepping(true);
+        skip_if(!physics->is_threaded_stepping(), "Needs more than one core");
+
+        bool enter_called = false;
+        Listener listener(&enter_called, nullptr, nullptr);
+
+        auto actor1 = stage->new_actor();
+        auto body = actor1->new_behaviour<behaviours::StaticBody>(physics.get());
+        body->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+        body->register_collision_listener(&listener);
+
+        auto actor2 = stage->new_actor();
+        auto body2 = actor2->new_behaviour<behaviours::RigidBody>(physics.get());
+        body2->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+
+        physics->fixed_update(1.0f / 60.0f);
+
+        // The step may well have finished, but nothing is reported until
+        // the results are picked up on this thread
+        assert_false(enter_called);
+
+        physics->wait();
+        assert_true(enter_called);
+
+        body->unregister_collision_listener(&listener);
+        physics->set_threaded_stepping(false);
+    }
+
+    void test_bodies_move_nodes_between_steps() {
+        auto actor = stage->new_actor();
+        auto body = actor->new_behaviour<behaviours::RigidBody>(physics.get());
+        body->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+        body->set_linear_velocity(Vec3(60, 0, 0));
+
+        physics->fixed_update(1.0f / 60.0f);
+
+        // The node lands somewhere between where the body was and where it is
+        body->update(0.0f);
+        assert_true(actor->absolute_position().x >= 0.0f);
+        assert_true(actor->absolute_position().x <= body->position().x + 0.0001f);
+    }
+
+    void test_batched_rays_match_single_rays() {
+        for(int i = 0; i < 10; ++i) {
+            auto actor = stage->new_actor();
+            actor->move_to(i * 2.0f, 0, 0);
+
+            auto body = actor->new_behaviour<behaviours::StaticBody>(physics.get());
+            body->add_box_collider(Vec3(1, 1, 1), behaviours::PhysicsMaterial::WOOD);
+        }
+
+        std::vector<Ray> rays;
+        for(int i = 0; i < 200; ++i) {
+            rays.push_back(Ray(Vec3(i * 0.1f, 5.0f, (i % 3) * 0.3f), Vec3(0, -10.0f, 0)));
+        }
+
+        auto hits = physics->intersect_rays(rays);
+        assert_equal(rays.size(), hits.size());
+
+        uint32_t hit_count = 0;
+        for(std::size_t i = 0; i < rays.size(); ++i) {
+            float distance = 0.0f;
+            Vec3 normal;
+            auto expected = physics->intersect_ray(rays[i].start, rays[i].dir, &distance, &normal);
+
+            assert_equal(expected.second, hits[i].hit);
+            if(expected.second) {
+                assert_equal(expected.first, hits[i].point);
+                assert_equal(normal, hits[i].normal);
+                assert_equal(distance, hits[i].distance);
+                ++hit_count;
+            }
+        }
+
+        // Some rays fall between the boxes
+        assert_true(hit_count > 0);
+        assert_true(hit_count < rays.size());
+
+        assert_true(physics->intersect_rays(std::vector<Ray>()).empty());
+    }
+
 private:
     std::shared_ptr<behaviours::RigidBodySimulation> physics;
     StagePtr stage;
@@ -2,11 +2,46 @@
 
 #include "simulant/simulant.h"
 #include "simulant/test.h"
+#include "simulant/renderers/batching/instancing.h"
 
 namespace {
 
 using namespace smlt;
 
+class TestRenderGroupFactory : public batcher::RenderGroupFactory {
+public:
+    batcher::RenderGroupKey prepare_render_group(
+        batcher::RenderGroup*,
+        const Renderable*,
+        const MaterialPass*,
+        const uint8_t pass_number,
+        const bool is_blended,
+        const float distance_to_camera) override {
+
+        return batcher::generate_render_group_key(pass_number, is_blended, distance_to_camera);
+    }
+};
+
+class RecordingVisitor : public batcher::RenderQueueVisitor {
+public:
+    void start_traversal(const batcher::RenderQueue&, uint64_t, Stage*) override {}
+    void change_render_group(const batcher::RenderGroup*, const batcher::RenderGroup*) override {}
+    void change_material_pass(const MaterialPass*, const MaterialPass*) override {}
+    void apply_lights(const LightState* const*, const uint8_t) override {}
+    void end_traversal(const batcher::RenderQueue&, Stage*) override {}
+
+    void visit(const Renderable*, const MaterialPass*, batcher::Iteration) override {
+        ++visits;
+    }
+
+    void visit_instanced(const Renderable* const*, std::size_t count, const MaterialPass*, batcher::Iteration) override {
+        batches.push_back(count);
+    }
+
+    uint32_t visits = 0;
+    std::vector<std::size_t> batches;
+};
+
 class RenderQueueTests : public smlt::test::SimulantTestCase {
 public:
     void set_up() {
@@ -53,6 +88,109 @@ public:
         assert_true(pass0_blended_100_tex1 < pass1_blended_10_tex1);
     }
 
+    MeshPtr new_rectangle(float size) {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", stage_->assets->new_material(), size, size);
+        return mesh;
+    }
+
+    Renderable make_renderable(MeshPtr mesh, const Vec3& position) {
+        auto submesh = mesh->first_submesh();
+
+        Renderable r;
+        r.vertex_data = mesh->vertex_data.get();
+        r.index_data = submesh->index_data.get();
+        r.index_element_count = submesh->index_data->count();
+        r.material = submesh->material().get();
+        r.final_transformation = Mat4::as_translation(position);
+        r.centre = position;
+        return r;
+    }
+
+    void test_instances_are_gathered() {
+        auto camera = stage_->new_camera();
+
+        auto ship = new_rectangle(1.0f);
+        auto rock = new_rectangle(2.0f);
+
+        TestRenderGroupFactory factory;
+        batcher::RenderQueue queue;
+        queue.reset(stage_, &factory, camera);
+
+        for(int i = 0; i < 10; ++i) {
+            queue.insert_renderable(make_renderable(ship, Vec3(0, 0, -(i * 2.0f))));
+        }
+
+        queue.insert_renderable(make_renderable(rock, Vec3(0, 0, -5.0f)));
+
+        RecordingVisitor visitor;
+        queue.traverse(&visitor, 0);
+
+        // All the ships are drawn at once, the rock on its own
+        assert_equal(1u, visitor.batches.size());
+        assert_equal(10u, visitor.batches[0]);
+        assert_equal(1u, visitor.visits);
+
+        queue.set_instancing_enabled(false);
+        visitor = RecordingVisitor();
+        queue.traverse(&visitor, 0);
+
+        assert_equal(0u, visitor.batches.size());
+        assert_equal(11u, visitor.visits);
+    }
+
+    void test_blended_renderables_are_not_gathered() {
+        auto camera = stage_->new_camera();
+        auto ship = new_rectangle(1.0f);
+        ship->first_submesh()->material()->pass(0)->set_blend_func(BLEND_ALPHA);
+
+        TestRenderGroupFactory factory;
+        batcher::RenderQueue queue;
+        queue.reset(stage_, &factory, camera);
+
+        for(int i = 0; i < 5; ++i) {
+            queue.insert_renderable(make_renderable(ship, Vec3(0, 0, -(i * 2.0f))));
+        }
+
+        RecordingVisitor visitor;
+        queue.traverse(&visitor, 0);
+
+        assert_equal(0u, visitor.batches.size());
+        assert_equal(5u, visitor.visits);
+    }
+
+    void test_instance_merger_pretransforms() {
+        auto ship = new_rectangle(1.0f);
+
+        std::vector<Renderable> renderables;
+        for(int i = 0; i < 3; ++i) {
+            renderables.push_back(make_renderable(ship, Vec3(i * 10.0f, 0, 0)));
+        }
+
+        std::vector<const Renderable*> pointers;
+        for(auto& r: renderables) {
+            pointers.push_back(&r);
+        }
+
+        auto vertices = VertexData::create(ship->vertex_data->vertex_specification());
+        auto indices = IndexData::create(INDEX_TYPE_16_BIT);
+
+        batcher::InstanceMerger merger;
+        assert_true(merger.can_merge(pointers[0]));
+        assert_equal(3u, merger.merge(&pointers[0], pointers.size(), *vertices, *indices));
+
+        auto per_instance = vertices->count() / 3;
+        auto source_indices = renderables[0].index_element_count;
+
+        assert_equal(ship->vertex_data->count(), per_instance);
+        assert_equal(source_indices * 3, indices->count());
+
+        // The third copy has been moved along by 20 units
+        auto first = *vertices->position_at<Vec3>(indices->at(0));
+        auto third = *vertices->position_at<Vec3>(indices->at(source_indices * 2));
+        assert_close(first.x + 20.0f, third.x, 0.0001f);
+    }
+
 private:
     StagePtr stage_;
 
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/signals/signal.h"
+#include "simulant/threads/atomic.h"
+
+namespace {
+
+using namespace smlt;
+
+class SignalTests : public smlt::test::TestCase {
+public:
+    void test_connect_and_emit() {
+        sig::signal<void (int)> signal;
+
+        int total = 0;
+        signal.connect([&total](int v) { total += v; });
+        signal.connect([&total](int v) { total += v * 10; });
+        signal.connect([&total](int v) { total += v * 100; }); // Overflows the inline slots
+
+        signal(1);
+        assert_equal(111, total);
+        assert_equal(3u, signal.connection_count());
+    }
+
+    void test_disconnect() {
+        sig::signal<void ()> signal;
+
+        int calls = 0;
+        auto conn = signal.connect([&calls]() { ++calls; });
+        assert_true(conn.is_connected());
+
+        assert_true(conn.disconnect());
+        assert_false(conn.is_connected());
+        assert_false(conn.disconnect());
+        assert_equal(0u, signal.connection_count());
+
+        signal();
+        assert_equal(0, calls);
+    }
+
+    void test_reused_slot_does_not_revive_old_connection() {
+        sig::signal<void ()> signal;
+
+        auto first = signal.connect([]() {});
+        first.disconnect();
+
+        auto second = signal.connect([]() {});
+
+        assert_false(first.is_connected());
+        assert_false(first.disconnect());
+        assert_true(second.is_connected());
+    }
+
+    void test_disconnect_during_emit() {
+        sig::signal<void ()> signal;
+
+        int calls = 0;
+        sig::connection self;
+        self = signal.connect([&]() {
+            ++calls;
+            self.disconnect();
+        });
+
+        auto other = signal.connect([&calls]() { ++calls; });
+
+        signal();
+        assert_equal(2, calls);
+        assert_false(self.is_connected());
+        assert_true(other.is_connected());
+
+        signal();
+        assert_equal(3, calls);
+    }
+
+    void test_connect_during_emit_is_not_called_until_next_emit() {
+        sig::signal<void ()> signal;
+
+        int calls = 0;
+        signal.connect([&]() {
+            if(signal.connection_count() < 4) {
+                signal.connect([&calls]() { ++calls; });
+            }
+        });
+
+        signal();
+        assert_equal(0, calls);
+
+        signal();
+        assert_equal(1, calls);
+    }
+
+    void test_connection_outlives_signal() {
+        sig::connection conn;
+
+        {
+            sig::signal<void ()> signal;
+            conn = signal.connect([]() {});
+            assert_true(conn.is_connected());
+        }
+
+        assert_false(conn.is_connected());
+        assert_false(conn.disconnect());
+    }
+
+    void test_scoped_connection() {
+        sig::signal<void ()> signal;
+
+        {
+            sig::scoped_connection conn = signal.connect([]() {});
+            assert_equal(1u, signal.connection_count());
+        }
+
+        assert_equal(0u, signal.connection_count());
+    }
+
+    void test_small_callables_are_stored_inline() {
+        int value = 0;
+        sig::InlineFunction<void ()> small([&value]() { ++value; });
+        assert_false(small.is_heap_allocated());
+
+        char big_capture[64] = {0};
+        sig::InlineFunction<void ()> big([big_capture, &value]() { value += big_capture[0]; });
+        assert_true(big.is_heap_allocated());
+
+        small();
+        big();
+        assert_equal(1, value);
+    }
+
+    void test_connect_from_another_thread_during_emit() {
+        sig::signal<void ()> signal;
+
+        int calls = 0;
+        signal.connect([&calls]() { ++calls; });
+
+        /* Slots run on the emitting thread, and may run just after they
+         * were disconnected, so this has to outlive the thread */
+        int other_calls = 0;
+
+        thread::Atomic<bool> done(false);
+        thread::Thread t([&]() {
+            for(uint32_t i = 0; i < 1000; ++i) {
+                auto conn = signal.connect([&other_calls]() { ++other_calls; });
+                signal.connect([]() {}).disconnect(); // Reuses the overflow slots
+                conn.disconnect();
+            }
+
+            done = true;
+        });
+
+        /* The thread may finish before we get going, so emit a fixed number
+         * of times as well as until it's done */
+        uint32_t emits = 0;
+        while(emits < 1000 || !done) {
+            signal();
+            ++emits;
+        }
+
+        t.join();
+
+        assert_equal(int(emits), calls);
+        assert_equal(1u, signal.connection_count());
+    }
+};
+
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdio>
+#include <fstream>
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/sound_drivers/software_sound_driver.h"
+
+namespace {
+
+using namespace smlt;
+
+class RecordingSink : public AudioSink {
+public:
+    std::vector<int16_t> samples;
+
+    bool open(uint32_t) override { return true; }
+
+    void write(const int16_t* data, uint32_t frames) override {
+        samples.insert(samples.end(), data, data + frames * 2);
+    }
+};
+
+class SoftwareSoundDriverTests : public smlt::test::SimulantTestCase {
+public:
+    std::shared_ptr<RecordingSink> sink_;
+
+    std::shared_ptr<SoftwareSoundDriver> make_driver(uint32_t voices=SoftwareSoundDriver::DEFAULT_VOICE_COUNT) {
+        sink_ = std::make_shared<RecordingSink>();
+        auto driver = std::make_shared<SoftwareSoundDriver>(window, sink_, voices);
+        driver->startup();
+        return driver;
+    }
+
+    /* Starts a source playing a constant mono tone */
+    AudioSourceID play_tone(SoftwareSoundDriver* driver, int16_t value, uint32_t frames, uint32_t frequency=44100) {
+        std::vector<int16_t> data(frames, value);
+
+        auto source = driver->generate_sources(1).back();
+        auto buffer = driver->generate_buffers(1).back();
+        driver->upload_buffer_data(buffer, AUDIO_DATA_FORMAT_MONO16, (uint8_t*) &data[0], data.size() * sizeof(int16_t), frequency);
+        driver->queue_buffers_to_source(source, 1, {buffer});
+        driver->play_source(source);
+        return source;
+    }
+
+    void test_ambient_source_is_centred() {
+        auto driver = make_driver();
+        auto source = play_tone(driver.get(), 10000, 1000);
+        driver->set_source_as_ambient(source);
+
+        driver->mix(100);
+
+        assert_equal(200u, sink_->samples.size());
+        assert_close(7071, sink_->samples[0], 2);
+        assert_close(7071, sink_->samples[1], 2);
+    }
+
+    void test_positional_source_is_panned_and_attenuated() {
+        auto driver = make_driver();
+        driver->set_listener_properties(Vec3(), Quaternion(), Vec3());
+
+        auto source = play_tone(driver.get(), 10000, 1000);
+        driver->set_source_reference_distance(source, 1.0f);
+        driver->set_source_properties(source, Vec3(2, 0, 0), Quaternion(), Vec3());
+
+        driver->mix(10);
+
+        // Hard right, at half volume
+        assert_close(0, sink_->samples[0], 2);
+        assert_close(5000, sink_->samples[1], 2);
+    }
+
+    void test_source_stops_when_buffers_run_out() {
+        auto driver = make_driver();
+        auto source = play_tone(driver.get(), 1000, 100);
+
+        driver->mix(50);
+        assert_equal(AUDIO_SOURCE_STATE_PLAYING, driver->source_state(source));
+        assert_equal(0, driver->source_buffers_processed_count(source));
+
+        driver->mix(50);
+        assert_equal(AUDIO_SOURCE_STATE_STOPPED, driver->source_state(source));
+        assert_equal(1, driver->source_buffers_processed_count(source));
+        assert_equal(1u, driver->unqueue_buffers_from_source(source, 1).size());
+    }
+
+    void test_resampling() {
+        auto driver = make_driver();
+        auto source = play_tone(driver.get(), 1000, 100, 22050);
+
+        // Half the rate, so it lasts twice as long
+        driver->mix(150);
+        assert_equal(AUDIO_SOURCE_STATE_PLAYING, driver->source_state(source));
+
+        driver->mix(50);
+        assert_equal(AUDIO_SOURCE_STATE_STOPPED, driver->source_state(source));
+    }
+
+    void test_voices_are_limited_by_distance_and_priority() {
+        auto driver = make_driver(2);
+        driver->set_listener_properties(Vec3(), Quaternion(), Vec3());
+
+        std::vector<AudioSourceID> sources;
+        for(int i = 0; i < 4; ++i) {
+            auto source = play_tone(driver.get(), 1000, 10000);
+            driver->set_source_properties(source, Vec3(0, 0, -(i + 1) * 10.0f), Quaternion(), Vec3());
+            sources.push_back(source);
+        }
+
+        driver->mix(10);
+        assert_equal(2u, driver->real_voice_count());
+        assert_equal(2u, driver->virtual_voice_count());
+
+        // The nearest two are heard
+        assert_false(driver->is_source_virtual(sources[0]));
+        assert_false(driver->is_source_virtual(sources[1]));
+        assert_true(driver->is_source_virtual(sources[3]));
+
+        driver->set_source_priority(sources[3], 1);
+        driver->mix(10);
+
+        assert_false(driver->is_source_virtual(sources[3]));
+        assert_false(driver->is_source_virtual(sources[0]));
+        assert_true(driver->is_source_virtual(sources[1]));
+    }
+
+    void test_virtual_voices_keep_time() {
+        auto driver = make_driver(1);
+
+        auto heard = play_tone(driver.get(), 1000, 100);
+        driver->set_source_priority(heard, 1);
+
+        auto silent = play_tone(driver.get(), 1000, 100);
+
+        driver->mix(100);
+        assert_true(driver->is_source_virtual(silent));
+        assert_equal(AUDIO_SOURCE_STATE_STOPPED, driver->source_state(heard));
+        assert_equal(AUDIO_SOURCE_STATE_STOPPED, driver->source_state(silent));
+    }
+
+    void test_buffers_are_pooled() {
+        auto driver = make_driver();
+
+        auto buffer = driver->generate_buffers(1).back();
+        std::vector<int16_t> data(1024, 0);
+        driver->upload_buffer_data(buffer, AUDIO_DATA_FORMAT_MONO16, (uint8_t*) &data[0], data.size() * sizeof(int16_t), 44100);
+        driver->destroy_buffers({buffer});
+
+        auto recycled = driver->generate_buffers(1).back();
+        assert_equal(buffer, recycled);
+        assert_true(driver->buffer(recycled)->samples.capacity() >= 1024u);
+    }
+
+    void test_wav_sink() {
+        const std::string path = "test_software_sound_driver.wav";
+
+        {
+            auto driver = std::make_shared<SoftwareSoundDriver>(window, std::make_shared<WAVAudioSink>(path));
+            driver->startup();
+            play_tone(driver.get(), 1000, 500);
+            driver->mix(441);
+            driver->shutdown();
+        }
+
+        std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+        assert_true(file.good());
+        assert_equal(44 + 441 * 4, (int) file.tellg());
+        file.close();
+
+        std::remove(path.c_str());
+    }
+};
+
+}
@@ -4,6 +4,9 @@
 #include <cstdlib>
 #include "simulant/simulant.h"
 #include "simulant/test.h"
+#include "simulant/audio_stream.h"
+#include "simulant/threads/atomic.h"
+#include "simulant/sound_drivers/null_sound_driver.h"
 
 
 class SoundTest : public smlt::test::SimulantTestCase {
@@ -86,4 +89,176 @@ private:
     smlt::StagePtr stage_;
 
 };
+/* Produces silence, but only decodes while the gate is open */
+class GatedStream : public smlt::AudioStream {
+public:
+    GatedStream(std::size_t chunk_bytes, uint32_t chunks):
+        smlt::AudioStream(smlt::AUDIO_DATA_FORMAT_MONO16, 22050, chunk_bytes),
+        remaining_(chunks) {}
+
+    smlt::thread::Atomic<bool> open = {true};
+
+private:
+    std::size_t decode(uint8_t* out, std::size_t max_bytes) override {
+        while(!open) {
+            smlt::thread::sleep(1);
+        }
+
+        if(!remaining_) {
+            return 0;
+        }
+
+        --remaining_;
+        std::fill(out, out + max_bytes, 0);
+        return max_bytes;
+    }
+
+    uint32_t remaining_;
+};
+
+class AudioStreamTest : public smlt::test::SimulantTestCase {
+public:
+    void set_up() {
+        SimulantTestCase::set_up();
+        stage_ = window->new_stage();
+    }
+
+    void tear_down() {
+        SimulantTestCase::tear_down();
+        window->destroy_stage(stage_->id());
+    }
+
+    void test_ring_buffer() {
+        smlt::PCMRingBuffer ring(2, 16);
+
+        auto a = ring.begin_write();
+        assert_is_not_null(a);
+        a[0] = 1;
+        ring.end_write(16);
+
+        auto b = ring.begin_write();
+        assert_is_not_null(b);
+        b[0] = 2;
+        ring.end_write(8);
+
+        // Full
+        assert_is_null(ring.begin_write());
+        assert_equal(2u, ring.ready_count());
+
+        std::size_t bytes = 0;
+        auto r = ring.begin_read(&bytes);
+        assert_equal(1, r[0]);
+        assert_equal(16u, bytes);
+        ring.end_read();
+
+        r = ring.begin_read(&bytes);
+        assert_equal(2, r[0]);
+        assert_equal(8u, bytes);
+        ring.end_read();
+
+        assert_is_null(ring.begin_read(&bytes));
+        assert_is_not_null(ring.begin_write());
+    }
+
+    void test_stream_thread_decodes_ahead() {
+        smlt::NullSoundDriver driver(window);
+        auto buffer = driver.generate_buffers(1).back();
+
+        auto thread = std::make_shared<smlt::AudioStreamThread>();
+        auto stream = std::make_shared<GatedStream>(1024, 6);
+
+        {
+            smlt::AudioStreamHandle handle(thread, stream);
+            assert_equal(1u, thread->stream_count());
+
+            while(stream->ring().ready_count() < stream->ring().chunk_count()) {
+                smlt::thread::sleep(1);
+            }
+
+            for(int i = 0; i < 6; ++i) {
+                while(stream->queue_buffer(&driver, buffer) == smlt::STREAM_NOT_READY) {
+                    smlt::thread::sleep(1);
+                }
+            }
+
+            int32_t end = smlt::STREAM_NOT_READY;
+            while(end == smlt::STREAM_NOT_READY) {
+                end = stream->queue_buffer(&driver, buffer);
+            }
+
+            assert_equal(0, end);
+        }
+
+        assert_equal(0u, thread->stream_count());
+    }
+
+    void test_underruns_are_measurable() {
+        smlt::NullSoundDriver driver(window);
+        driver.set_playback_speed(100.0f);
+
+        auto sound = stage_->assets->new_sound_from_file("test_sound.ogg");
+        auto buffer_size = sound->buffer_size();
+        std::shared_ptr<GatedStream> stream;
+
+        sound->set_source_init_function([&stream, &driver, buffer_size](smlt::SourceInstance& source) {
+            stream = std::make_shared<GatedStream>(buffer_size, 20);
+            stream->prime(2);
+            stream->open = false;
+
+            auto handle = std::make_shared<smlt::AudioStreamHandle>(driver.stream_thread(), stream);
+            source.set_stream_func([handle, &driver](smlt::AudioBufferID buffer) -> int32_t {
+                return handle->stream()->queue_buffer(&driver, buffer);
+            });
+        });
+
+        smlt::Source source(stage_, &driver);
+        source.play_sound(sound->id());
+
+        // Let the driver chew through the primed buffers while the decoder is stalled
+        auto instance = source.instances_.front();
+        while(driver.source_state(instance->source_) == smlt::AUDIO_SOURCE_STATE_PLAYING) {
+            source.update_source(0.001f);
+            smlt::thread::sleep(1);
+        }
+
+        source.update_source(0.001f);
+        assert_true(stream->underrun_count() > 0);
+
+        // Still playing, as far as the outside world is concerned
+        assert_equal(1, source.playing_sound_count());
+
+        stream->open = true;
+        while(driver.underrun_count() == 0) {
+            source.update_source(0.001f);
+            smlt::thread::sleep(1);
+        }
+
+        instance.reset();
+        while(source.playing_sound_count()) {
+            source.update_source(0.001f);
+            smlt::thread::sleep(1);
+        }
+    }
+
+    void test_ogg_playback_without_underruns() {
+        smlt::NullSoundDriver driver(window);
+        driver.set_playback_speed(2.0f);
+
+        auto sound = stage_->assets->new_sound_from_file("test_sound.ogg");
+
+        smlt::Source source(stage_, &driver);
+        source.play_sound(sound->id());
+
+        while(source.playing_sound_count()) {
+            source.update_source(0.01f);
+            smlt::thread::sleep(10);
+        }
+
+        assert_equal(0u, driver.underrun_count());
+    }
+
+private:
+    smlt::StagePtr stage_;
+};
+
 #endif // TEST_SOUND_H
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cmath>
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/nodes/geoms/terrain_culler.h"
+
+namespace {
+
+using namespace smlt;
+
+class TerrainCullerTests : public smlt::test::SimulantTestCase {
+public:
+    void set_up() {
+        SimulantTestCase::set_up();
+        stage_ = window->new_stage();
+    }
+
+    void tear_down() {
+        window->destroy_stage(stage_->id());
+        SimulantTestCase::tear_down();
+    }
+
+    MeshPtr rolling_hills(uint32_t size, bool generate_mesh) {
+        std::vector<float> heights(size * size);
+        for(uint32_t z = 0; z < size; ++z) {
+            for(uint32_t x = 0; x < size; ++x) {
+                heights[(z * size) + x] = 0.5f + 0.25f * std::sin(x * 0.3f) * std::cos(z * 0.2f);
+            }
+        }
+
+        HeightmapSpecification spec;
+        spec.spacing = 1.0f;
+        spec.generate_mesh = generate_mesh;
+        return stage_->assets->new_mesh_from_heights(size, size, heights, spec);
+    }
+
+    uint32_t gather(GeomPtr geom, CameraPtr camera) {
+        batcher::RenderQueue queue;
+        queue.reset(stage_, window->renderer.get(), camera);
+        geom->culler->renderables_visible(camera->frustum(), &queue);
+        return queue.renderable_count();
+    }
+
+    void test_chunks_and_levels() {
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_TERRAIN;
+        options.terrain_chunk_size = 48; // Rounded down to 32
+
+        auto geom = stage_->new_geom_with_mesh(rolling_hills(129, false)->id(), options);
+        auto culler = dynamic_cast<TerrainCuller*>(geom->culler.get());
+        assert_true(culler);
+
+        assert_equal(4u, culler->chunks_across());
+        assert_equal(16u, culler->chunk_count());
+        assert_equal(6u, culler->lod_count());
+
+        // The mesh has no vertices, the bounds come from the heights
+        assert_close(-64.5f, geom->aabb().min().x, 0.001f);
+        assert_close(63.5f, geom->aabb().max().z, 0.001f);
+
+        for(uint32_t i = 0; i < culler->chunk_count(); ++i) {
+            assert_equal(0.0f, culler->chunk_error(i, 0));
+            for(uint32_t lod = 1; lod < culler->lod_count(); ++lod) {
+                assert_true(culler->chunk_error(i, lod) >= culler->chunk_error(i, lod - 1));
+            }
+        }
+    }
+
+    void test_near_chunks_are_finer() {
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_TERRAIN;
+        options.terrain_chunk_size = 16;
+
+        auto geom = stage_->new_geom_with_mesh(rolling_hills(257, false)->id(), options);
+        auto culler = dynamic_cast<TerrainCuller*>(geom->culler.get());
+
+        auto camera = stage_->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+        camera->move_to(-120, 10, -120);
+        camera->look_at(0, 0, 0);
+
+        culler->set_viewpoint(camera->absolute_position(), 240.0f);
+
+        // Each gather queues the levels it wants, and draws what's ready
+        assert_true(gather(geom, camera) > 0u);
+        for(uint32_t i = 0; i < 10; ++i) {
+            culler->wait_for_chunks();
+            gather(geom, camera);
+        }
+
+        uint32_t corner = 0;
+        uint32_t far_corner = culler->chunk_count() - 1;
+
+        assert_equal(0, culler->drawn_lod(corner));
+        assert_true(culler->drawn_lod(far_corner) > culler->drawn_lod(corner));
+
+        // Chunks behind the camera aren't drawn at all
+        camera->look_at(-200, 10, -200);
+        gather(geom, camera);
+        assert_equal(-1, culler->drawn_lod(far_corner));
+    }
+
+    void test_cameras_keep_each_others_levels() {
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_TERRAIN;
+        options.terrain_chunk_size = 16;
+
+        auto geom = stage_->new_geom_with_mesh(rolling_hills(257, false)->id(), options);
+        auto culler = dynamic_cast<TerrainCuller*>(geom->culler.get());
+
+        auto near = stage_->new_camera();
+        near->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+        near->move_to(-120, 10, -120);
+        near->look_at(0, 0, 0);
+
+        auto far = stage_->new_camera();
+        far->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+        far->move_to(120, 10, 120);
+        far->look_at(0, 0, 0);
+
+        uint32_t corner = 0;
+
+        for(uint32_t i = 0; i < 10; ++i) {
+            culler->set_viewpoint(near->absolute_position(), 240.0f);
+            gather(geom, near);
+            culler->wait_for_chunks();
+        }
+
+        assert_equal(0, culler->drawn_lod(corner));
+
+        // The far camera wants the corner much coarser, but the near one
+        // drew it recently
+        culler->set_viewpoint(far->absolute_position(), 240.0f);
+        gather(geom, far);
+        assert_true(culler->lod_built(corner, 0));
+
+        // Once nothing has used it for long enough it's released
+        for(uint32_t i = 0; i < TerrainCuller::RELEASE_AFTER_GATHERS + 1; ++i) {
+            culler->wait_for_chunks();
+            gather(geom, far);
+        }
+
+        assert_false(culler->lod_built(corner, 0));
+    }
+
+    void test_everything_is_full_detail_without_viewpoint() {
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_TERRAIN;
+        options.terrain_chunk_size = 16;
+
+        auto geom = stage_->new_geom_with_mesh(rolling_hills(33, true)->id(), options);
+        auto culler = dynamic_cast<TerrainCuller*>(geom->culler.get());
+
+        uint32_t count = 0;
+        geom->culler->each_renderable([&](Renderable* renderable) {
+            ++count;
+            assert_true(renderable->index_element_count > 0u);
+        });
+
+        assert_equal(4u, count);
+
+        auto camera = stage_->new_camera();
+        camera->set_perspective_projection(Degrees(90), 1.0, 1.0, 1000.0);
+        camera->move_to(0, 50, 50);
+        camera->look_at(0, 0, 0);
+
+        gather(geom, camera);
+        culler->wait_for_chunks();
+        assert_equal(4u, gather(geom, camera));
+
+        for(uint32_t i = 0; i < culler->chunk_count(); ++i) {
+            assert_equal(0, culler->drawn_lod(i));
+        }
+    }
+
+    void test_edges_match_coarser_neighbours() {
+        const uint32_t n = 8;
+
+        for(uint32_t step: {1u, 2u, 4u, 8u}) {
+            const uint32_t steps[4] = {step, 1, 1, 1};
+            auto indices = TerrainCuller::build_chunk_indices(n, steps);
+
+            // Every square is covered, and every triangle faces up
+            int32_t area = 0;
+            for(uint32_t i = 0; i < indices.size(); i += 3) {
+                int32_t ax = indices[i] % (n + 1), az = indices[i] / (n + 1);
+                int32_t bx = indices[i + 1] % (n + 1), bz = indices[i + 1] / (n + 1);
+                int32_t cx = indices[i + 2] % (n + 1), cz = indices[i + 2] / (n + 1);
+
+                int32_t y = (bz - az) * (cx - ax) - (bx - ax) * (cz - az);
+                assert_true(y > 0);
+                area += y;
+
+                // Only the neighbour's vertices are used along the -Z edge
+                for(auto idx: {indices[i], indices[i + 1], indices[i + 2]}) {
+                    if(idx <= n) {
+                        assert_equal(0u, idx % step);
+                    }
+                }
+            }
+
+            assert_equal(int32_t(n * n * 2), area);
+        }
+    }
+
+    void test_falls_back_without_terrain() {
+        auto mesh = stage_->assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", stage_->assets->new_material(), 1.0, 1.0);
+
+        GeomCullerOptions options;
+        options.type = GEOM_CULLER_TYPE_TERRAIN;
+        auto geom = stage_->new_geom_with_mesh(mesh->id(), options);
+
+        assert_false(dynamic_cast<TerrainCuller*>(geom->culler.get()));
+    }
+
+private:
+    StagePtr stage_;
+};
+
+}
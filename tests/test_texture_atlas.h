@@ -0,0 +1,222 @@
+#pragma once
+
+#include "simulant/simulant.h"
+#include "simulant/test.h"
+#include "simulant/texture_atlas.h"
+
+
+namespace {
+
+using namespace smlt;
+
+class TextureAtlasTests : public smlt::test::SimulantTestCase {
+public:
+    TexturePtr solid_texture(uint16_t w, uint16_t h, uint8_t value) {
+        auto tex = window->shared_assets->new_texture(w, h);
+        tex->set_free_data_mode(TEXTURE_FREE_DATA_NEVER);
+        tex->set_data(std::vector<uint8_t>(w * h * 4, value));
+        return tex;
+    }
+
+    void test_regions_do_not_overlap() {
+        TextureAtlasOptions opts;
+        opts.page_width = 128;
+        opts.page_height = 128;
+
+        TextureAtlas atlas(opts);
+        auto a = solid_texture(32, 32, 10);
+        auto b = solid_texture(16, 48, 20);
+        auto c = solid_texture(40, 8, 30);
+
+        assert_true(atlas.add_texture(a));
+        assert_true(atlas.add_texture(b));
+        assert_true(atlas.add_texture(c));
+        assert_true(atlas.pack());
+        assert_equal(1u, atlas.page_count());
+
+        std::vector<const AtlasRegion*> regions = {
+            atlas.region(a->id()), atlas.region(b->id()), atlas.region(c->id())
+        };
+
+        for(auto r: regions) {
+            assert_true(r);
+            assert_equal(0, r->x % opts.alignment);
+            assert_equal(0, r->y % opts.alignment);
+        }
+
+        for(uint32_t i = 0; i < regions.size(); ++i) {
+            for(uint32_t j = i + 1; j < regions.size(); ++j) {
+                auto r0 = regions[i];
+                auto r1 = regions[j];
+
+                bool separate = (
+                    r0->x + r0->width + opts.gutter <= r1->x ||
+                    r1->x + r1->width + opts.gutter <= r0->x ||
+                    r0->y + r0->height + opts.gutter <= r1->y ||
+                    r1->y + r1->height + opts.gutter <= r0->y
+                );
+
+                assert_true(separate);
+            }
+        }
+    }
+
+    void test_gutter_is_extruded() {
+        TextureAtlasOptions opts;
+        opts.page_width = 64;
+        opts.page_height = 64;
+
+        TextureAtlas atlas(opts);
+        auto a = solid_texture(8, 8, 200);
+        atlas.add_texture(a);
+        atlas.pack();
+
+        auto region = atlas.region(a->id());
+        auto& data = atlas.page_data(0);
+
+        // The pixel immediately to the left of the region is gutter
+        auto idx = ((region->y * opts.page_width) + (region->x - 1)) * 4;
+        assert_equal(200, data[idx]);
+    }
+
+    void test_overflow_creates_new_pages() {
+        TextureAtlasOptions opts;
+        opts.page_width = 64;
+        opts.page_height = 64;
+
+        TextureAtlas atlas(opts);
+        for(int i = 0; i < 6; ++i) {
+            atlas.add_texture(solid_texture(24, 24, i));
+        }
+
+        assert_true(atlas.pack());
+        assert_true(atlas.page_count() > 1);
+    }
+
+    void test_too_large_image_fails() {
+        TextureAtlasOptions opts;
+        opts.page_width = 32;
+        opts.page_height = 32;
+
+        TextureAtlas atlas(opts);
+        auto a = solid_texture(64, 8, 1);
+        atlas.add_texture(a);
+
+        assert_false(atlas.pack());
+        assert_false(atlas.has_region(a->id()));
+    }
+
+    void test_apply_to_mesh_remaps_uvs() {
+        TextureAtlasOptions opts;
+        opts.page_width = 128;
+        opts.page_height = 128;
+
+        auto tex = solid_texture(32, 32, 255);
+        auto mat = window->shared_assets->new_material_from_texture(tex->id());
+        auto mesh = window->shared_assets->new_mesh(VertexSpecification::DEFAULT);
+        mesh->new_submesh_as_rectangle("rect", mat, 1.0f, 1.0f);
+
+        TextureAtlas atlas(opts);
+        atlas.add_texture(solid_texture(16, 16, 0));
+        atlas.add_texture(tex);
+        atlas.build(window->shared_assets.get());
+
+        assert_equal(1u, atlas.apply_to_mesh(mesh));
+
+        auto region = atlas.region(tex->id());
+        auto sm = mesh->first_submesh();
+
+        auto uv = *mesh->vertex_data->texcoord0_at<Vec2>(sm->index_data->at(0));
+        assert_true(uv.x >= region->uv_min.x && uv.x <= region->uv_max.x);
+        assert_true(uv.y >= region->uv_min.y && uv.y <= region->uv_max.y);
+
+        assert_equal(
+            atlas.page_texture(region->page)->id(),
+            sm->material()->pass(0)->diffuse_map()->texture_id()
+        );
+    }
+
+    void test_apply_to_sprite() {
+        TextureAtlasOptions opts;
+        opts.page_width = 128;
+        opts.page_height = 128;
+
+        auto stage = window->new_stage();
+
+        auto tex = stage->assets->new_texture(32, 32);
+        tex->set_free_data_mode(TEXTURE_FREE_DATA_NEVER);
+        tex->set_data(std::vector<uint8_t>(32 * 32 * 4, 255));
+
+        auto sprite = stage->sprites->new_sprite_from_texture(tex->id(), 32, 32);
+        auto other = stage->sprites->new_sprite_from_texture(solid_texture(8, 8, 0)->id(), 8, 8);
+
+        TextureAtlas atlas(opts);
+        atlas.add_texture(solid_texture(16, 16, 0));
+        atlas.add_texture(tex);
+        atlas.build(stage->assets.get());
+
+        assert_true(atlas.apply_to_sprite(sprite));
+        assert_false(atlas.apply_to_sprite(other)); // Its texture wasn't added
+
+        auto region = atlas.region(tex->id());
+        auto page = atlas.page_texture(region->page);
+
+        auto material = stage->assets->material(sprite->material_id());
+        assert_equal(page->id(), material->pass(0)->diffuse_map()->texture_id());
+
+        // The corners are half a texel inside the region
+        auto mesh = sprite->actor->base_mesh();
+        auto first = *mesh->vertex_data->texcoord0_at<Vec2>(0);
+        auto third = *mesh->vertex_data->texcoord0_at<Vec2>(2);
+
+        const float w = opts.page_width, h = opts.page_height;
+        assert_close((region->x + 0.5f) / w, first.x, 0.0001f);
+        assert_close((region->y + 0.5f) / h, first.y, 0.0001f);
+        assert_close((region->x + region->width - 0.5f) / w, third.x, 0.0001f);
+        assert_close((region->y + region->height - 0.5f) / h, third.y, 0.0001f);
+
+        window->destroy_stage(stage->id());
+    }
+
+    void test_apply_to_font() {
+        TextureAtlasOptions opts;
+        opts.page_width = 1024;
+        opts.page_height = 1024;
+
+        /* A fresh copy of the default font, so others using it aren't affected */
+        auto assets = window->shared_assets.get();
+        auto font = assets->new_font_from_file(assets->default_font_filename(DEFAULT_FONT_STYLE_BODY));
+
+        auto font_texture = assets->texture(font->texture_id());
+        font_texture->set_free_data_mode(TEXTURE_FREE_DATA_NEVER);
+
+        const float old_width = font_texture->width();
+        const float old_height = font_texture->height();
+        auto before = font->texture_coordinates_for_character('A');
+
+        TextureAtlas atlas(opts);
+        atlas.add_texture(solid_texture(16, 16, 0));
+        assert_true(atlas.add_font(font));
+        assert_true(atlas.build(assets));
+
+        assert_true(atlas.apply_to_font(font));
+
+        auto region = atlas.region(font_texture->id());
+        auto page = atlas.page_texture(region->page);
+
+        assert_equal(page->id(), font->texture_id());
+        assert_equal(page->id(), assets->material(font->material_id())->pass(0)->diffuse_map()->texture_id());
+
+        // The glyph is in the same place, relative to the font's region
+        auto after = font->texture_coordinates_for_character('A');
+
+        const float w = opts.page_width, h = opts.page_height;
+        assert_close((region->x + before.first.x * old_width) / w, after.first.x, 0.0001f);
+        assert_close((region->y + before.first.y * old_height) / h, after.first.y, 0.0001f);
+        assert_close((region->x + before.second.x * old_width) / w, after.second.x, 0.0001f);
+        assert_close((region->y + before.second.y * old_height) / h, after.second.y, 0.0001f);
+    }
+};
+
+
+}
@@ -4,6 +4,7 @@
 #include "simulant/test.h"
 
 #include "simulant/threads/future.h"
+#include "simulant/threads/thread_pool.h"
 
 namespace {
 
@@ -44,6 +45,106 @@ public:
         assert_true(promise.is_ready());
         assert_true(promise.is_failed());
     }
+
+    void test_thread_pool_parallel_for() {
+        ThreadPool pool(3);
+
+        std::vector<int> values(1000, 0);
+        pool.parallel_for(values.size(), 16, [&values](std::size_t begin, std::size_t end) {
+            for(auto i = begin; i < end; ++i) {
+                values[i] += 1;
+            }
+        });
+
+        for(auto v: values) {
+            assert_equal(1, v);
+        }
+
+        /* No workers runs everything inline */
+        ThreadPool inline_pool(0);
+        std::size_t total = 0;
+        inline_pool.parallel_for(10, 1, [&total](std::size_t begin, std::size_t end) {
+            total += end - begin;
+        });
+
+        assert_equal(10u, total);
+    }
+
+    void test_thread_pool_submit() {
+        ThreadPool pool(2);
+
+        Mutex lock;
+        Condition done;
+        int count = 0;
+
+        for(int i = 0; i < 10; ++i) {
+            pool.submit([&]() {
+                Lock<Mutex> g(lock);
+                if(++count == 10) {
+                    done.notify_all();
+                }
+            });
+        }
+
+        {
+            Lock<Mutex> g(lock);
+            while(count < 10) {
+                done.wait(lock);
+            }
+        }
+
+        assert_equal(10, count);
+
+        /* No workers runs the task before submit returns */
+        ThreadPool inline_pool(0);
+        bool ran = false;
+        inline_pool.submit([&ran]() { ran = true; });
+        assert_true(ran);
+    }
+
+    void test_parallel_for_leaves_submitted_tasks_to_workers() {
+        ThreadPool pool(1);
+
+        Mutex lock;
+        Condition released;
+        bool release = false;
+        bool caller_ran_task = false;
+
+        auto caller = this_thread_id();
+
+        /* Keeps the only worker busy */
+        pool.submit([&]() {
+            Lock<Mutex> g(lock);
+            while(!release) {
+                released.wait(lock);
+            }
+        });
+
+        /* Queued behind it, like a terrain build */
+        pool.submit([&]() {
+            Lock<Mutex> g(lock);
+            caller_ran_task = (this_thread_id() == caller);
+        });
+
+        std::vector<int> values(100, 0);
+        pool.parallel_for(values.size(), 10, [&values](std::size_t begin, std::size_t end) {
+            for(auto i = begin; i < end; ++i) {
+                values[i] += 1;
+            }
+        });
+
+        /* The caller did every chunk itself, and nothing else */
+        for(auto v: values) {
+            assert_equal(1, v);
+        }
+
+        {
+            Lock<Mutex> g(lock);
+            assert_false(caller_ran_task);
+            release = true;
+            released.notify_all();
+        }
+    }
 };
 
 }
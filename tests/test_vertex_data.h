@@ -1,6 +1,8 @@
 #ifndef TEST_VERTEX_DATA_H
 #define TEST_VERTEX_DATA_H
 
+#include <cmath>
+
 #include "simulant/simulant.h"
 #include "simulant/test.h"
 
@@ -182,6 +184,130 @@ public:
         // sizeof(float) * 10 + sizeof(byte) * 8, but rounded to the nearest 16 byte boundary == 64
         assert_equal(64u, data.data_size());
     }
+
+    void test_half_float_conversion() {
+        for(auto f: {0.0f, 1.0f, -2.5f, 0.333f, 1024.5f, 65504.0f}) {
+            assert_close(f, smlt::half_to_float(smlt::float_to_half(f)), std::abs(f) * 0.001f);
+        }
+
+        // Denormals survive, values too large become infinity
+        assert_close(0.00001f, smlt::half_to_float(smlt::float_to_half(0.00001f)), 0.0000001f);
+        assert_true(std::isinf(smlt::half_to_float(smlt::float_to_half(100000.0f))));
+        assert_equal(0x3C00, smlt::float_to_half(1.0f));
+    }
+
+    void test_compact_attributes() {
+        smlt::VertexSpecification spec;
+        spec.position_attribute = smlt::VERTEX_ATTRIBUTE_4H;
+        spec.normal_attribute = smlt::VERTEX_ATTRIBUTE_4B;
+        spec.texcoord0_attribute = smlt::VERTEX_ATTRIBUTE_2H;
+        spec.texcoord1_attribute = smlt::VERTEX_ATTRIBUTE_2US;
+
+        // 8 + 4 + 4 + 4 bytes, rounded up to 32
+        assert_equal(32u, spec.stride());
+
+        smlt::VertexData data(spec);
+        data.position(1.5f, -2.0f, 100.0f);
+        data.normal(smlt::Vec3(0.6f, -0.8f, 0.0f));
+        data.tex_coord0(4.25f, -1.0f);
+        data.tex_coord1(0.25f, 1.0f);
+        data.move_next();
+        data.done();
+
+        auto p = data.position_nd_at(0);
+        assert_close(1.5f, p.x, 0.001f);
+        assert_close(-2.0f, p.y, 0.001f);
+        assert_close(100.0f, p.z, 0.001f);
+        assert_close(1.0f, p.w, 0.001f);
+
+        auto n = data.normal_at<smlt::Vec3>(0);
+        assert_close(0.6f, n->x, 0.01f);
+        assert_close(-0.8f, n->y, 0.01f);
+        assert_close(0.0f, n->z, 0.01f);
+
+        auto uv0 = data.attribute_nd_at(smlt::VERTEX_ATTRIBUTE_TYPE_TEXCOORD0, 0);
+        assert_close(4.25f, uv0.x, 0.001f);
+        assert_close(-1.0f, uv0.y, 0.001f);
+
+        auto uv1 = data.attribute_nd_at(smlt::VERTEX_ATTRIBUTE_TYPE_TEXCOORD1, 0);
+        assert_close(0.25f, uv1.x, 0.0001f);
+        assert_close(1.0f, uv1.y, 0.0001f);
+    }
+
+    void test_transform_half_float_positions() {
+        smlt::VertexSpecification spec;
+        spec.position_attribute = smlt::VERTEX_ATTRIBUTE_2H;
+
+        smlt::VertexData data(spec);
+        data.position(1.0f, 2.0f);
+        data.move_next();
+
+        data.transform_by(smlt::Mat4::as_translation(smlt::Vec3(1.0f, -1.0f, 0.0f)));
+
+        auto p = data.position_nd_at(0);
+        assert_close(2.0f, p.x, 0.001f);
+        assert_close(1.0f, p.y, 0.001f);
+    }
+
+    smlt::VertexSpecification float_specification() {
+        // DEFAULT, but with float normals everywhere
+        smlt::VertexSpecification spec = smlt::VertexSpecification::DEFAULT;
+        spec.normal_attribute = smlt::VERTEX_ATTRIBUTE_3F;
+        return spec;
+    }
+
+    void test_repack() {
+        smlt::VertexData data(float_specification());
+
+        for(auto i = 0; i < 3; ++i) {
+            data.position(i, i * 2, i * 3);
+            data.normal(smlt::Vec3(0, 1, 0));
+            data.tex_coord0(i * 0.5f, 1.0f);
+            data.diffuse(smlt::Colour(1.0f, 0.5f, 0.0f, 1.0f));
+            data.move_next();
+        }
+
+        auto before = data.data_size();
+        data.repack(smlt::VertexSpecification::COMPACT);
+
+        assert_true(data.vertex_specification() == smlt::VertexSpecification::COMPACT);
+        assert_equal(3u, data.count());
+        assert_true(data.data_size() < before);
+
+        for(auto i = 0; i < 3; ++i) {
+            assert_equal(smlt::Vec3(i, i * 2, i * 3), *data.position_at<smlt::Vec3>(i));
+            assert_close(1.0f, data.normal_at<smlt::Vec3>(i)->y, 0.01f);
+
+            auto uv = data.attribute_nd_at(smlt::VERTEX_ATTRIBUTE_TYPE_TEXCOORD0, i);
+            assert_close(i * 0.5f, uv.x, 0.001f);
+            assert_close(1.0f, uv.y, 0.001f);
+
+            auto colour = data.attribute_nd_at(smlt::VERTEX_ATTRIBUTE_TYPE_DIFFUSE, i);
+            assert_close(1.0f, colour.x, 0.01f);
+            assert_close(0.5f, colour.y, 0.01f);
+            assert_close(0.0f, colour.z, 0.01f);
+        }
+    }
+
+    void test_repack_on_load() {
+        smlt::MeshLoadOptions options;
+        options.repack_specification = smlt::VertexSpecification::COMPACT;
+
+        auto plain = window->shared_assets->new_mesh_from_file("cube.obj", float_specification());
+        auto compact = window->shared_assets->new_mesh_from_file("cube.obj", float_specification(), options);
+
+        auto spec = compact->vertex_data->vertex_specification();
+        if(window->renderer->supports_vertex_attribute(smlt::VERTEX_ATTRIBUTE_2H)) {
+            assert_true(spec == smlt::VertexSpecification::COMPACT);
+        } else {
+            // Falls back to floats when the renderer can't draw half floats
+            assert_equal(smlt::VERTEX_ATTRIBUTE_2F, (smlt::VertexAttribute) spec.texcoord0_attribute);
+        }
+
+        assert_equal(plain->vertex_data->count(), compact->vertex_data->count());
+        assert_true(compact->vertex_data->data_size() < plain->vertex_data->data_size());
+        assert_true(compact->aabb().max() == plain->aabb().max());
+    }
 };
 
 }
@@ -0,0 +1,64 @@
+#!/usr/bin/env python
+
+"""
+    Compares two JSON files written by simulant_benchmarks --json and
+    prints the change in median time for each benchmark. Returns non-zero
+    if anything got slower than the threshold.
+"""
+
+import argparse
+import json
+import sys
+
+
+parser = argparse.ArgumentParser(description="Compare two simulant_benchmarks results files")
+parser.add_argument("baseline", type=str, help="Results from before the change")
+parser.add_argument("current", type=str, help="Results from after the change")
+parser.add_argument("--threshold", type=float, default=5.0, help="Percentage slowdown to report as a regression")
+
+
+def load(path):
+    with open(path, "rt") as f:
+        data = json.load(f)
+
+    return data, dict((x["name"], x) for x in data["benchmarks"])
+
+
+def main():
+    args = parser.parse_args()
+
+    baseline_data, baseline = load(args.baseline)
+    current_data, current = load(args.current)
+
+    if baseline_data.get("seed") != current_data.get("seed"):
+        print("Warning: results were generated with different seeds")
+
+    regressions = 0
+
+    for name in sorted(set(baseline.keys()) | set(current.keys())):
+        if name not in baseline:
+            print("%-60s %12s" % (name, "new"))
+            continue
+
+        if name not in current:
+            print("%-60s %12s" % (name, "removed"))
+            continue
+
+        before = baseline[name]["p50_ns"]
+        after = current[name]["p50_ns"]
+        change = ((after - before) / before) * 100.0 if before else 0.0
+
+        flag = ""
+        if change > args.threshold:
+            flag = "  <-- slower"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "  faster"
+
+        print("%-60s %12.1fns -> %12.1fns %+7.1f%%%s" % (name, before, after, change, flag))
+
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
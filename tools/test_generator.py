@@ -8,10 +8,15 @@ parser = argparse.ArgumentParser(description="Generate C++ unit tests")
 parser.add_argument("--output", type=str, nargs=1, help="The output source file for the generated test main()", required=True)
 parser.add_argument("test_files", type=str, nargs="+", help="The list of C++ files containing your tests")
 parser.add_argument("--verbose", help="Verbose logging", action="store_true", default=False)
+parser.add_argument("--benchmarks", help="Generate a benchmark runner from BenchmarkCase subclasses", action="store_true", default=False)
 
 
 CLASS_REGEX = r"\s*class\s+(\w+)\s*([\:|,]\s*(?:public|private|protected)\s+[\w|::]+\s*)*"
 TEST_FUNC_REGEX = r"void\s+(?P<func_name>test_\S[^\(]+)\(\s*(void)?\s*\)"
+BENCHMARK_FUNC_REGEX = r"void\s+(?P<func_name>bench_\S[^\(]+)\(\s*(void)?\s*\)"
+
+TEST_BASE_CLASSES = ("TestCase", "SimulantTestCase")
+BENCHMARK_BASE_CLASSES = ("BenchmarkCase", "SimulantBenchmarkCase")
 
 
 INCLUDE_TEMPLATE = "#include \"%(file_path)s\""
@@ -84,6 +89,90 @@ int main(int argc, char* argv[]) {
 }
 
 
+"""
+
+BENCHMARK_MAIN_TEMPLATE = """
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <map>
+
+#include "simulant/benchmark.h"
+
+%(includes)s
+
+
+std::map<std::string, std::string> parse_args(int argc, char* argv[]) {
+    std::map<std::string, std::string> ret;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        auto eq = arg.find('=');
+        if(eq != std::string::npos && arg[0] == '-' && arg[1] == '-') {
+            auto key = std::string(arg.begin(), arg.begin() + eq);
+            auto value = std::string(arg.begin() + eq + 1, arg.end());
+            ret[key] = value;
+        } else if(arg[0] == '-' && arg[1] == '-') {
+            auto key = arg;
+            if(i < (argc - 1)) {
+                auto value = argv[++i];
+                ret[key] = value;
+            } else {
+                ret[key] = "";
+            }
+        } else {
+            ret[arg] = "";  // Positional, not key=value
+        }
+    }
+
+    return ret;
+}
+
+std::string take_arg(std::map<std::string, std::string>& args, const std::string& key) {
+    auto it = args.find(key);
+    if(it == args.end()) {
+        return "";
+    }
+
+    auto value = it->second;
+    args.erase(it);
+    return value;
+}
+
+int main(int argc, char* argv[]) {
+    auto runner = std::make_shared<smlt::test::BenchmarkRunner>();
+
+    auto args = parse_args(argc, argv);
+
+    smlt::test::BenchmarkOptions options;
+
+    std::string json = take_arg(args, "--json");
+
+    std::string value = take_arg(args, "--seed");
+    if(!value.empty()) options.seed = (uint32_t) std::strtoul(value.c_str(), nullptr, 10);
+
+    value = take_arg(args, "--repetitions");
+    if(!value.empty()) options.repetitions = std::max(1, std::atoi(value.c_str()));
+
+    value = take_arg(args, "--warmup");
+    if(!value.empty()) options.warmup_runs = std::max(0, std::atoi(value.c_str()));
+
+    value = take_arg(args, "--min-time-us");
+    if(!value.empty()) options.min_repetition_us = (uint64_t) std::strtoull(value.c_str(), nullptr, 10);
+
+    std::string benchmark;
+    if(args.size()) {
+        benchmark = args.begin()->first;
+    }
+
+    %(registrations)s
+
+    return runner->run(benchmark, options, json);
+}
+
+
 """
 
 VERBOSE = False
@@ -93,7 +182,7 @@ def log_verbose(message):
         print(message)
 
 
-def find_tests(files):
+def find_tests(files, func_regex=TEST_FUNC_REGEX, base_classes=TEST_BASE_CLASSES):
 
     subclasses = []
 
@@ -146,7 +235,7 @@ def find_tests(files):
                     class_data = "".join(class_data)
 
                     while True:
-                        match = re.search(TEST_FUNC_REGEX, class_data)
+                        match = re.search(func_regex, class_data)
                         if not match:
                             break
 
@@ -165,7 +254,7 @@ def find_tests(files):
 
         # If this subclasses TestCase, or it subclasses any of the already found testcase subclasses
         # then add it to the list
-        if "TestCase" in subclass_names or "SimulantTestCase" in subclass_names or any(x[1] in subclasses[i][2] for x in test_case_subclasses):
+        if any(x in subclass_names for x in base_classes) or any(x[1] in subclasses[i][2] for x in test_case_subclasses):
             if subclasses[i] not in test_case_subclasses:
                 test_case_subclasses.append(subclasses[i])
 
@@ -184,7 +273,12 @@ def main():
 
     VERBOSE = args.verbose
 
-    testcases = find_tests(args.test_files)
+    if args.benchmarks:
+        testcases = find_tests(args.test_files, BENCHMARK_FUNC_REGEX, BENCHMARK_BASE_CLASSES)
+        template = BENCHMARK_MAIN_TEMPLATE
+    else:
+        testcases = find_tests(args.test_files)
+        template = MAIN_TEMPLATE
 
     includes = "\n".join([ INCLUDE_TEMPLATE % { 'file_path' : x } for x in set([y[0] for y in testcases]) ])
     registrations = []
@@ -199,7 +293,7 @@ def main():
 
     registrations = "\n".join(registrations)
 
-    final = MAIN_TEMPLATE % {
+    final = template % {
         'registrations' : registrations,
         'includes' : includes
     }